@@ -0,0 +1,49 @@
+# frozen_string_literal: true
+
+require 'benchmark/ips'
+
+$LOAD_PATH.unshift File.expand_path('../lib', __dir__)
+require 'cataract'
+
+# Regression benchmark for the inputs scripts/fuzzer/complexity.rb found to
+# scale superlinearly. Each fixture's header names the operation to time.
+
+FIXTURES = Dir.glob(File.expand_path('fixtures/complexity/*.css', __dir__)).sort
+
+OPERATIONS = {
+  'parse' => ->(css, _sheet) { Cataract.parse_css(css) },
+  'flatten' => ->(_css, sheet) { sheet.flatten },
+  'to_s' => ->(_css, sheet) { sheet.to_s },
+  'to_formatted_s' => ->(_css, sheet) { sheet.to_formatted_s },
+  'scopes' => lambda { |_css, sheet|
+    sheet.with_media(:screen).to_a
+    sheet.with_selector('.s0-0').to_a
+    sheet.with_property('color').base_only.to_a
+  }
+}.freeze
+
+abort 'No fixtures in benchmarks/fixtures/complexity - run rake fuzz:complexity first' if FIXTURES.empty?
+
+puts '=' * 60
+puts 'Complexity Regression Fixtures'
+puts '=' * 60
+puts ''
+
+cases = FIXTURES.map do |path|
+  css = File.read(path)
+  operation = css[/operation=(\S+)/, 1]
+  raise "#{File.basename(path)}: unknown operation #{operation.inspect}" unless OPERATIONS.key?(operation)
+
+  sheet = Cataract.parse_css(css)
+  puts "  #{File.basename(path)}: #{css.bytesize} bytes, #{sheet.size} rules"
+  [File.basename(path, '.css'), OPERATIONS[operation], css, sheet]
+end
+puts ''
+
+Benchmark.ips do |x|
+  x.config(time: 5, warmup: 2)
+
+  cases.each do |name, operation, css, sheet|
+    x.report(name) { operation.call(css, sheet) }
+  end
+end
@@ -0,0 +1,209 @@
+# frozen_string_literal: true
+
+# Soak benchmark - parses randomized but realistic CSS for a fixed duration and
+# samples process memory over time, failing if any of it keeps growing.
+#
+# Usage:
+#   ruby benchmarks/benchmark_soak.rb [duration_seconds=60] [seed]
+#
+# Environment:
+#   SOAK_SAMPLES  - Number of samples over the run (default 30)
+#   SOAK_CSV      - Write the samples to this CSV file
+#
+# Each iteration generates a stylesheet with fresh class names, custom
+# properties, keyframe names and @media breakpoints, then parses, flattens,
+# serializes and queries it. A full GC runs before every sample so the numbers
+# are what stays reachable, not garbage that has not been collected yet.
+#
+# The first quarter of the run is warmup. The remaining samples are split in
+# two halves and the median of the later half is compared to the earlier one;
+# growth beyond the tolerance for any metric is reported as unbounded and the
+# script exits 1. Memory that plateaus passes, memory that climbs does not.
+
+$LOAD_PATH.unshift File.expand_path('../lib', __dir__)
+require 'cataract'
+
+DURATION = (ARGV[0] || 60).to_f
+SEED = (ARGV[1] || Random.new_seed % 100_000).to_i
+SAMPLES = (ENV['SOAK_SAMPLES'] || 30).to_i
+RNG = Random.new(SEED)
+WARMUP = 0.25
+
+# Allowed growth from the earlier to the later half of the samples. Symbols are
+# absolute since a steady state should not create any; the rest are relative.
+TOLERANCES = {
+  rss_kb: 0.20,
+  heap_live_slots: 0.10,
+  heap_available_slots: 0.10,
+  symbols: 200
+}.freeze
+
+PROPERTIES = {
+  'color' => -> { color },
+  'background' => -> { "#{color} url(img/#{word}.png) no-repeat" },
+  'margin' => -> { Array.new(RNG.rand(1..4)) { length }.join(' ') },
+  'padding' => -> { Array.new(RNG.rand(1..4)) { length }.join(' ') },
+  'font' => -> { "#{RNG.rand(10..24)}px/1.5 #{%w[Arial Georgia sans-serif].sample(random: RNG)}" },
+  'border' => -> { "#{RNG.rand(1..3)}px solid #{color}" },
+  'width' => -> { "calc(100% - #{length})" },
+  'display' => -> { %w[block flex grid none inline-block].sample(random: RNG) },
+  'transition' => -> { "opacity #{RNG.rand(100..500)}ms ease-in-out" }
+}.freeze
+
+def word
+  Array.new(RNG.rand(3..8)) { ('a'..'z').to_a.sample(random: RNG) }.join
+end
+
+def color
+  format('#%06x', RNG.rand(0xffffff))
+end
+
+def length
+  "#{RNG.rand(0..64)}#{%w[px em rem %].sample(random: RNG)}"
+end
+
+def selector
+  base = ".#{word}-#{RNG.rand(10_000)}"
+  case RNG.rand(5)
+  when 0 then "#{base} > #{%w[a li span p].sample(random: RNG)}"
+  when 1 then "#{base}:hover"
+  when 2 then "#{base}[data-#{word}=\"#{word}\"]"
+  when 3 then "##{word} #{base}"
+  else base
+  end
+end
+
+def declarations(count)
+  Array.new(count) do
+    name, value = PROPERTIES.to_a.sample(random: RNG)
+    "#{name}: #{value.call}#{' !important' if RNG.rand(10).zero?}"
+  end.join('; ')
+end
+
+def rule
+  selectors = Array.new(RNG.rand(1..3)) { selector }.join(', ')
+  body = declarations(RNG.rand(1..6))
+  body += "; & .#{word} { #{declarations(RNG.rand(1..3))} }" if RNG.rand(6).zero?
+  "#{selectors} { #{body} }"
+end
+
+def media_query
+  case RNG.rand(4)
+  when 0 then "screen and (min-width: #{RNG.rand(200..2000)}px)"
+  when 1 then "(max-width: #{RNG.rand(200..2000)}px) and (orientation: #{%w[portrait landscape].sample(random: RNG)})"
+  when 2 then "print and (min-resolution: #{RNG.rand(1..3)}dppx)"
+  else "#{word} and (min-height: #{RNG.rand(100..1000)}px)"
+  end
+end
+
+def stylesheet
+  parts = [":root { --#{word}: #{color}; --#{word}: #{length} }"]
+  RNG.rand(20..60).times do
+    parts << case RNG.rand(12)
+             when 0..1 then "@media #{media_query} { #{Array.new(RNG.rand(1..4)) { rule }.join(' ')} }"
+             when 2 then "@supports (display: grid) { #{rule} }"
+             when 3 then "@keyframes #{word} { from { opacity: 0 } to { opacity: 1 } }"
+             when 4 then "@font-face { font-family: #{word}; src: url(fonts/#{word}.woff2) }"
+             else rule
+             end
+  end
+  parts.join("\n")
+end
+
+def rss_kb
+  status = File.read('/proc/self/status') if File.exist?('/proc/self/status')
+  return status[/^VmRSS:\s+(\d+)/, 1].to_i if status
+
+  `ps -o rss= -p #{Process.pid}`.to_i
+end
+
+def sample(elapsed, iterations)
+  GC.start
+  stat = GC.stat
+  {
+    elapsed: elapsed.round(1),
+    iterations: iterations,
+    rss_kb: rss_kb,
+    heap_live_slots: stat[:heap_live_slots],
+    heap_available_slots: stat[:heap_available_slots],
+    symbols: Symbol.all_symbols.size,
+    gc_count: stat[:count]
+  }
+end
+
+def median(values)
+  sorted = values.sort
+  (sorted[(sorted.size - 1) / 2] + sorted[sorted.size / 2]) / 2.0
+end
+
+def soak(interval)
+  samples = []
+  iterations = 0
+  start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+  next_sample = start
+
+  loop do
+    now = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    if now >= next_sample
+      samples << sample(now - start, iterations)
+      report(samples.last)
+      break if samples.size > SAMPLES
+
+      next_sample += interval
+    end
+
+    sheet = Cataract.parse_css(stylesheet)
+    sheet.to_s
+    sheet.flatten.to_formatted_s
+    sheet.with_media(sheet.media_index.keys.sample(random: RNG) || :all).to_a
+    sheet.with_property('color').to_a
+    iterations += 1
+  end
+
+  samples
+end
+
+def report(row)
+  puts format('%8.1fs %10d %10d KB %12d %12d %10d %6d', *row.values)
+end
+
+def growth(samples)
+  steady = samples.drop((samples.size * WARMUP).ceil)
+  earlier = steady.first(steady.size / 2)
+  later = steady.last(steady.size / 2)
+
+  TOLERANCES.filter_map do |metric, tolerance|
+    before = median(earlier.map { |row| row[metric] })
+    after = median(later.map { |row| row[metric] })
+    allowed = tolerance.is_a?(Float) ? before * tolerance : tolerance
+    next if after - before <= allowed
+
+    "#{metric} grew from #{before.round} to #{after.round} (allowed +#{allowed.round})"
+  end
+end
+
+puts '=' * 80
+puts 'Soak Benchmark'
+puts '=' * 80
+puts "Implementation: #{Cataract::IMPLEMENTATION}"
+puts "Duration: #{DURATION}s, #{SAMPLES} samples, seed #{SEED}"
+puts ''
+puts format('%9s %10s %13s %12s %12s %10s %6s', 'elapsed', 'iterations', 'rss', 'live slots', 'heap slots',
+            'symbols', 'gcs')
+
+samples = soak(DURATION / SAMPLES)
+
+if ENV['SOAK_CSV']
+  File.write(ENV['SOAK_CSV'], ([samples.first.keys.join(',')] + samples.map { |row| row.values.join(',') }).join("\n"))
+  puts "\nSamples written to #{ENV['SOAK_CSV']}"
+end
+
+failures = growth(samples)
+puts ''
+if failures.empty?
+  puts "No unbounded growth (#{samples.last[:iterations]} stylesheets)"
+else
+  puts 'Unbounded growth:'
+  failures.each { |failure| puts "  #{failure}" }
+  exit 1
+end
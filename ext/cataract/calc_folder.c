@@ -0,0 +1,731 @@
+/*
+ * calc_folder.c - Constant folding for calc(), min(), max() and clamp()
+ *
+ * Purpose: Compute math functions whose result is known at build time.
+ *
+ * Examples:
+ *   "calc(8px * 2)"                 => "16px"
+ *   "calc(100% - 0px)"              => "100%"
+ *   "calc(5px - 10px)"              => "calc(-5px)"
+ *   "calc(100% - (8px + 8px))"      => "calc(100% - 16px)"
+ *   "calc(var(--gap) + 2px + 2px)"  => "calc(var(--gap) + 4px)"
+ *   "min(10px, 1in)"                => "10px"
+ *   "clamp(1rem, calc(2rem * 2), 3rem)" => "3rem"
+ *   "min(10px, 2em)"                => unchanged (not comparable)
+ *   "calc(1in + 10mm)"              => unchanged (mixed units)
+ *
+ * Algorithm:
+ *   Each math expression is parsed into a sum of typed terms. Numeric terms
+ *   (number, percentage or dimension) with the same unit are added together;
+ *   sums of different units stay in calc() rather than being converted to
+ *   rounded px/deg/s values. Anything that can't
+ *   be computed (var(), env(), unknown functions, products of two dimensions)
+ *   becomes an opaque term that is carried through with a coefficient.
+ *
+ *   min()/max()/clamp() fold only when every argument reduces to a single
+ *   comparable numeric term; the winning argument is emitted in its own unit.
+ *
+ *   A negative result keeps its calc() wrapper: "padding: -5px" is invalid
+ *   and dropped, while "padding: calc(-5px)" is clamped to 0 by the browser.
+ *
+ *   The rewritten text replaces the original only when it is strictly shorter,
+ *   so expressions that can't be simplified keep their authored form.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cataract.h"
+
+#define CALC_MAX_TERMS 16
+#define CALC_MAX_ARGS 8
+#define CALC_MAX_DEPTH 16
+#define CALC_UNIT_MAX 8
+
+typedef struct {
+    int opaque;                 // 1 = uncomputable source text scaled by value
+    double value;               // Numeric value, or coefficient for opaque terms
+    char unit[CALC_UNIT_MAX];   // Lowercased unit: "" number, "%" percentage, "px", ...
+    VALUE text;                 // Opaque source text
+} calc_term;
+
+typedef struct {
+    int count;
+    calc_term terms[CALC_MAX_TERMS];
+} calc_sum;
+
+typedef struct {
+    const char *p;
+    const char *end;
+    int depth;
+    VALUE keep;                 // Holds opaque text Strings so GC can't collect them
+} calc_parser;
+
+// Unit families with exact conversion factors to the family's first entry,
+// used to compare min()/max()/clamp() arguments
+typedef struct {
+    const char *unit;
+    int family;
+    double factor;
+} calc_unit_info;
+
+static const calc_unit_info CALC_UNITS[] = {
+    // Absolute lengths (canonical: px)
+    {"px", 1, 1.0},
+    {"in", 1, 96.0},
+    {"cm", 1, 96.0 / 2.54},
+    {"mm", 1, 96.0 / 25.4},
+    {"q", 1, 96.0 / 101.6},
+    {"pt", 1, 96.0 / 72.0},
+    {"pc", 1, 16.0},
+    // Angles (canonical: deg)
+    {"deg", 2, 1.0},
+    {"grad", 2, 0.9},
+    {"rad", 2, 180.0 / 3.14159265358979323846},
+    {"turn", 2, 360.0},
+    // Time (canonical: s)
+    {"s", 3, 1.0},
+    {"ms", 3, 0.001},
+    // Frequency (canonical: hz)
+    {"hz", 4, 1.0},
+    {"khz", 4, 1000.0},
+    // Resolution (canonical: dppx)
+    {"dppx", 5, 1.0},
+    {"x", 5, 1.0},
+    {"dpi", 5, 1.0 / 96.0},
+    {"dpcm", 5, 2.54 / 96.0},
+    {NULL, 0, 0.0}
+};
+
+static const calc_unit_info *calc_unit_lookup(const char *unit) {
+    for (const calc_unit_info *info = CALC_UNITS; info->unit; info++) {
+        if (strcmp(info->unit, unit) == 0) return info;
+    }
+    return NULL;
+}
+
+// Convert value from unit `from` to unit `to`.
+// Returns 0 if the units are not interchangeable.
+static int calc_convert(double value, const char *from, const char *to, double *out) {
+    if (strcmp(from, to) == 0) {
+        *out = value;
+        return 1;
+    }
+    const calc_unit_info *a = calc_unit_lookup(from);
+    const calc_unit_info *b = calc_unit_lookup(to);
+    if (!a || !b || a->family != b->family) return 0;
+    *out = value * a->factor / b->factor;
+    return 1;
+}
+
+static int calc_is_ident_char(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == '_' || c >= 0x80;
+}
+
+static int calc_is_ident_start(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '_' || c >= 0x80;
+}
+
+static void calc_skip_ws(calc_parser *cp) {
+    while (cp->p < cp->end && IS_WHITESPACE(*cp->p)) cp->p++;
+}
+
+// Advance from an opening '(' to just past its matching ')', skipping strings.
+// Returns 0 if unbalanced.
+static int calc_skip_parens(const char **pp, const char *end) {
+    const char *p = *pp;
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == '"' || c == '\'') {
+            p++;
+            while (p < end && *p != c) {
+                if (*p == '\\' && p + 1 < end) p++;
+                p++;
+            }
+            if (p >= end) return 0;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            depth--;
+            if (depth == 0) {
+                *pp = p + 1;
+                return 1;
+            }
+        }
+        p++;
+    }
+    return 0;
+}
+
+static int calc_name_is(const char *name, long len, const char *expected) {
+    long expected_len = (long)strlen(expected);
+    if (len != expected_len) return 0;
+    for (long i = 0; i < len; i++) {
+        char c = name[i];
+        if (c >= 'A' && c <= 'Z') c += 32;
+        if (c != expected[i]) return 0;
+    }
+    return 1;
+}
+
+static void calc_set_opaque(calc_parser *cp, calc_sum *out, const char *start, const char *stop) {
+    VALUE text = rb_str_new(start, stop - start);
+    rb_ary_push(cp->keep, text);
+    out->count = 1;
+    out->terms[0].opaque = 1;
+    out->terms[0].value = 1.0;
+    out->terms[0].unit[0] = '\0';
+    out->terms[0].text = text;
+}
+
+static int calc_is_scalar(const calc_sum *s) {
+    return s->count == 1 && !s->terms[0].opaque;
+}
+
+static int calc_is_number(const calc_sum *s) {
+    return calc_is_scalar(s) && s->terms[0].unit[0] == '\0';
+}
+
+// acc += sign * rhs, merging numeric terms with the same unit
+static int calc_add(calc_sum *acc, const calc_sum *rhs, double sign) {
+    for (int i = 0; i < rhs->count; i++) {
+        const calc_term *t = &rhs->terms[i];
+        int merged = 0;
+
+        if (!t->opaque) {
+            for (int j = 0; j < acc->count; j++) {
+                calc_term *existing = &acc->terms[j];
+                if (existing->opaque) continue;
+
+                if (strcmp(existing->unit, t->unit) == 0) {
+                    existing->value += sign * t->value;
+                    merged = 1;
+                    break;
+                }
+            }
+        }
+
+        if (!merged) {
+            if (acc->count >= CALC_MAX_TERMS) return 0;
+            acc->terms[acc->count] = *t;
+            acc->terms[acc->count].value = sign * t->value;
+            acc->count++;
+        }
+    }
+    return 1;
+}
+
+static void calc_multiply(calc_sum *s, double k) {
+    for (int i = 0; i < s->count; i++) s->terms[i].value *= k;
+}
+
+static void calc_divide(calc_sum *s, double k) {
+    for (int i = 0; i < s->count; i++) s->terms[i].value /= k;
+}
+
+// Format a non-negative magnitude with up to 5 decimals. Returns 0 if the
+// number can't be represented faithfully (infinite, NaN, or rounds to zero).
+static int calc_format_number(double value, char *buf, size_t buf_size) {
+    if (isnan(value) || isinf(value)) return 0;
+    int len = snprintf(buf, buf_size, "%.5f", value);
+    if (len <= 0 || (size_t)len >= buf_size) return 0;
+
+    // Strip trailing zeros and a dangling decimal point
+    char *dot = strchr(buf, '.');
+    if (dot) {
+        char *last = buf + len - 1;
+        while (last > dot && *last == '0') *last-- = '\0';
+        if (last == dot) *last = '\0';
+    }
+
+    if (strcmp(buf, "0") == 0 && value != 0.0) return 0;
+    return 1;
+}
+
+// Drop zero numeric terms (100% - 0px => 100%), keeping one term if all are zero
+static void calc_compact(calc_sum *s) {
+    int kept = 0;
+    for (int i = 0; i < s->count; i++) {
+        const calc_term *t = &s->terms[i];
+        if (!t->opaque && t->value == 0.0) continue;
+        s->terms[kept++] = *t;
+    }
+    if (kept > 0) s->count = kept;
+    else if (s->count > 1) s->count = 1;
+}
+
+static int calc_parse_sum(calc_parser *cp, calc_sum *out);
+
+// Parse comma-separated math function arguments up to and including ')'
+static int calc_parse_args(calc_parser *cp, calc_sum *args, int max_args, int *count) {
+    *count = 0;
+    while (1) {
+        if (*count >= max_args) return 0;
+        if (!calc_parse_sum(cp, &args[*count])) return 0;
+        (*count)++;
+        calc_skip_ws(cp);
+        if (cp->p >= cp->end) return 0;
+        if (*cp->p == ',') {
+            cp->p++;
+            continue;
+        }
+        if (*cp->p == ')') {
+            cp->p++;
+            return 1;
+        }
+        return 0;
+    }
+}
+
+// Canonical value for comparing scalars of the same family
+static int calc_comparable(const calc_sum *args, int count) {
+    for (int i = 0; i < count; i++) {
+        double ignored;
+        if (!calc_is_scalar(&args[i])) return 0;
+        if (!calc_convert(1.0, args[i].terms[0].unit, args[0].terms[0].unit, &ignored)) return 0;
+    }
+    return 1;
+}
+
+static double calc_canonical(const calc_sum *arg, const char *unit) {
+    double converted = 0.0;
+    calc_convert(arg->terms[0].value, arg->terms[0].unit, unit, &converted);
+    return converted;
+}
+
+static int calc_serialize_sum(const calc_sum *s, VALUE out);
+
+// min()/max()/clamp(): fold to the winning argument when all are comparable,
+// otherwise rebuild the function from the (folded) arguments as opaque text
+static int calc_parse_math_function(calc_parser *cp, calc_sum *out, const char *name, long name_len) {
+    calc_sum args[CALC_MAX_ARGS];
+    int count;
+    int is_min = calc_name_is(name, name_len, "min");
+    int is_max = calc_name_is(name, name_len, "max");
+
+    if (!calc_parse_args(cp, args, CALC_MAX_ARGS, &count)) return 0;
+    if (!is_min && !is_max && count != 3) return 0;
+
+    if (calc_comparable(args, count)) {
+        const char *unit = args[0].terms[0].unit;
+        int winner = 0;
+        if (is_min || is_max) {
+            for (int i = 1; i < count; i++) {
+                double candidate = calc_canonical(&args[i], unit);
+                double best = calc_canonical(&args[winner], unit);
+                if (is_min ? candidate < best : candidate > best) winner = i;
+            }
+        } else {
+            // clamp(MIN, VAL, MAX) = max(MIN, min(VAL, MAX))
+            int inner = calc_canonical(&args[2], unit) < calc_canonical(&args[1], unit) ? 2 : 1;
+            winner = calc_canonical(&args[inner], unit) > calc_canonical(&args[0], unit) ? inner : 0;
+        }
+        *out = args[winner];
+        return 1;
+    }
+
+    VALUE text = rb_str_new(name, name_len);
+    rb_str_cat2(text, "(");
+    for (int i = 0; i < count; i++) {
+        if (i > 0) rb_str_cat2(text, ", ");
+        calc_compact(&args[i]);
+        if (!calc_serialize_sum(&args[i], text)) return 0;
+    }
+    rb_str_cat2(text, ")");
+    rb_ary_push(cp->keep, text);
+
+    out->count = 1;
+    out->terms[0].opaque = 1;
+    out->terms[0].value = 1.0;
+    out->terms[0].unit[0] = '\0';
+    out->terms[0].text = text;
+    return 1;
+}
+
+static int calc_parse_number(calc_parser *cp, calc_sum *out) {
+    const char *start = cp->p;
+    const char *p = cp->p;
+    const char *end = cp->end;
+    int digits = 0;
+
+    if (p < end && (*p == '+' || *p == '-')) p++;
+    while (p < end && *p >= '0' && *p <= '9') { p++; digits++; }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') { p++; digits++; }
+    }
+    if (digits == 0) return 0;
+
+    // Exponent only if followed by a digit (so "1em" stays a unit)
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        if (q < end && (*q == '+' || *q == '-')) q++;
+        if (q < end && *q >= '0' && *q <= '9') {
+            p = q;
+            while (p < end && *p >= '0' && *p <= '9') p++;
+        }
+    }
+
+    char num_buf[64];
+    long num_len = p - start;
+    if (num_len >= (long)sizeof(num_buf)) return 0;
+    memcpy(num_buf, start, num_len);
+    num_buf[num_len] = '\0';
+
+    calc_term *t = &out->terms[0];
+    out->count = 1;
+    t->opaque = 0;
+    t->value = strtod(num_buf, NULL);
+    t->text = Qnil;
+
+    if (p < end && *p == '%') {
+        strcpy(t->unit, "%");
+        p++;
+    } else {
+        long unit_len = 0;
+        while (p < end && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))) {
+            if (unit_len >= CALC_UNIT_MAX - 1) return 0;
+            char c = *p;
+            if (c >= 'A' && c <= 'Z') c += 32;
+            t->unit[unit_len++] = c;
+            p++;
+        }
+        t->unit[unit_len] = '\0';
+    }
+
+    cp->p = p;
+    return 1;
+}
+
+static int calc_parse_value(calc_parser *cp, calc_sum *out) {
+    calc_skip_ws(cp);
+    if (cp->p >= cp->end) return 0;
+
+    unsigned char c = (unsigned char)*cp->p;
+
+    if (c == '(') {
+        cp->p++;
+        if (!calc_parse_sum(cp, out)) return 0;
+        calc_skip_ws(cp);
+        if (cp->p >= cp->end || *cp->p != ')') return 0;
+        cp->p++;
+        return 1;
+    }
+
+    if ((c >= '0' && c <= '9') || c == '.' ||
+        ((c == '+' || c == '-') && cp->p + 1 < cp->end &&
+         ((cp->p[1] >= '0' && cp->p[1] <= '9') || cp->p[1] == '.'))) {
+        return calc_parse_number(cp, out);
+    }
+
+    if (calc_is_ident_start(c)) {
+        const char *start = cp->p;
+        while (cp->p < cp->end && calc_is_ident_char((unsigned char)*cp->p)) cp->p++;
+        long name_len = cp->p - start;
+
+        if (cp->p < cp->end && *cp->p == '(') {
+            if (calc_name_is(start, name_len, "calc")) {
+                cp->p++;
+                if (!calc_parse_sum(cp, out)) return 0;
+                calc_skip_ws(cp);
+                if (cp->p >= cp->end || *cp->p != ')') return 0;
+                cp->p++;
+                return 1;
+            }
+            if (calc_name_is(start, name_len, "min") || calc_name_is(start, name_len, "max") ||
+                calc_name_is(start, name_len, "clamp")) {
+                cp->p++;
+                return calc_parse_math_function(cp, out, start, name_len);
+            }
+
+            // var(), env() and anything else we don't compute: keep verbatim
+            if (!calc_skip_parens(&cp->p, cp->end)) return 0;
+        }
+
+        calc_set_opaque(cp, out, start, cp->p);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int calc_parse_product(calc_parser *cp, calc_sum *out) {
+    if (++cp->depth > CALC_MAX_DEPTH) return 0;
+
+    calc_skip_ws(cp);
+    const char *start = cp->p;
+    int unfoldable = 0;
+
+    if (!calc_parse_value(cp, out)) return 0;
+
+    while (1) {
+        const char *before_ws = cp->p;
+        calc_skip_ws(cp);
+        if (cp->p >= cp->end || (*cp->p != '*' && *cp->p != '/')) {
+            cp->p = before_ws;
+            break;
+        }
+        char op = *cp->p++;
+
+        calc_sum rhs;
+        if (!calc_parse_value(cp, &rhs)) return 0;
+        if (unfoldable) continue;
+
+        if (op == '*') {
+            if (calc_is_number(out)) {
+                double k = out->terms[0].value;
+                *out = rhs;
+                calc_multiply(out, k);
+            } else if (calc_is_number(&rhs)) {
+                calc_multiply(out, rhs.terms[0].value);
+            } else {
+                unfoldable = 1;
+            }
+        } else {
+            if (calc_is_number(&rhs) && rhs.terms[0].value != 0.0) {
+                calc_divide(out, rhs.terms[0].value);
+            } else {
+                unfoldable = 1;
+            }
+        }
+    }
+
+    // Keep products we can't compute as written
+    if (unfoldable) calc_set_opaque(cp, out, start, cp->p);
+
+    cp->depth--;
+    return 1;
+}
+
+static int calc_parse_sum(calc_parser *cp, calc_sum *out) {
+    if (!calc_parse_product(cp, out)) return 0;
+
+    while (1) {
+        const char *before_ws = cp->p;
+        calc_skip_ws(cp);
+        // + and - must be surrounded by whitespace
+        if (cp->p == before_ws || cp->p + 1 >= cp->end ||
+            (*cp->p != '+' && *cp->p != '-') || !IS_WHITESPACE(cp->p[1])) {
+            cp->p = before_ws;
+            return 1;
+        }
+        double sign = (*cp->p == '-') ? -1.0 : 1.0;
+        cp->p++;
+
+        calc_sum rhs;
+        if (!calc_parse_product(cp, &rhs)) return 0;
+        if (!calc_add(out, &rhs, sign)) return 0;
+    }
+}
+
+// Append "<magnitude><unit>" or "<coefficient> * <text>" for one term
+static int calc_append_term(VALUE out, const calc_term *t, int force_coefficient) {
+    char num[64];
+    double magnitude = fabs(t->value);
+
+    if (t->opaque) {
+        if (magnitude != 1.0 || force_coefficient) {
+            if (!calc_format_number(magnitude, num, sizeof(num))) return 0;
+            rb_str_cat2(out, num);
+            rb_str_cat2(out, " * ");
+        }
+        rb_str_append(out, t->text);
+        return 1;
+    }
+
+    if (!calc_format_number(magnitude, num, sizeof(num))) {
+        // Zero is fine; it just has no distinguishable digits to lose
+        if (magnitude != 0.0) return 0;
+        strcpy(num, "0");
+    }
+    rb_str_cat2(out, num);
+    rb_str_cat2(out, t->unit);
+    return 1;
+}
+
+// Serialize a sum without a calc() wrapper
+static int calc_serialize_sum(const calc_sum *s, VALUE out) {
+    for (int i = 0; i < s->count; i++) {
+        const calc_term *t = &s->terms[i];
+        int negative = t->value < 0.0;
+
+        if (i == 0) {
+            if (negative) rb_str_cat2(out, "-");
+            // "-var(--x)" would be an identifier, so spell out the coefficient
+            if (!calc_append_term(out, t, negative && t->opaque)) return 0;
+        } else {
+            rb_str_cat2(out, negative ? " - " : " + ");
+            if (!calc_append_term(out, t, 0)) return 0;
+        }
+    }
+    return 1;
+}
+
+// Final text for a top-level math function. A single numeric term is emitted
+// bare unless it is a unitless non-integer (integer-only properties like
+// z-index accept calc(1.5) but reject 1.5) or negative (calc() clamps to the
+// property's range, a bare -5px is invalid where negatives aren't allowed).
+static int calc_finalize(calc_sum *s, int keep_wrapper_for_opaque, VALUE out) {
+    calc_compact(s);
+    if (calc_is_scalar(s)) {
+        const calc_term *t = &s->terms[0];
+        if (t->value >= 0.0 && (t->unit[0] != '\0' || t->value == floor(t->value))) {
+            return calc_serialize_sum(s, out);
+        }
+    } else if (s->count == 1 && s->terms[0].value == 1.0 && !keep_wrapper_for_opaque) {
+        rb_str_append(out, s->terms[0].text);
+        return 1;
+    }
+
+    rb_str_cat2(out, "calc(");
+    if (!calc_serialize_sum(s, out)) return 0;
+    rb_str_cat2(out, ")");
+    return 1;
+}
+
+/*
+ * Fold every calc()/min()/max()/clamp() in a CSS value.
+ *
+ * @param value [String] CSS declaration value
+ * @return [String] Folded value (the same object if nothing changed)
+ */
+static VALUE fold_calc_value(VALUE value) {
+    const char *str = RSTRING_PTR(value);
+    long len = RSTRING_LEN(value);
+
+    // Fast path: no functions at all
+    if (!memchr(str, '(', len)) return value;
+
+    const char *p = str;
+    const char *end = str + len;
+    const char *copied = str;
+    VALUE result = Qnil;
+    VALUE keep = rb_ary_new();
+
+    while (p < end) {
+        char c = *p;
+
+        if (c == '"' || c == '\'') {
+            p++;
+            while (p < end && *p != c) {
+                if (*p == '\\' && p + 1 < end) p++;
+                p++;
+            }
+            if (p < end) p++;
+            continue;
+        }
+
+        if (!calc_is_ident_start((unsigned char)c) || (p > str && calc_is_ident_char((unsigned char)p[-1]))) {
+            p++;
+            continue;
+        }
+
+        const char *name = p;
+        while (p < end && calc_is_ident_char((unsigned char)*p)) p++;
+        long name_len = p - name;
+        if (p >= end || *p != '(') continue;
+
+        // url() contents are opaque
+        if (calc_name_is(name, name_len, "url")) {
+            if (!calc_skip_parens(&p, end)) break;
+            continue;
+        }
+
+        if (!calc_name_is(name, name_len, "calc") && !calc_name_is(name, name_len, "min") &&
+            !calc_name_is(name, name_len, "max") && !calc_name_is(name, name_len, "clamp")) {
+            continue;
+        }
+
+        calc_parser cp = { name, end, 0, keep };
+        calc_sum folded;
+        if (!calc_parse_value(&cp, &folded)) continue;
+
+        VALUE replacement = rb_str_buf_new(cp.p - name);
+        int is_calc = calc_name_is(name, name_len, "calc");
+        if (calc_finalize(&folded, is_calc, replacement) && RSTRING_LEN(replacement) < cp.p - name) {
+            if (NIL_P(result)) result = rb_str_buf_new(len);
+            rb_str_cat(result, copied, name - copied);
+            rb_str_append(result, replacement);
+            copied = cp.p;
+        }
+        p = cp.p;
+    }
+
+    RB_GC_GUARD(keep);
+    if (NIL_P(result)) return value;
+
+    rb_str_cat(result, copied, end - copied);
+    rb_enc_copy(result, value);
+    RB_GC_GUARD(value);
+    return result;
+}
+
+/*
+ * Cataract.fold_calc(value) - fold math functions in a single value
+ */
+VALUE cataract_fold_calc(VALUE self, VALUE value) {
+    Check_Type(value, T_STRING);
+    return fold_calc_value(value);
+}
+
+// Fold declaration values in place; returns number of declarations changed
+static long fold_calc_declarations(VALUE declarations) {
+    long changed = 0;
+    if (NIL_P(declarations)) return 0;
+
+    long len = RARRAY_LEN(declarations);
+    for (long i = 0; i < len; i++) {
+        VALUE decl = RARRAY_AREF(declarations, i);
+        if (!rb_obj_is_kind_of(decl, cDeclaration)) continue;
+
+        VALUE value = rb_struct_aref(decl, INT2FIX(DECL_VALUE));
+        if (!RB_TYPE_P(value, T_STRING)) continue;
+
+        VALUE folded = fold_calc_value(value);
+        if (folded != value) {
+            rb_struct_aset(decl, INT2FIX(DECL_VALUE), folded);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+/*
+ * Cataract.fold_calc_values(rules) - fold math functions in every declaration
+ *
+ * Walks Rule declarations and AtRule content (@font-face declarations and
+ * @keyframes blocks), rewriting values in place.
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules to rewrite
+ * @return [Integer] Number of declarations changed
+ */
+VALUE cataract_fold_calc_values(VALUE self, VALUE rules_array) {
+    Check_Type(rules_array, T_ARRAY);
+    long changed = 0;
+
+    long num_rules = RARRAY_LEN(rules_array);
+    for (long i = 0; i < num_rules; i++) {
+        VALUE rule = RARRAY_AREF(rules_array, i);
+
+        if (rb_obj_is_kind_of(rule, cAtRule)) {
+            VALUE content = rb_struct_aref(rule, INT2FIX(AT_RULE_CONTENT));
+            if (!RB_TYPE_P(content, T_ARRAY)) continue;
+
+            changed += fold_calc_declarations(content);
+            long content_len = RARRAY_LEN(content);
+            for (long j = 0; j < content_len; j++) {
+                VALUE block = RARRAY_AREF(content, j);
+                if (rb_obj_is_kind_of(block, cRule)) {
+                    changed += fold_calc_declarations(rb_struct_aref(block, INT2FIX(RULE_DECLARATIONS)));
+                }
+            }
+        } else {
+            changed += fold_calc_declarations(rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS)));
+        }
+    }
+
+    return LONG2NUM(changed);
+}
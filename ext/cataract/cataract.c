@@ -9,11 +9,13 @@ VALUE cAtRule;
 VALUE cStylesheet;
 VALUE cImportStatement;
 VALUE cMediaQuery;
+VALUE cUrlReference;
 
 // Error class definitions (shared with main extension)
 VALUE eCataractError;
 VALUE eDepthError;
 VALUE eSizeError;
+VALUE eLimitError;
 VALUE eParseError;
 
 // ============================================================================
@@ -33,8 +35,8 @@ static void append_media_query_text(VALUE result, VALUE media_query) {
 
     if (!NIL_P(media_conditions)) {
         // Has conditions
-        ID all_id = rb_intern("all");
-        if (SYM2ID(media_type) == all_id) {
+        VALUE all_sym = ID2SYM(rb_intern("all"));
+        if (media_type == all_sym) {
             // Type is :all - just output conditions (don't say "all and ...")
             rb_str_append(result, media_conditions);
         } else {
@@ -402,8 +404,76 @@ struct format_opts {
     const char *decl_indent_base;   // NULL (compact) vs "  " (formatted base rules)
     const char *decl_indent_media;  // NULL (compact) vs "    " (formatted media rules)
     int add_blank_lines;            // 0 (compact) vs 1 (formatted)
+    int consolidate_media;          // Hoist media rules into earlier identical @media blocks when cascade-safe
+    int compression_order;          // Sort declarations and cluster similar rules when cascade-safe
+    VALUE rule_ids;                 // Subset of rule ids to serialize (ascending), or Qnil for all rules
+    VALUE sink;                     // Object responding to #write that receives output in chunks, or Qnil
+    long chunk_size;                // Flush to sink once the buffer reaches this many bytes
 };
 
+// Default chunk size for streaming output to a sink (e.g. Zlib::GzipWriter)
+#define SERIALIZE_CHUNK_SIZE 65536
+
+// Read serialization options hash (nil or Hash) into format_opts
+static void apply_serialize_options(struct format_opts *opts, VALUE options) {
+    if (NIL_P(options)) return;
+    Check_Type(options, T_HASH);
+    opts->consolidate_media = RTEST(rb_hash_aref(options, ID2SYM(rb_intern("consolidate_media"))));
+    opts->compression_order = RTEST(rb_hash_aref(options, ID2SYM(rb_intern("compression_order"))));
+
+    VALUE rule_ids = rb_hash_aref(options, ID2SYM(rb_intern("rule_ids")));
+    if (!NIL_P(rule_ids)) {
+        Check_Type(rule_ids, T_ARRAY);
+        opts->rule_ids = rule_ids;
+    }
+
+    VALUE sink = rb_hash_aref(options, ID2SYM(rb_intern("sink")));
+    if (!NIL_P(sink)) {
+        opts->sink = sink;
+        VALUE chunk_size = rb_hash_aref(options, ID2SYM(rb_intern("chunk_size")));
+        opts->chunk_size = NIL_P(chunk_size) ? SERIALIZE_CHUNK_SIZE : NUM2LONG(chunk_size);
+    }
+}
+
+// Hand the buffer to the sink once it is full, then reuse it for the next chunk.
+// The sink must consume the string during #write (IO, GzipWriter and StringIO do).
+static void flush_to_sink(VALUE result, const struct format_opts *opts) {
+    if (NIL_P(opts->sink) || RSTRING_LEN(result) < opts->chunk_size) return;
+    rb_funcall(opts->sink, rb_intern("write"), 1, result);
+    rb_str_set_len(result, 0);
+}
+
+// Build rule id => position map for rules_array, or Qnil when every rule's id is its
+// position. Ids and positions drift apart when @import statements take ids from the
+// same counter (unresolved imports) or rules have been removed.
+static VALUE build_rule_position_map(VALUE rules_array) {
+    long num_rules = RARRAY_LEN(rules_array);
+    long i = 0;
+    for (; i < num_rules; i++) {
+        VALUE id = rb_struct_aref(RARRAY_AREF(rules_array, i), INT2FIX(RULE_ID));
+        if (!FIXNUM_P(id) || FIX2LONG(id) != i) break;
+    }
+    if (i == num_rules) return Qnil;
+
+    VALUE positions = rb_hash_new();
+    for (i = 0; i < num_rules; i++) {
+        VALUE id = rb_struct_aref(RARRAY_AREF(rules_array, i), INT2FIX(RULE_ID));
+        rb_hash_aset(positions, id, LONG2FIX(i));
+    }
+    return positions;
+}
+
+// Position of rule_id in rules_array (see build_rule_position_map), or -1 if absent
+static long rule_position(VALUE rules_array, VALUE positions, VALUE rule_id) {
+    if (NIL_P(positions)) {
+        if (!FIXNUM_P(rule_id)) return -1;
+        long pos = FIX2LONG(rule_id);
+        return (pos >= 0 && pos < RARRAY_LEN(rules_array)) ? pos : -1;
+    }
+    VALUE pos = rb_hash_aref(positions, rule_id);
+    return NIL_P(pos) ? -1 : FIX2LONG(pos);
+}
+
 // Private shared implementation for stylesheet serialization with optional selector list grouping
 // All formatting behavior controlled by format_opts struct to avoid mode flags and if/else branches
 static VALUE serialize_stylesheet_with_grouping(
@@ -414,7 +484,7 @@ static VALUE serialize_stylesheet_with_grouping(
     VALUE selector_lists,
     const struct format_opts *opts
 ) {
-    long total_rules = RARRAY_LEN(rules_array);
+    long num_rules = RARRAY_LEN(rules_array);
 
     // Check if selector list grouping is enabled (non-empty hash)
     int grouping_enabled = (!NIL_P(selector_lists) && TYPE(selector_lists) == T_HASH && RHASH_SIZE(selector_lists) > 0);
@@ -430,12 +500,57 @@ static VALUE serialize_stylesheet_with_grouping(
     // Track processed rules to avoid duplicates when grouping
     VALUE processed_rule_ids = rb_hash_new();
 
+    // Rule ids are not always positions in rules_array (see build_rule_position_map)
+    VALUE rule_positions = build_rule_position_map(rules_array);
+
+    // Optional subset of rules (e.g. from StylesheetScope). rules_array stays complete so
+    // selector list members can still be looked up; the ids become a rule_order of
+    // positions, and allowed_rule_ids stops selector list grouping from pulling in
+    // rules outside the subset.
+    VALUE rule_order = Qnil;
+    VALUE allowed_rule_ids = Qnil;
+    if (!NIL_P(opts->rule_ids)) {
+        long num_ids = RARRAY_LEN(opts->rule_ids);
+        rule_order = rb_ary_new_capa(num_ids);
+        allowed_rule_ids = rb_hash_new();
+        for (long i = 0; i < num_ids; i++) {
+            VALUE id = RARRAY_AREF(opts->rule_ids, i);
+            long pos = rule_position(rules_array, rule_positions, id);
+            if (pos < 0) {
+                rb_raise(rb_eArgError, "rule_ids contains invalid rule id: %"PRIsVALUE, rb_inspect(id));
+            }
+            rb_ary_push(rule_order, LONG2FIX(pos));
+            rb_hash_aset(allowed_rule_ids, id, Qtrue);
+        }
+    }
+
+    // Optional emit order that moves media rules into earlier identical @media blocks
+    // (nil when disabled or when nothing could be moved - see media_consolidation.c)
+    if (opts->consolidate_media) {
+        VALUE consolidated = consolidate_media_rule_order(rules_array, rule_order, media_queries, media_query_lists, mq_id_to_list_id);
+        if (!NIL_P(consolidated)) rule_order = consolidated;
+    }
+
+    // Optional canonical declaration order and clustering of similar rules
+    // (see compression_order.c). Sorted rules are copies; the stylesheet is untouched.
+    if (opts->compression_order) {
+        rules_array = compression_sorted_rules(rules_array, rule_order);
+        VALUE clustered = compression_rule_order(rules_array, rule_order, grouping_enabled ? selector_lists : Qnil);
+        if (!NIL_P(clustered)) rule_order = clustered;
+    }
+
+    long total_rules = NIL_P(rule_order) ? num_rules : RARRAY_LEN(rule_order);
+
     // Iterate through rules in insertion order, grouping consecutive media queries
     VALUE current_media = Qnil;
     int in_media_block = 0;
 
     for (long i = 0; i < total_rules; i++) {
-        VALUE rule = rb_ary_entry(rules_array, i);
+        // Stream completed rules out before starting the next one
+        flush_to_sink(result, opts);
+
+        long rule_idx = NIL_P(rule_order) ? i : FIX2LONG(RARRAY_AREF(rule_order, i));
+        VALUE rule = rb_ary_entry(rules_array, rule_idx);
         VALUE rule_id = rb_struct_aref(rule, INT2FIX(RULE_ID));
 
         // Skip if already processed (when grouped)
@@ -489,14 +604,18 @@ static VALUE serialize_stylesheet_with_grouping(
                         for (long j = 0; j < list_len; j++) {
                             VALUE other_rule_id = rb_ary_entry(rule_ids_in_list, j);
 
-                            // Skip if already processed
+                            // Skip if already processed or outside the requested subset
                             if (RTEST(rb_hash_aref(processed_rule_ids, other_rule_id))) {
                                 continue;
                             }
+                            if (!NIL_P(allowed_rule_ids) && !RTEST(rb_hash_aref(allowed_rule_ids, other_rule_id))) {
+                                continue;
+                            }
 
                             // Find the rule by ID
-                            VALUE other_rule = rb_ary_entry(rules_array, FIX2INT(other_rule_id));
-                            if (NIL_P(other_rule)) continue;
+                            long other_pos = rule_position(rules_array, rule_positions, other_rule_id);
+                            if (other_pos < 0) continue;
+                            VALUE other_rule = RARRAY_AREF(rules_array, other_pos);
 
                             // Check same media context (compare media_query_id directly)
                             VALUE other_rule_media_query_id = rb_struct_aref(other_rule, INT2FIX(RULE_MEDIA_QUERY_ID));
@@ -602,9 +721,11 @@ static VALUE serialize_stylesheet_with_grouping(
                         for (long j = 0; j < list_len; j++) {
                             VALUE other_rule_id = rb_ary_entry(rule_ids_in_list, j);
                             if (RTEST(rb_hash_aref(processed_rule_ids, other_rule_id))) continue;
+                            if (!NIL_P(allowed_rule_ids) && !RTEST(rb_hash_aref(allowed_rule_ids, other_rule_id))) continue;
 
-                            VALUE other_rule = rb_ary_entry(rules_array, FIX2INT(other_rule_id));
-                            if (NIL_P(other_rule)) continue;
+                            long other_pos = rule_position(rules_array, rule_positions, other_rule_id);
+                            if (other_pos < 0) continue;
+                            VALUE other_rule = RARRAY_AREF(rules_array, other_pos);
 
                             VALUE other_rule_media_query_id = rb_struct_aref(other_rule, INT2FIX(RULE_MEDIA_QUERY_ID));
                             if (!rb_equal(rule_media_query_id, other_rule_media_query_id)) continue;
@@ -665,11 +786,14 @@ static VALUE serialize_stylesheet_with_grouping(
     // Guard hash objects we created and used throughout
     RB_GC_GUARD(mq_id_to_list_id);
     RB_GC_GUARD(processed_rule_ids);
+    RB_GC_GUARD(rule_order);
+    RB_GC_GUARD(allowed_rule_ids);
+    RB_GC_GUARD(rule_positions);
     return result;
 }
 
 // Original stylesheet serialization (no nesting support) - compact format
-static VALUE stylesheet_to_s_without_nesting(VALUE rules_array, VALUE media_queries, VALUE media_query_lists, VALUE charset, VALUE selector_lists) {
+static VALUE stylesheet_to_s_without_nesting(VALUE rules_array, VALUE media_queries, VALUE media_query_lists, VALUE charset, VALUE selector_lists, VALUE options) {
     Check_Type(rules_array, T_ARRAY);
     Check_Type(media_queries, T_ARRAY);
 
@@ -689,8 +813,14 @@ static VALUE stylesheet_to_s_without_nesting(VALUE rules_array, VALUE media_quer
         .media_indent = "",
         .decl_indent_base = NULL,
         .decl_indent_media = NULL,
-        .add_blank_lines = 0
+        .add_blank_lines = 0,
+        .consolidate_media = 0,
+        .compression_order = 0,
+        .rule_ids = Qnil,
+        .sink = Qnil,
+        .chunk_size = SERIALIZE_CHUNK_SIZE
     };
+    apply_serialize_options(&opts, options);
 
     return serialize_stylesheet_with_grouping(rules_array, media_queries, media_query_lists, result, selector_lists, &opts);
 }
@@ -905,7 +1035,12 @@ static void serialize_rule_with_children(VALUE result, VALUE rules_array, long r
 }
 
 // New stylesheet serialization entry point - checks for nesting and delegates
-static VALUE stylesheet_to_s(VALUE self, VALUE rules_array, VALUE charset, VALUE has_nesting, VALUE selector_lists, VALUE media_queries, VALUE media_query_lists) {
+// Optional 7th argument is a serialization options hash (e.g. { consolidate_media: true })
+static VALUE stylesheet_to_s(int argc, VALUE *argv, VALUE self) {
+    VALUE rules_array, charset, has_nesting, selector_lists, media_queries, media_query_lists, options;
+    rb_scan_args(argc, argv, "61", &rules_array, &charset, &has_nesting, &selector_lists,
+                 &media_queries, &media_query_lists, &options);
+
     DEBUG_PRINTF("[STYLESHEET_TO_S] Called with:\n");
     DEBUG_PRINTF("  rules_array length: %ld\n", RARRAY_LEN(rules_array));
     DEBUG_PRINTF("  media_queries type: %s, length: %ld\n",
@@ -927,7 +1062,7 @@ static VALUE stylesheet_to_s(VALUE self, VALUE rules_array, VALUE charset, VALUE
     // Fast path: if no nesting, use original implementation (zero overhead)
     if (!RTEST(has_nesting)) {
         DEBUG_PRINTF("[STYLESHEET_TO_S] Taking fast path (no nesting)\n");
-        return stylesheet_to_s_without_nesting(rules_array, media_queries, media_query_lists, charset, selector_lists);
+        return stylesheet_to_s_without_nesting(rules_array, media_queries, media_query_lists, charset, selector_lists, options);
     }
 
     DEBUG_PRINTF("[STYLESHEET_TO_S] Taking slow path (has nesting)\n");
@@ -1043,7 +1178,7 @@ static VALUE stylesheet_to_s(VALUE self, VALUE rules_array, VALUE charset, VALUE
 }
 
 // Original formatted serialization (no nesting support)
-static VALUE stylesheet_to_formatted_s_without_nesting(VALUE rules_array, VALUE media_queries, VALUE media_query_lists, VALUE charset, VALUE selector_lists) {
+static VALUE stylesheet_to_formatted_s_without_nesting(VALUE rules_array, VALUE media_queries, VALUE media_query_lists, VALUE charset, VALUE selector_lists, VALUE options) {
     Check_Type(rules_array, T_ARRAY);
     Check_Type(media_queries, T_ARRAY);
 
@@ -1063,14 +1198,25 @@ static VALUE stylesheet_to_formatted_s_without_nesting(VALUE rules_array, VALUE
         .media_indent = "  ",
         .decl_indent_base = "  ",
         .decl_indent_media = "    ",
-        .add_blank_lines = 1
+        .add_blank_lines = 1,
+        .consolidate_media = 0,
+        .compression_order = 0,
+        .rule_ids = Qnil,
+        .sink = Qnil,
+        .chunk_size = SERIALIZE_CHUNK_SIZE
     };
+    apply_serialize_options(&opts, options);
 
     return serialize_stylesheet_with_grouping(rules_array, media_queries, media_query_lists, result, selector_lists, &opts);
 }
 
 // Formatted version with indentation and newlines (with nesting support)
-static VALUE stylesheet_to_formatted_s(VALUE self, VALUE rules_array, VALUE charset, VALUE has_nesting, VALUE selector_lists, VALUE media_queries, VALUE media_query_lists) {
+// Optional 7th argument is a serialization options hash (see stylesheet_to_s)
+static VALUE stylesheet_to_formatted_s(int argc, VALUE *argv, VALUE self) {
+    VALUE rules_array, charset, has_nesting, selector_lists, media_queries, media_query_lists, options;
+    rb_scan_args(argc, argv, "61", &rules_array, &charset, &has_nesting, &selector_lists,
+                 &media_queries, &media_query_lists, &options);
+
     Check_Type(rules_array, T_ARRAY);
     Check_Type(media_queries, T_ARRAY);
     if (!NIL_P(media_query_lists)) Check_Type(media_query_lists, T_HASH);
@@ -1078,7 +1224,7 @@ static VALUE stylesheet_to_formatted_s(VALUE self, VALUE rules_array, VALUE char
 
     // Fast path: if no nesting, use original implementation (zero overhead)
     if (!RTEST(has_nesting)) {
-        return stylesheet_to_formatted_s_without_nesting(rules_array, media_queries, media_query_lists, charset, selector_lists);
+        return stylesheet_to_formatted_s_without_nesting(rules_array, media_queries, media_query_lists, charset, selector_lists, options);
     }
 
     // SLOW PATH: Has nesting - use parameterized serialization with formatted=1
@@ -1408,6 +1554,12 @@ void Init_native_extension(void) {
         eSizeError = rb_define_class_under(mCataract, "SizeError", eCataractError);
     }
 
+    if (rb_const_defined(mCataract, rb_intern("LimitError"))) {
+        eLimitError = rb_const_get(mCataract, rb_intern("LimitError"));
+    } else {
+        eLimitError = rb_define_class_under(mCataract, "LimitError", eCataractError);
+    }
+
     if (rb_const_defined(mCataract, rb_intern("ParseError"))) {
         eParseError = rb_const_get(mCataract, rb_intern("ParseError"));
     } else {
@@ -1446,6 +1598,12 @@ void Init_native_extension(void) {
         rb_raise(rb_eLoadError, "Cataract::MediaQuery not defined. Do not require 'cataract/native_extension' directly, use require 'cataract'");
     }
 
+    if (rb_const_defined(mCataract, rb_intern("UrlReference"))) {
+        cUrlReference = rb_const_get(mCataract, rb_intern("UrlReference"));
+    } else {
+        rb_raise(rb_eLoadError, "Cataract::UrlReference not defined. Do not require 'cataract/native_extension' directly, use require 'cataract'");
+    }
+
     // Define Declarations class and add to_s method
     VALUE cDeclarations = rb_define_class_under(mCataract, "Declarations", rb_cObject);
     rb_define_method(cDeclarations, "to_s", new_declarations_to_s_method, 0);
@@ -1455,18 +1613,34 @@ void Init_native_extension(void) {
 
     // Define module functions
     rb_define_module_function(mCataract, "_parse_css", parse_css_new, -1);
-    rb_define_module_function(mCataract, "stylesheet_to_s", stylesheet_to_s, 6);
-    rb_define_module_function(mCataract, "stylesheet_to_formatted_s", stylesheet_to_formatted_s, 6);
+    rb_define_module_function(mCataract, "_parse_css_many", parse_css_many, 2);
+    rb_define_module_function(mCataract, "stylesheet_to_s", stylesheet_to_s, -1);
+    rb_define_module_function(mCataract, "stylesheet_to_formatted_s", stylesheet_to_formatted_s, -1);
+    rb_define_module_function(mCataract, "stylesheet_to_json", stylesheet_to_json, -1);
     rb_define_module_function(mCataract, "parse_media_types", parse_media_types, 1);
     rb_define_module_function(mCataract, "parse_declarations", new_parse_declarations, 1);
-    rb_define_module_function(mCataract, "flatten", cataract_flatten, 1);
-    rb_define_module_function(mCataract, "merge", cataract_flatten, 1); // Deprecated alias for backwards compatibility
+    rb_define_module_function(mCataract, "flatten", cataract_flatten, -1);
+    rb_define_module_function(mCataract, "merge", cataract_flatten, -1); // Deprecated alias for backwards compatibility
+    rb_define_module_function(mCataract, "eliminate_dead_declarations", cataract_eliminate_dead_declarations, 1);
     rb_define_module_function(mCataract, "calculate_specificity", calculate_specificity, 1);
     rb_define_module_function(mCataract, "expand_shorthand", cataract_expand_shorthand, 1);
+    rb_define_module_function(mCataract, "fold_calc", cataract_fold_calc, 1);
+    rb_define_module_function(mCataract, "fold_calc_values", cataract_fold_calc_values, 1);
+    rb_define_module_function(mCataract, "rewrite_values", cataract_rewrite_values, 5);
+    rb_define_module_function(mCataract, "extract_urls", cataract_extract_urls, 2);
+    rb_define_module_function(mCataract, "map_urls", cataract_map_urls, 3);
+    rb_define_module_function(mCataract, "prune_prefixes", cataract_prune_prefixes, 6);
+    rb_define_module_function(mCataract, "_property_family", cataract_property_family, 1);
 
     // Initialize flatten constants (cached property strings)
     init_flatten_constants();
 
+    // Define Cataract.each_token and Cataract::TokenStream
+    init_tokenizer(mCataract);
+
+    // Define Cataract.parse_selector
+    init_selector_parser(mCataract);
+
     // Export compile-time flags as a hash for runtime introspection
     VALUE compile_flags = rb_hash_new();
 
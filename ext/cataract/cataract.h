@@ -3,6 +3,7 @@
 
 #include <ruby.h>
 #include <ruby/encoding.h>
+#include <stdint.h>
 
 // ============================================================================
 // Global struct class references
@@ -14,11 +15,13 @@ extern VALUE cAtRule;
 extern VALUE cStylesheet;
 extern VALUE cImportStatement;
 extern VALUE cMediaQuery;
+extern VALUE cUrlReference;
 
 // Error class references
 extern VALUE eCataractError;
 extern VALUE eDepthError;
 extern VALUE eSizeError;
+extern VALUE eLimitError;
 extern VALUE eParseError;
 
 // ============================================================================
@@ -51,12 +54,17 @@ extern VALUE eParseError;
 #define DECL_VALUE 1
 #define DECL_IMPORTANT 2
 
-// AtRule struct field indices (id, selector, content, specificity)
+// AtRule struct field indices (id, selector, content, specificity, media_query_id)
 // Matches Rule interface for duck-typing
 #define AT_RULE_ID 0
 #define AT_RULE_SELECTOR 1
 #define AT_RULE_CONTENT 2
 #define AT_RULE_SPECIFICITY 3
+#define AT_RULE_MEDIA_QUERY_ID 4
+
+// ImportStatement struct field indices (id, url, media, media_query_id, resolved)
+#define IMPORT_ID 0
+#define IMPORT_URL 1
 
 // ============================================================================
 // Macros
@@ -148,15 +156,84 @@ static inline VALUE strip_string(const char *str, long len) {
 // CSS parser (css_parser_new.c)
 VALUE parse_css_new(int argc, VALUE *argv, VALUE self);
 VALUE parse_css_new_impl(VALUE css_string, VALUE parser_options, int rule_id_offset);
+VALUE parse_css_many(VALUE self, VALUE sources, VALUE parser_options);
 VALUE parse_media_types(VALUE self, VALUE media_query_sym);
 
 // Flatten (flatten.c)
-VALUE cataract_flatten(VALUE self, VALUE rules_array);
+VALUE cataract_flatten(int argc, VALUE *argv, VALUE self);
+VALUE cataract_eliminate_dead_declarations(VALUE self, VALUE stylesheet);
 void init_flatten_constants(void);
 
+// Media block consolidation (media_consolidation.c)
+// Cascade conflict keys: one bit per hashed (property family, specificity, important)
+#define CONSOLIDATION_BITSET_WORDS 16
+#define CONSOLIDATION_BITSET_BITS (CONSOLIDATION_BITSET_WORDS * 64)
+
+typedef struct {
+    uint64_t words[CONSOLIDATION_BITSET_WORDS];
+} prop_bitset;
+
+#define FNV1A_OFFSET 14695981039346656037ULL
+
+static inline uint64_t fnv1a(const char *p, long len, uint64_t h) {
+    for (long i = 0; i < len; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static inline void bitset_or(prop_bitset *dst, const prop_bitset *src) {
+    for (int i = 0; i < CONSOLIDATION_BITSET_WORDS; i++) dst->words[i] |= src->words[i];
+}
+
+static inline int bitset_intersects(const prop_bitset *a, const prop_bitset *b) {
+    for (int i = 0; i < CONSOLIDATION_BITSET_WORDS; i++) {
+        if (a->words[i] & b->words[i]) return 1;
+    }
+    return 0;
+}
+
+VALUE consolidate_media_rule_order(VALUE rules_array, VALUE rule_ids, VALUE media_queries, VALUE media_query_lists, VALUE mq_id_to_list_id);
+void rule_cascade_bitset(VALUE rule, prop_bitset *set);
+long property_family(VALUE property, const char **family);
+VALUE cataract_property_family(VALUE self, VALUE property);
+
+// Compression-friendly ordering (compression_order.c)
+VALUE compression_sorted_rules(VALUE rules_array, VALUE rule_ids);
+VALUE compression_rule_order(VALUE rules_array, VALUE rule_ids, VALUE selector_lists);
+
+// JSON export (json_serializer.c)
+VALUE stylesheet_to_json(int argc, VALUE *argv, VALUE self);
+
+// calc() folding (calc_folder.c)
+VALUE cataract_fold_calc(VALUE self, VALUE value);
+VALUE cataract_fold_calc_values(VALUE self, VALUE rules_array);
+
+// Bulk value rewriting (value_rewriter.c)
+VALUE cataract_rewrite_values(VALUE self, VALUE rules_array, VALUE patterns, VALUE replacements, VALUE prefix, VALUE properties);
+
+// url() extraction and mapping (url_rewriter.c)
+VALUE cataract_extract_urls(VALUE self, VALUE rules_array, VALUE imports);
+VALUE cataract_map_urls(VALUE self, VALUE rules_array, VALUE imports, VALUE mapping);
+
+// Vendor prefix pruning (prefix_pruner.c)
+VALUE cataract_prune_prefixes(VALUE self, VALUE rules_array, VALUE properties, VALUE values, VALUE selectors, VALUE at_rules, VALUE prefixes);
+
+// Token stream (tokenizer.c)
+void init_tokenizer(VALUE module);
+
 // Specificity (specificity.c)
 VALUE calculate_specificity(VALUE self, VALUE selector);
 
+// Selector components (selector_parser.c)
+VALUE parse_selector(VALUE self, VALUE selector);
+VALUE selector_tokens(VALUE self, VALUE selector);
+VALUE rule_page_masks(VALUE self, VALUE rules, VALUE token_masks, VALUE all_pages);
+VALUE rule_name_counts(VALUE self, VALUE rules);
+VALUE rename_rule_names(VALUE self, VALUE rules, VALUE mapping);
+void init_selector_parser(VALUE module);
+
 // Import scanner (import_scanner.c)
 VALUE extract_imports(VALUE self, VALUE css_string);
 
@@ -0,0 +1,342 @@
+#include <ruby.h>
+#include <string.h>
+#include <stdint.h>
+#include "cataract.h"
+
+/*
+ * Compression-friendly ordering for serialization
+ *
+ * gzip and brotli find repeats within a sliding window, so output compresses
+ * better when similar text sits close together. Two passes, both opt-in through
+ * the serializer's compression_order option:
+ *
+ * 1. Declarations within a rule are sorted by property family, families ranked
+ *    by where the sheet first uses them, so every block prints its properties
+ *    in the sheet's dominant order:
+ *
+ *      .a { color: red; margin: 0; }         .a { color: red; margin: 0; }
+ *      .b { margin: 4px; color: blue; }  =>  .b { color: blue; margin: 4px; }
+ *
+ *    The sort is stable and only compares families (see media_consolidation.c),
+ *    so declarations that can interact through source order - duplicates,
+ *    fallbacks, shorthand/longhand, prefixed/standard pairs - keep their
+ *    relative order. Rules containing "all" are left alone.
+ *
+ * 2. Rules with identical declaration blocks are clustered together:
+ *
+ *      .a { color: red; }                    .a { color: red; }
+ *      .b { margin: 0; }               =>    .c { color: red; }
+ *      .c { color: red; }                    .b { margin: 0; }
+ *
+ *    Rules are only reordered among consecutive rules in the same media block.
+ *    At-rules, media boundaries and selector lists split across the sheet stay
+ *    put and end the run. Moving a rule back past others uses the same safety
+ *    argument as media consolidation: it must not share a cascade key
+ *    (property family, specificity, important) with any rule it jumps over.
+ *
+ * Each run of movable rules is built up as a list of segments, one cluster of
+ * rules with the same declarations each. A rule joins the latest segment with
+ * its declarations when it doesn't conflict with anything emitted after that
+ * segment, otherwise it starts a new segment. "Anything after" is a range of
+ * segments, so the per-segment cascade bitsets live in a segment tree: adding a
+ * rule and checking a range are both O(log n) bitset operations, which keeps
+ * the pass linear-ish on sheets with thousands of rules.
+ */
+
+// Declaration sort entry: family rank and source position (for stability)
+struct decl_sort_entry {
+    long rank;
+    long index;
+};
+
+static int compare_decl_sort_entries(const void *a, const void *b) {
+    const struct decl_sort_entry *x = a;
+    const struct decl_sort_entry *y = b;
+    if (x->rank != y->rank) return x->rank < y->rank ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+// Hash key for a property's family
+static VALUE family_key(VALUE property) {
+    const char *family;
+    long family_len = property_family(property, &family);
+    return LONG2FIX((long)(fnv1a(family, family_len, FNV1A_OFFSET) >> 2));
+}
+
+// Declarations in canonical order, or Qnil if they are already in it
+static VALUE sorted_declarations(VALUE declarations, VALUE ranks) {
+    long num_decls = RARRAY_LEN(declarations);
+    if (num_decls < 2) return Qnil;
+
+    VALUE entries_buf;
+    struct decl_sort_entry *entries = ALLOCV_N(struct decl_sort_entry, entries_buf, num_decls);
+    int sorted = 1;
+
+    for (long i = 0; i < num_decls; i++) {
+        VALUE property = rb_struct_aref(RARRAY_AREF(declarations, i), INT2FIX(DECL_PROPERTY));
+
+        // "all" resets every property - its position matters to everything
+        if (STR_EQ(property, "all")) {
+            ALLOCV_END(entries_buf);
+            return Qnil;
+        }
+
+        entries[i].rank = FIX2LONG(rb_hash_aref(ranks, family_key(property)));
+        entries[i].index = i;
+        if (i > 0 && entries[i - 1].rank > entries[i].rank) sorted = 0;
+    }
+
+    VALUE result = Qnil;
+    if (!sorted) {
+        qsort(entries, num_decls, sizeof(struct decl_sort_entry), compare_decl_sort_entries);
+        result = rb_ary_new_capa(num_decls);
+        for (long i = 0; i < num_decls; i++) {
+            rb_ary_push(result, RARRAY_AREF(declarations, entries[i].index));
+        }
+    }
+
+    ALLOCV_END(entries_buf);
+    return result;
+}
+
+/*
+ * Rules with their declarations in canonical order
+ *
+ * The canonical order ranks property families by where the sheet first uses
+ * them, so a sheet that already follows one convention keeps it. Rules that
+ * need sorting are replaced by copies; the stylesheet itself is never modified.
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules in source order
+ * @param rule_ids [Array<Integer>, nil] Subset of rule indices to sort, or nil for all rules
+ * @return [Array<Rule, AtRule>] rules_array, or a copy with sorted rules swapped in
+ */
+VALUE compression_sorted_rules(VALUE rules_array, VALUE rule_ids) {
+    long num_rules = NIL_P(rule_ids) ? RARRAY_LEN(rules_array) : RARRAY_LEN(rule_ids);
+    VALUE ranks = rb_hash_new();
+
+    for (long n = 0; n < num_rules; n++) {
+        long i = NIL_P(rule_ids) ? n : FIX2LONG(RARRAY_AREF(rule_ids, n));
+        VALUE rule = RARRAY_AREF(rules_array, i);
+        if (rb_obj_is_kind_of(rule, cAtRule)) continue;
+
+        VALUE declarations = rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS));
+        long num_decls = RARRAY_LEN(declarations);
+        for (long j = 0; j < num_decls; j++) {
+            VALUE key = family_key(rb_struct_aref(RARRAY_AREF(declarations, j), INT2FIX(DECL_PROPERTY)));
+            if (NIL_P(rb_hash_lookup2(ranks, key, Qnil))) {
+                rb_hash_aset(ranks, key, LONG2FIX(RHASH_SIZE(ranks)));
+            }
+        }
+    }
+
+    VALUE result = rules_array;
+    for (long n = 0; n < num_rules; n++) {
+        long i = NIL_P(rule_ids) ? n : FIX2LONG(RARRAY_AREF(rule_ids, n));
+        VALUE rule = RARRAY_AREF(rules_array, i);
+        if (rb_obj_is_kind_of(rule, cAtRule)) continue;
+
+        VALUE sorted = sorted_declarations(rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS)), ranks);
+        if (NIL_P(sorted)) continue;
+
+        if (result == rules_array) result = rb_ary_dup(rules_array);
+        VALUE copy = rb_obj_dup(rule);
+        rb_struct_aset(copy, INT2FIX(RULE_DECLARATIONS), sorted);
+        rb_ary_store(result, i, copy);
+    }
+
+    RB_GC_GUARD(ranks);
+    return result;
+}
+
+// Cluster key: hash of the rule's declarations as printed
+static uint64_t rule_cluster_key(VALUE rule) {
+    VALUE declarations = rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS));
+    long num_decls = RARRAY_LEN(declarations);
+    uint64_t h = FNV1A_OFFSET;
+
+    for (long i = 0; i < num_decls; i++) {
+        VALUE decl = RARRAY_AREF(declarations, i);
+        VALUE property = rb_struct_aref(decl, INT2FIX(DECL_PROPERTY));
+        VALUE value = rb_struct_aref(decl, INT2FIX(DECL_VALUE));
+        h = fnv1a(RSTRING_PTR(property), RSTRING_LEN(property), h);
+        h = fnv1a(":", 1, h);
+        h = fnv1a(RSTRING_PTR(value), RSTRING_LEN(value), h);
+        h = RTEST(rb_struct_aref(decl, INT2FIX(DECL_IMPORTANT))) ? fnv1a("!\n", 2, h) : fnv1a("\n", 1, h);
+    }
+    return h;
+}
+
+// Segment tree over segment positions: node i holds the union of its children
+static void tree_add(prop_bitset *tree, long cap, long pos, const prop_bitset *bits) {
+    for (pos += cap; pos >= 1; pos >>= 1) bitset_or(&tree[pos], bits);
+}
+
+// Does any segment in [from, to) share a cascade key with bits?
+static int tree_range_intersects(const prop_bitset *tree, long cap, long from, long to, const prop_bitset *bits) {
+    for (from += cap, to += cap; from < to; from >>= 1, to >>= 1) {
+        if ((from & 1) && bitset_intersects(&tree[from++], bits)) return 1;
+        if ((to & 1) && bitset_intersects(&tree[--to], bits)) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Compute an emit order that clusters rules with identical declarations
+ *
+ * Rules from a selector list move together, and only when the whole list is a
+ * consecutive run (otherwise grouping on output could pull members across).
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules, declarations already sorted
+ * @param rule_ids [Array<Integer>, nil] Rule indices in emit order, or nil for all rules
+ * @param selector_lists [Hash, nil] list_id => Array of rule ids
+ * @return [Array<Integer>, nil] Rule indices in emit order, or nil if nothing moved
+ */
+VALUE compression_rule_order(VALUE rules_array, VALUE rule_ids, VALUE selector_lists) {
+    long num_rules = NIL_P(rule_ids) ? RARRAY_LEN(rules_array) : RARRAY_LEN(rule_ids);
+    if (num_rules < 3) return Qnil;
+
+    int grouping_enabled = (!NIL_P(selector_lists) && TYPE(selector_lists) == T_HASH && RHASH_SIZE(selector_lists) > 0);
+
+    // Units: [unit_start[u], unit_start[u + 1]) positions of rule_ids that move
+    // together. run_of[u] numbers the run a unit belongs to; -1 marks a barrier.
+    VALUE units_buf;
+    long *unit_start = ALLOCV_N(long, units_buf, 2 * (num_rules + 1));
+    long *run_of = unit_start + num_rules + 1;
+    long num_units = 0;
+    long num_runs = 0;
+    long max_run = 0;
+    long run_len = 0;
+    VALUE run_media = Qundef;
+
+    long pos = 0;
+    while (pos < num_rules) {
+        long i = NIL_P(rule_ids) ? pos : FIX2LONG(RARRAY_AREF(rule_ids, pos));
+        VALUE rule = RARRAY_AREF(rules_array, i);
+        long len = 1;
+        int movable = !rb_obj_is_kind_of(rule, cAtRule);
+        VALUE media_query_id = Qnil;
+
+        if (movable) {
+            media_query_id = rb_struct_aref(rule, INT2FIX(RULE_MEDIA_QUERY_ID));
+            VALUE list_id = grouping_enabled ? rb_struct_aref(rule, INT2FIX(RULE_SELECTOR_LIST_ID)) : Qnil;
+            if (!NIL_P(list_id)) {
+                while (pos + len < num_rules) {
+                    long j = NIL_P(rule_ids) ? pos + len : FIX2LONG(RARRAY_AREF(rule_ids, pos + len));
+                    VALUE next = RARRAY_AREF(rules_array, j);
+                    if (rb_obj_is_kind_of(next, cAtRule) ||
+                        !rb_equal(rb_struct_aref(next, INT2FIX(RULE_SELECTOR_LIST_ID)), list_id) ||
+                        !rb_equal(rb_struct_aref(next, INT2FIX(RULE_MEDIA_QUERY_ID)), media_query_id)) {
+                        break;
+                    }
+                    len++;
+                }
+                VALUE members = rb_hash_aref(selector_lists, list_id);
+                if (NIL_P(members) || RARRAY_LEN(members) != len) movable = 0;
+            }
+        }
+
+        if (!movable) {
+            run_of[num_units] = -1;
+            run_media = Qundef;
+        } else {
+            if (run_media == Qundef || !rb_equal(run_media, media_query_id)) {
+                num_runs++;
+                run_len = 0;
+                run_media = media_query_id;
+            }
+            run_of[num_units] = num_runs - 1;
+            if (++run_len > max_run) max_run = run_len;
+        }
+        unit_start[num_units++] = pos;
+        pos += len;
+    }
+    unit_start[num_units] = num_rules;
+
+    if (max_run < 3) {
+        ALLOCV_END(units_buf);
+        return Qnil;
+    }
+
+    long cap = 1;
+    while (cap < max_run) cap <<= 1;
+
+    VALUE tree_buf;
+    prop_bitset *tree = ALLOCV_N(prop_bitset, tree_buf, 2 * cap);
+
+    // Segments as linked lists of units
+    VALUE segs_buf;
+    long *seg_head = ALLOCV_N(long, segs_buf, 3 * max_run);
+    long *seg_tail = seg_head + max_run;
+    long *unit_next = seg_tail + max_run;  // Indexed by unit - run start
+
+    VALUE order = rb_ary_new_capa(num_rules);
+    VALUE key_to_segment = rb_hash_new();
+    prop_bitset unit_bits, rule_bits;
+    int moved = 0;
+
+    long u = 0;
+    while (u < num_units) {
+        if (run_of[u] < 0) {
+            for (long p = unit_start[u]; p < unit_start[u + 1]; p++) {
+                rb_ary_push(order, LONG2FIX(NIL_P(rule_ids) ? p : FIX2LONG(RARRAY_AREF(rule_ids, p))));
+            }
+            u++;
+            continue;
+        }
+
+        long run_start = u;
+        long run_end = u;
+        while (run_end < num_units && run_of[run_end] == run_of[run_start]) run_end++;
+
+        long run_cap = 1;
+        while (run_cap < run_end - run_start) run_cap <<= 1;
+        memset(tree, 0, 2 * run_cap * sizeof(prop_bitset));
+        rb_hash_clear(key_to_segment);
+        long num_segments = 0;
+
+        for (u = run_start; u < run_end; u++) {
+            long first = NIL_P(rule_ids) ? unit_start[u] : FIX2LONG(RARRAY_AREF(rule_ids, unit_start[u]));
+            uint64_t key = rule_cluster_key(RARRAY_AREF(rules_array, first));
+
+            memset(unit_bits.words, 0, sizeof(unit_bits.words));
+            for (long p = unit_start[u]; p < unit_start[u + 1]; p++) {
+                long i = NIL_P(rule_ids) ? p : FIX2LONG(RARRAY_AREF(rule_ids, p));
+                rule_cascade_bitset(RARRAY_AREF(rules_array, i), &rule_bits);
+                bitset_or(&unit_bits, &rule_bits);
+            }
+
+            VALUE key_val = LONG2FIX((long)(key >> 2));
+            VALUE seg_val = rb_hash_aref(key_to_segment, key_val);
+            long seg = NIL_P(seg_val) ? -1 : FIX2LONG(seg_val);
+
+            // Join the cluster only if no rule emitted after it can conflict
+            if (seg >= 0 && !tree_range_intersects(tree, run_cap, seg + 1, num_segments, &unit_bits)) {
+                if (seg != num_segments - 1) moved = 1;
+                unit_next[seg_tail[seg]] = u - run_start;
+                seg_tail[seg] = u - run_start;
+            } else {
+                seg = num_segments++;
+                seg_head[seg] = seg_tail[seg] = u - run_start;
+                rb_hash_aset(key_to_segment, key_val, LONG2FIX(seg));
+            }
+            unit_next[u - run_start] = -1;
+            tree_add(tree, run_cap, seg, &unit_bits);
+        }
+
+        for (long seg = 0; seg < num_segments; seg++) {
+            for (long k = seg_head[seg]; k >= 0; k = unit_next[k]) {
+                for (long p = unit_start[run_start + k]; p < unit_start[run_start + k + 1]; p++) {
+                    rb_ary_push(order, LONG2FIX(NIL_P(rule_ids) ? p : FIX2LONG(RARRAY_AREF(rule_ids, p))));
+                }
+            }
+        }
+    }
+
+    ALLOCV_END(segs_buf);
+    ALLOCV_END(tree_buf);
+    ALLOCV_END(units_buf);
+
+    RB_GC_GUARD(key_to_segment);
+
+    return moved ? order : Qnil;
+}
@@ -12,12 +12,31 @@
 
 #include "cataract.h"
 #include <string.h>
+#include <time.h>
 #include <stdint.h>
 
 // Use uint8_t for boolean flags to reduce struct size and improve cache efficiency
 // (int is 4 bytes, uint8_t is 1 byte - saves 27 bytes across 9 flags)
 #define BOOLEAN uint8_t
 
+// Read the clock for the :timeout limit once per this many budget charges
+#define BUDGET_CLOCK_INTERVAL 256
+
+// Resource limits for one parse call (parser option :limits), with running
+// totals. A limit of 0 means unlimited.
+typedef struct {
+    long max_rules;           // Rules and at-rules created
+    long max_declarations;    // Declarations across all created rules
+    long max_selectors;       // Selectors in one comma-separated list
+    long max_nested_rules;    // Rules created from CSS nesting
+    double timeout;           // Wall-clock seconds
+    double deadline;          // CLOCK_MONOTONIC time the timeout expires
+    long rules;
+    long declarations;
+    long nested_rules;
+    unsigned long charges;
+} ParseBudget;
+
 // Parser context passed through recursive calls
 typedef struct {
     VALUE rules_array;        // Array of Rule structs
@@ -31,6 +50,7 @@ typedef struct {
     int media_query_id_counter; // Next MediaQuery ID (0-indexed)
     int next_media_query_list_id; // Next media query list ID (0-indexed)
     int media_query_count;    // Safety limit for media queries
+    long source_rule_start;   // Rules before the current source (@import must precede its rules)
     st_table *media_cache;    // Parse-time cache: string => parsed media types
     BOOLEAN has_nesting;      // Set to 1 if any nested rules are created
     BOOLEAN selector_lists_enabled; // Parser option: track selector lists (1=enabled, 0=disabled)
@@ -47,6 +67,7 @@ typedef struct {
     BOOLEAN check_invalid_selector_syntax; // Raise error on syntax violations (.. ## etc)
     BOOLEAN check_malformed_at_rules; // Raise error on @media/@supports without conditions
     BOOLEAN check_unclosed_blocks; // Raise error on missing closing braces
+    ParseBudget *budget;      // Resource limits (NULL if none configured)
 } ParserContext;
 
 // Macro to skip CSS comments /* ... */
@@ -127,6 +148,69 @@ static void raise_parse_error_at(ParserContext *ctx, const char *error_pos, cons
     rb_exc_raise(error);
 }
 
+// Raise LimitError for an exceeded :limits budget
+// Does not return - raises error and exits
+__attribute__((noreturn))
+static void raise_limit_error(const char *limit, VALUE max) {
+    VALUE kwargs = rb_hash_new();
+    rb_hash_aset(kwargs, ID2SYM(rb_intern("limit")), ID2SYM(rb_intern(limit)));
+    rb_hash_aset(kwargs, ID2SYM(rb_intern("max")), max);
+
+    VALUE argv[1] = {kwargs};
+    VALUE error = rb_funcallv_kw(eLimitError, rb_intern("new"), 1, argv, RB_PASS_KEYWORDS);
+    rb_exc_raise(error);
+}
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Count created rules / declarations against the :limits budget
+ *
+ * Called once per rule (with its declaration count, when known up front) and
+ * once per declaration parsed into a nesting block. Does nothing unless
+ * limits are configured; the clock is only read every BUDGET_CLOCK_INTERVAL
+ * charges.
+ */
+static inline void charge_budget(ParserContext *ctx, long rules, long declarations, long nested_rules) {
+    ParseBudget *budget = ctx->budget;
+    if (RB_LIKELY(budget == NULL)) return;
+
+    budget->rules += rules;
+    budget->declarations += declarations;
+    budget->nested_rules += nested_rules;
+
+    if (budget->max_rules > 0 && budget->rules > budget->max_rules) {
+        raise_limit_error("max_rules", LONG2NUM(budget->max_rules));
+    }
+    if (budget->max_declarations > 0 && budget->declarations > budget->max_declarations) {
+        raise_limit_error("max_declarations", LONG2NUM(budget->max_declarations));
+    }
+    if (budget->max_nested_rules > 0 && budget->nested_rules > budget->max_nested_rules) {
+        raise_limit_error("max_nested_rules", LONG2NUM(budget->max_nested_rules));
+    }
+    if (budget->timeout > 0 && ++budget->charges % BUDGET_CLOCK_INTERVAL == 0 &&
+        monotonic_seconds() > budget->deadline) {
+        raise_limit_error("timeout", DBL2NUM(budget->timeout));
+    }
+}
+
+// Check a comma-separated selector list against the :max_selectors budget
+static inline void check_selector_budget(ParserContext *ctx, const char *start, const char *end) {
+    if (RB_LIKELY(ctx->budget == NULL) || ctx->budget->max_selectors <= 0) return;
+
+    long count = 1;
+    for (const char *p = start; p < end; p++) {
+        if (*p == ',') count++;
+    }
+    if (count > ctx->budget->max_selectors) {
+        raise_limit_error("max_selectors", LONG2NUM(ctx->budget->max_selectors));
+    }
+}
+
 // Check if a selector contains only valid CSS selector characters and sequences
 // Returns 1 if valid, 0 if invalid
 // Valid characters: a-z A-Z 0-9 - _ . # [ ] : * > + ~ ( ) ' " = ^ $ | \ & % / whitespace
@@ -446,7 +530,7 @@ static VALUE extract_media_types(const char *query, long query_len) {
 
             if (!is_keyword && !is_media_feature) {
                 // This is a media type - add it as symbol
-                VALUE type_sym = ID2SYM(rb_intern2(word_start, word_len));
+                VALUE type_sym = rb_str_intern(rb_usascii_str_new(word_start, word_len));
                 rb_ary_push(types, type_sym);
             }
         }
@@ -954,12 +1038,14 @@ static VALUE combine_media_queries(VALUE parent, VALUE child) {
         rb_str_append(combined, child_str);
     }
 
-    return ID2SYM(rb_intern_str(combined));
+    return rb_str_intern(combined);
 }
 
 /*
  * Intern media query string to symbol with safety check
  * Keeps media query exactly as written - parentheses are required per CSS spec
+ * Uses rb_str_intern so the symbol is dynamic and can be collected once no
+ * stylesheet references it (rb_intern_str would make it immortal)
  */
 static VALUE intern_media_query_safe(ParserContext *ctx, const char *query_str, long query_len) {
     if (query_len == 0) {
@@ -983,7 +1069,7 @@ static VALUE intern_media_query_safe(ParserContext *ctx, const char *query_str,
 
     long final_len = end - start;
     VALUE query_string = rb_usascii_str_new(start, final_len);
-    VALUE sym = ID2SYM(rb_intern_str(query_string));
+    VALUE sym = rb_str_intern(query_string);
     ctx->media_query_count++;
 
     return sym;
@@ -1057,7 +1143,7 @@ static VALUE parse_mixed_block(ParserContext *ctx, const char *start, const char
                 const char *type_start = mq_ptr;
                 while (mq_ptr < media_query_end_trimmed && !IS_WHITESPACE(*mq_ptr) && *mq_ptr != '(') mq_ptr++;
                 VALUE type_str = rb_utf8_str_new(type_start, mq_ptr - type_start);
-                media_type = ID2SYM(rb_intern_str(type_str));
+                media_type = rb_str_intern(type_str);
 
                 // Skip "and" keyword if present
                 while (mq_ptr < media_query_end_trimmed && IS_WHITESPACE(*mq_ptr)) mq_ptr++;
@@ -1120,8 +1206,8 @@ static VALUE parse_mixed_block(ParserContext *ctx, const char *start, const char
 
                 // Determine combined type (if parent is :all, use child type; if child is :all, use parent type; if both have types, use parent type)
                 VALUE combined_type;
-                ID all_id = rb_intern("all");
-                if (SYM2ID(parent_type) == all_id) {
+                VALUE all_sym = ID2SYM(rb_intern("all"));
+                if (parent_type == all_sym) {
                     combined_type = media_type;
                 } else {
                     combined_type = parent_type;
@@ -1144,6 +1230,7 @@ static VALUE parse_mixed_block(ParserContext *ctx, const char *start, const char
 
             // Parse the block with parse_mixed_block to support further nesting
             // Create a rule ID for this media rule
+            charge_budget(ctx, 1, 0, 1);
             int media_rule_id = ctx->rule_id_counter++;
 
             // Reserve position for parent rule
@@ -1217,6 +1304,7 @@ static VALUE parse_mixed_block(ParserContext *ctx, const char *start, const char
 
             // Split nested selector on commas and create a rule for each
             // Example: "& .child, & .sibling { ... }" creates 2 nested rules
+            check_selector_budget(ctx, nested_sel_start, nested_sel_end);
             const char *seg_start = nested_sel_start;
             const char *seg = nested_sel_start;
 
@@ -1239,6 +1327,7 @@ static VALUE parse_mixed_block(ParserContext *ctx, const char *start, const char
                         VALUE nesting_style = rb_ary_entry(result, 1);
 
                         // Get rule ID
+                        charge_budget(ctx, 1, 0, 1);
                         int rule_id = ctx->rule_id_counter++;
 
                         // Reserve position in rules array (ensures sequential IDs match array indices)
@@ -1363,6 +1452,7 @@ static VALUE parse_mixed_block(ParserContext *ctx, const char *start, const char
                 important ? Qtrue : Qfalse
             );
 
+            charge_budget(ctx, 0, 1, 0);
             rb_ary_push(declarations, decl);
         }
     }
@@ -1484,7 +1574,7 @@ static void parse_import_statement(ParserContext *ctx, const char **p_ptr, const
                             const char *type_start = mq_ptr;
                             while (mq_ptr < query_end && !IS_WHITESPACE(*mq_ptr) && *mq_ptr != '(') mq_ptr++;
                             VALUE type_str = rb_utf8_str_new(type_start, mq_ptr - type_start);
-                            media_type = ID2SYM(rb_intern_str(type_str));
+                            media_type = rb_str_intern(type_str);
 
                             // Skip whitespace
                             while (mq_ptr < query_end && IS_WHITESPACE(*mq_ptr)) mq_ptr++;
@@ -1589,7 +1679,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
             strncmp(p + 1, "import", 6) == 0 && IS_WHITESPACE(p[7]))) {
             DEBUG_PRINTF("[IMPORT] Found @import at position, rules_count=%ld\n", RARRAY_LEN(ctx->rules_array));
             // Check if we've already seen a rule
-            if (RARRAY_LEN(ctx->rules_array) > 0) {
+            if (RARRAY_LEN(ctx->rules_array) > ctx->source_rule_start) {
                 // Warn and skip - @import must come before rules
                 rb_warn("CSS @import ignored: @import must appear before all rules (found import after rules)");
                 // Skip to semicolon
@@ -1676,7 +1766,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
                             const char *type_start = mq_ptr;
                             while (mq_ptr < query_end && !IS_WHITESPACE(*mq_ptr) && *mq_ptr != '(') mq_ptr++;
                             VALUE type_str = rb_utf8_str_new(type_start, mq_ptr - type_start);
-                            media_type = ID2SYM(rb_intern_str(type_str));
+                            media_type = rb_str_intern(type_str);
 
                             // Skip whitespace and "and" keyword if present
                             while (mq_ptr < query_end && IS_WHITESPACE(*mq_ptr)) mq_ptr++;
@@ -1841,7 +1931,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
             BOOLEAN is_keyframes =
                 (at_name_len == 9 && strncmp(at_start, "keyframes", 9) == 0) ||
                 (at_name_len == 17 && strncmp(at_start, "-webkit-keyframes", 17) == 0) ||
-                (at_name_len == 13 && strncmp(at_start, "-moz-keyframes", 13) == 0);
+                (at_name_len == 14 && strncmp(at_start, "-moz-keyframes", 14) == 0);
 
             if (is_keyframes) {
                 // Build full selector string: "@keyframes fade"
@@ -1878,11 +1968,13 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
                     .media_cache = NULL,
                     .has_nesting = 0,
                     .selector_lists_enabled = ctx->selector_lists_enabled,
-                    .depth = 0
+                    .depth = 0,
+                    .budget = ctx->budget
                 };
                 parse_css_recursive(&nested_ctx, block_start, block_end, NO_PARENT_MEDIA, NO_PARENT_SELECTOR, NO_PARENT_RULE_ID, NO_MEDIA_QUERY_ID);
 
                 // Get rule ID and increment
+                charge_budget(ctx, 1, 0, 0);
                 int rule_id = ctx->rule_id_counter++;
 
                 // Create AtRule with nested rules
@@ -1941,6 +2033,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
                 VALUE declarations = parse_declarations(decl_start, decl_end, ctx);
 
                 // Get rule ID and increment
+                charge_budget(ctx, 1, RARRAY_LEN(declarations), 0);
                 int rule_id = ctx->rule_id_counter++;
 
                 // Create AtRule with declarations
@@ -2046,6 +2139,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
                         rb_hash_aset(ctx->selector_lists, INT2FIX(list_id), rule_ids_array);
                     }
 
+                    check_selector_budget(ctx, selector_start, sel_end);
                     const char *seg_start = selector_start;
                     const char *seg = selector_start;
 
@@ -2114,6 +2208,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
                                 }
 
                                 // Get rule ID and increment
+                                charge_budget(ctx, 1, RARRAY_LEN(declarations), 0);
                                 int rule_id = ctx->rule_id_counter++;
 
                                 // Determine selector_list_id value
@@ -2208,6 +2303,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
                         rb_hash_aset(ctx->selector_lists, INT2FIX(list_id), rule_ids_array);
                     }
 
+                    check_selector_budget(ctx, selector_start, sel_end);
                     const char *seg_start = selector_start;
                     const char *seg = selector_start;
 
@@ -2243,6 +2339,7 @@ static void parse_css_recursive(ParserContext *ctx, const char *css, const char
                                 }
 
                                 // Get rule ID for current selector (increment to reserve it)
+                                charge_budget(ctx, 1, 0, 0);
                                 int current_rule_id = ctx->rule_id_counter++;
 
                                 // Reserve parent's position in rules array with placeholder
@@ -2336,16 +2433,10 @@ VALUE parse_media_types(VALUE self, VALUE media_query_sym) {
 }
 
 /*
- * Main parse entry point
- * Returns: { rules: [...], media_index: {...}, charset: "..." | nil, last_rule_id: N }
+ * Set up a parser context: empty result collections, counters starting at
+ * rule_id_offset / 0, and options read from the parser_options Hash
  */
-VALUE parse_css_new_impl(VALUE css_string, VALUE parser_options, int rule_id_offset) {
-    Check_Type(css_string, T_STRING);
-    Check_Type(parser_options, T_HASH);
-
-    DEBUG_PRINTF("\n[PARSE_NEW] ========== NEW PARSE CALL ==========\n");
-    DEBUG_PRINTF("[PARSE_NEW] Input CSS (first 100 chars): %.100s\n", RSTRING_PTR(css_string));
-
+static void init_parser_context(ParserContext *ctx, VALUE parser_options, int rule_id_offset) {
     // Read parser options
     VALUE selector_lists_opt = rb_hash_aref(parser_options, ID2SYM(rb_intern("selector_lists")));
     BOOLEAN selector_lists_enabled = (NIL_P(selector_lists_opt) || RTEST(selector_lists_opt)) ? 1 : 0;
@@ -2391,6 +2482,78 @@ VALUE parse_css_new_impl(VALUE css_string, VALUE parser_options, int rule_id_off
         }
     }
 
+    // Initialize parser context with offset
+    ctx->rules_array = rb_ary_new();
+    ctx->media_index = rb_hash_new();
+    ctx->selector_lists = rb_hash_new();
+    ctx->imports_array = rb_ary_new();
+    ctx->media_queries = rb_ary_new();
+    ctx->media_query_lists = rb_hash_new();
+    ctx->rule_id_counter = rule_id_offset;  // Start from offset
+    ctx->next_selector_list_id = 0;  // Start from 0
+    ctx->media_query_id_counter = 0;  // Start from 0
+    ctx->next_media_query_list_id = 0;  // Start from 0
+    ctx->media_query_count = 0;
+    ctx->source_rule_start = 0;
+    ctx->media_cache = NULL;  // Removed - no perf benefit
+    ctx->has_nesting = 0;  // Will be set to 1 if any nested rules are created
+    ctx->selector_lists_enabled = selector_lists_enabled;
+    ctx->depth = 0;  // Start at depth 0
+    // URL conversion options
+    ctx->base_uri = base_uri;
+    ctx->uri_resolver = uri_resolver;
+    ctx->absolute_paths = absolute_paths;
+    // Parse error options
+    ctx->css_string = Qnil;
+    ctx->check_empty_values = check_empty_values;
+    ctx->check_malformed_declarations = check_malformed_declarations;
+    ctx->check_invalid_selectors = check_invalid_selectors;
+    ctx->check_invalid_selector_syntax = check_invalid_selector_syntax;
+    ctx->check_malformed_at_rules = check_malformed_at_rules;
+    ctx->check_unclosed_blocks = check_unclosed_blocks;
+    ctx->budget = NULL;  // Set by init_parse_budget when :limits is given
+}
+
+// Read one :limits entry (nil = unlimited)
+static long budget_limit(VALUE limits, const char *name) {
+    VALUE value = rb_hash_aref(limits, ID2SYM(rb_intern(name)));
+    return NIL_P(value) ? 0 : NUM2LONG(value);
+}
+
+/*
+ * Set up budget from the :limits parser option and check the input size
+ * Returns: budget, or NULL when no limits are configured
+ */
+static ParseBudget *init_parse_budget(ParseBudget *budget, VALUE parser_options, long input_bytes) {
+    VALUE limits = rb_hash_aref(parser_options, ID2SYM(rb_intern("limits")));
+    if (NIL_P(limits)) return NULL;
+    Check_Type(limits, T_HASH);
+
+    long max_bytes = budget_limit(limits, "max_bytes");
+    if (max_bytes > 0 && input_bytes > max_bytes) {
+        raise_limit_error("max_bytes", LONG2NUM(max_bytes));
+    }
+
+    VALUE timeout = rb_hash_aref(limits, ID2SYM(rb_intern("timeout")));
+
+    memset(budget, 0, sizeof(ParseBudget));
+    budget->max_rules = budget_limit(limits, "max_rules");
+    budget->max_declarations = budget_limit(limits, "max_declarations");
+    budget->max_selectors = budget_limit(limits, "max_selectors");
+    budget->max_nested_rules = budget_limit(limits, "max_nested_rules");
+    budget->timeout = NIL_P(timeout) ? 0 : NUM2DBL(timeout);
+    if (budget->timeout > 0) {
+        budget->deadline = monotonic_seconds() + budget->timeout;
+    }
+    return budget;
+}
+
+/*
+ * Parse one CSS source into ctx, continuing its rule / selector list /
+ * media query numbering
+ * Returns: the source's @charset value, or Qnil
+ */
+static VALUE parse_css_source(ParserContext *ctx, VALUE css_string) {
     const char *css = RSTRING_PTR(css_string);
     const char *pe = css + RSTRING_LEN(css_string);
     const char *p = css;
@@ -2421,53 +2584,113 @@ VALUE parse_css_new_impl(VALUE css_string, VALUE parser_options, int rule_id_off
     // @import statements are now handled in parse_css_recursive
     // They must come before all rules (except @charset) per CSS spec
 
-    // Initialize parser context with offset
-    ParserContext ctx;
-    ctx.rules_array = rb_ary_new();
-    ctx.media_index = rb_hash_new();
-    ctx.selector_lists = rb_hash_new();
-    ctx.imports_array = rb_ary_new();
-    ctx.media_queries = rb_ary_new();
-    ctx.media_query_lists = rb_hash_new();
-    ctx.rule_id_counter = rule_id_offset;  // Start from offset
-    ctx.next_selector_list_id = 0;  // Start from 0
-    ctx.media_query_id_counter = 0;  // Start from 0
-    ctx.next_media_query_list_id = 0;  // Start from 0
-    ctx.media_query_count = 0;
-    ctx.media_cache = NULL;  // Removed - no perf benefit
-    ctx.has_nesting = 0;  // Will be set to 1 if any nested rules are created
-    ctx.selector_lists_enabled = selector_lists_enabled;
-    ctx.depth = 0;  // Start at depth 0
-    // URL conversion options
-    ctx.base_uri = base_uri;
-    ctx.uri_resolver = uri_resolver;
-    ctx.absolute_paths = absolute_paths;
-    // Parse error options
-    ctx.css_string = css_string;
-    ctx.check_empty_values = check_empty_values;
-    ctx.check_malformed_declarations = check_malformed_declarations;
-    ctx.check_invalid_selectors = check_invalid_selectors;
-    ctx.check_invalid_selector_syntax = check_invalid_selector_syntax;
-    ctx.check_malformed_at_rules = check_malformed_at_rules;
-    ctx.check_unclosed_blocks = check_unclosed_blocks;
+    // Error positions and the @import and media query limits are per source
+    ctx->css_string = css_string;
+    ctx->source_rule_start = RARRAY_LEN(ctx->rules_array);
+    ctx->media_query_count = 0;
 
     // Parse CSS (top-level, no parent context)
     DEBUG_PRINTF("[PARSE] Starting parse_css_recursive from: %.80s\n", p);
-    parse_css_recursive(&ctx, p, pe, NO_PARENT_MEDIA, NO_PARENT_SELECTOR, NO_PARENT_RULE_ID, NO_MEDIA_QUERY_ID);
+    parse_css_recursive(ctx, p, pe, NO_PARENT_MEDIA, NO_PARENT_SELECTOR, NO_PARENT_RULE_ID, NO_MEDIA_QUERY_ID);
+
+    RB_GC_GUARD(css_string);
+    return charset;
+}
 
-    // Build result hash
+// Build the result Hash returned to Ruby
+static VALUE build_parse_result(ParserContext *ctx, VALUE charset) {
     VALUE result = rb_hash_new();
-    rb_hash_aset(result, ID2SYM(rb_intern("rules")), ctx.rules_array);
-    rb_hash_aset(result, ID2SYM(rb_intern("_media_index")), ctx.media_index);
-    rb_hash_aset(result, ID2SYM(rb_intern("media_queries")), ctx.media_queries);
-    rb_hash_aset(result, ID2SYM(rb_intern("_selector_lists")), ctx.selector_lists);
-    rb_hash_aset(result, ID2SYM(rb_intern("_media_query_lists")), ctx.media_query_lists);
-    rb_hash_aset(result, ID2SYM(rb_intern("imports")), ctx.imports_array);
+    rb_hash_aset(result, ID2SYM(rb_intern("rules")), ctx->rules_array);
+    rb_hash_aset(result, ID2SYM(rb_intern("_media_index")), ctx->media_index);
+    rb_hash_aset(result, ID2SYM(rb_intern("media_queries")), ctx->media_queries);
+    rb_hash_aset(result, ID2SYM(rb_intern("_selector_lists")), ctx->selector_lists);
+    rb_hash_aset(result, ID2SYM(rb_intern("_media_query_lists")), ctx->media_query_lists);
+    rb_hash_aset(result, ID2SYM(rb_intern("imports")), ctx->imports_array);
     rb_hash_aset(result, ID2SYM(rb_intern("charset")), charset);
-    rb_hash_aset(result, ID2SYM(rb_intern("last_rule_id")), INT2FIX(ctx.rule_id_counter));
-    rb_hash_aset(result, ID2SYM(rb_intern("_has_nesting")), ctx.has_nesting ? Qtrue : Qfalse);
+    rb_hash_aset(result, ID2SYM(rb_intern("last_rule_id")), INT2FIX(ctx->rule_id_counter));
+    rb_hash_aset(result, ID2SYM(rb_intern("_has_nesting")), ctx->has_nesting ? Qtrue : Qfalse);
+    return result;
+}
+
+/*
+ * Main parse entry point
+ * Returns: { rules: [...], media_index: {...}, charset: "..." | nil, last_rule_id: N }
+ */
+VALUE parse_css_new_impl(VALUE css_string, VALUE parser_options, int rule_id_offset) {
+    Check_Type(css_string, T_STRING);
+    Check_Type(parser_options, T_HASH);
+
+    DEBUG_PRINTF("\n[PARSE_NEW] ========== NEW PARSE CALL ==========\n");
+    DEBUG_PRINTF("[PARSE_NEW] Input CSS (first 100 chars): %.100s\n", RSTRING_PTR(css_string));
+
+    ParserContext ctx;
+    ParseBudget budget;
+    init_parser_context(&ctx, parser_options, rule_id_offset);
+    ctx.budget = init_parse_budget(&budget, parser_options, RSTRING_LEN(css_string));
+
+    VALUE charset = parse_css_source(&ctx, css_string);
+    VALUE result = build_parse_result(&ctx, charset);
+
+    RB_GC_GUARD(charset);
+    RB_GC_GUARD(ctx.rules_array);
+    RB_GC_GUARD(ctx.media_index);
+    RB_GC_GUARD(ctx.media_queries);
+    RB_GC_GUARD(ctx.selector_lists);
+    RB_GC_GUARD(ctx.media_query_lists);
+    RB_GC_GUARD(ctx.imports_array);
+    RB_GC_GUARD(ctx.base_uri);
+    RB_GC_GUARD(ctx.uri_resolver);
+    RB_GC_GUARD(result);
+
+    return result;
+}
+
+/*
+ * Parse several CSS sources into one result, sharing a single context
+ *
+ * Rule, selector list, media query and media query list IDs run on across
+ * sources exactly as if the sources had been parsed one after another and
+ * merged, so no remapping is needed afterwards. @import is accepted at the
+ * start of each source. The first @charset wins.
+ *
+ * Returns: the parse_css_new_impl Hash plus
+ *   _import_sources: Array mapping each import to its source index
+ */
+VALUE parse_css_many(VALUE self, VALUE sources, VALUE parser_options) {
+    Check_Type(sources, T_ARRAY);
+    Check_Type(parser_options, T_HASH);
+
+    long count = RARRAY_LEN(sources);
+    long total_bytes = 0;
+    for (long i = 0; i < count; i++) {
+        Check_Type(RARRAY_AREF(sources, i), T_STRING);
+        total_bytes += RSTRING_LEN(RARRAY_AREF(sources, i));
+    }
+
+    // Limits apply to the sources together, as one parse
+    ParserContext ctx;
+    ParseBudget budget;
+    init_parser_context(&ctx, parser_options, 0);
+    ctx.budget = init_parse_budget(&budget, parser_options, total_bytes);
+
+    VALUE charset = Qnil;
+    VALUE import_sources = rb_ary_new();
+    for (long i = 0; i < count; i++) {
+        VALUE source_charset = parse_css_source(&ctx, RARRAY_AREF(sources, i));
+        if (NIL_P(charset)) {
+            charset = source_charset;
+        }
+        while (RARRAY_LEN(import_sources) < RARRAY_LEN(ctx.imports_array)) {
+            rb_ary_push(import_sources, LONG2FIX(i));
+        }
+    }
+
+    VALUE result = build_parse_result(&ctx, charset);
+    rb_hash_aset(result, ID2SYM(rb_intern("_import_sources")), import_sources);
 
+    RB_GC_GUARD(sources);
     RB_GC_GUARD(charset);
+    RB_GC_GUARD(import_sources);
     RB_GC_GUARD(ctx.rules_array);
     RB_GC_GUARD(ctx.media_index);
     RB_GC_GUARD(ctx.media_queries);
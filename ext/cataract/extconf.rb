@@ -23,7 +23,9 @@ end
 
 # Compile main file, parser, flatten, and supporting files
 $objs = ['cataract.o', 'css_parser.o', 'flatten.o', 'shorthand_expander.o', 'specificity.o', 'value_splitter.o',
-         'import_scanner.o']
+         'import_scanner.o', 'media_consolidation.o', 'compression_order.o', 'json_serializer.o',
+         'calc_folder.o', 'value_rewriter.o', 'url_rewriter.o', 'tokenizer.o',
+         'selector_parser.o', 'prefix_pruner.o']
 
 # Suppress warnings
 $CFLAGS << ' -Wno-unused-const-variable' if darwin? || linux?
@@ -1311,18 +1311,62 @@ static void update_selector_lists_for_divergence(VALUE merged_rules, VALUE selec
     DEBUG_PRINTF("\n=== End divergence tracking: %ld selector lists preserved ===\n\n", RHASH_SIZE(selector_lists));
 }
 
+// Check whether a rule's selector passes the selective-flatten filter
+// filter is either a Hash (used as a set of selector strings) or a Regexp
+static inline int selector_matches_filter(VALUE selector, VALUE filter) {
+    if (RB_TYPE_P(filter, T_HASH)) {
+        return RTEST(rb_hash_aref(filter, selector));
+    }
+    return !NIL_P(rb_reg_match(filter, selector));
+}
+
+// Normalize the optional selectors argument into a filter usable by selector_matches_filter
+// Accepts nil (no filter), String, Array of Strings, or Regexp
+static VALUE build_selector_filter(VALUE selectors) {
+    if (NIL_P(selectors) || RB_TYPE_P(selectors, T_REGEXP)) {
+        return selectors;
+    }
+
+    VALUE filter = rb_hash_new();
+    if (RB_TYPE_P(selectors, T_STRING)) {
+        rb_hash_aset(filter, selectors, Qtrue);
+        return filter;
+    }
+
+    if (!RB_TYPE_P(selectors, T_ARRAY)) {
+        rb_raise(rb_eTypeError, "selectors must be a String, Array, or Regexp, got %s",
+                rb_obj_classname(selectors));
+    }
+
+    long len = RARRAY_LEN(selectors);
+    for (long i = 0; i < len; i++) {
+        VALUE selector = RARRAY_AREF(selectors, i);
+        Check_Type(selector, T_STRING);
+        rb_hash_aset(filter, selector, Qtrue);
+    }
+    return filter;
+}
+
 // Flatten CSS rules by applying cascade rules
-// Input: Stylesheet object or CSS string
+// Input: Stylesheet object or CSS string, optional selectors filter
 // Output: Stylesheet with flattened declarations (cascade applied)
-VALUE cataract_flatten(VALUE self, VALUE input) {
+//
+// When selectors is given (String, Array of Strings, or Regexp), only rules whose
+// selector matches are grouped and cascaded; everything else (including AtRules)
+// is skipped, so the result contains just the merged rules for those selectors.
+VALUE cataract_flatten(int argc, VALUE *argv, VALUE self) {
+    VALUE input, selectors;
+    rb_scan_args(argc, argv, "11", &input, &selectors);
+
+    VALUE selector_filter = build_selector_filter(selectors);
     VALUE rules_array;
 
     // Handle different input types
     // Most calls pass Stylesheet (common case), String is rare
     if (TYPE(input) == T_STRING) {
         // Parse CSS string first
-        VALUE argv[1] = { input };
-        VALUE parsed = parse_css_new(1, argv, self);
+        VALUE parse_argv[1] = { input };
+        VALUE parsed = parse_css_new(1, parse_argv, self);
         rules_array = rb_hash_aref(parsed, ID2SYM(rb_intern("rules")));
     } else if (rb_obj_is_kind_of(input, cStylesheet)) {
         // Extract @rules from Stylesheet (common case)
@@ -1478,6 +1522,9 @@ VALUE cataract_flatten(VALUE self, VALUE input) {
         // Handle AtRule objects (@keyframes, @font-face, etc.) - pass through unchanged
         // AtRule has 'content' (string) instead of 'declarations' (array)
         if (rb_obj_is_kind_of(rule, cAtRule)) {
+            // Selective flatten only returns rules for the requested selectors
+            if (!NIL_P(selector_filter)) continue;
+
             DEBUG_PRINTF("  [Rule %ld] PASSTHROUGH: AtRule (e.g., @keyframes, @font-face)\n", i);
             rb_ary_push(passthrough_rules, rule);
             continue;
@@ -1487,6 +1534,10 @@ VALUE cataract_flatten(VALUE self, VALUE input) {
         VALUE selector = rb_struct_aref(rule, INT2FIX(RULE_SELECTOR));
         VALUE rule_id_val = rb_struct_aref(rule, INT2FIX(RULE_ID));
 
+        if (!NIL_P(selector_filter) && !selector_matches_filter(selector, selector_filter)) {
+            continue;
+        }
+
         // Skip empty rules (no declarations)
         // This handles both empty containers and rules with no properties
         if (RARRAY_LEN(declarations) == 0) {
@@ -1661,6 +1712,7 @@ VALUE cataract_flatten(VALUE self, VALUE input) {
         RB_GC_GUARD(passthrough_rules);
         RB_GC_GUARD(old_to_new_id);
         RB_GC_GUARD(new_media_index);
+        RB_GC_GUARD(selector_filter);
 
         return merged_sheet;
     }
@@ -2148,3 +2200,163 @@ VALUE cataract_flatten(VALUE self, VALUE input) {
 
     return merged_sheet;
 }
+
+#define IS_ALPHA(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z'))
+#define IS_IDENT_CHAR(c) (IS_ALPHA(c) || ((c) >= '0' && (c) <= '9') || (c) == '-' || (c) == '_')
+
+// True when a value may be rejected by some browsers, so a declaration of
+// the same property next to it is still needed as the fallback: it holds a
+// vendor-prefixed keyword ("-webkit-box") or a function ("linear-gradient(").
+static int value_needs_fallback(VALUE value) {
+    if (!RB_TYPE_P(value, T_STRING)) return 0;
+
+    const char *ptr = RSTRING_PTR(value);
+    long len = RSTRING_LEN(value);
+    for (long i = 0; i < len; i++) {
+        char c = ptr[i];
+        if (c == '(') return 1;
+        if (c == '-' && i + 1 < len && IS_ALPHA(ptr[i + 1]) && (i == 0 || !IS_IDENT_CHAR(ptr[i - 1]))) {
+            long j = i + 1;
+            while (j < len && IS_IDENT_CHAR(ptr[j]) && ptr[j] != '-') j++;
+            if (j < len && ptr[j] == '-') return 1;
+            i = j - 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Remove declarations that can never win the cascade, without merging rules
+ *
+ * Unlike flatten, rule count and rule order are preserved - only the
+ * declarations arrays are compacted in place. Uses the same grouping key as
+ * flatten: [selector, media_query_id].
+ *
+ * Within a group every rule has identical specificity and matches identical
+ * elements, so for each property exactly one declaration can win:
+ *   1. The last !important declaration, if any
+ *   2. Otherwise the last declaration
+ * Rules with other selectors between group members cannot change this outcome,
+ * since whichever group member wins also beats (or loses to) them on its own.
+ *
+ * When either the new winner or the one it replaces needs a fallback
+ * (vendor-prefixed keyword or function, see value_needs_fallback) the
+ * replaced declarations stay alive, so "display: -webkit-box; display: flex"
+ * and "background: red; background: linear-gradient(...)" are left alone.
+ *
+ * Properties are compared by exact name only. Shorthands are NOT expanded, so
+ * "margin: 0" does not kill an earlier "margin-top" (that would require
+ * expansion and change output shape).
+ *
+ * @param stylesheet [Stylesheet] Stylesheet to compact (mutated)
+ * @return [Integer] Number of declarations removed
+ */
+VALUE cataract_eliminate_dead_declarations(VALUE self, VALUE stylesheet) {
+    if (!rb_obj_is_kind_of(stylesheet, cStylesheet)) {
+        rb_raise(rb_eTypeError, "Expected Stylesheet, got %s", rb_obj_classname(stylesheet));
+    }
+
+    VALUE rules_array = rb_ivar_get(stylesheet, id_ivar_rules);
+    Check_Type(rules_array, T_ARRAY);
+
+    long num_rules = RARRAY_LEN(rules_array);
+    if (num_rules == 0) {
+        return INT2FIX(0);
+    }
+
+    // Pass 1: find the live Declaration objects for each property in each group
+    // group_key => { property => [winner and the fallbacks it keeps, in order] }
+    VALUE groups = rb_hash_new();
+    // rule index => winners hash for its group (nil for AtRules/empty rules)
+    VALUE rule_winners = rb_ary_new_capa(num_rules);
+
+    for (long i = 0; i < num_rules; i++) {
+        VALUE rule = RARRAY_AREF(rules_array, i);
+
+        if (rb_obj_is_kind_of(rule, cAtRule)) {
+            rb_ary_push(rule_winners, Qnil);
+            continue;
+        }
+
+        VALUE declarations = rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS));
+        if (RARRAY_LEN(declarations) == 0) {
+            rb_ary_push(rule_winners, Qnil);
+            continue;
+        }
+
+        VALUE selector = rb_struct_aref(rule, INT2FIX(RULE_SELECTOR));
+        VALUE media_query_id = rb_struct_aref(rule, INT2FIX(RULE_MEDIA_QUERY_ID));
+        VALUE group_key = rb_ary_new3(2, selector, media_query_id);
+
+        VALUE winners = rb_hash_aref(groups, group_key);
+        if (NIL_P(winners)) {
+            winners = rb_hash_new();
+            rb_hash_aset(groups, group_key, winners);
+        }
+        rb_ary_push(rule_winners, winners);
+
+        long num_decls = RARRAY_LEN(declarations);
+        for (long j = 0; j < num_decls; j++) {
+            VALUE decl = RARRAY_AREF(declarations, j);
+            VALUE property = rb_struct_aref(decl, INT2FIX(DECL_PROPERTY));
+            VALUE live = rb_hash_aref(winners, property);
+            VALUE existing = NIL_P(live) ? Qnil : rb_ary_entry(live, -1);
+
+            // Later declaration wins unless it would demote an !important one
+            if (NIL_P(existing) ||
+                RTEST(rb_struct_aref(decl, INT2FIX(DECL_IMPORTANT))) ||
+                !RTEST(rb_struct_aref(existing, INT2FIX(DECL_IMPORTANT)))) {
+                if (NIL_P(live) ||
+                    (!value_needs_fallback(rb_struct_aref(decl, INT2FIX(DECL_VALUE))) &&
+                     !value_needs_fallback(rb_struct_aref(existing, INT2FIX(DECL_VALUE))))) {
+                    live = rb_ary_new_capa(1);
+                    rb_hash_aset(winners, property, live);
+                }
+                rb_ary_push(live, decl);
+            }
+        }
+    }
+
+    // Pass 2: compact each rule's declarations, keeping only live ones (order preserved)
+    long removed = 0;
+    for (long i = 0; i < num_rules; i++) {
+        VALUE winners = RARRAY_AREF(rule_winners, i);
+        if (NIL_P(winners)) continue;
+
+        VALUE rule = RARRAY_AREF(rules_array, i);
+        VALUE declarations = rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS));
+        long num_decls = RARRAY_LEN(declarations);
+        long write_pos = 0;
+
+        for (long j = 0; j < num_decls; j++) {
+            VALUE decl = RARRAY_AREF(declarations, j);
+            VALUE live = rb_hash_aref(winners, rb_struct_aref(decl, INT2FIX(DECL_PROPERTY)));
+
+            // Identity check - live entries are specific Declaration objects
+            int keep = 0;
+            for (long k = 0; k < RARRAY_LEN(live); k++) {
+                if (RARRAY_AREF(live, k) == decl) {
+                    keep = 1;
+                    break;
+                }
+            }
+            if (keep) {
+                if (write_pos != j) {
+                    rb_ary_store(declarations, write_pos, decl);
+                }
+                write_pos++;
+            }
+        }
+
+        if (write_pos < num_decls) {
+            DEBUG_PRINTF("  [Rule %ld] removed %ld dead declarations\n", i, num_decls - write_pos);
+            removed += num_decls - write_pos;
+            rb_ary_resize(declarations, write_pos);
+        }
+    }
+
+    RB_GC_GUARD(groups);
+    RB_GC_GUARD(rule_winners);
+
+    return LONG2NUM(removed);
+}
@@ -0,0 +1,350 @@
+#include <ruby.h>
+#include <ruby/encoding.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "cataract.h"
+
+/*
+ * JSON export of parsed stylesheets
+ *
+ * Writes rules, declarations, media queries, selector lists and imports straight
+ * into one String buffer instead of building a Hash tree for JSON.generate.
+ *
+ * Output shape:
+ *
+ *   {"charset":null,
+ *    "rules":[{"id":0,"type":"rule","selector":"body","declarations":[
+ *               {"property":"color","value":"red","important":false}],
+ *              "parent_rule_id":null,"nesting_style":null,
+ *              "selector_list_id":null,"media_query_id":null}, ...],
+ *    "media_queries":[{"id":0,"type":"print","conditions":null}, ...],
+ *    "media_query_lists":{"0":[0,1]},
+ *    "selector_lists":{"0":[0,1]},
+ *    "imports":[{"id":0,"url":"a.css","media":null,"media_query_id":null,"resolved":false}]}
+ *
+ * At-rules use "type":"at_rule" and a "content" array holding either
+ * declarations (@font-face) or {"selector","declarations"} blocks (@keyframes).
+ *
+ * ESCAPING:
+ * CSS strings are overwhelmingly plain ASCII with nothing to escape, so the
+ * escaper scans 8 bytes at a time with SWAR bit tricks (no intrinsics needed)
+ * and copies clean runs in one memcpy. Only words containing '"', '\\' or a
+ * control byte drop to the per-byte table. UTF-8 passes through untouched.
+ */
+
+#define JSON_ONES  0x0101010101010101ULL
+#define JSON_HIGHS 0x8080808080808080ULL
+
+// Escape table: 0 = copy as-is, 'u' = \u00XX, otherwise the char after the backslash
+static const char json_escape_table[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0
+    // Remaining entries (0x60-0xFF) are zero-initialized
+};
+
+// True if any byte in w is < 0x20, '"' or '\\'
+static inline int json_word_needs_escape(uint64_t w) {
+    uint64_t quote = w ^ (JSON_ONES * '"');
+    uint64_t backslash = w ^ (JSON_ONES * '\\');
+    uint64_t control = (w - JSON_ONES * 0x20) & ~w;
+    uint64_t zero_quote = (quote - JSON_ONES) & ~quote;
+    uint64_t zero_backslash = (backslash - JSON_ONES) & ~backslash;
+    return ((control | zero_quote | zero_backslash) & JSON_HIGHS) != 0;
+}
+
+static void json_append_escaped(VALUE buf, const char *str, long len) {
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char *p = (const unsigned char *)str;
+    const unsigned char *end = p + len;
+    const unsigned char *run = p;
+
+    rb_str_buf_cat(buf, "\"", 1);
+
+    while (p < end) {
+        // Fast path: skip whole words with nothing to escape
+        while (end - p >= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            if (json_word_needs_escape(w)) break;
+            p += 8;
+        }
+        if (p >= end) break;
+
+        char esc = json_escape_table[*p];
+        if (!esc) {
+            p++;
+            continue;
+        }
+
+        if (p > run) rb_str_buf_cat(buf, (const char *)run, p - run);
+        if (esc == 'u') {
+            char seq[6] = {'\\', 'u', '0', '0', hex[*p >> 4], hex[*p & 0xF]};
+            rb_str_buf_cat(buf, seq, 6);
+        } else {
+            char seq[2] = {'\\', esc};
+            rb_str_buf_cat(buf, seq, 2);
+        }
+        p++;
+        run = p;
+    }
+
+    if (end > run) rb_str_buf_cat(buf, (const char *)run, end - run);
+    rb_str_buf_cat(buf, "\"", 1);
+}
+
+static void json_append_literal(VALUE buf, const char *str) {
+    rb_str_buf_cat(buf, str, strlen(str));
+}
+
+static void json_append_key(VALUE buf, const char *key, int first) {
+    if (!first) rb_str_buf_cat(buf, ",", 1);
+    rb_str_buf_cat(buf, "\"", 1);
+    rb_str_buf_cat(buf, key, strlen(key));
+    rb_str_buf_cat(buf, "\":", 2);
+}
+
+static void json_append_long(VALUE buf, long n) {
+    char num[24];
+    int len = snprintf(num, sizeof(num), "%ld", n);
+    rb_str_buf_cat(buf, num, len);
+}
+
+// String, Symbol, Integer, true/false or nil
+static void json_append_value(VALUE buf, VALUE val) {
+    if (NIL_P(val)) {
+        json_append_literal(buf, "null");
+    } else if (val == Qtrue) {
+        json_append_literal(buf, "true");
+    } else if (val == Qfalse) {
+        json_append_literal(buf, "false");
+    } else if (FIXNUM_P(val)) {
+        json_append_long(buf, FIX2LONG(val));
+    } else if (SYMBOL_P(val)) {
+        VALUE str = rb_sym2str(val);
+        json_append_escaped(buf, RSTRING_PTR(str), RSTRING_LEN(str));
+    } else {
+        VALUE str = rb_obj_as_string(val);
+        json_append_escaped(buf, RSTRING_PTR(str), RSTRING_LEN(str));
+        RB_GC_GUARD(str);
+    }
+}
+
+static void json_append_declaration(VALUE buf, VALUE decl) {
+    rb_str_buf_cat(buf, "{", 1);
+    json_append_key(buf, "property", 1);
+    json_append_value(buf, rb_struct_aref(decl, INT2FIX(DECL_PROPERTY)));
+    json_append_key(buf, "value", 0);
+    json_append_value(buf, rb_struct_aref(decl, INT2FIX(DECL_VALUE)));
+    json_append_key(buf, "important", 0);
+    json_append_value(buf, RTEST(rb_struct_aref(decl, INT2FIX(DECL_IMPORTANT))) ? Qtrue : Qfalse);
+    rb_str_buf_cat(buf, "}", 1);
+}
+
+static void json_append_declarations(VALUE buf, VALUE declarations) {
+    rb_str_buf_cat(buf, "[", 1);
+    long len = NIL_P(declarations) ? 0 : RARRAY_LEN(declarations);
+    for (long i = 0; i < len; i++) {
+        if (i > 0) rb_str_buf_cat(buf, ",", 1);
+        json_append_declaration(buf, RARRAY_AREF(declarations, i));
+    }
+    rb_str_buf_cat(buf, "]", 1);
+}
+
+static VALUE json_rule_specificity(VALUE rule) {
+    VALUE specificity = rb_struct_aref(rule, INT2FIX(RULE_SPECIFICITY));
+    if (NIL_P(specificity)) {
+        // Calculate and cache, same as Rule#specificity
+        specificity = calculate_specificity(Qnil, rb_struct_aref(rule, INT2FIX(RULE_SELECTOR)));
+        rb_struct_aset(rule, INT2FIX(RULE_SPECIFICITY), specificity);
+    }
+    return specificity;
+}
+
+static void json_append_rule(VALUE buf, VALUE rule, int include_specificity) {
+    rb_str_buf_cat(buf, "{", 1);
+    json_append_key(buf, "id", 1);
+    json_append_value(buf, rb_struct_aref(rule, INT2FIX(RULE_ID)));
+
+    if (rb_obj_is_kind_of(rule, cAtRule)) {
+        json_append_key(buf, "type", 0);
+        json_append_literal(buf, "\"at_rule\"");
+        json_append_key(buf, "selector", 0);
+        json_append_value(buf, rb_struct_aref(rule, INT2FIX(AT_RULE_SELECTOR)));
+
+        // Content is either Declarations (@font-face) or Rules (@keyframes blocks)
+        json_append_key(buf, "content", 0);
+        VALUE content = rb_struct_aref(rule, INT2FIX(AT_RULE_CONTENT));
+        long len = NIL_P(content) ? 0 : RARRAY_LEN(content);
+        rb_str_buf_cat(buf, "[", 1);
+        for (long i = 0; i < len; i++) {
+            VALUE item = RARRAY_AREF(content, i);
+            if (i > 0) rb_str_buf_cat(buf, ",", 1);
+            if (rb_obj_is_kind_of(item, cDeclaration)) {
+                json_append_declaration(buf, item);
+            } else {
+                rb_str_buf_cat(buf, "{", 1);
+                json_append_key(buf, "selector", 1);
+                json_append_value(buf, rb_struct_aref(item, INT2FIX(RULE_SELECTOR)));
+                json_append_key(buf, "declarations", 0);
+                json_append_declarations(buf, rb_struct_aref(item, INT2FIX(RULE_DECLARATIONS)));
+                rb_str_buf_cat(buf, "}", 1);
+            }
+        }
+        rb_str_buf_cat(buf, "]", 1);
+
+        json_append_key(buf, "media_query_id", 0);
+        json_append_value(buf, rb_struct_aref(rule, INT2FIX(AT_RULE_MEDIA_QUERY_ID)));
+        rb_str_buf_cat(buf, "}", 1);
+        return;
+    }
+
+    json_append_key(buf, "type", 0);
+    json_append_literal(buf, "\"rule\"");
+    json_append_key(buf, "selector", 0);
+    json_append_value(buf, rb_struct_aref(rule, INT2FIX(RULE_SELECTOR)));
+    if (include_specificity) {
+        json_append_key(buf, "specificity", 0);
+        json_append_value(buf, json_rule_specificity(rule));
+    }
+    json_append_key(buf, "declarations", 0);
+    json_append_declarations(buf, rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS)));
+    json_append_key(buf, "parent_rule_id", 0);
+    json_append_value(buf, rb_struct_aref(rule, INT2FIX(RULE_PARENT_RULE_ID)));
+    json_append_key(buf, "nesting_style", 0);
+    json_append_value(buf, rb_struct_aref(rule, INT2FIX(RULE_NESTING_STYLE)));
+    json_append_key(buf, "selector_list_id", 0);
+    json_append_value(buf, rb_struct_aref(rule, INT2FIX(RULE_SELECTOR_LIST_ID)));
+    json_append_key(buf, "media_query_id", 0);
+    json_append_value(buf, rb_struct_aref(rule, INT2FIX(RULE_MEDIA_QUERY_ID)));
+    rb_str_buf_cat(buf, "}", 1);
+}
+
+static int json_append_id_list_i(VALUE key, VALUE ids, VALUE arg) {
+    VALUE *state = (VALUE *)arg;
+    VALUE buf = state[0];
+
+    if (state[1] == Qtrue) {
+        state[1] = Qfalse;
+    } else {
+        rb_str_buf_cat(buf, ",", 1);
+    }
+
+    // JSON object keys must be strings
+    VALUE key_str = rb_obj_as_string(key);
+    json_append_escaped(buf, RSTRING_PTR(key_str), RSTRING_LEN(key_str));
+    rb_str_buf_cat(buf, ":[", 2);
+    long len = RARRAY_LEN(ids);
+    for (long i = 0; i < len; i++) {
+        if (i > 0) rb_str_buf_cat(buf, ",", 1);
+        json_append_value(buf, RARRAY_AREF(ids, i));
+    }
+    rb_str_buf_cat(buf, "]", 1);
+    RB_GC_GUARD(key_str);
+    return ST_CONTINUE;
+}
+
+// Hash of id => Array<Integer> (selector lists, media query lists)
+static void json_append_id_lists(VALUE buf, VALUE lists) {
+    rb_str_buf_cat(buf, "{", 1);
+    if (!NIL_P(lists)) {
+        VALUE state[2] = {buf, Qtrue};
+        rb_hash_foreach(lists, json_append_id_list_i, (VALUE)state);
+    }
+    rb_str_buf_cat(buf, "}", 1);
+}
+
+/*
+ * Serialize a stylesheet's parsed structure to a JSON string
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules
+ * @param charset [String, nil] @charset value
+ * @param media_queries [Array<MediaQuery>] MediaQuery objects
+ * @param media_query_lists [Hash] list_id => Array of MediaQuery ids
+ * @param selector_lists [Hash] list_id => Array of rule ids
+ * @param imports [Array<ImportStatement>] Import statements
+ * @param options [Hash, nil] :specificity => include each rule's specificity
+ * @return [String] UTF-8 JSON string
+ */
+VALUE stylesheet_to_json(int argc, VALUE *argv, VALUE self) {
+    VALUE rules_array, charset, media_queries, media_query_lists, selector_lists, imports, options;
+    rb_scan_args(argc, argv, "61", &rules_array, &charset, &media_queries, &media_query_lists,
+                 &selector_lists, &imports, &options);
+
+    Check_Type(rules_array, T_ARRAY);
+
+    int include_specificity = 0;
+    if (!NIL_P(options)) {
+        Check_Type(options, T_HASH);
+        include_specificity = RTEST(rb_hash_aref(options, ID2SYM(rb_intern("specificity"))));
+    }
+
+    long num_rules = RARRAY_LEN(rules_array);
+    VALUE buf = STR_NEW_WITH_CAPACITY(num_rules * 192 + 128);
+
+    rb_str_buf_cat(buf, "{", 1);
+    json_append_key(buf, "charset", 1);
+    json_append_value(buf, charset);
+
+    json_append_key(buf, "rules", 0);
+    rb_str_buf_cat(buf, "[", 1);
+    for (long i = 0; i < num_rules; i++) {
+        if (i > 0) rb_str_buf_cat(buf, ",", 1);
+        json_append_rule(buf, RARRAY_AREF(rules_array, i), include_specificity);
+    }
+    rb_str_buf_cat(buf, "]", 1);
+
+    json_append_key(buf, "media_queries", 0);
+    rb_str_buf_cat(buf, "[", 1);
+    long num_mqs = NIL_P(media_queries) ? 0 : RARRAY_LEN(media_queries);
+    for (long i = 0; i < num_mqs; i++) {
+        VALUE mq = RARRAY_AREF(media_queries, i);
+        if (i > 0) rb_str_buf_cat(buf, ",", 1);
+        rb_str_buf_cat(buf, "{", 1);
+        json_append_key(buf, "id", 1);
+        json_append_value(buf, rb_struct_aref(mq, INT2FIX(0)));
+        json_append_key(buf, "type", 0);
+        json_append_value(buf, rb_struct_aref(mq, INT2FIX(1)));
+        json_append_key(buf, "conditions", 0);
+        json_append_value(buf, rb_struct_aref(mq, INT2FIX(2)));
+        rb_str_buf_cat(buf, "}", 1);
+    }
+    rb_str_buf_cat(buf, "]", 1);
+
+    json_append_key(buf, "media_query_lists", 0);
+    json_append_id_lists(buf, media_query_lists);
+    json_append_key(buf, "selector_lists", 0);
+    json_append_id_lists(buf, selector_lists);
+
+    json_append_key(buf, "imports", 0);
+    rb_str_buf_cat(buf, "[", 1);
+    long num_imports = NIL_P(imports) ? 0 : RARRAY_LEN(imports);
+    for (long i = 0; i < num_imports; i++) {
+        VALUE import = RARRAY_AREF(imports, i);
+        if (i > 0) rb_str_buf_cat(buf, ",", 1);
+        rb_str_buf_cat(buf, "{", 1);
+        json_append_key(buf, "id", 1);
+        json_append_value(buf, rb_struct_aref(import, INT2FIX(0)));
+        json_append_key(buf, "url", 0);
+        json_append_value(buf, rb_struct_aref(import, INT2FIX(1)));
+        json_append_key(buf, "media", 0);
+        json_append_value(buf, rb_struct_aref(import, INT2FIX(2)));
+        json_append_key(buf, "media_query_id", 0);
+        json_append_value(buf, rb_struct_aref(import, INT2FIX(3)));
+        json_append_key(buf, "resolved", 0);
+        json_append_value(buf, RTEST(rb_struct_aref(import, INT2FIX(4))) ? Qtrue : Qfalse);
+        rb_str_buf_cat(buf, "}", 1);
+    }
+    rb_str_buf_cat(buf, "]", 1);
+
+    rb_str_buf_cat(buf, "}", 1);
+    rb_enc_associate(buf, rb_utf8_encoding());
+
+    RB_GC_GUARD(rules_array);
+    RB_GC_GUARD(buf);
+    return buf;
+}
@@ -0,0 +1,316 @@
+#include <ruby.h>
+#include <string.h>
+#include <stdint.h>
+#include "cataract.h"
+
+/*
+ * Media block consolidation for serialization
+ *
+ * Framework CSS interleaves the same @media block many times:
+ *
+ *   .a { color: red; }
+ *   @media (min-width: 768px) { .a { color: blue; } }
+ *   .b { margin: 0; }
+ *   @media (min-width: 768px) { .b { margin: 4px; } }
+ *
+ * The serializer only merges *consecutive* rules with the same media query, so
+ * every block is re-emitted. This pass computes an alternate emit order that
+ * moves a media rule back into the most recent block with an identical media
+ * query, as long as doing so cannot change the cascade.
+ *
+ * SAFETY:
+ * Moving rule R earlier past rule X only matters when both could match the same
+ * element, set the same property, and tie on importance and specificity (then
+ * source order decides). Element matching is not provable from selectors, so we
+ * assume any two rules may overlap and only check the remaining three keys.
+ *
+ * Each rule gets a bitset of hashed (property family, specificity, important)
+ * keys. Each open media block tracks the union of bitsets for rules emitted
+ * after it. R is moved into its block only if the two bitsets don't intersect.
+ * Hash collisions only ever make us more conservative.
+ *
+ * Property families group shorthands with their longhands (margin-top -> margin,
+ * border-left-color -> border) and logical with physical properties
+ * (inline-size -> width), since those interact through source order too.
+ */
+
+// Latest open block for one media query text
+struct media_block {
+    long segment;           // Index of this block's segment in the output
+    prop_bitset after;      // Union of property keys emitted after the block
+};
+
+// Map the first hyphen-separated segment of a property to a family name.
+// Families exist so that shorthand/longhand and logical/physical pairs collide.
+struct family_alias {
+    const char *segment;
+    const char *family;
+};
+
+static const struct family_alias FAMILY_ALIASES[] = {
+    // inset shorthand and physical offsets
+    {"top", "inset"}, {"right", "inset"}, {"bottom", "inset"}, {"left", "inset"},
+    // place-* shorthands cover align-* and justify-*
+    {"align", "place"}, {"justify", "place"},
+    // gap / grid-gap / row-gap / column-gap / columns
+    {"row", "gap"}, {"column", "gap"}, {"columns", "gap"}, {"grid", "gap"},
+    // Logical and physical sizing
+    {"inline", "width"}, {"block", "width"}, {"height", "width"}, {"min", "width"}, {"max", "width"},
+    // font shorthand resets line-height
+    {"line", "font"},
+    // white-space shorthand covers text-wrap-mode
+    {"white", "text"},
+    // word-wrap is a legacy alias of overflow-wrap
+    {"word", "overflow"},
+    // page-break-* is a legacy alias of break-*
+    {"page", "break"},
+    {NULL, NULL}
+};
+
+/*
+ * Property family a declaration cascades with
+ *
+ * @param property [String] Property name
+ * @param family [const char **] Set to the start of the family name (points
+ *   into property or a static alias, not NUL-terminated)
+ * @return [long] Length of the family name
+ */
+long property_family(VALUE property, const char **family) {
+    const char *p = RSTRING_PTR(property);
+    long len = RSTRING_LEN(property);
+    long family_len = len;
+    *family = p;
+
+    // Custom properties cascade independently by full name
+    if (!(len >= 2 && p[0] == '-' && p[1] == '-')) {
+        // Strip vendor prefix: -webkit-transition -> transition
+        if (len > 1 && p[0] == '-') {
+            const char *dash = memchr(p + 1, '-', len - 1);
+            if (dash) {
+                *family = dash + 1;
+                family_len = len - (*family - p);
+            }
+        }
+
+        // First segment is the family: margin-top -> margin
+        const char *dash = memchr(*family, '-', family_len);
+        if (dash) family_len = dash - *family;
+
+        for (const struct family_alias *a = FAMILY_ALIASES; a->segment; a++) {
+            if ((long)strlen(a->segment) == family_len && memcmp(a->segment, *family, family_len) == 0) {
+                *family = a->family;
+                family_len = strlen(a->family);
+                break;
+            }
+        }
+    }
+
+    return family_len;
+}
+
+/*
+ * Cataract._property_family(property) - family a property cascades with
+ *
+ * Exposes property_family for Ruby callers that need the same grouping
+ * (StylesheetSplit).
+ *
+ * @api private
+ * @param property [String] Property name
+ * @return [String] e.g. "margin" for "margin-top", "width" for "inline-size"
+ */
+VALUE cataract_property_family(VALUE self, VALUE property) {
+    Check_Type(property, T_STRING);
+
+    const char *family;
+    long family_len = property_family(property, &family);
+    return rb_utf8_str_new(family, family_len);
+}
+
+// Hash a declaration's cascade key: (property family, specificity, important)
+static uint64_t cascade_key_hash(VALUE property, long specificity, int important) {
+    const char *family;
+    long family_len = property_family(property, &family);
+
+    uint64_t h = fnv1a(family, family_len, FNV1A_OFFSET);
+    h ^= (uint64_t)specificity * 0x9E3779B97F4A7C15ULL;
+    h ^= important ? 0xC2B2AE3D27D4EB4FULL : 0;
+    return h;
+}
+
+static inline void bitset_set(prop_bitset *set, uint64_t hash) {
+    uint64_t bit = hash % CONSOLIDATION_BITSET_BITS;
+    set->words[bit / 64] |= (1ULL << (bit % 64));
+}
+
+static inline void bitset_fill(prop_bitset *set) {
+    memset(set->words, 0xFF, sizeof(set->words));
+}
+
+// Build the bitset of cascade keys for a rule's declarations
+void rule_cascade_bitset(VALUE rule, prop_bitset *set) {
+    memset(set->words, 0, sizeof(set->words));
+
+    VALUE declarations = rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS));
+    long num_decls = RARRAY_LEN(declarations);
+    if (num_decls == 0) return;
+
+    VALUE specificity = rb_struct_aref(rule, INT2FIX(RULE_SPECIFICITY));
+    if (NIL_P(specificity)) {
+        specificity = calculate_specificity(Qnil, rb_struct_aref(rule, INT2FIX(RULE_SELECTOR)));
+    }
+    long spec = NUM2LONG(specificity);
+
+    for (long i = 0; i < num_decls; i++) {
+        VALUE decl = RARRAY_AREF(declarations, i);
+        VALUE property = rb_struct_aref(decl, INT2FIX(DECL_PROPERTY));
+
+        // "all" resets every property - conflicts with everything
+        if (STR_EQ(property, "all")) {
+            bitset_fill(set);
+            return;
+        }
+
+        int important = RTEST(rb_struct_aref(decl, INT2FIX(DECL_IMPORTANT)));
+        bitset_set(set, cascade_key_hash(property, spec, important));
+    }
+}
+
+// Build the identity key for a rule's media query: the full query text including
+// every query in a comma-separated list. Rules with equal keys print identical
+// @media preludes.
+static VALUE media_block_key(VALUE media_query_id, VALUE mq_id_to_list_id, VALUE media_query_lists, VALUE media_queries) {
+    VALUE key = rb_str_buf_new(32);
+    VALUE list_id = rb_hash_aref(mq_id_to_list_id, media_query_id);
+    VALUE mq_ids = NIL_P(list_id) ? Qnil : rb_hash_aref(media_query_lists, list_id);
+    long count = NIL_P(mq_ids) ? 1 : RARRAY_LEN(mq_ids);
+
+    for (long i = 0; i < count; i++) {
+        VALUE mq_id = NIL_P(mq_ids) ? media_query_id : RARRAY_AREF(mq_ids, i);
+        VALUE mq = rb_ary_entry(media_queries, FIX2LONG(mq_id));
+        if (NIL_P(mq)) continue;
+
+        VALUE type = rb_struct_aref(mq, INT2FIX(1)); // type field
+        VALUE conditions = rb_struct_aref(mq, INT2FIX(2)); // conditions field
+        rb_str_append(key, rb_sym2str(type));
+        rb_str_cat(key, "\0", 1);
+        if (!NIL_P(conditions)) rb_str_append(key, conditions);
+        rb_str_cat(key, "\n", 1);
+    }
+
+    return key;
+}
+
+/*
+ * Compute a consolidated emit order for rules
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules in source order
+ * @param rule_ids [Array<Integer>, nil] Subset of rule indices to order, or nil for all rules
+ * @param media_queries [Array<MediaQuery>] MediaQuery objects by id
+ * @param media_query_lists [Hash] list_id => Array of MediaQuery ids
+ * @param mq_id_to_list_id [Hash] Reverse map media_query_id => list_id
+ * @return [Array<Integer>, nil] Rule indices in emit order, or nil if nothing moved
+ */
+VALUE consolidate_media_rule_order(VALUE rules_array, VALUE rule_ids, VALUE media_queries, VALUE media_query_lists, VALUE mq_id_to_list_id) {
+    long num_rules = NIL_P(rule_ids) ? RARRAY_LEN(rules_array) : RARRAY_LEN(rule_ids);
+    if (num_rules < 2) return Qnil;
+
+    // Output is a list of segments (arrays of rule indices). A media segment is
+    // a run of rules with the same media key; others hold non-media rules.
+    VALUE segments = rb_ary_new();
+    VALUE segment_keys = rb_ary_new();      // Parallel to segments: media key or nil
+
+    // Per media query: key => index into blocks
+    VALUE mq_id_to_key = rb_hash_new();     // Memoized media_query_id => key
+    VALUE key_to_block = rb_hash_new();
+
+    // At most one open block per distinct media query
+    long num_blocks = 0;
+    VALUE blocks_buf;
+    struct media_block *blocks = ALLOCV_N(struct media_block, blocks_buf, RARRAY_LEN(media_queries) + 1);
+
+    prop_bitset rule_bits;
+    int moved = 0;
+
+    for (long n = 0; n < num_rules; n++) {
+        long i = NIL_P(rule_ids) ? n : FIX2LONG(RARRAY_AREF(rule_ids, n));
+        VALUE rule = RARRAY_AREF(rules_array, i);
+        VALUE key = Qnil;
+
+        if (!rb_obj_is_kind_of(rule, cAtRule)) {
+            VALUE media_query_id = rb_struct_aref(rule, INT2FIX(RULE_MEDIA_QUERY_ID));
+            if (!NIL_P(media_query_id)) {
+                key = rb_hash_aref(mq_id_to_key, media_query_id);
+                if (NIL_P(key)) {
+                    key = media_block_key(media_query_id, mq_id_to_list_id, media_query_lists, media_queries);
+                    rb_hash_aset(mq_id_to_key, media_query_id, key);
+                }
+            }
+            rule_cascade_bitset(rule, &rule_bits);
+        } else {
+            memset(rule_bits.words, 0, sizeof(rule_bits.words));
+        }
+
+        long last_segment = RARRAY_LEN(segments) - 1;
+        long target_segment = -1;
+        long block_idx = -1;
+
+        if (!NIL_P(key)) {
+            VALUE block_val = rb_hash_aref(key_to_block, key);
+            if (!NIL_P(block_val)) {
+                block_idx = FIX2LONG(block_val);
+                // Move into the open block only if nothing after it can conflict
+                if (!bitset_intersects(&rule_bits, &blocks[block_idx].after)) {
+                    target_segment = blocks[block_idx].segment;
+                }
+            }
+        }
+
+        if (target_segment >= 0) {
+            if (target_segment != last_segment) moved = 1;
+            rb_ary_push(RARRAY_AREF(segments, target_segment), LONG2FIX(i));
+        } else if (!NIL_P(key) || last_segment < 0 || !NIL_P(RARRAY_AREF(segment_keys, last_segment))) {
+            // Start a new segment (media rules always do, non-media after a media run)
+            target_segment = last_segment + 1;
+            rb_ary_push(segments, rb_ary_new_from_args(1, LONG2FIX(i)));
+            rb_ary_push(segment_keys, key);
+
+            if (!NIL_P(key)) {
+                // This becomes the open block for its media query
+                if (block_idx < 0) {
+                    block_idx = num_blocks++;
+                    rb_hash_aset(key_to_block, key, LONG2FIX(block_idx));
+                }
+                blocks[block_idx].segment = target_segment;
+                memset(blocks[block_idx].after.words, 0, sizeof(prop_bitset));
+            }
+        } else {
+            // Extend trailing non-media segment
+            target_segment = last_segment;
+            rb_ary_push(RARRAY_AREF(segments, last_segment), LONG2FIX(i));
+        }
+
+        // Everything positioned after this rule's segment now has it in between
+        for (long b = 0; b < num_blocks; b++) {
+            if (blocks[b].segment < target_segment) {
+                bitset_or(&blocks[b].after, &rule_bits);
+            }
+        }
+    }
+
+    ALLOCV_END(blocks_buf);
+
+    if (!moved) return Qnil;
+
+    VALUE order = rb_ary_new_capa(num_rules);
+    long num_segments = RARRAY_LEN(segments);
+    for (long s = 0; s < num_segments; s++) {
+        rb_ary_concat(order, RARRAY_AREF(segments, s));
+    }
+
+    RB_GC_GUARD(segments);
+    RB_GC_GUARD(segment_keys);
+    RB_GC_GUARD(mq_id_to_key);
+    RB_GC_GUARD(key_to_block);
+
+    return order;
+}
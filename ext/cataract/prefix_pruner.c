@@ -0,0 +1,467 @@
+#include <ruby.h>
+#include <ruby/encoding.h>
+#include <string.h>
+#include "cataract.h"
+
+/*
+ * Vendor prefix pruning
+ *
+ * Removes -webkit-, -moz-, -ms- and -o- forms the target browsers don't need:
+ *
+ *   .a { -webkit-transition: x; -moz-transition: x; transition: x; }
+ *   => .a { transition: x; }
+ *
+ * Ruby (Cataract::PrefixTable) compiles a capability table and a set of
+ * targets into one action per prefixed name, so this pass only does Hash
+ * lookups:
+ *
+ *   true   - keep (some target needs it)
+ *   false  - remove (no target parses this prefix)
+ *   String - the standard form: a target parses the prefix but doesn't need
+ *            it. Selectors and at-rule names are renamed to it, or removed
+ *            when the standard form is already there. A property and its
+ *            standard form count as one: the cascade winner among them is
+ *            kept under the standard name and the rest removed. Values are
+ *            removed when the declaration has an unprefixed fallback for the
+ *            same property, and kept otherwise.
+ *
+ * Property names are looked up whole, then by shorter '-'-separated heads, so
+ * an entry for "-webkit-animation" also covers "-webkit-animation-name" (its
+ * standard form gets the same tail); longhands that don't follow the head,
+ * like "-webkit-mask-composite", have their own entry. Values, selectors and
+ * at-rules need an exact entry (":-moz-placeholder" must not cover
+ * ":-moz-placeholder-shown").
+ * Names with no entry fall back to the vendor prefix alone ("-webkit-" =>
+ * true/false); unknown prefixes are kept.
+ *
+ * Selector and at-rule actions apply per rule. A removed rule is reported
+ * back so Stylesheet can renumber once; declaration edits happen in place.
+ */
+
+typedef struct {
+    VALUE properties;
+    VALUE values;
+    VALUE selectors;
+    VALUE at_rules;
+    VALUE prefixes;
+    VALUE existing;     // [media_query_id, selector] => true, built on first rename
+    VALUE rules;
+} prefix_tables;
+
+#define IS_ALPHA(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z'))
+#define IS_IDENT_CHAR(c) (IS_ALPHA(c) || ((c) >= '0' && (c) <= '9') || (c) == '-' || (c) == '_')
+
+// Action for the prefixed name ptr[0, len) whose vendor prefix starts at
+// ptr[start], trying shorter heads when `heads` is set. *matched is the
+// length of the matched table key, 0 when the action came from the prefix
+// fallback.
+static VALUE lookup_action(VALUE table, VALUE prefixes, const char *ptr, long len, long start, int heads, long *matched) {
+    long prefix_end = -1;
+    for (long i = start + 1; i < len; i++) {
+        if (ptr[i] == '-') {
+            prefix_end = i + 1;
+            break;
+        }
+    }
+    *matched = 0;
+    if (prefix_end < 0 || prefix_end >= len) return Qtrue;
+
+    long l = len;
+    while (l > prefix_end) {
+        VALUE action = rb_hash_lookup2(table, rb_utf8_str_new(ptr, l), Qundef);
+        if (action != Qundef) {
+            *matched = l;
+            return action;
+        }
+        if (!heads) break;
+        do {
+            l--;
+        } while (l > prefix_end && ptr[l] != '-');
+    }
+    return rb_hash_lookup2(prefixes, rb_utf8_str_new(ptr + start, prefix_end - start), Qtrue);
+}
+
+// Standard form for a String action: the action plus the unmatched tail
+static VALUE standard_name(VALUE action, const char *ptr, long len, long matched) {
+    if (matched >= len) return action;
+
+    VALUE name = rb_str_dup(action);
+    rb_str_cat(name, ptr + matched, len - matched);
+    return name;
+}
+
+static int url_at(const char *ptr, long len, long i) {
+    return i + 3 < len &&
+           (ptr[i] == 'u' || ptr[i] == 'U') &&
+           (ptr[i + 1] == 'r' || ptr[i + 1] == 'R') &&
+           (ptr[i + 2] == 'l' || ptr[i + 2] == 'L') &&
+           ptr[i + 3] == '(';
+}
+
+// Index just past the quoted string starting at ptr[i]
+static long skip_quoted(const char *ptr, long len, long i) {
+    char quote = ptr[i++];
+    while (i < len && ptr[i] != quote) {
+        i += (ptr[i] == '\\' && i + 1 < len) ? 2 : 1;
+    }
+    return i < len ? i + 1 : len;
+}
+
+// Worst action over the prefixed keywords of a value ("-webkit-box",
+// "-moz-calc(...)"): false beats a String beats true. Strings and url()
+// contents are skipped.
+static VALUE value_action(const prefix_tables *t, VALUE value) {
+    if (!RB_TYPE_P(value, T_STRING)) return Qtrue;
+
+    const char *ptr = RSTRING_PTR(value);
+    long len = RSTRING_LEN(value);
+    if (!memchr(ptr, '-', len)) return Qtrue;
+
+    VALUE result = Qtrue;
+    long i = 0;
+    while (i < len) {
+        char c = ptr[i];
+        if (c == '"' || c == '\'') {
+            i = skip_quoted(ptr, len, i);
+            continue;
+        }
+        if (url_at(ptr, len, i) && (i == 0 || !IS_IDENT_CHAR(ptr[i - 1]))) {
+            i += 4;
+            while (i < len && ptr[i] != ')') {
+                if (ptr[i] == '"' || ptr[i] == '\'') {
+                    i = skip_quoted(ptr, len, i);
+                } else {
+                    i++;
+                }
+            }
+            continue;
+        }
+        if (c == '-' && i + 1 < len && IS_ALPHA(ptr[i + 1]) && (i == 0 || !IS_IDENT_CHAR(ptr[i - 1]))) {
+            long end = i + 1;
+            while (end < len && IS_IDENT_CHAR(ptr[end])) end++;
+
+            long matched;
+            VALUE action = lookup_action(t->values, t->prefixes, ptr + i, end - i, 0, 0, &matched);
+            if (action == Qfalse) return Qfalse;
+            if (RB_TYPE_P(action, T_STRING)) result = action;
+            i = end;
+            continue;
+        }
+        i++;
+    }
+    return result;
+}
+
+static int vendor_prefixed(VALUE property) {
+    return RB_TYPE_P(property, T_STRING) && RSTRING_LEN(property) > 2 &&
+           RSTRING_PTR(property)[0] == '-' && IS_ALPHA(RSTRING_PTR(property)[1]);
+}
+
+static int decl_important(VALUE declarations, long i) {
+    return RTEST(rb_struct_aref(RARRAY_AREF(declarations, i), INT2FIX(DECL_IMPORTANT)));
+}
+
+// Standard name shared by declaration i and the prefixed forms renamed to it
+// (a key of groups), or Qnil when the declaration is in no such group
+static VALUE property_group(VALUE declarations, VALUE prop_actions, VALUE groups, long i) {
+    VALUE action = RARRAY_AREF(prop_actions, i);
+    if (RB_TYPE_P(action, T_STRING)) return action;
+    if (action != Qtrue) return Qnil;
+
+    VALUE decl = RARRAY_AREF(declarations, i);
+    if (!rb_obj_is_kind_of(decl, cDeclaration)) return Qnil;
+
+    VALUE property = rb_struct_aref(decl, INT2FIX(DECL_PROPERTY));
+    return rb_hash_lookup2(groups, property, Qundef) == Qundef ? Qnil : property;
+}
+
+// Prune one declarations Array in place; returns number of declarations changed
+static long prune_declarations(const prefix_tables *t, VALUE declarations) {
+    if (!RB_TYPE_P(declarations, T_ARRAY)) return 0;
+
+    long n = RARRAY_LEN(declarations);
+    if (n == 0) return 0;
+
+    // Actions live in Ruby Arrays so renamed properties stay marked; they
+    // are only allocated once a declaration needs something other than true
+    VALUE prop_actions = Qnil;
+    VALUE value_actions = Qnil;
+
+    for (long i = 0; i < n; i++) {
+        VALUE decl = RARRAY_AREF(declarations, i);
+        VALUE prop_action = Qtrue;
+        VALUE val_action = Qtrue;
+        if (rb_obj_is_kind_of(decl, cDeclaration)) {
+            VALUE property = rb_struct_aref(decl, INT2FIX(DECL_PROPERTY));
+            if (vendor_prefixed(property)) {
+                long matched;
+                const char *ptr = RSTRING_PTR(property);
+                long len = RSTRING_LEN(property);
+                VALUE action = lookup_action(t->properties, t->prefixes, ptr, len, 0, 1, &matched);
+                prop_action = RB_TYPE_P(action, T_STRING) ? standard_name(action, ptr, len, matched) : action;
+            }
+            val_action = value_action(t, rb_struct_aref(decl, INT2FIX(DECL_VALUE)));
+        }
+        if (NIL_P(prop_actions) && (prop_action != Qtrue || val_action != Qtrue)) {
+            prop_actions = rb_ary_new_capa(n);
+            value_actions = rb_ary_new_capa(n);
+            for (long j = 0; j < i; j++) {
+                rb_ary_push(prop_actions, Qtrue);
+                rb_ary_push(value_actions, Qtrue);
+            }
+        }
+        if (!NIL_P(prop_actions)) {
+            rb_ary_push(prop_actions, prop_action);
+            rb_ary_push(value_actions, val_action);
+        }
+    }
+    if (NIL_P(prop_actions)) return 0;
+
+    VALUE removed_buf;
+    char *removed = ALLOCV_N(char, removed_buf, n);
+    memset(removed, 0, n);
+    long changed = 0;
+
+    // Properties first: a renamed declaration can be the fallback for a value.
+    // A prefixed form that gets renamed and its standard form are one property,
+    // so only the cascade winner among them is kept (!important beats normal,
+    // then the later one wins): "transform: a; -webkit-transform: b" => "transform: b"
+    VALUE winners = rb_hash_new(); // standard name => index of the winning declaration
+    for (long i = 0; i < n; i++) {
+        VALUE action = RARRAY_AREF(prop_actions, i);
+        if (action == Qfalse) {
+            removed[i] = 1;
+        } else if (RB_TYPE_P(action, T_STRING)) {
+            rb_hash_aset(winners, action, Qnil);
+        }
+    }
+    if (RHASH_SIZE(winners) > 0) {
+        for (long i = 0; i < n; i++) {
+            VALUE key = property_group(declarations, prop_actions, winners, i);
+            if (NIL_P(key)) continue;
+
+            VALUE winner = rb_hash_aref(winners, key);
+            if (NIL_P(winner) || decl_important(declarations, i) || !decl_important(declarations, FIX2LONG(winner))) {
+                rb_hash_aset(winners, key, LONG2FIX(i));
+            }
+        }
+        for (long i = 0; i < n; i++) {
+            VALUE key = property_group(declarations, prop_actions, winners, i);
+            if (NIL_P(key)) continue;
+
+            if (FIX2LONG(rb_hash_aref(winners, key)) != i) {
+                removed[i] = 1;
+            } else if (RB_TYPE_P(RARRAY_AREF(prop_actions, i), T_STRING)) {
+                rb_struct_aset(RARRAY_AREF(declarations, i), INT2FIX(DECL_PROPERTY), key);
+                changed++;
+            }
+        }
+    }
+
+    for (long i = 0; i < n; i++) {
+        VALUE action = RARRAY_AREF(value_actions, i);
+        if (removed[i] || action == Qtrue) continue;
+        if (action == Qfalse) {
+            removed[i] = 1;
+            continue;
+        }
+
+        VALUE property = rb_struct_aref(RARRAY_AREF(declarations, i), INT2FIX(DECL_PROPERTY));
+        for (long j = 0; j < n; j++) {
+            if (j == i || removed[j] || RARRAY_AREF(value_actions, j) != Qtrue) continue;
+            VALUE other = RARRAY_AREF(declarations, j);
+            if (rb_obj_is_kind_of(other, cDeclaration) &&
+                rb_str_equal(rb_struct_aref(other, INT2FIX(DECL_PROPERTY)), property) == Qtrue) {
+                removed[i] = 1;
+                break;
+            }
+        }
+    }
+
+    long kept = 0;
+    for (long i = 0; i < n; i++) {
+        if (removed[i]) {
+            changed++;
+            continue;
+        }
+        if (kept != i) rb_ary_store(declarations, kept, RARRAY_AREF(declarations, i));
+        kept++;
+    }
+    if (kept != n) rb_ary_resize(declarations, kept);
+
+    ALLOCV_END(removed_buf);
+    return changed;
+}
+
+// Rewrite prefixed pseudo-classes/elements in a selector. Returns the
+// selector (same object when unchanged), or Qfalse when the rule should go.
+static VALUE prune_selector(const prefix_tables *t, VALUE selector) {
+    if (!RB_TYPE_P(selector, T_STRING)) return selector;
+
+    const char *ptr = RSTRING_PTR(selector);
+    long len = RSTRING_LEN(selector);
+    if (!memchr(ptr, ':', len)) return selector;
+
+    VALUE result = Qnil;
+    long copied = 0;
+    long i = 0;
+    while (i < len) {
+        char c = ptr[i];
+        if (c == '\\') {
+            i += 2;
+        } else if (c == '"' || c == '\'') {
+            i = skip_quoted(ptr, len, i);
+        } else if (c == '[') {
+            while (i < len && ptr[i] != ']') {
+                if (ptr[i] == '"' || ptr[i] == '\'') {
+                    i = skip_quoted(ptr, len, i);
+                } else {
+                    i++;
+                }
+            }
+        } else if (c == ':') {
+            long start = (i + 1 < len && ptr[i + 1] == ':') ? i + 2 : i + 1;
+            if (start + 1 < len && ptr[start] == '-' && IS_ALPHA(ptr[start + 1])) {
+                long end = start + 1;
+                while (end < len && IS_IDENT_CHAR(ptr[end])) end++;
+
+                long matched;
+                VALUE action = lookup_action(t->selectors, t->prefixes, ptr + i, end - i, start - i, 0, &matched);
+                if (action == Qfalse) return Qfalse;
+                if (RB_TYPE_P(action, T_STRING)) {
+                    if (NIL_P(result)) result = rb_str_buf_new(len);
+                    rb_str_cat(result, ptr + copied, i - copied);
+                    rb_str_append(result, standard_name(action, ptr + i, end - i, matched));
+                    copied = end;
+                }
+                i = end;
+            } else {
+                i = start;
+            }
+        } else {
+            i++;
+        }
+    }
+    if (NIL_P(result)) return selector;
+
+    rb_str_cat(result, ptr + copied, len - copied);
+    rb_enc_associate(result, rb_enc_get(selector));
+    return result;
+}
+
+// "@-webkit-keyframes spin" => "@keyframes spin", selector, or Qfalse
+static VALUE prune_at_rule_name(const prefix_tables *t, VALUE selector) {
+    if (!RB_TYPE_P(selector, T_STRING)) return selector;
+
+    const char *ptr = RSTRING_PTR(selector);
+    long len = RSTRING_LEN(selector);
+    if (len < 3 || ptr[0] != '@' || ptr[1] != '-' || !IS_ALPHA(ptr[2])) return selector;
+
+    long end = 2;
+    while (end < len && IS_IDENT_CHAR(ptr[end])) end++;
+
+    long matched;
+    VALUE action = lookup_action(t->at_rules, t->prefixes, ptr, end, 1, 0, &matched);
+    if (!RB_TYPE_P(action, T_STRING)) return action == Qfalse ? Qfalse : selector;
+
+    VALUE result = standard_name(action, ptr, end, matched);
+    result = rb_str_dup(result);
+    rb_str_cat(result, ptr + end, len - end);
+    rb_enc_associate(result, rb_enc_get(selector));
+    return result;
+}
+
+static VALUE existing_key(VALUE rule, long media_field, VALUE selector) {
+    return rb_assoc_new(rb_struct_aref(rule, INT2FIX(media_field)), selector);
+}
+
+// Selectors already in the sheet, so a rename that would duplicate a
+// standard rule removes the prefixed rule instead
+static VALUE existing_selectors(prefix_tables *t) {
+    if (NIL_P(t->existing)) {
+        t->existing = rb_hash_new();
+        long n = RARRAY_LEN(t->rules);
+        for (long i = 0; i < n; i++) {
+            VALUE rule = RARRAY_AREF(t->rules, i);
+            if (rb_obj_is_kind_of(rule, cRule)) {
+                rb_hash_aset(t->existing, existing_key(rule, RULE_MEDIA_QUERY_ID, rb_struct_aref(rule, INT2FIX(RULE_SELECTOR))), Qtrue);
+            } else if (rb_obj_is_kind_of(rule, cAtRule)) {
+                rb_hash_aset(t->existing, existing_key(rule, AT_RULE_MEDIA_QUERY_ID, rb_struct_aref(rule, INT2FIX(AT_RULE_SELECTOR))), Qtrue);
+            }
+        }
+    }
+    return t->existing;
+}
+
+// Apply a selector action; returns 0 when the rule should be removed
+static int apply_selector(prefix_tables *t, VALUE rule, long selector_field, long media_field, VALUE original, VALUE pruned) {
+    if (pruned == Qfalse) return 0;
+    if (pruned == original) return 1;
+
+    VALUE existing = existing_selectors(t);
+    VALUE key = existing_key(rule, media_field, pruned);
+    if (RTEST(rb_hash_lookup2(existing, key, Qfalse))) return 0;
+
+    rb_hash_aset(existing, key, Qtrue);
+    rb_struct_aset(rule, INT2FIX(selector_field), pruned);
+    return 1;
+}
+
+/*
+ * Cataract.prune_prefixes(rules, properties, values, selectors, at_rules, prefixes)
+ *
+ * @api private
+ * @param rules_array [Array<Rule, AtRule>] Rules to prune in place
+ * @param properties [Hash{String => true, false, String}] Property actions
+ * @param values [Hash{String => true, false, String}] Value keyword actions
+ * @param selectors [Hash{String => true, false, String}] Pseudo selector actions (":-moz-focusring")
+ * @param at_rules [Hash{String => true, false, String}] At-rule name actions ("@-webkit-keyframes")
+ * @param prefixes [Hash{String => Boolean}] Fallback per vendor prefix ("-webkit-")
+ * @return [Array<Integer>] Indexes of rules to remove
+ */
+VALUE cataract_prune_prefixes(VALUE self, VALUE rules_array, VALUE properties, VALUE values, VALUE selectors, VALUE at_rules, VALUE prefixes) {
+    Check_Type(rules_array, T_ARRAY);
+    Check_Type(properties, T_HASH);
+    Check_Type(values, T_HASH);
+    Check_Type(selectors, T_HASH);
+    Check_Type(at_rules, T_HASH);
+    Check_Type(prefixes, T_HASH);
+
+    prefix_tables t = { properties, values, selectors, at_rules, prefixes, Qnil, rules_array };
+    VALUE removed = rb_ary_new();
+
+    long num_rules = RARRAY_LEN(rules_array);
+    for (long i = 0; i < num_rules; i++) {
+        VALUE rule = RARRAY_AREF(rules_array, i);
+
+        if (rb_obj_is_kind_of(rule, cAtRule)) {
+            VALUE selector = rb_struct_aref(rule, INT2FIX(AT_RULE_SELECTOR));
+            if (!apply_selector(&t, rule, AT_RULE_SELECTOR, AT_RULE_MEDIA_QUERY_ID, selector, prune_at_rule_name(&t, selector))) {
+                rb_ary_push(removed, LONG2FIX(i));
+                continue;
+            }
+
+            VALUE content = rb_struct_aref(rule, INT2FIX(AT_RULE_CONTENT));
+            if (!RB_TYPE_P(content, T_ARRAY)) continue;
+
+            prune_declarations(&t, content);
+            long content_len = RARRAY_LEN(content);
+            for (long j = 0; j < content_len; j++) {
+                VALUE block = RARRAY_AREF(content, j);
+                if (rb_obj_is_kind_of(block, cRule)) {
+                    prune_declarations(&t, rb_struct_aref(block, INT2FIX(RULE_DECLARATIONS)));
+                }
+            }
+        } else if (rb_obj_is_kind_of(rule, cRule)) {
+            VALUE selector = rb_struct_aref(rule, INT2FIX(RULE_SELECTOR));
+            if (!apply_selector(&t, rule, RULE_SELECTOR, RULE_MEDIA_QUERY_ID, selector, prune_selector(&t, selector))) {
+                rb_ary_push(removed, LONG2FIX(i));
+                continue;
+            }
+            prune_declarations(&t, rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS)));
+        }
+    }
+
+    RB_GC_GUARD(t.existing);
+    return removed;
+}
@@ -0,0 +1,833 @@
+#include <ruby.h>
+#include <ruby/encoding.h>
+#include <string.h>
+#include "cataract.h"
+
+/*
+ * Selector component parser
+ *
+ * Splits one complex selector into compound selectors and combinators in a
+ * single scan:
+ *
+ *   "nav > a.active:not(.x)"
+ *   => [[[:type, "nav"]],
+ *       :child,
+ *       [[:type, "a"], [:class, "active"], [:pseudo_class, "not", ".x"]]]
+ *
+ * Compounds are Arrays of simple selectors, [kind, name] or, for attribute
+ * selectors and functional pseudos, [kind, name, argument]. Kinds are
+ * :type, :universal, :id, :class, :attribute, :pseudo_class, :pseudo_element
+ * and :nesting (&). Combinators are :descendant, :child, :next_sibling,
+ * :subsequent_sibling, and :list for a top-level comma. Relative selectors
+ * ("> a" inside nesting) start with a combinator.
+ *
+ * Names and arguments are interned strings (frozen and deduplicated), so the
+ * same class name across a stylesheet is one object and compares by identity.
+ * Text is kept as written: escapes are not decoded and case is not folded.
+ * A namespace prefix stays part of the name ("svg|a", "*|a", "|a", "*|*").
+ * Legacy single-colon pseudo-elements (:before, :after, :first-line,
+ * :first-letter, :selection) are reported as :pseudo_element, matching
+ * calculate_specificity.
+ *
+ * The result and every nested Array are frozen.
+ *
+ * selector_tokens and class/id name minification read the same scan
+ * (scan_selector) through the byte offsets of each component.
+ */
+
+static VALUE sym_type, sym_universal, sym_id, sym_class, sym_attribute;
+static VALUE sym_pseudo_class, sym_pseudo_element, sym_nesting;
+static VALUE sym_descendant, sym_child, sym_next_sibling, sym_subsequent_sibling, sym_list;
+
+// Bytes that end a name
+static inline int is_name_stop(char c) {
+    switch (c) {
+        case ' ': case '\t': case '\n': case '\r': case '\f':
+        case '#': case '.': case '[': case ']': case ':': case '(': case ')':
+        case '>': case '+': case '~': case ',': case '*': case '&':
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static inline int is_selector_space(char c) {
+    return IS_WHITESPACE(c) || c == '\f';
+}
+
+// Scan a name starting at p; a backslash escapes the next byte
+static const char *scan_name(const char *p, const char *pe) {
+    while (p < pe && !is_name_stop(*p)) {
+        p += (*p == '\\' && p + 1 < pe) ? 2 : 1;
+    }
+    return p;
+}
+
+// Find the closer for an opener at p - 1, skipping quoted strings and nested
+// pairs. Returns pe when unbalanced.
+static const char *scan_block(const char *p, const char *pe, char open, char close) {
+    int depth = 1;
+    while (p < pe) {
+        char c = *p;
+        if (c == '\\' && p + 1 < pe) {
+            p += 2;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            p++;
+            while (p < pe && *p != c) {
+                p += (*p == '\\' && p + 1 < pe) ? 2 : 1;
+            }
+            if (p < pe) p++;
+            continue;
+        }
+        if (c == open) {
+            depth++;
+        } else if (c == close && --depth == 0) {
+            return p;
+        }
+        p++;
+    }
+    return pe;
+}
+
+static inline VALUE intern(const char *start, const char *end, rb_encoding *enc) {
+    return rb_enc_interned_str(start, end - start, enc);
+}
+
+static VALUE simple_selector(VALUE kind, VALUE name, VALUE argument) {
+    VALUE simple = NIL_P(argument) ? rb_ary_new_from_args(2, kind, name)
+                                   : rb_ary_new_from_args(3, kind, name, argument);
+    return rb_ary_freeze(simple);
+}
+
+static int is_legacy_pseudo_element(const char *name, long len) {
+    return (len == 6 && strncmp(name, "before", 6) == 0) ||
+           (len == 5 && strncmp(name, "after", 5) == 0) ||
+           (len == 10 && strncmp(name, "first-line", 10) == 0) ||
+           (len == 12 && strncmp(name, "first-letter", 12) == 0) ||
+           (len == 9 && strncmp(name, "selection", 9) == 0);
+}
+
+/*
+ * Single scanner behind parse_selector, selector_tokens and name minification.
+ * Each simple selector and combinator is reported to a visitor with byte
+ * ranges into the selector text, so visitors can read names in place or
+ * splice the original string.
+ */
+typedef struct {
+    VALUE kind;              // sym_type ... sym_nesting, or a combinator Symbol
+    const char *start;       // First byte ('.', '#', '[', ':' or the name)
+    const char *end;         // One past the last byte (== start for :descendant)
+    const char *name_start;  // Name as in parse_selector's [kind, name]
+    const char *name_end;
+    const char *arg_start;   // Argument, whitespace-trimmed; NULL when there is none
+    const char *arg_end;
+} selector_part;
+
+typedef void (*part_visitor)(const selector_part *part, void *ctx);
+
+// Attribute selector; p points past '['. Returns the position after ']'.
+static const char *scan_attribute(const char *p, const char *pe, selector_part *part) {
+    const char *close = scan_block(p, pe, '[', ']');
+
+    while (p < close && is_selector_space(*p)) p++;
+    part->name_start = p;
+    while (p < close && !is_selector_space(*p) && *p != '=' && *p != '~' && *p != '^' &&
+           *p != '$' && *p != '*' && *p != '!' && !(*p == '|' && p + 1 < close && p[1] == '=')) {
+        p += (*p == '\\' && p + 1 < close) ? 2 : 1;
+    }
+    part->name_end = p;
+
+    const char *arg_end = close;
+    while (arg_end > p && is_selector_space(*(arg_end - 1))) arg_end--;
+    while (p < arg_end && is_selector_space(*p)) p++;
+    if (p < arg_end) {
+        part->arg_start = p;
+        part->arg_end = arg_end;
+    }
+
+    part->kind = sym_attribute;
+    return close < pe ? close + 1 : pe;
+}
+
+// :name, ::name or :name(args); p points past the first ':'. Returns the
+// position after the pseudo.
+static const char *scan_pseudo(const char *p, const char *pe, selector_part *part) {
+    int is_element = 0;
+    if (p < pe && *p == ':') {
+        is_element = 1;
+        p++;
+    }
+
+    part->name_start = p;
+    p = scan_name(p, pe);
+    part->name_end = p;
+    part->kind = (is_element || is_legacy_pseudo_element(part->name_start, p - part->name_start)) ? sym_pseudo_element
+                                                                                                  : sym_pseudo_class;
+
+    if (p < pe && *p == '(') {
+        const char *close = scan_block(p + 1, pe, '(', ')');
+        const char *arg_start = p + 1;
+        const char *arg_end = close;
+        while (arg_start < arg_end && is_selector_space(*arg_start)) arg_start++;
+        while (arg_end > arg_start && is_selector_space(*(arg_end - 1))) arg_end--;
+        part->arg_start = arg_start;
+        part->arg_end = arg_end;
+        p = close < pe ? close + 1 : pe;
+    }
+    return p;
+}
+
+// Report the simple selectors and combinators of selector text [p, pe)
+static void scan_selector(const char *p, const char *pe, part_visitor visit, void *ctx) {
+    int in_compound = 0;
+    int pending_descendant = 0;
+    selector_part part;
+
+    while (p < pe) {
+        char c = *p;
+
+        if (is_selector_space(c)) {
+            if (in_compound) {
+                in_compound = 0;
+                pending_descendant = 1;
+            }
+            p++;
+            continue;
+        }
+
+        VALUE combinator = Qnil;
+        switch (c) {
+            case '>': combinator = sym_child; break;
+            case '+': combinator = sym_next_sibling; break;
+            case '~': combinator = sym_subsequent_sibling; break;
+            case ',': combinator = sym_list; break;
+        }
+        if (!NIL_P(combinator)) {
+            part = (selector_part){ combinator, p, p + 1, p, p + 1, NULL, NULL };
+            visit(&part, ctx);
+            in_compound = 0;
+            pending_descendant = 0;
+            p++;
+            continue;
+        }
+
+        // Stray closers, parenthesized text and strings can't start a simple selector
+        if (c == ')' || c == ']') {
+            p++;
+            continue;
+        }
+        if (c == '(') {
+            p = scan_block(p + 1, pe, '(', ')');
+            if (p < pe) p++;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            p++;
+            while (p < pe && *p != c) {
+                p += (*p == '\\' && p + 1 < pe) ? 2 : 1;
+            }
+            if (p < pe) p++;
+            continue;
+        }
+
+        if (pending_descendant) {
+            part = (selector_part){ sym_descendant, p, p, p, p, NULL, NULL };
+            visit(&part, ctx);
+            pending_descendant = 0;
+        }
+        in_compound = 1;
+
+        part = (selector_part){ Qnil, p, NULL, NULL, NULL, NULL, NULL };
+        switch (c) {
+            case '#':
+            case '.':
+                part.kind = c == '#' ? sym_id : sym_class;
+                part.name_start = ++p;
+                p = scan_name(p, pe);
+                part.name_end = p;
+                break;
+            case '[':
+                p = scan_attribute(p + 1, pe, &part);
+                break;
+            case ':':
+                p = scan_pseudo(p + 1, pe, &part);
+                break;
+            case '*':
+                part.kind = sym_universal;
+                part.name_start = p++;
+                // *|name and *|* - any namespace
+                if (p + 1 < pe && *p == '|') {
+                    int any_element = p[1] == '*';
+                    const char *name_end = any_element ? p + 2 : scan_name(p + 1, pe);
+                    if (name_end > p + 1) {
+                        p = name_end;
+                        if (!any_element) part.kind = sym_type;
+                    }
+                }
+                part.name_end = p;
+                break;
+            case '&':
+                part.kind = sym_nesting;
+                part.name_start = p++;
+                part.name_end = p;
+                break;
+            default:
+                part.kind = sym_type;
+                part.name_start = p;
+                p = scan_name(p, pe);
+                // ns|* namespaced universal
+                if (p < pe && *p == '*' && *(p - 1) == '|') {
+                    p++;
+                    part.kind = sym_universal;
+                }
+                part.name_end = p;
+                break;
+        }
+        part.end = p;
+        visit(&part, ctx);
+    }
+}
+
+typedef struct {
+    VALUE components;
+    VALUE compound;
+    rb_encoding *enc;
+} component_builder;
+
+static void build_component(const selector_part *part, void *ctx) {
+    component_builder *b = ctx;
+
+    if (part->kind == sym_child || part->kind == sym_next_sibling || part->kind == sym_subsequent_sibling ||
+        part->kind == sym_list || part->kind == sym_descendant) {
+        if (!NIL_P(b->compound)) {
+            rb_ary_push(b->components, rb_ary_freeze(b->compound));
+            b->compound = Qnil;
+        }
+        rb_ary_push(b->components, part->kind);
+        return;
+    }
+
+    if (NIL_P(b->compound)) {
+        b->compound = rb_ary_new();
+    }
+    VALUE argument = part->arg_start ? intern(part->arg_start, part->arg_end, b->enc) : Qnil;
+    rb_ary_push(b->compound, simple_selector(part->kind, intern(part->name_start, part->name_end, b->enc), argument));
+}
+
+/*
+ * Parse a selector into compound selectors and combinators
+ *
+ * @param selector [String] A single (complex) selector
+ * @return [Array] Frozen component Array (see top of file)
+ */
+VALUE parse_selector(VALUE self, VALUE selector) {
+    Check_Type(selector, T_STRING);
+
+    const char *p = RSTRING_PTR(selector);
+    component_builder b = { rb_ary_new(), Qnil, rb_enc_get(selector) };
+    scan_selector(p, p + RSTRING_LEN(selector), build_component, &b);
+
+    if (!NIL_P(b.compound)) {
+        rb_ary_push(b.components, rb_ary_freeze(b.compound));
+    }
+
+    RB_GC_GUARD(selector);
+    return rb_ary_freeze(b.components);
+}
+
+/*
+ * Selector tokens for bundle splitting
+ *
+ * A page can use a rule when every class, id and type selector of one of
+ * the rule's comma-separated branches is in the page's token set. Tokens
+ * are ".class", "#id" and lowercased type names; a backslash escape in a
+ * name is decoded to the character after it. Attribute selectors,
+ * pseudo-class arguments (:not(.x), :is(...)), "*" and "&" add no tokens,
+ * so a branch without tokens is usable by every page.
+ */
+
+static ID id_and, id_or;
+
+// New token String: prefix (or 0) + name with escapes decoded
+static VALUE make_token(char prefix, const char *start, const char *end, int downcase, rb_encoding *enc) {
+    VALUE token = rb_str_new(NULL, (end - start) + 1);
+    char *out = RSTRING_PTR(token);
+    long len = 0;
+    if (prefix) out[len++] = prefix;
+    for (const char *p = start; p < end; p++) {
+        char c = *p;
+        if (c == '\\' && p + 1 < end) {
+            c = *++p;
+        } else if (downcase && c >= 'A' && c <= 'Z') {
+            c = (char)(c + ('a' - 'A'));
+        }
+        out[len++] = c;
+    }
+    rb_str_set_len(token, len);
+    rb_enc_associate(token, enc);
+    return token;
+}
+
+typedef struct {
+    VALUE branches;
+    VALUE branch;
+    rb_encoding *enc;
+} token_builder;
+
+static void add_token(const selector_part *part, void *ctx) {
+    token_builder *t = ctx;
+
+    if (part->kind == sym_list) {
+        t->branch = rb_ary_new();
+        rb_ary_push(t->branches, t->branch);
+    } else if (part->kind == sym_class || part->kind == sym_id) {
+        if (part->name_end > part->name_start) {
+            rb_ary_push(t->branch, make_token(*part->start, part->name_start, part->name_end, 0, t->enc));
+        }
+    } else if (part->kind == sym_type) {
+        // ns|type - only the type name counts
+        const char *start = part->name_start;
+        for (const char *q = start; q < part->name_end; q++) {
+            if (*q == '\\' && q + 1 < part->name_end) {
+                q++;
+            } else if (*q == '|') {
+                start = q + 1;
+            }
+        }
+        if (part->name_end > start) {
+            rb_ary_push(t->branch, make_token(0, start, part->name_end, 1, t->enc));
+        }
+    }
+}
+
+// Array of branches, each an Array of token Strings
+static VALUE token_branches(VALUE selector) {
+    const char *p = RSTRING_PTR(selector);
+    token_builder t = { rb_ary_new(), rb_ary_new(), rb_enc_get(selector) };
+    rb_ary_push(t.branches, t.branch);
+
+    scan_selector(p, p + RSTRING_LEN(selector), add_token, &t);
+
+    RB_GC_GUARD(selector);
+    return t.branches;
+}
+
+/*
+ * Class, id and type tokens of a selector, per comma-separated branch
+ *
+ * @param selector [String] Selector
+ * @return [Array<Array<String>>] e.g. [[".nav", "a"], ["#main"]]
+ */
+VALUE selector_tokens(VALUE self, VALUE selector) {
+    Check_Type(selector, T_STRING);
+    return token_branches(selector);
+}
+
+/*
+ * Which pages can use each rule
+ *
+ * @param rules [Array<Rule, AtRule>] Rules to test
+ * @param token_masks [Hash{String => Integer}] Token => bit mask of pages using it
+ * @param all_pages [Integer] Mask with a bit set for every page
+ * @return [Array<Integer, nil>] Mask of pages per rule (nil for at-rules)
+ */
+VALUE rule_page_masks(VALUE self, VALUE rules, VALUE token_masks, VALUE all_pages) {
+    Check_Type(rules, T_ARRAY);
+    Check_Type(token_masks, T_HASH);
+
+    long count = RARRAY_LEN(rules);
+    VALUE masks = rb_ary_new_capa(count);
+    VALUE none = INT2FIX(0);
+
+    for (long i = 0; i < count; i++) {
+        VALUE rule = RARRAY_AREF(rules, i);
+        if (!rb_obj_is_kind_of(rule, cRule)) {
+            rb_ary_push(masks, Qnil);
+            continue;
+        }
+
+        VALUE branches = token_branches(RSTRUCT_GET(rule, RULE_SELECTOR));
+        VALUE mask = none;
+        long branch_count = RARRAY_LEN(branches);
+        for (long b = 0; b < branch_count; b++) {
+            VALUE tokens = RARRAY_AREF(branches, b);
+            VALUE branch_mask = all_pages;
+            long token_count = RARRAY_LEN(tokens);
+            for (long t = 0; t < token_count && branch_mask != none; t++) {
+                VALUE token_mask = rb_hash_lookup2(token_masks, RARRAY_AREF(tokens, t), none);
+                branch_mask = rb_funcall(branch_mask, id_and, 1, token_mask);
+            }
+            if (branch_mask != none) {
+                mask = rb_funcall(mask, id_or, 1, branch_mask);
+            }
+        }
+        rb_ary_push(masks, mask);
+    }
+
+    RB_GC_GUARD(rules);
+    return masks;
+}
+
+/*
+ * Class and id name minification
+ *
+ * Names are found by scan_selector as in token_branches, but pseudo-class
+ * arguments are scanned too (:not(.a), :is(#b .c)) since they name the same
+ * classes and ids. In attribute selectors only [class] and [id] refer to names: "=" and
+ * "~=" values are read as whitespace-separated names, counted and rewritten
+ * like .class and #id tokens. Prefix, suffix and substring matches (^= $=
+ * *= |=) and case-insensitive matches can't be rewritten, so they are
+ * reported as patterns and the caller keeps every name they could match.
+ * Names and values written with hex escapes ("\31 0") are left alone; their
+ * decoded names are reported as fixed, so the caller neither renames a
+ * plain spelling of them nor hands them out as short names.
+ */
+
+typedef struct {
+    VALUE counts;       // count mode: token => occurrences
+    VALUE patterns;     // count mode: [kind, operator, value, case_insensitive]
+    VALUE fixed;        // count mode: decoded tokens written with hex escapes
+    VALUE mapping;      // rename mode: token => replacement token
+    VALUE result;       // rename mode: rewritten selector, Qnil until a name changes
+    const char *copied; // rename mode: end of the selector text already in result
+    rb_encoding *enc;
+} name_scan;
+
+static inline int is_hex_digit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static int has_hex_escape(const char *p, const char *pe) {
+    for (; p < pe; p++) {
+        if (*p == '\\' && p + 1 < pe) {
+            if (is_hex_digit(p[1])) return 1;
+            p++;
+        }
+    }
+    return 0;
+}
+
+static inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    return (c | 0x20) - 'a' + 10;
+}
+
+// UTF-8 token String: prefix (or 0) + name with hex and plain escapes decoded
+// ("\61 b" => "ab")
+static VALUE decode_escaped(char prefix, const char *p, const char *pe) {
+    VALUE token = rb_utf8_str_new(&prefix, prefix ? 1 : 0);
+    while (p < pe) {
+        if (*p == '\\' && p + 1 < pe) {
+            p++;
+            if (is_hex_digit(*p)) {
+                unsigned int cp = 0;
+                for (int digits = 0; digits < 6 && p < pe && is_hex_digit(*p); digits++) {
+                    cp = cp * 16 + hex_value(*p++);
+                }
+                if (p < pe && is_selector_space(*p)) p++;
+                if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+                rb_str_concat(token, UINT2NUM(cp));
+                continue;
+            }
+        }
+        rb_str_cat(token, p, 1);
+        p++;
+    }
+    return token;
+}
+
+// Replace selector text [from, to) with text in the rewritten selector
+static void splice(name_scan *s, const char *from, const char *to, const char *text, long len) {
+    if (NIL_P(s->result)) {
+        s->result = rb_enc_str_new(NULL, 0, s->enc);
+    }
+    rb_str_cat(s->result, s->copied, from - s->copied);
+    rb_str_cat(s->result, text, len);
+    s->copied = to;
+}
+
+static void count_token(name_scan *s, VALUE token) {
+    VALUE count = rb_hash_lookup2(s->counts, token, INT2FIX(0));
+    rb_hash_aset(s->counts, token, LONG2FIX(FIX2LONG(count) + 1));
+}
+
+// A .class or #id token at from; the name is [start, end)
+static void visit_name(name_scan *s, char prefix, const char *from, const char *start, const char *end) {
+    if (has_hex_escape(start, end)) {
+        if (NIL_P(s->mapping)) rb_ary_push(s->fixed, decode_escaped(prefix, start, end));
+        return;
+    }
+
+    VALUE token = make_token(prefix, start, end, 0, s->enc);
+    if (NIL_P(s->mapping)) {
+        count_token(s, token);
+        return;
+    }
+
+    VALUE replacement = rb_hash_lookup2(s->mapping, token, Qnil);
+    if (RB_TYPE_P(replacement, T_STRING)) {
+        splice(s, from, end, RSTRING_PTR(replacement), RSTRING_LEN(replacement));
+    }
+}
+
+// Count or rename the whitespace-separated names of a decoded [class] or
+// [id] value. Returns the renamed value, or Qnil when nothing changed.
+static VALUE visit_attribute_words(name_scan *s, char prefix, VALUE value) {
+    const char *p = RSTRING_PTR(value);
+    const char *pe = p + RSTRING_LEN(value);
+    VALUE renamed = Qnil;
+    const char *copied = p;
+
+    while (p < pe) {
+        while (p < pe && is_selector_space(*p)) p++;
+        const char *start = p;
+        while (p < pe && !is_selector_space(*p)) p++;
+        if (p == start) break;
+
+        VALUE token = rb_enc_str_new(NULL, (p - start) + 1, s->enc);
+        RSTRING_PTR(token)[0] = prefix;
+        memcpy(RSTRING_PTR(token) + 1, start, p - start);
+        if (NIL_P(s->mapping)) {
+            count_token(s, token);
+            continue;
+        }
+
+        VALUE replacement = rb_hash_lookup2(s->mapping, token, Qnil);
+        if (!RB_TYPE_P(replacement, T_STRING)) continue;
+
+        if (NIL_P(renamed)) renamed = rb_enc_str_new(NULL, 0, s->enc);
+        rb_str_cat(renamed, copied, start - copied);
+        rb_str_cat(renamed, RSTRING_PTR(replacement) + 1, RSTRING_LEN(replacement) - 1);
+        copied = p;
+    }
+
+    if (!NIL_P(renamed)) rb_str_cat(renamed, copied, pe - copied);
+    RB_GC_GUARD(value);
+    return renamed;
+}
+
+// Report the names of a [class] or [id] value written with hex escapes as fixed
+static void fix_attribute_words(name_scan *s, char prefix, VALUE value) {
+    const char *p = RSTRING_PTR(value);
+    const char *pe = p + RSTRING_LEN(value);
+
+    while (p < pe) {
+        while (p < pe && is_selector_space(*p)) p++;
+        const char *start = p;
+        while (p < pe && !is_selector_space(*p)) p++;
+        if (p == start) break;
+
+        VALUE token = rb_utf8_str_new(&prefix, 1);
+        rb_str_cat(token, start, p - start);
+        rb_ary_push(s->fixed, token);
+    }
+    RB_GC_GUARD(value);
+}
+
+// Names in an attribute selector: [class] and [id] only
+static void visit_attribute(name_scan *s, const selector_part *part) {
+    const char *name_start = part->name_start;
+    for (const char *q = name_start; q < part->name_end; q++) {
+        if (*q == '\\' && q + 1 < part->name_end) {
+            q++;
+        } else if (*q == '|') {
+            name_start = q + 1; // ns|attr
+        }
+    }
+
+    long name_len = part->name_end - name_start;
+    char prefix;
+    if (name_len == 5 && strncasecmp(name_start, "class", 5) == 0) {
+        prefix = '.';
+    } else if (name_len == 2 && strncasecmp(name_start, "id", 2) == 0) {
+        prefix = '#';
+    } else {
+        return;
+    }
+    if (!part->arg_start) return; // [class] presence test
+
+    const char *p = part->arg_start;
+    const char *close = part->arg_end;
+    const char *op = p;
+    if (*p == '=') {
+        p++;
+    } else if (p + 1 < close && p[1] == '=' && (*p == '~' || *p == '|' || *p == '^' || *p == '$' || *p == '*')) {
+        p += 2;
+    } else {
+        return;
+    }
+    long op_len = p - op;
+    while (p < close && is_selector_space(*p)) p++;
+    const char *value_from = p;
+    const char *value_start, *value_end;
+    if (p < close && (*p == '"' || *p == '\'')) {
+        char quote = *p++;
+        value_start = p;
+        while (p < close && *p != quote) {
+            p += (*p == '\\' && p + 1 < close) ? 2 : 1;
+        }
+        value_end = p;
+        if (p < close) p++;
+    } else {
+        value_start = p;
+        while (p < close && !is_selector_space(*p)) {
+            p += (*p == '\\' && p + 1 < close) ? 2 : 1;
+        }
+        value_end = p;
+    }
+    const char *value_to = p;
+
+    while (p < close && is_selector_space(*p)) p++;
+    int case_insensitive = p < close && (*p == 'i' || *p == 'I');
+
+    int escaped = has_hex_escape(value_start, value_end);
+    VALUE value = escaped ? decode_escaped(0, value_start, value_end) : make_token(0, value_start, value_end, 0, s->enc);
+    int exact = !case_insensitive && (op_len == 1 || *op == '~');
+    if (!exact) {
+        if (NIL_P(s->mapping)) {
+            VALUE kind = rb_enc_str_new(&prefix, 1, s->enc);
+            VALUE operator = rb_enc_str_new(op, op_len, s->enc);
+            rb_ary_push(s->patterns, rb_ary_new_from_args(4, kind, operator, value, case_insensitive ? Qtrue : Qfalse));
+        }
+        return;
+    }
+    if (escaped) {
+        if (NIL_P(s->mapping)) fix_attribute_words(s, prefix, value);
+        return;
+    }
+
+    VALUE renamed = visit_attribute_words(s, prefix, value);
+    if (!NIL_P(renamed)) {
+        // Quote the new value; kept names may need escaping
+        VALUE quoted = rb_enc_str_new("\"", 1, s->enc);
+        const char *q = RSTRING_PTR(renamed);
+        const char *qe = q + RSTRING_LEN(renamed);
+        for (; q < qe; q++) {
+            if (*q == '"' || *q == '\\') rb_str_cat(quoted, "\\", 1);
+            rb_str_cat(quoted, q, 1);
+        }
+        rb_str_cat(quoted, "\"", 1);
+        splice(s, value_from, value_to, RSTRING_PTR(quoted), RSTRING_LEN(quoted));
+        RB_GC_GUARD(quoted);
+    }
+    RB_GC_GUARD(renamed);
+}
+
+static void visit_part_names(const selector_part *part, void *ctx) {
+    name_scan *s = ctx;
+
+    if (part->kind == sym_class || part->kind == sym_id) {
+        if (part->name_end > part->name_start) {
+            visit_name(s, *part->start, part->start, part->name_start, part->name_end);
+        }
+    } else if (part->kind == sym_attribute) {
+        visit_attribute(s, part);
+    } else if ((part->kind == sym_pseudo_class || part->kind == sym_pseudo_element) && part->arg_start) {
+        // :not(.a), :is(#b .c) - the argument is a selector in the same text
+        scan_selector(part->arg_start, part->arg_end, visit_part_names, s);
+    }
+}
+
+static void visit_selector_names(name_scan *s, VALUE selector) {
+    const char *p = RSTRING_PTR(selector);
+    const char *pe = p + RSTRING_LEN(selector);
+    s->result = Qnil;
+    s->copied = p;
+
+    scan_selector(p, pe, visit_part_names, s);
+
+    if (!NIL_P(s->result)) {
+        rb_str_cat(s->result, s->copied, pe - s->copied);
+    }
+    RB_GC_GUARD(selector);
+}
+
+/*
+ * Class and id names used by rule selectors
+ *
+ * @api private
+ * @param rules [Array<Rule, AtRule>] Rules to scan (at-rules are skipped)
+ * @return [Array(Hash{String => Integer}, Array<Array>, Array<String>)]
+ *   Occurrences per ".class" / "#id" token, in first-seen order, the [kind,
+ *   operator, value, case_insensitive] attribute matches that can't be
+ *   rewritten, and the decoded tokens written with hex escapes
+ */
+VALUE rule_name_counts(VALUE self, VALUE rules) {
+    Check_Type(rules, T_ARRAY);
+
+    name_scan s = { rb_hash_new(), rb_ary_new(), rb_ary_new(), Qnil, Qnil, NULL, NULL };
+    long count = RARRAY_LEN(rules);
+    for (long i = 0; i < count; i++) {
+        VALUE rule = RARRAY_AREF(rules, i);
+        if (!rb_obj_is_kind_of(rule, cRule)) continue;
+
+        VALUE selector = RSTRUCT_GET(rule, RULE_SELECTOR);
+        if (!RB_TYPE_P(selector, T_STRING)) continue;
+        s.enc = rb_enc_get(selector);
+        visit_selector_names(&s, selector);
+    }
+
+    RB_GC_GUARD(rules);
+    return rb_ary_new_from_args(3, s.counts, s.patterns, s.fixed);
+}
+
+/*
+ * Rename class and id names in rule selectors, in place
+ *
+ * @api private
+ * @param rules [Array<Rule, AtRule>] Rules to rewrite (at-rules are skipped)
+ * @param mapping [Hash{String => String}] ".class" / "#id" token => new token
+ * @return [Integer] Number of selectors changed
+ */
+VALUE rename_rule_names(VALUE self, VALUE rules, VALUE mapping) {
+    Check_Type(rules, T_ARRAY);
+    Check_Type(mapping, T_HASH);
+
+    name_scan s = { Qnil, Qnil, Qnil, mapping, Qnil, NULL, NULL };
+    long changed = 0;
+    long count = RARRAY_LEN(rules);
+    for (long i = 0; i < count; i++) {
+        VALUE rule = RARRAY_AREF(rules, i);
+        if (!rb_obj_is_kind_of(rule, cRule)) continue;
+
+        VALUE selector = RSTRUCT_GET(rule, RULE_SELECTOR);
+        if (!RB_TYPE_P(selector, T_STRING)) continue;
+        s.enc = rb_enc_get(selector);
+        visit_selector_names(&s, selector);
+        if (!NIL_P(s.result)) {
+            RSTRUCT_SET(rule, RULE_SELECTOR, s.result);
+            changed++;
+        }
+    }
+
+    RB_GC_GUARD(rules);
+    RB_GC_GUARD(mapping);
+    return LONG2FIX(changed);
+}
+
+void init_selector_parser(VALUE module) {
+    sym_type = ID2SYM(rb_intern("type"));
+    sym_universal = ID2SYM(rb_intern("universal"));
+    sym_id = ID2SYM(rb_intern("id"));
+    sym_class = ID2SYM(rb_intern("class"));
+    sym_attribute = ID2SYM(rb_intern("attribute"));
+    sym_pseudo_class = ID2SYM(rb_intern("pseudo_class"));
+    sym_pseudo_element = ID2SYM(rb_intern("pseudo_element"));
+    sym_nesting = ID2SYM(rb_intern("nesting"));
+    sym_descendant = ID2SYM(rb_intern("descendant"));
+    sym_child = ID2SYM(rb_intern("child"));
+    sym_next_sibling = ID2SYM(rb_intern("next_sibling"));
+    sym_subsequent_sibling = ID2SYM(rb_intern("subsequent_sibling"));
+    sym_list = ID2SYM(rb_intern("list"));
+
+    rb_define_module_function(module, "parse_selector", parse_selector, 1);
+
+    id_and = rb_intern("&");
+    id_or = rb_intern("|");
+    rb_define_module_function(module, "selector_tokens", selector_tokens, 1);
+    rb_define_module_function(module, "_rule_page_masks", rule_page_masks, 3);
+    rb_define_module_function(module, "_rule_name_counts", rule_name_counts, 1);
+    rb_define_module_function(module, "_rename_rule_names", rename_rule_names, 2);
+}
@@ -10,7 +10,9 @@
  *   c = count of type selectors (div) and pseudo-elements (::before)
  *
  * Special handling:
- *   - :not() doesn't count itself, but its content does
+ *   - :is(), :not(), :has() (and legacy :matches()) don't count themselves;
+ *     they take the specificity of their most specific argument
+ *   - :where() and its arguments have zero specificity
  *   - Legacy pseudo-elements with single colon (:before) count as pseudo-elements
  *   - Universal selector (*) has zero specificity
  */
@@ -18,6 +20,29 @@
 #include "cataract.h"
 #include <string.h>
 
+// Specificity of the most specific selector in a comma-separated argument list
+static int max_argument_specificity(VALUE self, const char *start, const char *end) {
+    int max = 0;
+    int depth = 0;
+    const char *arg_start = start;
+
+    for (const char *p = start; p <= end; p++) {
+        if (p < end && (*p == '(' || *p == '[')) depth++;
+        else if (p < end && (*p == ')' || *p == ']')) depth--;
+        else if (p == end || (*p == ',' && depth == 0)) {
+            if (p > arg_start) {
+                VALUE arg = rb_str_new(arg_start, p - arg_start);
+                int spec = NUM2INT(calculate_specificity(self, arg));
+                if (spec > max) max = spec;
+                RB_GC_GUARD(arg);
+            }
+            arg_start = p + 1;
+        }
+    }
+
+    return max;
+}
+
 // Calculate specificity for a CSS selector string
 VALUE calculate_specificity(VALUE self, VALUE selector_string) {
     Check_Type(selector_string, T_STRING);
@@ -32,6 +57,7 @@ VALUE calculate_specificity(VALUE self, VALUE selector_string) {
     int pseudo_class_count = 0;
     int pseudo_element_count = 0;
     int element_count = 0;
+    int argument_specificity = 0;
 
     while (p < pe) {
         char c = *p;
@@ -111,67 +137,42 @@ VALUE calculate_specificity(VALUE self, VALUE selector_string) {
                     (pseudo_len == 9 && strncmp(pseudo_start, "selection", 9) == 0);
             }
 
-            // Check for :not() - it doesn't count itself, but its content does
-            int is_not = (pseudo_len == 3 && strncmp(pseudo_start, "not", 3) == 0);
+            // :is()/:not()/:has() take their most specific argument, :where() counts nothing
+            int is_where = (pseudo_len == 5 && strncmp(pseudo_start, "where", 5) == 0);
+            int takes_argument = (pseudo_len == 3 && strncmp(pseudo_start, "not", 3) == 0) ||
+                                 (pseudo_len == 2 && strncmp(pseudo_start, "is", 2) == 0) ||
+                                 (pseudo_len == 3 && strncmp(pseudo_start, "has", 3) == 0) ||
+                                 (pseudo_len == 7 && strncmp(pseudo_start, "matches", 7) == 0);
+            int is_selector_function = takes_argument || is_where;
 
             // Skip function arguments if present
             if (p < pe && *p == '(') {
                 p++;
                 int paren_depth = 1;
+                const char *args_start = p;
 
-                // If it's :not(), we need to calculate specificity of the content
-                if (is_not) {
-                    const char *not_content_start = p;
-
-                    // Find closing paren
-                    while (p < pe && paren_depth > 0) {
-                        if (*p == '(') paren_depth++;
-                        else if (*p == ')') paren_depth--;
-                        if (paren_depth > 0) p++;
-                    }
-
-                    const char *not_content_end = p;
-                    long not_content_len = not_content_end - not_content_start;
-
-                    // Recursively calculate specificity of :not() content
-                    if (not_content_len > 0) {
-                        VALUE not_content = rb_str_new(not_content_start, not_content_len);
-                        VALUE not_spec = calculate_specificity(self, not_content);
-                        int not_specificity = NUM2INT(not_spec);
-
-                        // Add :not() content's specificity to our counts
-                        int additional_a = not_specificity / 100;
-                        int additional_b = (not_specificity % 100) / 10;
-                        int additional_c = not_specificity % 10;
-
-                        id_count += additional_a;
-                        class_count += additional_b;
-                        element_count += additional_c;
-
-                        RB_GC_GUARD(not_content);
-                        RB_GC_GUARD(not_spec);
-                    }
+                // Find closing paren
+                while (p < pe && paren_depth > 0) {
+                    if (*p == '(') paren_depth++;
+                    else if (*p == ')') paren_depth--;
+                    if (paren_depth > 0) p++;
+                }
 
-                    p++;  // Skip closing paren
+                if (takes_argument) {
+                    argument_specificity += max_argument_specificity(self, args_start, p);
+                } else if (is_where) {
+                    // Zero specificity
+                } else if (is_pseudo_element || is_legacy_pseudo_element) {
+                    pseudo_element_count++;
                 } else {
-                    // Skip other function arguments
-                    while (p < pe && paren_depth > 0) {
-                        if (*p == '(') paren_depth++;
-                        else if (*p == ')') paren_depth--;
-                        p++;
-                    }
-
-                    // Count the pseudo-class/element
-                    if (is_pseudo_element || is_legacy_pseudo_element) {
-                        pseudo_element_count++;
-                    } else {
-                        pseudo_class_count++;
-                    }
+                    pseudo_class_count++;
                 }
+
+                if (p < pe) p++;  // Skip closing paren
             } else {
                 // No function arguments - count the pseudo-class/element
-                if (is_not) {
-                    // :not without parens is invalid, but don't count it
+                if (is_selector_function) {
+                    // :not/:is/:where without parens is invalid, but don't count it
                 } else if (is_pseudo_element || is_legacy_pseudo_element) {
                     pseudo_element_count++;
                 } else {
@@ -207,7 +208,8 @@ VALUE calculate_specificity(VALUE self, VALUE selector_string) {
     // IDs * 100 + (classes + attributes + pseudo-classes) * 10 + (elements + pseudo-elements) * 1
     int specificity = (id_count * 100) +
                       ((class_count + attr_count + pseudo_class_count) * 10) +
-                      ((element_count + pseudo_element_count) * 1);
+                      ((element_count + pseudo_element_count) * 1) +
+                      argument_specificity;
 
     return INT2NUM(specificity);
 }
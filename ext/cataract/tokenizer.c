@@ -0,0 +1,765 @@
+#include <ruby.h>
+#include <ruby/encoding.h>
+#include <stdint.h>
+#include <string.h>
+#include "cataract.h"
+
+/*
+ * CSS Syntax Level 3 tokenizer (https://www.w3.org/TR/css-syntax-3/#tokenization)
+ *
+ * Exposed two ways:
+ *
+ *   Cataract.each_token(css) { |type, offset, length, number, unit| ... }
+ *     Streams tokens straight from the source, nothing is buffered.
+ *
+ *   Cataract::TokenStream.new(css)
+ *     Tokenizes once into a packed C array (TypedData). Tokens are read back
+ *     by index; text(i) / value(i) materialize strings only when asked for.
+ *
+ * A token is (type, byte offset, byte length). Numeric tokens also carry the
+ * length of their number part, so the number and unit are sliced out of the
+ * source on demand: numbers are parsed when yielded, and units are returned
+ * as interned (deduplicated, frozen) strings, so "px" is allocated once.
+ *
+ * Offsets refer to the original bytes. Instead of the spec's preprocessing
+ * step, CR, CRLF and FF are treated as newlines where they occur. Non-ASCII
+ * bytes are ident code points (every byte of a UTF-8 sequence is >= 0x80).
+ * Comments are skipped unless comments: true is given.
+ *
+ * Differences from the spec: the url( check compares the raw ident bytes
+ * case-insensitively, so an escaped form like u\72l( is tokenized as a
+ * function rather than a url token.
+ */
+
+enum css_token_type {
+    TOK_IDENT,
+    TOK_FUNCTION,
+    TOK_AT_KEYWORD,
+    TOK_HASH,
+    TOK_STRING,
+    TOK_BAD_STRING,
+    TOK_URL,
+    TOK_BAD_URL,
+    TOK_DELIM,
+    TOK_NUMBER,
+    TOK_PERCENTAGE,
+    TOK_DIMENSION,
+    TOK_WHITESPACE,
+    TOK_CDO,
+    TOK_CDC,
+    TOK_COLON,
+    TOK_SEMICOLON,
+    TOK_COMMA,
+    TOK_LEFT_SQUARE,
+    TOK_RIGHT_SQUARE,
+    TOK_LEFT_PAREN,
+    TOK_RIGHT_PAREN,
+    TOK_LEFT_BRACE,
+    TOK_RIGHT_BRACE,
+    TOK_COMMENT,
+    TOK_TYPE_COUNT
+};
+
+static const char *TOKEN_TYPE_NAMES[TOK_TYPE_COUNT] = {
+    "ident", "function", "at_keyword", "hash", "string", "bad_string", "url", "bad_url",
+    "delim", "number", "percentage", "dimension", "whitespace", "cdo", "cdc", "colon",
+    "semicolon", "comma", "left_square", "right_square", "left_paren", "right_paren",
+    "left_brace", "right_brace", "comment"
+};
+
+static VALUE token_type_syms[TOK_TYPE_COUNT];
+static VALUE cTokenStream;
+static ID id_comments;
+
+#define TOKEN_FLAG_INTEGER 1
+
+typedef struct {
+    long offset;
+    long length;
+    uint32_t num_len;   // Numeric tokens: bytes of the number (unit follows)
+    uint8_t type;
+    uint8_t flags;
+} css_token;
+
+typedef struct {
+    VALUE source;       // Frozen copy of the tokenized string
+    css_token *tokens;
+    long count;
+    long capacity;
+} token_stream;
+
+// ============================================================================
+// Code point classification
+// ============================================================================
+
+#define TOK_IS_NEWLINE(c) ((c) == '\n' || (c) == '\r' || (c) == '\f')
+#define TOK_IS_WHITESPACE(c) ((c) == ' ' || (c) == '\t' || TOK_IS_NEWLINE(c))
+#define TOK_IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+#define TOK_IS_HEX(c) (TOK_IS_DIGIT(c) || ((c) >= 'a' && (c) <= 'f') || ((c) >= 'A' && (c) <= 'F'))
+#define TOK_IS_IDENT_START(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || (c) == '_' || (c) >= 0x80 || (c) == 0)
+#define TOK_IS_IDENT(c) (TOK_IS_IDENT_START(c) || TOK_IS_DIGIT(c) || (c) == '-')
+#define TOK_IS_NON_PRINTABLE(c) (((c) >= 0x01 && (c) <= 0x08) || (c) == 0x0B || ((c) >= 0x0E && (c) <= 0x1F) || (c) == 0x7F)
+
+// Byte at p, or -1 past the end (EOF)
+static inline int peek(const unsigned char *s, long len, long p) {
+    return p < len ? s[p] : -1;
+}
+
+static inline int is_valid_escape(int c1, int c2) {
+    return c1 == '\\' && !TOK_IS_NEWLINE(c2);
+}
+
+static inline int starts_ident(int c1, int c2, int c3) {
+    if (c1 == '-') {
+        return (c2 >= 0 && TOK_IS_IDENT_START(c2)) || c2 == '-' || is_valid_escape(c2, c3);
+    }
+    if (c1 >= 0 && TOK_IS_IDENT_START(c1)) return 1;
+    return c1 == '\\' && is_valid_escape(c1, c2);
+}
+
+static inline int starts_number(int c1, int c2, int c3) {
+    if (c1 == '+' || c1 == '-') {
+        return (c2 >= 0 && TOK_IS_DIGIT(c2)) || (c2 == '.' && c3 >= 0 && TOK_IS_DIGIT(c3));
+    }
+    if (c1 == '.') return c2 >= 0 && TOK_IS_DIGIT(c2);
+    return c1 >= 0 && TOK_IS_DIGIT(c1);
+}
+
+// Length in bytes of the UTF-8 sequence starting with lead byte c
+static inline long utf8_len(unsigned char c) {
+    if (c < 0x80) return 1;
+    if (c >= 0xF0) return 4;
+    if (c >= 0xE0) return 3;
+    if (c >= 0xC0) return 2;
+    return 1;
+}
+
+// ============================================================================
+// Consumers (each takes a position and returns the position after)
+// ============================================================================
+
+// Escape body: p points just past the backslash
+static long consume_escape(const unsigned char *s, long len, long p) {
+    if (p >= len) return p;
+
+    if (TOK_IS_HEX(s[p])) {
+        long end = p + 1;
+        while (end < len && end - p < 6 && TOK_IS_HEX(s[end])) end++;
+        if (end < len && TOK_IS_WHITESPACE(s[end])) {
+            end += (s[end] == '\r' && end + 1 < len && s[end + 1] == '\n') ? 2 : 1;
+        }
+        return end;
+    }
+
+    long end = p + utf8_len(s[p]);
+    return end > len ? len : end;
+}
+
+static long consume_ident_sequence(const unsigned char *s, long len, long p) {
+    while (p < len) {
+        if (TOK_IS_IDENT(s[p])) {
+            p++;
+        } else if (is_valid_escape(s[p], peek(s, len, p + 1))) {
+            p = consume_escape(s, len, p + 1);
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+// Returns position after the number; sets *is_integer
+static long consume_number(const unsigned char *s, long len, long p, int *is_integer) {
+    *is_integer = 1;
+    if (p < len && (s[p] == '+' || s[p] == '-')) p++;
+    while (p < len && TOK_IS_DIGIT(s[p])) p++;
+
+    if (p + 1 < len && s[p] == '.' && TOK_IS_DIGIT(s[p + 1])) {
+        p += 2;
+        while (p < len && TOK_IS_DIGIT(s[p])) p++;
+        *is_integer = 0;
+    }
+
+    if (p + 1 < len && (s[p] == 'e' || s[p] == 'E')) {
+        int c2 = s[p + 1];
+        int c3 = peek(s, len, p + 2);
+        if (TOK_IS_DIGIT(c2)) {
+            p += 2;
+        } else if ((c2 == '+' || c2 == '-') && c3 >= 0 && TOK_IS_DIGIT(c3)) {
+            p += 3;
+        } else {
+            return p;
+        }
+        while (p < len && TOK_IS_DIGIT(s[p])) p++;
+        *is_integer = 0;
+    }
+    return p;
+}
+
+static long consume_bad_url_remnants(const unsigned char *s, long len, long p) {
+    while (p < len) {
+        if (s[p] == ')') return p + 1;
+        if (is_valid_escape(s[p], peek(s, len, p + 1))) {
+            p = consume_escape(s, len, p + 1);
+        } else {
+            p++;
+        }
+    }
+    return p;
+}
+
+// p points just past "url(" and any whitespace; sets tok->type
+static long consume_url(const unsigned char *s, long len, long p, css_token *tok) {
+    tok->type = TOK_URL;
+    while (p < len) {
+        unsigned char c = s[p];
+        if (c == ')') return p + 1;
+
+        if (TOK_IS_WHITESPACE(c)) {
+            while (p < len && TOK_IS_WHITESPACE(s[p])) p++;
+            if (p >= len) return p;
+            if (s[p] == ')') return p + 1;
+            tok->type = TOK_BAD_URL;
+            return consume_bad_url_remnants(s, len, p);
+        }
+        if (c == '"' || c == '\'' || c == '(' || TOK_IS_NON_PRINTABLE(c)) {
+            tok->type = TOK_BAD_URL;
+            return consume_bad_url_remnants(s, len, p + 1);
+        }
+        if (c == '\\') {
+            if (is_valid_escape(c, peek(s, len, p + 1))) {
+                p = consume_escape(s, len, p + 1);
+                continue;
+            }
+            tok->type = TOK_BAD_URL;
+            return consume_bad_url_remnants(s, len, p + 1);
+        }
+        p++;
+    }
+    return p;
+}
+
+static long consume_ident_like(const unsigned char *s, long len, long start, css_token *tok) {
+    long p = consume_ident_sequence(s, len, start);
+
+    if (p < len && s[p] == '(') {
+        if (p - start == 3 &&
+            (s[start] | 0x20) == 'u' && (s[start + 1] | 0x20) == 'r' && (s[start + 2] | 0x20) == 'l') {
+            p++;
+            while (p + 1 < len && TOK_IS_WHITESPACE(s[p]) && TOK_IS_WHITESPACE(s[p + 1])) p++;
+
+            int c1 = peek(s, len, p);
+            int c2 = peek(s, len, p + 1);
+            if (c1 == '"' || c1 == '\'' || (c1 >= 0 && TOK_IS_WHITESPACE(c1) && (c2 == '"' || c2 == '\''))) {
+                tok->type = TOK_FUNCTION;
+                return p;
+            }
+            while (p < len && TOK_IS_WHITESPACE(s[p])) p++;
+            return consume_url(s, len, p, tok);
+        }
+        tok->type = TOK_FUNCTION;
+        return p + 1;
+    }
+
+    tok->type = TOK_IDENT;
+    return p;
+}
+
+static long consume_numeric(const unsigned char *s, long len, long start, css_token *tok) {
+    int is_integer;
+    long p = consume_number(s, len, start, &is_integer);
+
+    tok->num_len = (uint32_t)(p - start);
+    tok->flags = is_integer ? TOKEN_FLAG_INTEGER : 0;
+
+    if (starts_ident(peek(s, len, p), peek(s, len, p + 1), peek(s, len, p + 2))) {
+        tok->type = TOK_DIMENSION;
+        return consume_ident_sequence(s, len, p);
+    }
+    if (p < len && s[p] == '%') {
+        tok->type = TOK_PERCENTAGE;
+        return p + 1;
+    }
+    tok->type = TOK_NUMBER;
+    return p;
+}
+
+static long consume_string(const unsigned char *s, long len, long p, unsigned char quote, css_token *tok) {
+    tok->type = TOK_STRING;
+    while (p < len) {
+        unsigned char c = s[p];
+        if (c == quote) return p + 1;
+        if (TOK_IS_NEWLINE(c)) {
+            tok->type = TOK_BAD_STRING;
+            return p;  // Newline is not part of the token
+        }
+        if (c == '\\') {
+            if (p + 1 >= len) return p + 1;
+            if (TOK_IS_NEWLINE(s[p + 1])) {
+                p += (s[p + 1] == '\r' && p + 2 < len && s[p + 2] == '\n') ? 3 : 2;
+            } else {
+                p = consume_escape(s, len, p + 1);
+            }
+            continue;
+        }
+        p++;
+    }
+    return p;
+}
+
+/*
+ * Consume one token starting at pos. Returns 0 at EOF.
+ * Comments are returned as TOK_COMMENT; callers skip them if not wanted.
+ */
+static int next_token(const unsigned char *s, long len, long pos, css_token *tok) {
+    if (pos >= len) return 0;
+
+    long p = pos;
+    unsigned char c = s[p];
+    int c1 = peek(s, len, p + 1);
+    int c2 = peek(s, len, p + 2);
+
+    tok->offset = pos;
+    tok->num_len = 0;
+    tok->flags = 0;
+
+    if (c == '/' && c1 == '*') {
+        p += 2;
+        while (p + 1 < len && !(s[p] == '*' && s[p + 1] == '/')) p++;
+        p = (p + 1 < len) ? p + 2 : len;
+        tok->type = TOK_COMMENT;
+    } else if (TOK_IS_WHITESPACE(c)) {
+        while (p < len && TOK_IS_WHITESPACE(s[p])) p++;
+        tok->type = TOK_WHITESPACE;
+    } else if (c == '"' || c == '\'') {
+        p = consume_string(s, len, p + 1, c, tok);
+    } else if (c == '#') {
+        if ((c1 >= 0 && TOK_IS_IDENT(c1)) || is_valid_escape(c1, c2)) {
+            p = consume_ident_sequence(s, len, p + 1);
+            tok->type = TOK_HASH;
+        } else {
+            p++;
+            tok->type = TOK_DELIM;
+        }
+    } else if (c == '+' || c == '.') {
+        if (starts_number(c, c1, c2)) {
+            p = consume_numeric(s, len, p, tok);
+        } else {
+            p++;
+            tok->type = TOK_DELIM;
+        }
+    } else if (c == '-') {
+        if (starts_number(c, c1, c2)) {
+            p = consume_numeric(s, len, p, tok);
+        } else if (c1 == '-' && c2 == '>') {
+            p += 3;
+            tok->type = TOK_CDC;
+        } else if (starts_ident(c, c1, c2)) {
+            p = consume_ident_like(s, len, p, tok);
+        } else {
+            p++;
+            tok->type = TOK_DELIM;
+        }
+    } else if (c == '<') {
+        if (c1 == '!' && c2 == '-' && peek(s, len, p + 3) == '-') {
+            p += 4;
+            tok->type = TOK_CDO;
+        } else {
+            p++;
+            tok->type = TOK_DELIM;
+        }
+    } else if (c == '@') {
+        if (starts_ident(c1, c2, peek(s, len, p + 3))) {
+            p = consume_ident_sequence(s, len, p + 1);
+            tok->type = TOK_AT_KEYWORD;
+        } else {
+            p++;
+            tok->type = TOK_DELIM;
+        }
+    } else if (c == '\\') {
+        if (is_valid_escape(c, c1)) {
+            p = consume_ident_like(s, len, p, tok);
+        } else {
+            p++;
+            tok->type = TOK_DELIM;
+        }
+    } else if (TOK_IS_DIGIT(c)) {
+        p = consume_numeric(s, len, p, tok);
+    } else if (TOK_IS_IDENT_START(c)) {
+        p = consume_ident_like(s, len, p, tok);
+    } else {
+        p++;
+        switch (c) {
+            case '(': tok->type = TOK_LEFT_PAREN; break;
+            case ')': tok->type = TOK_RIGHT_PAREN; break;
+            case '[': tok->type = TOK_LEFT_SQUARE; break;
+            case ']': tok->type = TOK_RIGHT_SQUARE; break;
+            case '{': tok->type = TOK_LEFT_BRACE; break;
+            case '}': tok->type = TOK_RIGHT_BRACE; break;
+            case ',': tok->type = TOK_COMMA; break;
+            case ':': tok->type = TOK_COLON; break;
+            case ';': tok->type = TOK_SEMICOLON; break;
+            default: tok->type = TOK_DELIM; break;
+        }
+    }
+
+    tok->length = p - pos;
+    return 1;
+}
+
+// ============================================================================
+// Token values
+// ============================================================================
+
+// Number as Integer or Float, parsed from the source bytes
+static VALUE token_number(const char *s, const css_token *tok) {
+    if (tok->num_len == 0) return Qnil;
+
+    char stack_buf[64];
+    char *buf = stack_buf;
+    VALUE heap = 0;
+    if (tok->num_len >= sizeof(stack_buf)) {
+        buf = ALLOCV_N(char, heap, tok->num_len + 1);
+    }
+    memcpy(buf, s + tok->offset, tok->num_len);
+    buf[tok->num_len] = '\0';
+
+    VALUE number = (tok->flags & TOKEN_FLAG_INTEGER) ? rb_cstr2inum(buf, 10) : DBL2NUM(rb_cstr_to_dbl(buf, 0));
+    if (heap) ALLOCV_END(heap);
+    return number;
+}
+
+static VALUE token_unit(const char *s, const css_token *tok, rb_encoding *enc) {
+    if (tok->type == TOK_PERCENTAGE) return rb_enc_interned_str("%", 1, enc);
+    if (tok->type != TOK_DIMENSION) return Qnil;
+    return rb_enc_interned_str(s + tok->offset + tok->num_len, tok->length - tok->num_len, enc);
+}
+
+static void append_code_point(VALUE buf, unsigned long cp) {
+    char out[4];
+    int n;
+
+    if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) cp = 0xFFFD;
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        out[0] = (char)(0xF0 | (cp >> 18));
+        out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    rb_str_buf_cat(buf, out, n);
+}
+
+enum decode_mode { DECODE_IDENT, DECODE_STRING, DECODE_URL };
+
+/*
+ * Decode escapes from p up to end, stopping where the token's value ends:
+ * at the first non-ident code point (ident), the closing quote (string), or
+ * ')' / whitespace (url).
+ */
+static VALUE decode_value(const unsigned char *s, long p, long end, enum decode_mode mode, unsigned char quote, rb_encoding *enc) {
+    VALUE buf = rb_enc_str_new(NULL, 0, enc);
+    long run = p;
+
+    while (p < end) {
+        unsigned char c = s[p];
+
+        if (c == '\\') {
+            rb_str_buf_cat(buf, (const char *)s + run, p - run);
+            if (p + 1 >= end) {
+                // Escape at EOF: ident/url get U+FFFD, strings drop it
+                if (mode != DECODE_STRING) append_code_point(buf, 0xFFFD);
+                p = end;
+            } else if (TOK_IS_NEWLINE(s[p + 1])) {
+                if (mode != DECODE_STRING) break;
+                p += (s[p + 1] == '\r' && p + 2 < end && s[p + 2] == '\n') ? 3 : 2;
+            } else if (TOK_IS_HEX(s[p + 1])) {
+                unsigned long cp = 0;
+                long q = p + 1;
+                while (q < end && q - (p + 1) < 6 && TOK_IS_HEX(s[q])) {
+                    unsigned char h = s[q];
+                    cp = cp * 16 + (TOK_IS_DIGIT(h) ? h - '0' : (h | 0x20) - 'a' + 10);
+                    q++;
+                }
+                if (q < end && TOK_IS_WHITESPACE(s[q])) {
+                    q += (s[q] == '\r' && q + 1 < end && s[q + 1] == '\n') ? 2 : 1;
+                }
+                append_code_point(buf, cp);
+                p = q;
+            } else {
+                long n = utf8_len(s[p + 1]);
+                if (p + 1 + n > end) n = end - p - 1;
+                rb_str_buf_cat(buf, (const char *)s + p + 1, n);
+                p += 1 + n;
+            }
+            run = p;
+            continue;
+        }
+
+        if (mode == DECODE_IDENT && !TOK_IS_IDENT(c)) break;
+        if (mode == DECODE_STRING && c == quote) break;
+        if (mode == DECODE_URL && (c == ')' || TOK_IS_WHITESPACE(c))) break;
+        p++;
+    }
+    if (p > run) rb_str_buf_cat(buf, (const char *)s + run, p - run);
+    return buf;
+}
+
+static VALUE token_value(VALUE source, const css_token *tok) {
+    const unsigned char *s = (const unsigned char *)RSTRING_PTR(source);
+    rb_encoding *enc = rb_enc_get(source);
+    long start = tok->offset;
+    long end = tok->offset + tok->length;
+
+    switch (tok->type) {
+        case TOK_IDENT:
+        case TOK_FUNCTION:
+            return decode_value(s, start, end, DECODE_IDENT, 0, enc);
+        case TOK_AT_KEYWORD:
+        case TOK_HASH:
+            return decode_value(s, start + 1, end, DECODE_IDENT, 0, enc);
+        case TOK_STRING:
+            return decode_value(s, start + 1, end, DECODE_STRING, s[start], enc);
+        case TOK_URL: {
+            long p = start;
+            while (p < end && s[p] != '(') p++;
+            p++;
+            while (p < end && TOK_IS_WHITESPACE(s[p])) p++;
+            return decode_value(s, p, end, DECODE_URL, 0, enc);
+        }
+        case TOK_DELIM:
+            return rb_enc_str_new((const char *)s + start, tok->length, enc);
+        default:
+            return Qnil;
+    }
+}
+
+static int comments_option(VALUE opts) {
+    if (NIL_P(opts)) return 0;
+    return RTEST(rb_hash_lookup2(opts, ID2SYM(id_comments), Qfalse));
+}
+
+// ============================================================================
+// Cataract.each_token
+// ============================================================================
+
+/*
+ * Cataract.each_token(css, comments: false) { |type, offset, length, number, unit| }
+ *
+ * Streams CSS Syntax Level 3 tokens. +number+ is an Integer or Float for
+ * number, percentage and dimension tokens (nil otherwise); +unit+ is the
+ * dimension unit as written, or "%" for percentages.
+ *
+ * @return [nil, Enumerator] Enumerator if no block given
+ */
+static VALUE cataract_each_token(int argc, VALUE *argv, VALUE self) {
+    RETURN_ENUMERATOR(self, argc, argv);
+
+    VALUE css, opts;
+    rb_scan_args(argc, argv, "1:", &css, &opts);
+    Check_Type(css, T_STRING);
+
+    int comments = comments_option(opts);
+    VALUE source = rb_str_new_frozen(css);
+    rb_encoding *enc = rb_enc_get(source);
+    long len = RSTRING_LEN(source);
+    long pos = 0;
+    css_token tok;
+
+    while (next_token((const unsigned char *)RSTRING_PTR(source), len, pos, &tok)) {
+        pos = tok.offset + tok.length;
+        if (tok.type == TOK_COMMENT && !comments) continue;
+
+        const char *s = RSTRING_PTR(source);
+        rb_yield_values(5, token_type_syms[tok.type], LONG2NUM(tok.offset), LONG2NUM(tok.length),
+                        token_number(s, &tok), token_unit(s, &tok, enc));
+    }
+
+    RB_GC_GUARD(source);
+    return Qnil;
+}
+
+// ============================================================================
+// Cataract::TokenStream
+// ============================================================================
+
+static void token_stream_mark(void *ptr) {
+    token_stream *ts = ptr;
+    rb_gc_mark(ts->source);
+}
+
+static void token_stream_free(void *ptr) {
+    token_stream *ts = ptr;
+    xfree(ts->tokens);
+    xfree(ts);
+}
+
+static size_t token_stream_memsize(const void *ptr) {
+    const token_stream *ts = ptr;
+    return sizeof(token_stream) + sizeof(css_token) * ts->capacity;
+}
+
+static const rb_data_type_t token_stream_type = {
+    "Cataract::TokenStream",
+    { token_stream_mark, token_stream_free, token_stream_memsize },
+    0, 0, RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+static VALUE token_stream_alloc(VALUE klass) {
+    token_stream *ts;
+    VALUE obj = TypedData_Make_Struct(klass, token_stream, &token_stream_type, ts);
+    ts->source = Qnil;
+    return obj;
+}
+
+static token_stream *get_token_stream(VALUE self) {
+    token_stream *ts;
+    TypedData_Get_Struct(self, token_stream, &token_stream_type, ts);
+    if (NIL_P(ts->source)) rb_raise(rb_eRuntimeError, "uninitialized TokenStream");
+    return ts;
+}
+
+static const css_token *get_token(token_stream *ts, VALUE index) {
+    long i = NUM2LONG(index);
+    if (i < 0) i += ts->count;
+    if (i < 0 || i >= ts->count) {
+        rb_raise(rb_eIndexError, "index %ld outside of token stream (size %ld)", NUM2LONG(index), ts->count);
+    }
+    return &ts->tokens[i];
+}
+
+/*
+ * TokenStream.new(css, comments: false)
+ */
+static VALUE token_stream_initialize(int argc, VALUE *argv, VALUE self) {
+    VALUE css, opts;
+    rb_scan_args(argc, argv, "1:", &css, &opts);
+    Check_Type(css, T_STRING);
+
+    token_stream *ts;
+    TypedData_Get_Struct(self, token_stream, &token_stream_type, ts);
+    if (!NIL_P(ts->source)) rb_raise(rb_eRuntimeError, "TokenStream already initialized");
+
+    int comments = comments_option(opts);
+    ts->source = rb_str_new_frozen(css);
+
+    const unsigned char *s = (const unsigned char *)RSTRING_PTR(ts->source);
+    long len = RSTRING_LEN(ts->source);
+
+    // Rough estimate: one token per 4 bytes of typical CSS
+    ts->capacity = len / 4 + 16;
+    ts->tokens = ALLOC_N(css_token, ts->capacity);
+    ts->count = 0;
+
+    long pos = 0;
+    css_token tok;
+    while (next_token(s, len, pos, &tok)) {
+        pos = tok.offset + tok.length;
+        if (tok.type == TOK_COMMENT && !comments) continue;
+
+        if (ts->count == ts->capacity) {
+            ts->capacity *= 2;
+            REALLOC_N(ts->tokens, css_token, ts->capacity);
+        }
+        ts->tokens[ts->count++] = tok;
+    }
+
+    return self;
+}
+
+static VALUE token_stream_size(VALUE self) {
+    return LONG2NUM(get_token_stream(self)->count);
+}
+
+static VALUE token_stream_source(VALUE self) {
+    return get_token_stream(self)->source;
+}
+
+static VALUE token_stream_enum_size(VALUE self, VALUE args, VALUE eobj) {
+    return token_stream_size(self);
+}
+
+// Token record: [type, offset, length, number, unit]
+static VALUE token_record(token_stream *ts, const css_token *tok) {
+    const char *s = RSTRING_PTR(ts->source);
+    return rb_ary_new_from_args(5, token_type_syms[tok->type], LONG2NUM(tok->offset), LONG2NUM(tok->length),
+                                token_number(s, tok), token_unit(s, tok, rb_enc_get(ts->source)));
+}
+
+/*
+ * Yields the record [type, offset, length, number, unit] for each token
+ */
+static VALUE token_stream_each(VALUE self) {
+    RETURN_SIZED_ENUMERATOR(self, 0, 0, token_stream_enum_size);
+
+    token_stream *ts = get_token_stream(self);
+    for (long i = 0; i < ts->count; i++) {
+        rb_yield(token_record(ts, &ts->tokens[i]));
+    }
+    return self;
+}
+
+static VALUE token_stream_aref(VALUE self, VALUE index) {
+    token_stream *ts = get_token_stream(self);
+    return token_record(ts, get_token(ts, index));
+}
+
+static VALUE token_stream_type_at(VALUE self, VALUE index) {
+    token_stream *ts = get_token_stream(self);
+    return token_type_syms[get_token(ts, index)->type];
+}
+
+static VALUE token_stream_number(VALUE self, VALUE index) {
+    token_stream *ts = get_token_stream(self);
+    return token_number(RSTRING_PTR(ts->source), get_token(ts, index));
+}
+
+static VALUE token_stream_unit(VALUE self, VALUE index) {
+    token_stream *ts = get_token_stream(self);
+    return token_unit(RSTRING_PTR(ts->source), get_token(ts, index), rb_enc_get(ts->source));
+}
+
+static VALUE token_stream_text(VALUE self, VALUE index) {
+    token_stream *ts = get_token_stream(self);
+    const css_token *tok = get_token(ts, index);
+    return rb_enc_str_new(RSTRING_PTR(ts->source) + tok->offset, tok->length, rb_enc_get(ts->source));
+}
+
+static VALUE token_stream_value(VALUE self, VALUE index) {
+    token_stream *ts = get_token_stream(self);
+    return token_value(ts->source, get_token(ts, index));
+}
+
+void init_tokenizer(VALUE module) {
+    id_comments = rb_intern("comments");
+    for (int i = 0; i < TOK_TYPE_COUNT; i++) {
+        token_type_syms[i] = ID2SYM(rb_intern(TOKEN_TYPE_NAMES[i]));
+    }
+
+    rb_define_module_function(module, "each_token", cataract_each_token, -1);
+
+    cTokenStream = rb_define_class_under(module, "TokenStream", rb_cObject);
+    rb_define_alloc_func(cTokenStream, token_stream_alloc);
+    rb_define_method(cTokenStream, "initialize", token_stream_initialize, -1);
+    rb_define_method(cTokenStream, "size", token_stream_size, 0);
+    rb_define_method(cTokenStream, "source", token_stream_source, 0);
+    rb_define_method(cTokenStream, "each", token_stream_each, 0);
+    rb_define_method(cTokenStream, "[]", token_stream_aref, 1);
+    rb_define_method(cTokenStream, "type", token_stream_type_at, 1);
+    rb_define_method(cTokenStream, "number", token_stream_number, 1);
+    rb_define_method(cTokenStream, "unit", token_stream_unit, 1);
+    rb_define_method(cTokenStream, "text", token_stream_text, 1);
+    rb_define_method(cTokenStream, "value", token_stream_value, 1);
+}
@@ -0,0 +1,349 @@
+#include <ruby.h>
+#include <ruby/encoding.h>
+#include <string.h>
+#include "cataract.h"
+
+/*
+ * url() extraction and mapping
+ *
+ * Asset pipelines need every url(...) reference in a stylesheet, then swap
+ * them for fingerprinted paths:
+ *
+ *   .logo { background: url("logo.png") }   with {"logo.png" => "logo-3f2a1c.png"}
+ *   => .logo { background: url("logo-3f2a1c.png") }
+ *
+ * Both passes walk declaration values (including @font-face src lists and
+ * @keyframes blocks) and @import statements. url() tokens are found with the
+ * same rules as the parser's URL resolution (convert_urls_in_value): the
+ * match on "url(" is case-insensitive, quoted URLs honour backslash escapes,
+ * and unquoted URLs end at ')' or whitespace. Text inside quoted strings
+ * (content: "see url(x.css)") is not a url() token and is skipped.
+ *
+ * "url(" only starts a token at an identifier boundary, so "myurl(x)" is left
+ * alone.
+ *
+ * Mapping is a plain Hash lookup on the URL text as written (without quotes),
+ * so there is no Ruby call per URL. Replacements keep the original quoting
+ * (with quotes and backslashes escaped); an unquoted URL whose replacement
+ * needs quoting is emitted in double quotes.
+ */
+
+typedef struct {
+    long url_start;     // First byte of the URL text
+    long url_end;       // One past the last byte of the URL text
+    char quote;         // Quote character, or 0 for unquoted URLs
+} url_token;
+
+// Bytes that continue an identifier, so "myurl(" is a function, not url(
+#define IS_NAME_CHAR(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || \
+                         ((c) >= '0' && (c) <= '9') || (c) == '-' || (c) == '_' || \
+                         (unsigned char)(c) >= 0x80 || (c) == '\\')
+
+// Find the next url() token at or after *pos. Returns 1 and advances *pos past
+// the token (including its closing paren), or 0 when there are no more.
+static int next_url_token(const char *val, long len, long *pos, url_token *tok) {
+    long p = *pos;
+
+    while (p + 3 < len) {
+        // Skip "..." and '...' strings
+        if (val[p] == '"' || val[p] == '\'') {
+            char quote = val[p++];
+            while (p < len && val[p] != quote) {
+                p += (val[p] == '\\' && p + 1 < len) ? 2 : 1;
+            }
+            p++;
+            continue;
+        }
+        if ((val[p] == 'u' || val[p] == 'U') &&
+            (val[p + 1] == 'r' || val[p + 1] == 'R') &&
+            (val[p + 2] == 'l' || val[p + 2] == 'L') &&
+            val[p + 3] == '(' &&
+            (p == 0 || !IS_NAME_CHAR(val[p - 1]))) {
+            break;
+        }
+        p++;
+    }
+    if (p + 3 >= len) return 0;
+
+    p += 4;
+    while (p < len && IS_WHITESPACE(val[p])) p++;
+
+    tok->quote = 0;
+    if (p < len && (val[p] == '\'' || val[p] == '"')) {
+        tok->quote = val[p];
+        p++;
+    }
+
+    tok->url_start = p;
+    if (tok->quote) {
+        while (p < len && val[p] != tok->quote) {
+            p += (val[p] == '\\' && p + 1 < len) ? 2 : 1;
+        }
+    } else {
+        while (p < len && val[p] != ')' && !IS_WHITESPACE(val[p])) p++;
+    }
+    tok->url_end = p;
+
+    if (tok->quote && p < len && val[p] == tok->quote) p++;
+    while (p < len && IS_WHITESPACE(val[p])) p++;
+    if (p < len && val[p] == ')') p++;
+
+    *pos = p;
+    return 1;
+}
+
+// Unquoted url() can't hold whitespace, quotes, parens or backslashes
+static int needs_quotes(VALUE url) {
+    const char *p = RSTRING_PTR(url);
+    long len = RSTRING_LEN(url);
+
+    for (long i = 0; i < len; i++) {
+        char c = p[i];
+        if (IS_WHITESPACE(c) || c == '"' || c == '\'' || c == '(' || c == ')' || c == '\\') return 1;
+    }
+    return 0;
+}
+
+// Append a replacement URL in the given quote style, escaping the quote
+// character and backslashes
+static void append_quoted_url(VALUE buf, VALUE url, char quote) {
+    const char *p = RSTRING_PTR(url);
+    long len = RSTRING_LEN(url);
+    long run = 0;
+
+    rb_str_buf_cat(buf, &quote, 1);
+    for (long i = 0; i < len; i++) {
+        if (p[i] == quote || p[i] == '\\') {
+            rb_str_buf_cat(buf, p + run, i - run);
+            rb_str_buf_cat(buf, "\\", 1);
+            run = i;
+        }
+    }
+    rb_str_buf_cat(buf, p + run, len - run);
+    rb_str_buf_cat(buf, &quote, 1);
+}
+
+// Look up a replacement for url text; returns Qundef when there is none
+static VALUE lookup_url(VALUE mapping, VALUE url) {
+    VALUE replacement = rb_hash_lookup2(mapping, url, Qundef);
+    if (replacement == Qundef || NIL_P(replacement)) return Qundef;
+
+    Check_Type(replacement, T_STRING);
+    if (rb_str_equal(replacement, url) == Qtrue) return Qundef;
+    return replacement;
+}
+
+// ============================================================================
+// Extraction
+// ============================================================================
+
+static void extract_declaration_urls(VALUE result, VALUE declarations, VALUE rule_id, VALUE block_index) {
+    if (!RB_TYPE_P(declarations, T_ARRAY)) return;
+
+    long num_decls = RARRAY_LEN(declarations);
+    for (long i = 0; i < num_decls; i++) {
+        VALUE decl = RARRAY_AREF(declarations, i);
+        if (!rb_obj_is_kind_of(decl, cDeclaration)) continue;
+
+        VALUE value = rb_struct_aref(decl, INT2FIX(DECL_VALUE));
+        if (!RB_TYPE_P(value, T_STRING)) continue;
+
+        const char *val = RSTRING_PTR(value);
+        long len = RSTRING_LEN(value);
+        long pos = 0;
+        url_token tok;
+
+        while (next_url_token(val, len, &pos, &tok)) {
+            if (tok.url_end == tok.url_start) continue;
+
+            VALUE url = rb_enc_str_new(val + tok.url_start, tok.url_end - tok.url_start, rb_enc_get(value));
+            rb_ary_push(result, rb_struct_new(cUrlReference,
+                url,
+                rule_id,
+                rb_struct_aref(decl, INT2FIX(DECL_PROPERTY)),
+                LONG2NUM(i),
+                block_index));
+            // val may move if allocation triggered compaction
+            val = RSTRING_PTR(value);
+        }
+        RB_GC_GUARD(value);
+    }
+}
+
+/*
+ * Cataract.extract_urls(rules, imports) - collect url() references
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules to scan
+ * @param imports [Array<ImportStatement>, nil] @import statements (listed first)
+ * @return [Array<UrlReference>] References in source order
+ */
+VALUE cataract_extract_urls(VALUE self, VALUE rules_array, VALUE imports) {
+    Check_Type(rules_array, T_ARRAY);
+    if (!NIL_P(imports)) Check_Type(imports, T_ARRAY);
+
+    VALUE result = rb_ary_new();
+
+    long num_imports = NIL_P(imports) ? 0 : RARRAY_LEN(imports);
+    for (long i = 0; i < num_imports; i++) {
+        VALUE import = RARRAY_AREF(imports, i);
+        VALUE url = rb_struct_aref(import, INT2FIX(IMPORT_URL));
+        if (!RB_TYPE_P(url, T_STRING) || RSTRING_LEN(url) == 0) continue;
+
+        rb_ary_push(result, rb_struct_new(cUrlReference,
+            url, rb_struct_aref(import, INT2FIX(IMPORT_ID)), Qnil, Qnil, Qnil));
+    }
+
+    long num_rules = RARRAY_LEN(rules_array);
+    for (long i = 0; i < num_rules; i++) {
+        VALUE rule = RARRAY_AREF(rules_array, i);
+
+        if (rb_obj_is_kind_of(rule, cAtRule)) {
+            VALUE content = rb_struct_aref(rule, INT2FIX(AT_RULE_CONTENT));
+            if (!RB_TYPE_P(content, T_ARRAY)) continue;
+
+            VALUE rule_id = rb_struct_aref(rule, INT2FIX(AT_RULE_ID));
+            extract_declaration_urls(result, content, rule_id, Qnil);
+
+            long content_len = RARRAY_LEN(content);
+            for (long j = 0; j < content_len; j++) {
+                VALUE block = RARRAY_AREF(content, j);
+                if (rb_obj_is_kind_of(block, cRule)) {
+                    extract_declaration_urls(result, rb_struct_aref(block, INT2FIX(RULE_DECLARATIONS)), rule_id, LONG2NUM(j));
+                }
+            }
+        } else {
+            extract_declaration_urls(result, rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS)),
+                                     rb_struct_aref(rule, INT2FIX(RULE_ID)), Qnil);
+        }
+    }
+
+    return result;
+}
+
+// ============================================================================
+// Mapping
+// ============================================================================
+
+// Rewrite url() tokens in one value. Returns the same object when nothing maps.
+static VALUE map_urls_in_value(VALUE value, VALUE mapping, long *replaced) {
+    const char *val = RSTRING_PTR(value);
+    long len = RSTRING_LEN(value);
+    rb_encoding *enc = rb_enc_get(value);
+    VALUE result = Qnil;
+    long copied = 0;
+    long pos = 0;
+    url_token tok;
+
+    while (next_url_token(val, len, &pos, &tok)) {
+        if (tok.url_end == tok.url_start) continue;
+
+        VALUE url = rb_enc_str_new(val + tok.url_start, tok.url_end - tok.url_start, enc);
+        VALUE replacement = lookup_url(mapping, url);
+        val = RSTRING_PTR(value);
+        if (replacement == Qundef) continue;
+
+        if (NIL_P(result)) {
+            result = rb_str_buf_new(len);
+            rb_enc_associate(result, enc);
+        }
+
+        if (tok.quote) {
+            // Replace the quoted text including its quotes
+            rb_str_buf_cat(result, val + copied, tok.url_start - 1 - copied);
+            append_quoted_url(result, replacement, tok.quote);
+            copied = tok.url_end;
+            if (copied < len && val[copied] == tok.quote) copied++;
+        } else {
+            rb_str_buf_cat(result, val + copied, tok.url_start - copied);
+            if (needs_quotes(replacement)) {
+                append_quoted_url(result, replacement, '"');
+            } else {
+                rb_str_buf_append(result, replacement);
+            }
+            copied = tok.url_end;
+        }
+        (*replaced)++;
+    }
+
+    if (NIL_P(result)) return value;
+
+    rb_str_buf_cat(result, val + copied, len - copied);
+    RB_GC_GUARD(value);
+    return result;
+}
+
+static long map_declaration_urls(VALUE declarations, VALUE mapping) {
+    long replaced = 0;
+    if (!RB_TYPE_P(declarations, T_ARRAY)) return 0;
+
+    long num_decls = RARRAY_LEN(declarations);
+    for (long i = 0; i < num_decls; i++) {
+        VALUE decl = RARRAY_AREF(declarations, i);
+        if (!rb_obj_is_kind_of(decl, cDeclaration)) continue;
+
+        VALUE value = rb_struct_aref(decl, INT2FIX(DECL_VALUE));
+        if (!RB_TYPE_P(value, T_STRING)) continue;
+
+        VALUE mapped = map_urls_in_value(value, mapping, &replaced);
+        if (mapped != value) {
+            rb_struct_aset(decl, INT2FIX(DECL_VALUE), mapped);
+        }
+    }
+    return replaced;
+}
+
+/*
+ * Cataract.map_urls(rules, imports, mapping) - replace URLs via Hash lookup
+ *
+ * Rewrites url() tokens in declaration values and ImportStatement#url in
+ * place. URLs missing from the Hash (or mapped to nil) are left unchanged.
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules to rewrite
+ * @param imports [Array<ImportStatement>, nil] @import statements to rewrite
+ * @param mapping [Hash{String => String}] URL as written => replacement
+ * @return [Integer] Number of URLs replaced
+ */
+VALUE cataract_map_urls(VALUE self, VALUE rules_array, VALUE imports, VALUE mapping) {
+    Check_Type(rules_array, T_ARRAY);
+    if (!NIL_P(imports)) Check_Type(imports, T_ARRAY);
+    Check_Type(mapping, T_HASH);
+
+    long replaced = 0;
+    if (RHASH_SIZE(mapping) == 0) return INT2FIX(0);
+
+    long num_imports = NIL_P(imports) ? 0 : RARRAY_LEN(imports);
+    for (long i = 0; i < num_imports; i++) {
+        VALUE import = RARRAY_AREF(imports, i);
+        VALUE url = rb_struct_aref(import, INT2FIX(IMPORT_URL));
+        if (!RB_TYPE_P(url, T_STRING)) continue;
+
+        VALUE replacement = lookup_url(mapping, url);
+        if (replacement == Qundef) continue;
+
+        rb_struct_aset(import, INT2FIX(IMPORT_URL), rb_str_dup(replacement));
+        replaced++;
+    }
+
+    long num_rules = RARRAY_LEN(rules_array);
+    for (long i = 0; i < num_rules; i++) {
+        VALUE rule = RARRAY_AREF(rules_array, i);
+
+        if (rb_obj_is_kind_of(rule, cAtRule)) {
+            VALUE content = rb_struct_aref(rule, INT2FIX(AT_RULE_CONTENT));
+            if (!RB_TYPE_P(content, T_ARRAY)) continue;
+
+            replaced += map_declaration_urls(content, mapping);
+            long content_len = RARRAY_LEN(content);
+            for (long j = 0; j < content_len; j++) {
+                VALUE block = RARRAY_AREF(content, j);
+                if (rb_obj_is_kind_of(block, cRule)) {
+                    replaced += map_declaration_urls(rb_struct_aref(block, INT2FIX(RULE_DECLARATIONS)), mapping);
+                }
+            }
+        } else {
+            replaced += map_declaration_urls(rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS)), mapping);
+        }
+    }
+
+    return LONG2NUM(replaced);
+}
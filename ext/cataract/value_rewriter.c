@@ -0,0 +1,359 @@
+#include <ruby.h>
+#include <ruby/encoding.h>
+#include <string.h>
+#include <stdint.h>
+#include "cataract.h"
+
+/*
+ * Bulk declaration value rewriting
+ *
+ * Replaces literal substrings in every declaration value in one pass:
+ *
+ *   "url(http://old.cdn/a.png)"  with {"http://old.cdn" => "https://new.cdn"}
+ *   => "url(https://new.cdn/a.png)"
+ *
+ * All patterns are compiled into a single Aho-Corasick automaton. The root
+ * has a dense 256-way table; every other state keeps its trie edges as a
+ * byte-sorted slice of one shared edge array, plus a failure link. Memory is
+ * linear in the total pattern length (a full DFA needs 1 KB per state), and
+ * scanning stays amortized O(1) per byte: each failure step gives up depth
+ * that an earlier byte added. Values without a match are left alone (same
+ * String object, no allocation).
+ *
+ * Replacement semantics match a left-to-right scan: at the leftmost position
+ * where any pattern starts, the longest pattern starting there is replaced,
+ * and scanning resumes after it (matches never overlap). In prefix mode only
+ * the start of the value is checked.
+ */
+
+struct rewrite_automaton {
+    int32_t root[256];      // Child of the root for each byte, 0 if none
+    int32_t *edge_start;    // Edges of state s: edge_start[s] .. edge_start[s + 1]
+    uint8_t *edge_byte;     // Edge bytes, sorted within each state
+    int32_t *edge_target;
+    int32_t *fail;          // Longest proper suffix that is also a trie state
+    int32_t *terminal;      // Pattern index ending exactly here, or -1
+    uint8_t *hit;           // Some pattern is a suffix of this state
+    long max_len;           // Longest pattern
+    VALUE patterns;
+    VALUE replacements;
+};
+
+// Trie edge s -c->, or -1
+static int32_t trie_child(const struct rewrite_automaton *ac, int32_t state, unsigned char c) {
+    if (state == 0) return ac->root[c] ? ac->root[c] : -1;
+
+    int32_t lo = ac->edge_start[state];
+    int32_t hi = ac->edge_start[state + 1];
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (ac->edge_byte[mid] < c) {
+            lo = mid + 1;
+        } else if (ac->edge_byte[mid] > c) {
+            hi = mid;
+        } else {
+            return ac->edge_target[mid];
+        }
+    }
+    return -1;
+}
+
+// Automaton transition: follow failure links until some state has an edge for c
+static int32_t next_state(const struct rewrite_automaton *ac, int32_t state, unsigned char c) {
+    while (state != 0) {
+        int32_t t = trie_child(ac, state, c);
+        if (t >= 0) return t;
+        state = ac->fail[state];
+    }
+    return ac->root[c];
+}
+
+// Longest pattern starting at ptr, walking trie edges only. Returns -1 if none.
+static int32_t longest_match_at(const struct rewrite_automaton *ac, const unsigned char *ptr, long len) {
+    int32_t state = 0;
+    int32_t best = -1;
+
+    for (long i = 0; i < len; i++) {
+        state = trie_child(ac, state, ptr[i]);
+        if (state < 0) break;
+        if (ac->terminal[state] >= 0) best = ac->terminal[state];
+    }
+    return best;
+}
+
+// Rewrite one value. Returns the same object when nothing changes.
+static VALUE rewrite_value(const struct rewrite_automaton *ac, VALUE value, int prefix_only) {
+    const unsigned char *ptr = (const unsigned char *)RSTRING_PTR(value);
+    long len = RSTRING_LEN(value);
+    VALUE result = Qnil;
+    long copied = 0;
+    long pos = 0;
+
+    if (prefix_only) {
+        int32_t m = longest_match_at(ac, ptr, len);
+        if (m < 0) return value;
+
+        VALUE repl = RARRAY_AREF(ac->replacements, m);
+        long plen = RSTRING_LEN(RARRAY_AREF(ac->patterns, m));
+        result = rb_str_buf_new(len - plen + RSTRING_LEN(repl));
+        rb_str_buf_cat(result, RSTRING_PTR(repl), RSTRING_LEN(repl));
+        copied = plen;
+    } else {
+        while (pos < len) {
+            // Automaton scan for the first position where some match ends
+            int32_t state = 0;
+            long end = -1;
+            for (long i = pos; i < len; i++) {
+                state = next_state(ac, state, ptr[i]);
+                if (ac->hit[state]) {
+                    end = i;
+                    break;
+                }
+            }
+            if (end < 0) break;
+
+            // Every match ends at or after `end`, so none starts before end - max_len + 1
+            long from = end - ac->max_len + 1;
+            if (from < pos) from = pos;
+
+            int32_t m = -1;
+            long start = from;
+            for (; start <= end; start++) {
+                m = longest_match_at(ac, ptr + start, len - start);
+                if (m >= 0) break;
+            }
+            if (m < 0) break;  // Unreachable: the automaton reported a match
+
+            if (NIL_P(result)) {
+                result = rb_str_buf_new(len);
+            }
+            VALUE repl = RARRAY_AREF(ac->replacements, m);
+            rb_str_buf_cat(result, (const char *)ptr + copied, start - copied);
+            rb_str_buf_cat(result, RSTRING_PTR(repl), RSTRING_LEN(repl));
+            pos = copied = start + RSTRING_LEN(RARRAY_AREF(ac->patterns, m));
+        }
+        if (NIL_P(result)) return value;
+    }
+
+    rb_str_buf_cat(result, (const char *)ptr + copied, len - copied);
+
+    // Identity mappings (or replacements that cancel out) leave the value alone
+    if (RSTRING_LEN(result) == len && memcmp(RSTRING_PTR(result), ptr, len) == 0) {
+        return value;
+    }
+    rb_enc_associate(result, rb_enc_get(value));
+    return result;
+}
+
+static int property_selected(VALUE properties, VALUE property) {
+    if (NIL_P(properties)) return 1;
+    if (!RB_TYPE_P(property, T_STRING)) return 0;
+
+    long len = RARRAY_LEN(properties);
+    for (long i = 0; i < len; i++) {
+        VALUE p = RARRAY_AREF(properties, i);
+        if (RSTRING_LEN(p) == RSTRING_LEN(property) &&
+            memcmp(RSTRING_PTR(p), RSTRING_PTR(property), RSTRING_LEN(p)) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Rewrite declaration values in place; returns number of declarations changed
+static long rewrite_declarations(const struct rewrite_automaton *ac, VALUE declarations, int prefix_only, VALUE properties) {
+    long changed = 0;
+    if (!RB_TYPE_P(declarations, T_ARRAY)) return 0;
+
+    long len = RARRAY_LEN(declarations);
+    for (long i = 0; i < len; i++) {
+        VALUE decl = RARRAY_AREF(declarations, i);
+        if (!rb_obj_is_kind_of(decl, cDeclaration)) continue;
+        if (!property_selected(properties, rb_struct_aref(decl, INT2FIX(DECL_PROPERTY)))) continue;
+
+        VALUE value = rb_struct_aref(decl, INT2FIX(DECL_VALUE));
+        if (!RB_TYPE_P(value, T_STRING)) continue;
+
+        VALUE rewritten = rewrite_value(ac, value, prefix_only);
+        if (rewritten != value) {
+            rb_struct_aset(decl, INT2FIX(DECL_VALUE), rewritten);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+/*
+ * Cataract.rewrite_values(rules, patterns, replacements, prefix, properties)
+ *
+ * Walks Rule declarations and AtRule content (@font-face declarations and
+ * @keyframes blocks), replacing pattern occurrences in values in place.
+ *
+ * @param rules_array [Array<Rule, AtRule>] Rules to rewrite
+ * @param patterns [Array<String>] Non-empty, distinct literal patterns
+ * @param replacements [Array<String>] Replacement for each pattern
+ * @param prefix [Boolean] Only match at the start of a value
+ * @param properties [Array<String>, nil] Limit to these property names (nil = all)
+ * @return [Integer] Number of declarations changed
+ */
+VALUE cataract_rewrite_values(VALUE self, VALUE rules_array, VALUE patterns, VALUE replacements, VALUE prefix, VALUE properties) {
+    Check_Type(rules_array, T_ARRAY);
+    Check_Type(patterns, T_ARRAY);
+    Check_Type(replacements, T_ARRAY);
+    if (!NIL_P(properties)) {
+        Check_Type(properties, T_ARRAY);
+        for (long i = 0; i < RARRAY_LEN(properties); i++) {
+            Check_Type(RARRAY_AREF(properties, i), T_STRING);
+        }
+    }
+
+    long num_patterns = RARRAY_LEN(patterns);
+    if (RARRAY_LEN(replacements) != num_patterns) {
+        rb_raise(rb_eArgError, "patterns and replacements must have the same length");
+    }
+
+    long total_len = 0;
+    long max_len = 0;
+    for (long i = 0; i < num_patterns; i++) {
+        VALUE pattern = RARRAY_AREF(patterns, i);
+        Check_Type(pattern, T_STRING);
+        Check_Type(RARRAY_AREF(replacements, i), T_STRING);
+        if (RSTRING_LEN(pattern) == 0) {
+            rb_raise(rb_eArgError, "pattern must not be empty");
+        }
+        total_len += RSTRING_LEN(pattern);
+        if (RSTRING_LEN(pattern) > max_len) max_len = RSTRING_LEN(pattern);
+    }
+    if (num_patterns == 0) return INT2FIX(0);
+
+    // Build the trie (one state per pattern byte at most, plus the root).
+    // Children are kept as byte-sorted sibling lists until the edges are packed.
+    long max_states = total_len + 1;
+    VALUE first_child_buf, sibling_buf, in_byte_buf, terminal_buf, queue_buf;
+    struct rewrite_automaton ac;
+    memset(ac.root, 0, sizeof(ac.root));
+    int32_t *first_child = ALLOCV_N(int32_t, first_child_buf, max_states);
+    int32_t *sibling = ALLOCV_N(int32_t, sibling_buf, max_states);
+    uint8_t *in_byte = ALLOCV_N(uint8_t, in_byte_buf, max_states);
+    ac.terminal = ALLOCV_N(int32_t, terminal_buf, max_states);
+    ac.max_len = max_len;
+    ac.patterns = patterns;
+    ac.replacements = replacements;
+
+    first_child[0] = -1;
+    ac.terminal[0] = -1;
+    int32_t num_states = 1;
+
+    for (long i = 0; i < num_patterns; i++) {
+        VALUE pattern = RARRAY_AREF(patterns, i);
+        const unsigned char *p = (const unsigned char *)RSTRING_PTR(pattern);
+        long plen = RSTRING_LEN(pattern);
+        int32_t state = 0;
+
+        for (long j = 0; j < plen; j++) {
+            int32_t *link = NULL;   // Where a new child goes in the sorted sibling list
+            int32_t child;
+            if (state == 0) {
+                child = ac.root[p[j]] ? ac.root[p[j]] : -1;
+            } else {
+                link = &first_child[state];
+                while (*link >= 0 && in_byte[*link] < p[j]) link = &sibling[*link];
+                child = (*link >= 0 && in_byte[*link] == p[j]) ? *link : -1;
+            }
+            if (child < 0) {
+                child = num_states++;
+                first_child[child] = -1;
+                in_byte[child] = p[j];
+                ac.terminal[child] = -1;
+                if (link) {
+                    sibling[child] = *link;
+                    *link = child;
+                } else {
+                    sibling[child] = -1;
+                    ac.root[p[j]] = child;
+                }
+            }
+            state = child;
+        }
+        // Duplicate patterns: the last one wins, like Hash#[]=
+        ac.terminal[state] = (int32_t)i;
+    }
+
+    // Pack each state's sibling list into its slice of the edge arrays
+    VALUE edge_start_buf, edge_byte_buf, edge_target_buf, fail_buf, hit_buf;
+    ac.edge_start = ALLOCV_N(int32_t, edge_start_buf, num_states + 1);
+    ac.edge_byte = ALLOCV_N(uint8_t, edge_byte_buf, num_states);
+    ac.edge_target = ALLOCV_N(int32_t, edge_target_buf, num_states);
+    int32_t num_edges = 0;
+    for (int32_t s = 0; s < num_states; s++) {
+        ac.edge_start[s] = num_edges;
+        for (int32_t t = first_child[s]; t >= 0; t = sibling[t]) {
+            ac.edge_byte[num_edges] = in_byte[t];
+            ac.edge_target[num_edges++] = t;
+        }
+    }
+    ac.edge_start[num_states] = num_edges;
+
+    // Breadth-first pass computes failure links.
+    // States are visited by depth, so fail[s] is always finished before s.
+    ac.fail = ALLOCV_N(int32_t, fail_buf, num_states);
+    ac.hit = ALLOCV_N(uint8_t, hit_buf, num_states);
+    int32_t *queue = ALLOCV_N(int32_t, queue_buf, num_states);
+    long head = 0, tail = 0;
+
+    ac.fail[0] = 0;
+    ac.hit[0] = 0;
+    for (int c = 0; c < 256; c++) {
+        int32_t t = ac.root[c];
+        if (t > 0) {
+            ac.fail[t] = 0;
+            ac.hit[t] = ac.terminal[t] >= 0;
+            queue[tail++] = t;
+        }
+    }
+    while (head < tail) {
+        int32_t s = queue[head++];
+        for (int32_t t = first_child[s]; t >= 0; t = sibling[t]) {
+            ac.fail[t] = next_state(&ac, ac.fail[s], in_byte[t]);
+            ac.hit[t] = ac.terminal[t] >= 0 || ac.hit[ac.fail[t]];
+            queue[tail++] = t;
+        }
+    }
+    ALLOCV_END(queue_buf);
+    ALLOCV_END(in_byte_buf);
+    ALLOCV_END(sibling_buf);
+    ALLOCV_END(first_child_buf);
+
+    int prefix_only = RTEST(prefix);
+    long changed = 0;
+
+    long num_rules = RARRAY_LEN(rules_array);
+    for (long i = 0; i < num_rules; i++) {
+        VALUE rule = RARRAY_AREF(rules_array, i);
+
+        if (rb_obj_is_kind_of(rule, cAtRule)) {
+            VALUE content = rb_struct_aref(rule, INT2FIX(AT_RULE_CONTENT));
+            if (!RB_TYPE_P(content, T_ARRAY)) continue;
+
+            changed += rewrite_declarations(&ac, content, prefix_only, properties);
+            long content_len = RARRAY_LEN(content);
+            for (long j = 0; j < content_len; j++) {
+                VALUE block = RARRAY_AREF(content, j);
+                if (rb_obj_is_kind_of(block, cRule)) {
+                    changed += rewrite_declarations(&ac, rb_struct_aref(block, INT2FIX(RULE_DECLARATIONS)), prefix_only, properties);
+                }
+            }
+        } else {
+            changed += rewrite_declarations(&ac, rb_struct_aref(rule, INT2FIX(RULE_DECLARATIONS)), prefix_only, properties);
+        }
+    }
+
+    ALLOCV_END(hit_buf);
+    ALLOCV_END(fail_buf);
+    ALLOCV_END(edge_target_buf);
+    ALLOCV_END(edge_byte_buf);
+    ALLOCV_END(edge_start_buf);
+    ALLOCV_END(terminal_buf);
+
+    return LONG2NUM(changed);
+}
@@ -10,6 +10,7 @@ require_relative 'cataract/rule'
 require_relative 'cataract/at_rule'
 require_relative 'cataract/media_query'
 require_relative 'cataract/import_statement'
+require_relative 'cataract/url_reference'
 
 # Load pure Ruby or C extension based on ENV var
 if %w[1 true].include?(ENV.fetch('CATARACT_PURE', nil)) || RUBY_ENGINE == 'jruby'
@@ -21,8 +22,16 @@ end
 # Load supporting Ruby files (used by both implementations)
 require_relative 'cataract/stylesheet_scope'
 require_relative 'cataract/stylesheet'
+require_relative 'cataract/stylesheet_diff'
+require_relative 'cataract/cascade'
+require_relative 'cataract/stylesheet_split'
+require_relative 'cataract/prefix_table'
+require_relative 'cataract/name_minifier'
 require_relative 'cataract/declarations'
 require_relative 'cataract/import_resolver'
+require_relative 'cataract/caching_fetcher'
+require_relative 'cataract/import_graph'
+require_relative 'cataract/token_stream'
 
 # Cataract is a high-performance CSS parser written in C with a Ruby interface.
 #
@@ -88,6 +97,8 @@ module Cataract
     # the final computed declarations.
     #
     # @param stylesheet_or_css [Stylesheet, String] The stylesheet to flatten, or a CSS string to parse and flatten
+    # @param selectors [String, Array<String>, Regexp, nil] Optional filter - only rules whose
+    #   selector matches are flattened, and AtRules are dropped from the result
     # @return [Stylesheet] A new Stylesheet with flattened rules
     #
     # Flatten rules (in order of precedence):
@@ -65,8 +65,9 @@ module Cataract
     #
     # @param _property [String] CSS property name
     # @param _value [String, nil] Optional value to match
+    # @param prefix_match [Boolean] Accepted for parity with Rule#has_property?
     # @return [Boolean] Always returns false for AtRule objects
-    def has_property?(_property, _value = nil)
+    def has_property?(_property, _value = nil, prefix_match: false)
       false
     end
 
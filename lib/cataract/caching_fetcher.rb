@@ -0,0 +1,130 @@
+# frozen_string_literal: true
+
+require 'digest'
+require 'fileutils'
+require 'json'
+
+module Cataract
+  module ImportResolver
+    # Import fetcher that keeps remote responses in a local cache directory.
+    #
+    # Each HTTP/HTTPS response is stored with its ETag and Last-Modified
+    # headers and a freshness lifetime taken from Cache-Control. A fresh
+    # entry is returned without touching the network; a stale one is
+    # revalidated with If-None-Match / If-Modified-Since, and a 304 reuses
+    # the cached body. Responses marked +no-store+ are never written, and
+    # +no-cache+ forces revalidation on every fetch.
+    #
+    # Entries are one JSON file per URL, written atomically, so several
+    # processes can share a cache directory. The body is stored base64-encoded
+    # with its encoding name, so any bytes round-trip. A failed cache write is
+    # skipped and never fails the fetch. File imports are not cached.
+    #
+    # @example
+    #   fetcher = Cataract::ImportResolver::CachingFetcher.new('tmp/css-cache')
+    #   Cataract.parse_css(css, import: { fetcher: fetcher })
+    class CachingFetcher < DefaultFetcher
+      # @return [String] Cache directory
+      attr_reader :cache_dir
+
+      # @param cache_dir [String] Directory for cache entries (created if missing)
+      # @param default_max_age [Integer] Seconds a response without a
+      #   Cache-Control max-age stays fresh
+      def initialize(cache_dir, default_max_age: 0)
+        super()
+        @cache_dir = cache_dir
+        @default_max_age = default_max_age
+        FileUtils.mkdir_p(cache_dir)
+      end
+
+      # Remove every cache entry
+      #
+      # @return [void]
+      def clear
+        Dir.glob(File.join(@cache_dir, '*.json')).each { |path| File.delete(path) }
+      end
+
+      private
+
+      def fetch_http(uri, options)
+        url = uri.to_s
+        entry = read_entry(url)
+        return entry['body'] if entry && Time.now.to_f < entry['expires_at']
+
+        body, meta = open_http(uri, options, conditional_headers(entry)) { |io| [io.read, io.meta] }
+        write_entry(url, body, meta)
+        body
+      rescue OpenURI::HTTPError => e
+        raise unless entry && e.io.status[0] == '304'
+
+        # Not modified: keep the cached body, take the new freshness headers
+        write_entry(url, entry['body'], { 'etag' => entry['etag'], 'last-modified' => entry['last_modified'] }
+          .merge(e.io.meta))
+        entry['body']
+      end
+
+      def conditional_headers(entry)
+        headers = {}
+        return headers unless entry
+
+        headers['If-None-Match'] = entry['etag'] if entry['etag']
+        headers['If-Modified-Since'] = entry['last_modified'] if entry['last_modified']
+        headers
+      end
+
+      def entry_path(url)
+        File.join(@cache_dir, "#{Digest::SHA256.hexdigest(url)}.json")
+      end
+
+      # @return [Hash, nil] Stored entry with the decoded 'body', or nil when
+      #   missing or unreadable
+      def read_entry(url)
+        entry = JSON.parse(File.read(entry_path(url)))
+        return nil unless entry['url'] == url && entry['body_base64'].is_a?(String)
+
+        entry['body'] = entry['body_base64'].unpack1('m0').force_encoding(entry['encoding'])
+        entry
+      rescue Errno::ENOENT, JSON::ParserError, ArgumentError, TypeError
+        nil
+      end
+
+      def write_entry(url, body, meta)
+        path = entry_path(url)
+        max_age = max_age(meta)
+        unless max_age
+          FileUtils.rm_f(path)
+          return
+        end
+
+        entry = {
+          'url' => url,
+          'etag' => meta['etag'],
+          'last_modified' => meta['last-modified'],
+          'expires_at' => Time.now.to_f + max_age,
+          'encoding' => body.encoding.name,
+          'body_base64' => [body].pack('m0')
+        }
+        # Write then rename so readers never see a partial entry
+        tmp_path = "#{path}.#{Process.pid}.#{Fiber.current.object_id}.tmp"
+        File.write(tmp_path, JSON.generate(entry))
+        File.rename(tmp_path, path)
+      rescue SystemCallError, IOError, JSON::GeneratorError
+        # The cache is an optimization: keep the fetched body, drop the entry
+        FileUtils.rm_f(tmp_path) if tmp_path
+      end
+
+      # Freshness lifetime in seconds from Cache-Control and Age headers
+      #
+      # @return [Integer, nil] nil when the response must not be stored
+      def max_age(meta)
+        directives = meta['cache-control'].to_s.downcase.split(',').map(&:strip)
+        return nil if directives.include?('no-store')
+        return 0 if directives.include?('no-cache')
+
+        directive = directives.find { |d| d.start_with?('max-age=') }
+        seconds = directive ? directive.delete_prefix('max-age=').to_i : @default_max_age
+        [seconds - meta['age'].to_i, 0].max
+      end
+    end
+  end
+end
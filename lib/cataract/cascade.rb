@@ -0,0 +1,301 @@
+# frozen_string_literal: true
+
+module Cataract
+  # Origin-aware cascade over an ordered list of stylesheets.
+  #
+  # A Cascade references its member stylesheets instead of concatenating
+  # them. Each member gets an index of its rules grouped by (media, selector)
+  # - the same groups {Stylesheet#flatten} merges - and groups are resolved
+  # lazily across all members the first time they are asked for.
+  #
+  # Precedence follows CSS Cascading Level 5, highest last:
+  #
+  #   1. user-agent, user, author normal declarations
+  #   2. author, user, user-agent !important declarations
+  #
+  # Within an origin, normal declarations in earlier layers lose to later
+  # layers and unlayered declarations win; !important declarations reverse
+  # that. Layers are ordered by first appearance among the members of their
+  # origin. Ties go to the later member, then the later rule.
+  #
+  # Member stylesheets are never modified. After changing a member in place,
+  # call {#refresh} with it: each group keeps a hash of the member's
+  # declarations in it, and only groups whose hash changed (or that the
+  # member gained or lost) are resolved again.
+  #
+  # @example Layer a theme over a framework
+  #   cascade = Cataract::Cascade.new
+  #   cascade.add(ua_sheet, origin: :user_agent)
+  #   cascade.add(framework, layer: 'framework')
+  #   cascade.add(theme, layer: 'theme')
+  #   cascade.add(overrides, origin: :user)
+  #   cascade.declarations('.btn') #=> [#<Declaration color: ...>, ...]
+  #   cascade.to_stylesheet.to_s
+  class Cascade
+    # Origins in increasing precedence for normal declarations
+    ORIGINS = %i[user_agent user author].freeze
+
+    # A stylesheet in the cascade.
+    #
+    # @attr [Stylesheet] stylesheet Member stylesheet
+    # @attr [Symbol] origin :user_agent, :user or :author
+    # @attr [String, nil] layer Cascade layer name (nil when unlayered)
+    Member = Struct.new(:stylesheet, :origin, :layer)
+
+    # @return [Array<Member>] Members in cascade order
+    attr_reader :members
+
+    # @param stylesheets [Array<Stylesheet>] Initial author-origin, unlayered members
+    def initialize(stylesheets = [])
+      @members = []
+      @indexes = []
+      @digests = []
+      @resolved = {}
+      @keys = nil
+      @ranks = nil
+      stylesheets.each { |sheet| add(sheet) }
+    end
+
+    # Append a stylesheet to the cascade.
+    #
+    # @param stylesheet [Stylesheet] Stylesheet to reference (not copied)
+    # @param origin [Symbol] :user_agent, :user or :author
+    # @param layer [String, Symbol, nil] Cascade layer, nil for unlayered
+    # @return [self]
+    # @raise [ArgumentError] If origin is unknown
+    def add(stylesheet, origin: :author, layer: nil)
+      raise TypeError, "wrong argument type #{stylesheet.class} (expected Stylesheet)" unless stylesheet.is_a?(Stylesheet)
+      unless ORIGINS.include?(origin)
+        raise ArgumentError, "unknown origin #{origin.inspect} (expected one of #{ORIGINS.map(&:inspect).join(', ')})"
+      end
+
+      @members << Member.new(stylesheet, origin, layer&.to_s)
+      invalidate_keys(group_index(@members.size - 1).keys)
+      @ranks = nil
+      self
+    end
+    alias << add
+
+    # Re-index a member stylesheet after it was changed in place.
+    #
+    # Only groups whose declarations from this stylesheet changed are
+    # resolved again.
+    #
+    # @param stylesheet [Stylesheet] A member stylesheet
+    # @return [Integer] Number of groups invalidated
+    # @raise [ArgumentError] If the stylesheet is not a member
+    def refresh(stylesheet)
+      positions = @members.each_index.select { |i| @members[i].stylesheet.equal?(stylesheet) }
+      raise ArgumentError, 'stylesheet is not a member of this cascade' if positions.empty?
+
+      affected = {}
+      positions.each do |i|
+        old_digests = @digests[i] || {}
+        @indexes[i] = nil
+        group_index(i)
+        new_digests = @digests[i]
+        old_digests.each { |key, digest| affected[key] = true unless new_digests[key] == digest }
+        new_digests.each { |key, digest| affected[key] = true unless old_digests[key] == digest }
+      end
+      invalidate_keys(affected.keys)
+      affected.size
+    end
+
+    # Cascaded declarations for one selector.
+    #
+    # @param selector [String] Selector exactly as written in the stylesheets
+    # @param media [String, Symbol, nil] Media query text ("print",
+    #   "screen and (min-width: 768px)"), nil for rules outside @media
+    # @return [Array<Declaration>, nil] Winning declarations (shorthands
+    #   recreated where possible), or nil if no member has the selector
+    def declarations(selector, media: nil)
+      media_text = media && media.to_s.split(',').map(&:strip).sort.join(', ')
+      key = group_key(media_text, selector)
+      return nil unless keys.key?(key)
+
+      resolve([key]) unless @resolved.key?(key)
+      @resolved[key]&.map(&:dup)
+    end
+
+    # Resolve every group into a new stylesheet.
+    #
+    # Rules come out in order of first appearance across the members,
+    # followed by the members' at-rules. Resolved groups are cached, so
+    # later calls only redo groups invalidated by {#add} or {#refresh}.
+    #
+    # @return [Stylesheet] Flattened stylesheet
+    def to_stylesheet
+      pending = keys.each_key.reject { |key| @resolved.key?(key) }
+      resolve(pending) unless pending.empty?
+
+      result = Stylesheet.new
+      lookup = result.send(:patch_media_lookup)
+      rules = []
+      keys.each do |key, (member, rule)|
+        declarations = @resolved[key]
+        next unless declarations
+
+        media_query_id = nil
+        if rule.media_query_id
+          media_query_id = result.send(:patch_media_query_id,
+                                       media_lists(member.stylesheet)[rule.media_query_id], lookup)
+        end
+        rules << Rule.new(rules.size, rule.selector, declarations.map(&:dup), nil, nil, nil, nil, media_query_id)
+      end
+
+      @members.each do |member|
+        member.stylesheet.rules.each do |rule|
+          next unless rule.at_rule?
+
+          at_rule = rule.dup
+          at_rule.id = rules.size
+          at_rule.content = rule.content.dup
+          if rule.media_query_id
+            at_rule.media_query_id = result.send(:patch_media_query_id,
+                                                 media_lists(member.stylesheet)[rule.media_query_id], lookup)
+          end
+          rules << at_rule
+        end
+      end
+
+      result.instance_variable_set(:@rules, rules)
+      result.instance_variable_set(:@_last_rule_id, rules.size)
+      result.instance_variable_set(:@charset, @members.filter_map { |member| member.stylesheet.charset }.first)
+      result
+    end
+    alias flatten to_stylesheet
+
+    # @return [Integer] Number of (media, selector) groups across all members
+    def size
+      keys.size
+    end
+
+    def inspect
+      "#<Cataract::Cascade #{@members.size} stylesheets, #{size} groups>"
+    end
+
+    private
+
+    # group key => [first Member, first Rule] in first-appearance order
+    def keys
+      @keys ||= begin
+        keys = {}
+        @members.each_with_index do |member, member_index|
+          rules = member.stylesheet.rules
+          group_index(member_index).each do |key, rule_indexes|
+            keys[key] ||= [member, rules[rule_indexes.first]]
+          end
+        end
+        keys
+      end
+    end
+
+    def invalidate_keys(group_keys)
+      group_keys.each { |key| @resolved.delete(key) }
+      @keys = nil
+    end
+
+    # Per-member index: group key => indexes of its rules. Also records a
+    # hash of each group's declarations for {#refresh}.
+    def group_index(member_index)
+      @indexes[member_index] ||= begin
+        sheet = @members[member_index].stylesheet
+        media_texts = {}
+        media_lists(sheet).each do |mq_id, mqs|
+          media_texts[mq_id] = mqs.map(&:text).sort.join(', ')
+        end
+
+        index = {}
+        sheet.rules.each_with_index do |rule, rule_index|
+          next unless rule.is_a?(Rule)
+
+          key = group_key(media_texts[rule.media_query_id], rule.selector)
+          (index[key] ||= []) << rule_index
+        end
+
+        rules = sheet.rules
+        @digests[member_index] = index.transform_values do |rule_indexes|
+          rule_indexes.map { |rule_index| rules[rule_index].declarations.hash }.hash
+        end
+        index
+      end
+    end
+
+    def group_key(media_text, selector)
+      "#{media_text}\x00#{selector}"
+    end
+
+    # media_query_id => [MediaQuery, other members of its list...]
+    def media_lists(sheet)
+      StylesheetDiff.media_query_lists(sheet)
+    end
+
+    # Cascade the given groups across members, then let flatten recreate
+    # shorthands for all of them in one pass
+    def resolve(group_keys)
+      ranks = layer_ranks
+      winners_by_key = group_keys.map { |key| [key, cascade_group(key, ranks)] }
+
+      scratch = Stylesheet.new
+      rules = []
+      winners_by_key.each_with_index do |(_key, winners), group|
+        next if winners.empty?
+
+        # Distinct media_query_id per group keeps flatten from merging them
+        rules << Rule.new(rules.size, 'g', winners, nil, nil, nil, nil, group)
+      end
+      scratch.instance_variable_set(:@rules, rules)
+
+      flattened = {}
+      Cataract.flatten(scratch).rules.each { |rule| flattened[rule.media_query_id] = rule.declarations }
+
+      winners_by_key.each_with_index do |(key, _winners), group|
+        @resolved[key] = flattened[group]&.freeze
+      end
+    end
+
+    # Winning longhand declaration per property for one group
+    def cascade_group(key, ranks)
+      winners = {}
+      @members.each_with_index do |member, member_index|
+        rule_indexes = group_index(member_index)[key]
+        next unless rule_indexes
+
+        normal_rank, important_rank = ranks[member_index]
+        rules = member.stylesheet.rules
+        rule_indexes.each do |rule_index|
+          rules[rule_index].declarations.each do |decl|
+            Cataract.expand_shorthand(decl).each do |longhand|
+              rank = longhand.important ? important_rank : normal_rank
+              existing = winners[longhand.property]
+              # Members and rules are visited in order, so ties go to the later one
+              winners[longhand.property] = [rank, longhand] if existing.nil? || rank >= existing[0]
+            end
+          end
+        end
+      end
+      winners.each_value.map { |(_rank, decl)| Declaration.new(decl.property, decl.value, decl.important) }
+    end
+
+    # [normal rank, !important rank] per member
+    def layer_ranks
+      @ranks ||= begin
+        layers = Hash.new { |hash, origin| hash[origin] = [] }
+        @members.each do |member|
+          layers[member.origin] << member.layer if member.layer && !layers[member.origin].include?(member.layer)
+        end
+
+        slots = @members.map { |member| layers[member.origin].size + 1 }.max || 1
+        @members.map do |member|
+          origin_index = ORIGINS.index(member.origin)
+          layer_count = layers[member.origin].size
+          # Unlayered sits above every layer for normal declarations
+          position = member.layer ? layers[member.origin].index(member.layer) : layer_count
+          normal = (origin_index * slots) + position
+          important = (ORIGINS.size * slots) + ((ORIGINS.size - 1 - origin_index) * slots) + (layer_count - position)
+          [normal, important]
+        end
+      end
+    end
+  end
+end
@@ -9,6 +9,22 @@ module Cataract
   # Parsing errors
   class DepthError < Error; end
   class SizeError < Error; end
+
+  # Error raised when a parse exceeds one of the :limits budgets
+  class LimitError < Error
+    # @return [Symbol] Exceeded limit (:max_bytes, :max_rules, :timeout, ...)
+    attr_reader :limit
+    # @return [Numeric] Configured value of that limit
+    attr_reader :max
+
+    # @param limit [Symbol] Exceeded limit
+    # @param max [Numeric] Configured value of that limit
+    def initialize(limit:, max:)
+      @limit = limit
+      @max = max
+      super(limit == :timeout ? "CSS parse exceeded timeout of #{max}s" : "CSS exceeds #{limit} limit of #{max}")
+    end
+  end
   # Internal parser consistency errors
 
   # Error raised when invalid CSS is encountered in strict mode
@@ -0,0 +1,216 @@
+# frozen_string_literal: true
+
+require 'digest'
+require 'json'
+
+module Cataract
+  # Import dependency graph across several entry stylesheets, for watch-mode
+  # rebuilds.
+  #
+  # Loading entries through the graph records which files each one imports,
+  # transitively, with a SHA-256 digest of every file's content. When a file
+  # changes, {invalidate} names the entries that depend on it; reloading them
+  # re-fetches and re-parses only the changed file and the imports between it
+  # and the entry, while every other import is spliced from a parsed copy the
+  # graph kept from the previous build.
+  #
+  # Edges and digests persist with {save} / {load}; parsed copies live only in
+  # memory. After a restart, {changed} compares the saved digests with the
+  # files on disk.
+  #
+  # Nodes are keyed by URL ("file:///src/base.css"); methods taking a node
+  # also accept a file path.
+  #
+  # @example Watch loop
+  #   graph = Cataract::ImportGraph.new
+  #   sheets = entries.to_h { |path| [path, graph.load_file(path)] }
+  #
+  #   on_change do |path|
+  #     graph.invalidate(path).each do |entry|
+  #       sheets[entry] = graph.load_file(entry)
+  #     end
+  #   end
+  class ImportGraph
+    # @return [Array<String>] Entry stylesheet URLs, in load order
+    attr_reader :entries
+
+    def initialize
+      @entries = []
+      @edges = {}   # Hash: URL => Array of imported URLs
+      @digests = {} # Hash: URL => SHA-256 hex digest of its content
+      @sheets = {}  # Hash: URL => parsed Stylesheet, imports resolved but not yet spliced
+    end
+
+    # Load a graph saved with {save}
+    #
+    # @param path [String] JSON file
+    # @return [ImportGraph]
+    def self.load(path)
+      data = JSON.parse(File.read(path))
+      graph = new
+      graph.instance_variable_set(:@entries, data['entries'])
+      graph.instance_variable_set(:@edges, data['edges'])
+      graph.instance_variable_set(:@digests, data['digests'])
+      graph
+    end
+
+    # Save edges and digests as JSON
+    #
+    # @param path [String] JSON file
+    # @return [void]
+    def save(path)
+      File.write(path, JSON.generate('entries' => @entries, 'edges' => @edges, 'digests' => @digests))
+    end
+
+    # Parse an entry stylesheet, recording its imports in the graph
+    #
+    # Imports the graph holds a parsed copy of are spliced from that copy
+    # instead of being fetched and parsed again.
+    #
+    # @param path [String] Entry file
+    # @param options [Hash] Options passed to Stylesheet.new. +:import+
+    #   defaults to allowing file imports only.
+    # @return [Stylesheet]
+    def load_file(path, **options)
+      file_path = File.expand_path(path)
+      entry = "file://#{file_path}"
+      css = File.read(file_path)
+
+      import = options.fetch(:import, { allowed_schemes: ['file'] })
+      import = {} if import == true
+      import = import.merge(base_path: File.dirname(file_path), importer: entry, graph: self)
+      sheet = Stylesheet.parse(css, **options, import: import)
+
+      @entries << entry unless @entries.include?(entry)
+      @edges[entry] = sheet.import_graph[entry] || []
+      @digests[entry] = Digest::SHA256.hexdigest(css)
+      prune
+      sheet
+    end
+
+    # @param node [String] URL or file path
+    # @return [Array<String>] URLs node imports directly
+    def imports(node)
+      @edges.fetch(key(node), []).dup
+    end
+
+    # @param node [String] URL or file path
+    # @return [Array<String>] URLs that import node directly
+    def importers(node)
+      node = key(node)
+      @edges.filter_map { |importer, urls| importer if urls.include?(node) }
+    end
+
+    # Entry stylesheets that import node, directly or transitively (or are node)
+    #
+    # @param node [String] URL or file path
+    # @return [Array<String>] Entry URLs, in load order
+    def affected_entries(node)
+      dependents = dependents(key(node))
+      @entries.select { |entry| dependents.include?(entry) }
+    end
+
+    # Drop the parsed copies of node and everything importing it, so the
+    # next {load_file} of an affected entry re-resolves just that subtree
+    #
+    # @param node [String] URL or file path of the changed file
+    # @return [Array<String>] Affected entry URLs, in load order
+    def invalidate(node)
+      dependents = dependents(key(node))
+      dependents.each_key { |url| @sheets.delete(url) }
+      @entries.select { |entry| dependents.include?(entry) }
+    end
+
+    # Files whose content no longer matches the recorded digest
+    #
+    # Only file:// nodes are checked; a deleted file counts as changed.
+    #
+    # @return [Array<String>] Changed URLs
+    def changed
+      @digests.filter_map do |url, digest|
+        next unless url.start_with?('file://')
+
+        current = begin
+          Digest::SHA256.file(url.delete_prefix('file://')).hexdigest
+        rescue Errno::ENOENT
+          nil
+        end
+        url if current != digest
+      end
+    end
+
+    # @param node [String] URL or file path
+    # @return [String, nil] Recorded SHA-256 digest
+    def digest(node)
+      @digests[key(node)]
+    end
+
+    # @private
+    # Copy of the parsed import at url, or nil when it must be fetched
+    def cached_sheet(url)
+      sheet = @sheets[url]
+      sheet && copy(sheet)
+    end
+
+    # @private
+    # Record a fetched import and keep a parsed copy for later builds
+    def store(url, css, sheet)
+      @edges[url] = sheet.import_graph[url] || []
+      @digests[url] = Digest::SHA256.hexdigest(css)
+      @sheets[url] = copy(sheet)
+    end
+
+    private
+
+    def key(node)
+      node.include?('://') ? node : "file://#{File.expand_path(node)}"
+    end
+
+    # node and every URL importing it, transitively
+    def dependents(node)
+      importers = {}
+      @edges.each { |importer, urls| urls.each { |url| (importers[url] ||= []) << importer } }
+
+      found = { node => true }
+      queue = [node]
+      until queue.empty?
+        importers.fetch(queue.shift, []).each do |importer|
+          next if found[importer]
+
+          found[importer] = true
+          queue << importer
+        end
+      end
+      found
+    end
+
+    # Forget nodes no entry reaches any more
+    def prune
+      reachable = {}
+      queue = @entries.dup
+      until queue.empty?
+        url = queue.shift
+        next if reachable[url]
+
+        reachable[url] = true
+        queue.concat(@edges.fetch(url, []))
+      end
+      [@edges, @digests, @sheets].each { |hash| hash.select! { |url, _| reachable[url] } }
+    end
+
+    # Splicing takes ownership of rules, so hand out copies
+    def copy(sheet)
+      copy = sheet.dup
+      copy.instance_variable_set(:@rules, sheet.rules.map do |source|
+        rule = source.dup
+        if rule.is_a?(Rule)
+          rule.declarations = source.declarations.map(&:dup)
+        elsif rule.is_a?(AtRule)
+          rule.content = source.content.dup
+        end
+        rule
+      end)
+      copy
+    end
+  end
+end
@@ -9,9 +9,20 @@ module Cataract
 
   # Resolves @import statements in CSS
   # Handles fetching imported files and inlining them with proper security controls
+  #
+  # A fetcher is anything responding to +call(url, options)+ that returns the
+  # imported CSS. Fetchers may also implement
+  # +fetch_each(urls, options) { |index, css| ... }+ to fetch sibling imports
+  # together: yield each result as it arrives, in any order, and return once
+  # all are done. The resolver parses each import as it is yielded.
   module ImportResolver
     # Default fetcher implementation using File I/O and Net::HTTP
     # Can be replaced with custom fetchers for different environments (e.g., browser, caching)
+    #
+    # Under a Fiber scheduler (e.g. the async gem, Falcon) sibling imports are
+    # fetched concurrently in non-blocking fibers, so an import-heavy parse
+    # waits on the network without blocking the reactor. Without a scheduler
+    # they are fetched one after another.
     class DefaultFetcher
       # Fetch content from a URL
       #
@@ -42,10 +53,46 @@ module Cataract
         raise ImportError, "Error fetching import: #{url} (#{e.class}: #{e.message})"
       end
 
+      # Fetch several URLs, yielding each one's content as it arrives
+      #
+      # @param urls [Array<String>] URLs to fetch
+      # @param options [Hash] Import resolution options
+      # @yieldparam index [Integer] Position of the URL in urls
+      # @yieldparam content [String] Fetched content
+      # @return [void]
+      # @raise [ImportError] If a fetch fails (the first failing URL in order,
+      #   after the others have finished)
+      def fetch_each(urls, options)
+        unless Fiber.scheduler && !Fiber.blocking?
+          urls.each_with_index { |url, index| yield index, call(url, options) }
+          return
+        end
+
+        done = Thread::Queue.new
+        urls.each_with_index do |url, index|
+          Fiber.schedule do
+            yield index, call(url, options)
+            done << [index, nil]
+          rescue StandardError => e
+            done << [index, e]
+          end
+        end
+
+        errors = Array.new(urls.size) { done.pop }.select { |_index, error| error }
+        raise errors.min_by(&:first).last unless errors.empty?
+      end
+
       private
 
       # Fetch content via HTTP/HTTPS
       def fetch_http(uri, options)
+        open_http(uri, options, &:read)
+      end
+
+      # Open an HTTP/HTTPS URI, yielding the response IO
+      #
+      # @param headers [Hash{String => String}] Extra request headers
+      def open_http(uri, options, headers = {}, &block)
         # Use open-uri with timeout
         open_uri_options = {
           read_timeout: options[:timeout],
@@ -53,7 +100,7 @@ module Cataract
         }
 
         # Use uri.open instead of URI.open to avoid shell command injection
-        uri.open(open_uri_options, &:read)
+        uri.open(open_uri_options.merge(headers), &block)
       end
     end
 
@@ -66,9 +113,23 @@ module Cataract
       follow_redirects: true,            # Follow redirects
       base_path: nil,                    # Base path for resolving relative file imports
       base_uri: nil,                     # Base URI for resolving relative HTTP imports
-      fetcher: nil                       # Custom fetcher (defaults to DefaultFetcher)
+      fetcher: nil,                      # Custom fetcher (defaults to DefaultFetcher)
+      graph: nil,                        # ImportGraph to record into and reuse parsed imports from
+      importer: nil                      # URL of the CSS being resolved (import_graph key)
     }.freeze
 
+    # Fetch urls with fetcher, yielding (index, content) as each arrives
+    #
+    # Uses the fetcher's own +fetch_each+ when it has one, otherwise calls it
+    # once per URL in order.
+    def self.fetch_each(fetcher, urls, options, &block)
+      if fetcher.respond_to?(:fetch_each)
+        fetcher.fetch_each(urls, options, &block)
+      else
+        urls.each_with_index { |url, index| yield index, fetcher.call(url, options) }
+      end
+    end
+
     # Normalize options with safe defaults
     def self.normalize_options(options)
       if options == true
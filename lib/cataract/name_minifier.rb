@@ -0,0 +1,112 @@
+# frozen_string_literal: true
+
+module Cataract
+  # Short class and id names for {Stylesheet#minify_names!}.
+  #
+  # Names are ranked by how many times selectors use them, most used first
+  # (ties keep stylesheet order), and take the next free short name in that
+  # order: "a".."z", then two characters ("aa", "ba", ... "z9"), and so on.
+  # Classes and ids are separate namespaces, so ".btn" and "#main" can both
+  # become "a".
+  #
+  # A name is kept as is when +keep+ lists it, a selector spells it with hex
+  # escapes (".\61" is ".a"), or an attribute selector that can't be
+  # rewritten could match it ([class^="col-"] keeps ".col-6"). Short names
+  # are never taken from kept names, nor chosen where such an attribute
+  # selector would start matching them.
+  module NameMinifier
+    # Characters a short name starts with
+    FIRST = ('a'..'z').map(&:freeze).freeze
+
+    # Characters for the rest of a short name
+    REST = [*'a'..'z', *'0'..'9'].map(&:freeze).freeze
+
+    # @param counts [Hash{String => Integer}] ".class" / "#id" token =>
+    #   occurrences, in stylesheet order
+    # @param patterns [Array<Array>] [kind, operator, value, case_insensitive]
+    #   attribute matches that can't be rewritten
+    # @param keep [Enumerable<String>] Tokens to keep (".btn", "#app"), or
+    #   bare names to keep as both class and id
+    # @param fixed [Array<String>] Decoded tokens the selectors spell with
+    #   hex escapes, which can't be rewritten
+    # @return [Hash{String => String}] Token => short token, most used first
+    # @raise [TypeError] If keep is not an Enumerable of Strings
+    def self.mapping(counts, patterns, keep, fixed = [])
+      taken = kept_tokens(keep)
+      fixed.each { |token| taken[token] = true }
+      renamed = []
+      counts.each_key do |token|
+        if taken.key?(token) || matched?(token, patterns)
+          taken[token] = true
+        else
+          renamed << token
+        end
+      end
+
+      order = renamed.each_with_index.to_h
+      renamed.sort_by! { |token| [-counts[token], order[token]] }
+
+      next_index = Hash.new(0)
+      renamed.to_h do |token|
+        kind = token[0]
+        short = nil
+        loop do
+          short = kind + short_name(next_index[kind])
+          next_index[kind] += 1
+          break unless taken.key?(short) || matched?(short, patterns)
+        end
+        [token, short]
+      end
+    end
+
+    # Short name number index: "a".."z", "aa", "ba", ...
+    #
+    # @param index [Integer]
+    # @return [String]
+    def self.short_name(index)
+      name = +FIRST[index % FIRST.size]
+      index /= FIRST.size
+      while index > 0
+        index -= 1
+        name << REST[index % REST.size]
+        index /= REST.size
+      end
+      name
+    end
+
+    class << self
+      private
+
+      # Whether an attribute match that can't be rewritten could select the
+      # token. Matches the name against every word of the value, as a
+      # substring, so it errs on the side of keeping names.
+      def matched?(token, patterns)
+        patterns.any? do |kind, _operator, value, case_insensitive|
+          next false unless token.start_with?(kind)
+
+          name = token[1..]
+          if case_insensitive
+            name = name.downcase
+            value = value.downcase
+          end
+          value.split.any? { |word| name.include?(word) }
+        end
+      end
+
+      def kept_tokens(keep)
+        raise TypeError, "keep must be Enumerable, got #{keep.class}" unless keep.is_a?(Enumerable)
+
+        keep.each_with_object({}) do |name, tokens|
+          raise TypeError, "keep entries must be Strings, got #{name.class}" unless name.is_a?(String)
+
+          if name.start_with?('.', '#')
+            tokens[name] = true
+          else
+            tokens[".#{name}"] = true
+            tokens["##{name}"] = true
+          end
+        end
+      end
+    end
+  end
+end
@@ -0,0 +1,146 @@
+# frozen_string_literal: true
+
+module Cataract
+  # Browser capability table for vendor prefix pruning.
+  #
+  # The table is a JSON file with five sections:
+  #
+  # - +engines+: vendor prefix => browsers that parse it
+  #   ({ "-moz-": ["firefox"] })
+  # - +properties+, +values+, +selectors+, +at_rules+: prefixed name =>
+  #   last version of each browser that still needs it, or "all" when no
+  #   version supports the standard form. An optional +standard+ key names
+  #   the standard form (null when there is none).
+  #
+  # A property entry also covers longer names with the same head, so
+  # "-webkit-animation" covers "-webkit-animation-delay". Longhands whose
+  # standard name or value grammar differs need their own entry
+  # ("-webkit-mask-composite" with "standard": null). The bundled
+  # table ({DEFAULT_PATH}) lists the common prefixes; point
+  # {Stylesheet#prune_prefixes!} at a copy to change the data.
+  #
+  # @example
+  #   table = Cataract::PrefixTable.load('config/prefixes.json')
+  #   sheet.prune_prefixes!(targets: { chrome: 120, safari: '16.4' }, table: table)
+  class PrefixTable
+    # Bundled capability table
+    DEFAULT_PATH = File.expand_path('data/prefixes.json', __dir__)
+
+    # Entry sections, in the order Cataract.prune_prefixes takes them
+    SECTIONS = %w[properties values selectors at_rules].freeze
+
+    # @return [Array<String>] Browser names the table knows about
+    attr_reader :browsers
+
+    # Load a table from a JSON file.
+    #
+    # @param path [String] Path to the JSON file
+    # @return [PrefixTable]
+    def self.load(path)
+      require 'json'
+      new(JSON.parse(File.read(path)))
+    end
+
+    # @return [PrefixTable] The bundled table (loaded once)
+    def self.default
+      @default ||= load(DEFAULT_PATH)
+    end
+
+    # @param data [Hash] Parsed table (see class documentation)
+    # @raise [ArgumentError] If the engines section is missing
+    def initialize(data)
+      raise TypeError, "wrong argument type #{data.class} (expected Hash)" unless data.is_a?(Hash)
+      raise ArgumentError, 'prefix table has no engines section' unless data['engines'].is_a?(Hash)
+
+      @engines = data['engines']
+      @sections = SECTIONS.to_h { |section| [section, data[section] || {}] }
+      @browsers = @engines.values.flatten.uniq.freeze
+      @compiled = {}
+    end
+
+    # Actions for {Cataract.prune_prefixes}, one Hash per section and one
+    # for the vendor prefixes themselves: true (keep), false (no target
+    # parses it) or the standard form (a target parses it but doesn't
+    # need it).
+    #
+    # @api private
+    # @param targets [Hash{Symbol, String => Numeric, String}] Browser => oldest version supported
+    # @return [Array<Hash>] properties, values, selectors, at_rules, prefixes
+    # @raise [ArgumentError] If targets is empty, a browser is unknown or a version is invalid
+    def actions(targets)
+      targets = normalize_targets(targets)
+      @compiled[targets] ||= begin
+        prefixes = @engines.keys.to_h { |prefix| [prefix, targeted?(prefix, targets)] }
+        sections = SECTIONS.map do |section|
+          @sections[section].to_h { |name, entry| [name, action(section, name, entry, targets, prefixes)] }
+        end
+        (sections << prefixes).each(&:freeze).freeze
+      end
+    end
+
+    def inspect
+      "#<Cataract::PrefixTable #{@browsers.size} browsers, #{@sections.sum { |_, entries| entries.size }} entries>"
+    end
+
+    private
+
+    def normalize_targets(targets)
+      raise TypeError, "targets must be a Hash, got #{targets.class}" unless targets.is_a?(Hash)
+      raise ArgumentError, 'targets must name at least one browser' if targets.empty?
+
+      targets.to_h do |browser, version|
+        browser = browser.to_s
+        raise ArgumentError, "unknown browser #{browser.inspect} (known: #{@browsers.join(', ')})" unless @browsers.include?(browser)
+
+        [browser, parse_version(version)]
+      end.freeze
+    end
+
+    def parse_version(version)
+      Gem::Version.new(version.to_s)
+    rescue ArgumentError
+      raise ArgumentError, "invalid browser version #{version.inspect}"
+    end
+
+    def action(section, name, entry, targets, prefixes)
+      return true if needed?(entry, targets)
+
+      prefix = vendor_prefix(name)
+      return false unless prefixes.fetch(prefix, true)
+
+      standard = entry.key?('standard') ? entry['standard'] : default_standard(section, name, prefix)
+      standard ? -standard : true
+    end
+
+    def needed?(entry, targets)
+      targets.any? do |browser, version|
+        last = entry[browser]
+        next false if last.nil?
+
+        last == 'all' || version <= parse_version(last)
+      end
+    end
+
+    def targeted?(prefix, targets)
+      @engines[prefix].any? { |browser| targets.key?(browser) }
+    end
+
+    # "-webkit-" from "-webkit-appearance", "::-moz-selection" or "@-o-keyframes"
+    def vendor_prefix(name)
+      start = 0
+      start += 1 while name[start] == ':' || name[start] == '@'
+      finish = name.index('-', start + 1)
+      finish ? name[start..finish] : name
+    end
+
+    # Properties, values and at-rules drop the prefix; selectors only have
+    # a standard form when the table names one
+    def default_standard(section, name, prefix)
+      case section
+      when 'properties' then name.delete_prefix(prefix)
+      when 'at_rules' then "@#{name.delete_prefix("@#{prefix}")}"
+      when 'values' then name.delete_prefix(prefix)
+      end
+    end
+  end
+end
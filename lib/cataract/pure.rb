@@ -37,10 +37,19 @@ require_relative 'rule'
 require_relative 'at_rule'
 require_relative 'media_query'
 require_relative 'import_statement'
+require_relative 'url_reference'
 require_relative 'stylesheet_scope'
 require_relative 'stylesheet'
+require_relative 'stylesheet_diff'
+require_relative 'cascade'
+require_relative 'stylesheet_split'
+require_relative 'prefix_table'
+require_relative 'name_minifier'
 require_relative 'declarations'
 require_relative 'import_resolver'
+require_relative 'caching_fetcher'
+require_relative 'import_graph'
+require_relative 'token_stream'
 
 # Add to_s method to Declarations class for pure Ruby mode
 module Cataract
@@ -66,6 +75,16 @@ require_relative 'pure/byte_constants'
 require_relative 'pure/helpers'
 require_relative 'pure/specificity'
 require_relative 'pure/serializer'
+require_relative 'pure/media_consolidation'
+require_relative 'pure/compression_order'
+require_relative 'pure/json_serializer'
+require_relative 'pure/calc_folder'
+require_relative 'pure/value_rewriter'
+require_relative 'pure/url_rewriter'
+require_relative 'pure/prefix_pruner'
+require_relative 'pure/tokenizer'
+require_relative 'pure/selector_parser'
+require_relative 'pure/parse_budget'
 require_relative 'pure/parser'
 require_relative 'pure/flatten'
 
@@ -93,6 +112,7 @@ module Cataract
   #   rules: Array<Rule>,           # Flat array of Rule/AtRule structs
   #   _media_index: Hash,           # Symbol => Array of rule IDs
   #   charset: String|nil,          # @charset value if present
+  #   last_rule_id: Integer,        # Next rule ID (imports take IDs too)
   #   _has_nesting: Boolean         # Whether any nested rules exist
   # }
   def self._parse_css(css_string, parser_options = {})
@@ -100,6 +120,94 @@ module Cataract
     parser.parse
   end
 
+  # Parse several CSS strings into one result
+  #
+  # Mirrors the native shared-context parse: IDs continue across sources as
+  # if the sources were parsed one after another and merged. Each source is
+  # parsed on its own and shifted by the counts of the sources before it.
+  #
+  # @api private
+  # @param sources [Array<String>] CSS strings, in order
+  # @param parser_options [Hash] Parser configuration options
+  # @return [Hash] Same keys as {_parse_css} plus last_rule_id and
+  #   _import_sources (source index of each import)
+  def self._parse_css_many(sources, parser_options)
+    raise TypeError, "wrong argument type #{sources.class} (expected Array)" unless sources.is_a?(Array)
+
+    sources.each do |css|
+      raise TypeError, "wrong argument type #{css.class} (expected String)" unless css.is_a?(String)
+    end
+
+    rules = []
+    rule_offset = 0
+    media_index = {}
+    media_queries = []
+    selector_lists = {}
+    media_query_lists = {}
+    imports = []
+    import_sources = []
+    charset = nil
+    has_nesting = false
+
+    # Limits apply to the sources together, as one parse
+    if parser_options[:limits]
+      budget = ParseBudget.new(parser_options[:limits], sources.sum(&:bytesize))
+      parser_options = parser_options.merge(_budget: budget)
+    end
+
+    sources.each_with_index do |css, source_index|
+      result = Parser.new(css, parser_options: parser_options).parse
+      list_offset = selector_lists.size
+      mq_offset = media_queries.size
+      mq_list_offset = media_query_lists.size
+
+      result[:rules].each do |rule|
+        rule.id += rule_offset
+        rule.media_query_id += mq_offset if rule.media_query_id
+        if rule.is_a?(Rule)
+          rule.parent_rule_id += rule_offset if rule.parent_rule_id
+          rule.selector_list_id += list_offset if rule.selector_list_id
+        end
+        rules << rule
+      end
+      result[:_media_index].each do |media, rule_ids|
+        (media_index[media] ||= []).concat(rule_ids.map { |id| id + rule_offset })
+      end
+      result[:media_queries].each do |mq|
+        mq.id += mq_offset
+        media_queries << mq
+      end
+      result[:_selector_lists].each do |list_id, rule_ids|
+        selector_lists[list_id + list_offset] = rule_ids.map { |id| id + rule_offset }
+      end
+      result[:_media_query_lists].each do |list_id, mq_ids|
+        media_query_lists[list_id + mq_list_offset] = mq_ids.map { |id| id + mq_offset }
+      end
+      result[:imports].each do |import|
+        import.id += rule_offset
+        import.media_query_id += mq_offset if import.media_query_id
+        imports << import
+        import_sources << source_index
+      end
+      charset ||= result[:charset]
+      has_nesting ||= result[:_has_nesting]
+      rule_offset += result[:last_rule_id]
+    end
+
+    {
+      rules: rules,
+      _media_index: media_index,
+      media_queries: media_queries,
+      _selector_lists: selector_lists,
+      _media_query_lists: media_query_lists,
+      imports: imports,
+      charset: charset,
+      last_rule_id: rule_offset,
+      _has_nesting: has_nesting,
+      _import_sources: import_sources
+    }
+  end
+
   # NOTE: Copied from cataract.rb
   # Need to untangle this eventually
   def self.parse_css(css, **options)
@@ -109,9 +217,10 @@ module Cataract
   # Flatten stylesheet rules according to CSS cascade rules
   #
   # @param stylesheet [Stylesheet] Stylesheet to flatten
+  # @param selectors [String, Array<String>, Regexp, nil] Only flatten rules with matching selectors
   # @return [Stylesheet] New stylesheet with flattened rules
-  def self.flatten(stylesheet)
-    Flatten.flatten(stylesheet, mutate: false)
+  def self.flatten(stylesheet, selectors = nil)
+    Flatten.flatten(stylesheet, mutate: false, selectors: selectors)
   end
 
   # Flatten stylesheet rules in-place (mutates receiver)
@@ -122,10 +231,116 @@ module Cataract
     Flatten.flatten(stylesheet, mutate: true)
   end
 
+  # Remove overridden declarations in-place without merging rules
+  #
+  # @param stylesheet [Stylesheet] Stylesheet to compact (mutated)
+  # @return [Integer] Number of declarations removed
+  def self.eliminate_dead_declarations(stylesheet)
+    Flatten.eliminate_dead_declarations(stylesheet)
+  end
+
+  # Fold calc()/min()/max()/clamp() expressions in a single CSS value
+  #
+  # @param value [String] CSS declaration value
+  # @return [String] Folded value (the same object if nothing changed)
+  def self.fold_calc(value)
+    raise TypeError, "wrong argument type #{value.class} (expected String)" unless value.is_a?(String)
+
+    CalcFolder.fold_value(value)
+  end
+
+  # Fold calc() expressions in every declaration in-place
+  #
+  # @param rules [Array<Rule, AtRule>] Rules to rewrite
+  # @return [Integer] Number of declarations changed
+  def self.fold_calc_values(rules)
+    CalcFolder.fold_rules(rules)
+  end
+
+  # Replace literal substrings in every declaration value in-place
+  #
+  # @param rules [Array<Rule, AtRule>] Rules to rewrite
+  # @param patterns [Array<String>] Non-empty literal patterns
+  # @param replacements [Array<String>] Replacement for each pattern
+  # @param prefix [Boolean] Only match at the start of a value
+  # @param properties [Array<String>, nil] Limit to these property names (nil = all)
+  # @return [Integer] Number of declarations changed
+  def self.rewrite_values(rules, patterns, replacements, prefix, properties)
+    raise TypeError, "wrong argument type #{rules.class} (expected Array)" unless rules.is_a?(Array)
+    raise TypeError, "wrong argument type #{patterns.class} (expected Array)" unless patterns.is_a?(Array)
+    raise TypeError, "wrong argument type #{replacements.class} (expected Array)" unless replacements.is_a?(Array)
+    raise ArgumentError, 'patterns and replacements must have the same length' if patterns.length != replacements.length
+
+    (patterns + replacements + Array(properties)).each do |str|
+      raise TypeError, "wrong argument type #{str.class} (expected String)" unless str.is_a?(String)
+    end
+    raise ArgumentError, 'pattern must not be empty' if patterns.any?(&:empty?)
+    return 0 if patterns.empty?
+
+    ValueRewriter.rewrite_rules(rules, patterns, replacements, prefix, properties)
+  end
+
+  # Collect url() references from declaration values and @import statements
+  #
+  # @param rules [Array<Rule, AtRule>] Rules to scan
+  # @param imports [Array<ImportStatement>, nil] @import statements (listed first)
+  # @return [Array<UrlReference>] References in source order
+  def self.extract_urls(rules, imports)
+    raise TypeError, "wrong argument type #{rules.class} (expected Array)" unless rules.is_a?(Array)
+    raise TypeError, "wrong argument type #{imports.class} (expected Array)" unless imports.nil? || imports.is_a?(Array)
+
+    UrlRewriter.extract(rules, imports)
+  end
+
+  # Replace url() references and @import URLs in-place via Hash lookup
+  #
+  # @param rules [Array<Rule, AtRule>] Rules to rewrite
+  # @param imports [Array<ImportStatement>, nil] @import statements to rewrite
+  # @param mapping [Hash{String => String}] URL as written => replacement
+  # @return [Integer] Number of URLs replaced
+  def self.map_urls(rules, imports, mapping)
+    raise TypeError, "wrong argument type #{rules.class} (expected Array)" unless rules.is_a?(Array)
+    raise TypeError, "wrong argument type #{imports.class} (expected Array)" unless imports.nil? || imports.is_a?(Array)
+    raise TypeError, "wrong argument type #{mapping.class} (expected Hash)" unless mapping.is_a?(Hash)
+
+    UrlRewriter.map(rules, imports, mapping)
+  end
+
+  # Remove vendor-prefixed forms the targets don't need, in place
+  #
+  # @api private
+  # @param rules [Array<Rule, AtRule>] Rules to prune
+  # @param properties [Hash] Property actions (see PrefixTable#actions)
+  # @param values [Hash] Value keyword actions
+  # @param selectors [Hash] Pseudo selector actions
+  # @param at_rules [Hash] At-rule name actions
+  # @param prefixes [Hash{String => Boolean}] Fallback per vendor prefix
+  # @return [Array<Integer>] Indexes of rules to remove
+  def self.prune_prefixes(rules, properties, values, selectors, at_rules, prefixes)
+    raise TypeError, "wrong argument type #{rules.class} (expected Array)" unless rules.is_a?(Array)
+
+    [properties, values, selectors, at_rules, prefixes].each do |table|
+      raise TypeError, "wrong argument type #{table.class} (expected Hash)" unless table.is_a?(Hash)
+    end
+
+    PrefixPruner.prune(rules, properties, values, selectors, at_rules, prefixes)
+  end
+
+  # Family a property cascades with ("margin" for margin-top)
+  #
+  # @api private
+  # @param property [String] Property name
+  # @return [String]
+  def self._property_family(property)
+    raise TypeError, "wrong argument type #{property.class} (expected String)" unless property.is_a?(String)
+
+    MediaConsolidation.property_family(property)
+  end
+
   # Deprecated: Use flatten instead
-  def self.merge(stylesheet)
+  def self.merge(stylesheet, selectors = nil)
     warn 'Cataract.merge is deprecated, use Cataract.flatten instead', uplevel: 1
-    flatten(stylesheet)
+    flatten(stylesheet, selectors)
   end
 
   # Deprecated: Use flatten! instead
@@ -58,6 +58,8 @@ module Cataract
   BYTE_LOWER_D    = 100 # 'd'
   BYTE_LOWER_T    = 116 # 't'
   BYTE_LOWER_N    = 110 # 'n'
+  BYTE_LOWER_I    = 105 # 'i'
+  BYTE_LOWER_F    = 102 # 'f'
 
   # Specific uppercase letters (for case-insensitive matching)
   BYTE_UPPER_U    = 85  # 'U'
@@ -66,6 +68,8 @@ module Cataract
   BYTE_UPPER_D    = 68  # 'D'
   BYTE_UPPER_T    = 84  # 'T'
   BYTE_UPPER_N    = 78  # 'N'
+  BYTE_UPPER_I    = 73  # 'I'
+  BYTE_UPPER_F    = 70  # 'F'
 
   # Letter ranges (a-z, A-Z)
   BYTE_LOWER_A   = 97  # 'a'
@@ -0,0 +1,581 @@
+# frozen_string_literal: true
+
+# Pure Ruby calc() folding - mirrors ext/cataract/calc_folder.c
+# NO REGEXP ALLOWED - byte-by-byte parsing only
+#
+# @api private
+# Computes calc(), min(), max() and clamp() expressions whose result is known
+# at build time. See the C file for the full description.
+
+module Cataract
+  module CalcFolder
+    MAX_TERMS = 16
+    MAX_ARGS = 8
+    MAX_DEPTH = 16
+    UNIT_MAX = 7
+
+    # A sum term: numeric (value + unit) or opaque (coefficient * source text)
+    Term = Struct.new(:opaque, :value, :unit, :text)
+
+    # Raised internally when an expression can't be folded
+    class Unfoldable < StandardError; end
+
+    # unit => [family, factor to the family's first entry], used to compare
+    # min()/max()/clamp() arguments
+    UNITS = {
+      # Absolute lengths (canonical: px)
+      'px' => [1, 1.0],
+      'in' => [1, 96.0],
+      'cm' => [1, 96.0 / 2.54],
+      'mm' => [1, 96.0 / 25.4],
+      'q' => [1, 96.0 / 101.6],
+      'pt' => [1, 96.0 / 72.0],
+      'pc' => [1, 16.0],
+      # Angles (canonical: deg)
+      'deg' => [2, 1.0],
+      'grad' => [2, 0.9],
+      'rad' => [2, 180.0 / 3.14159265358979323846],
+      'turn' => [2, 360.0],
+      # Time (canonical: s)
+      's' => [3, 1.0],
+      'ms' => [3, 0.001],
+      # Frequency (canonical: hz)
+      'hz' => [4, 1.0],
+      'khz' => [4, 1000.0],
+      # Resolution (canonical: dppx)
+      'dppx' => [5, 1.0],
+      'x' => [5, 1.0],
+      'dpi' => [5, 1.0 / 96.0],
+      'dpcm' => [5, 2.54 / 96.0]
+    }.freeze
+
+    MATH_FUNCTIONS = %w[calc min max clamp].freeze
+
+    # Fold every calc()/min()/max()/clamp() in a CSS value.
+    #
+    # @param value [String] CSS declaration value
+    # @return [String] Folded value (the same object if nothing changed)
+    def self.fold_value(value)
+      # Fast path: no functions at all
+      return value unless value.include?('(')
+
+      len = value.bytesize
+      pos = 0
+      copied = 0
+      result = nil
+
+      while pos < len
+        byte = value.getbyte(pos)
+
+        if byte == BYTE_DQUOTE || byte == BYTE_SQUOTE
+          pos += 1
+          while pos < len && value.getbyte(pos) != byte
+            pos += 1 if value.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < len
+            pos += 1
+          end
+          pos += 1 if pos < len
+          next
+        end
+
+        if !ident_start?(byte) || (pos > 0 && ident_char?(value.getbyte(pos - 1)))
+          pos += 1
+          next
+        end
+
+        name_start = pos
+        pos += 1 while pos < len && ident_char?(value.getbyte(pos))
+        next if pos >= len || value.getbyte(pos) != BYTE_LPAREN
+
+        name = value.byteslice(name_start, pos - name_start).downcase
+
+        # url() contents are opaque
+        if name == 'url'
+          close = skip_parens(value, pos, len)
+          break unless close
+
+          pos = close
+          next
+        end
+
+        next unless MATH_FUNCTIONS.include?(name)
+
+        parser = Parser.new(value, name_start, len)
+        begin
+          folded = parser.parse_value
+        rescue Unfoldable
+          next
+        end
+
+        stop = parser.pos
+        replacement = +''
+        begin
+          finalize(folded, name == 'calc', replacement)
+          if replacement.bytesize < stop - name_start
+            result ||= String.new(capacity: len, encoding: value.encoding)
+            result << value.byteslice(copied, name_start - copied) << replacement
+            copied = stop
+          end
+        rescue Unfoldable
+          # Keep original text
+        end
+        pos = stop
+      end
+
+      return value unless result
+
+      result << value.byteslice(copied, len - copied)
+    end
+
+    # Fold declaration values in every rule (in place)
+    #
+    # @param rules [Array<Rule, AtRule>] Rules to rewrite
+    # @return [Integer] Number of declarations changed
+    def self.fold_rules(rules)
+      changed = 0
+      rules.each do |rule|
+        if rule.at_rule?
+          content = rule.content
+          next unless content.is_a?(Array)
+
+          changed += fold_declarations(content)
+          content.each do |block|
+            changed += fold_declarations(block.declarations) if block.is_a?(Rule)
+          end
+        else
+          changed += fold_declarations(rule.declarations)
+        end
+      end
+      changed
+    end
+
+    def self.fold_declarations(declarations)
+      changed = 0
+      return changed unless declarations
+
+      declarations.each do |decl|
+        next unless decl.is_a?(Declaration) && decl.value.is_a?(String)
+
+        folded = fold_value(decl.value)
+        unless folded.equal?(decl.value)
+          decl.value = folded
+          changed += 1
+        end
+      end
+      changed
+    end
+
+    def self.ident_char?(byte)
+      (byte >= 97 && byte <= 122) || (byte >= 65 && byte <= 90) || (byte >= 48 && byte <= 57) ||
+        byte == BYTE_HYPHEN || byte == 95 || byte >= 0x80
+    end
+
+    def self.ident_start?(byte)
+      (byte >= 97 && byte <= 122) || (byte >= 65 && byte <= 90) || byte == BYTE_HYPHEN || byte == 95 || byte >= 0x80
+    end
+
+    def self.whitespace?(byte)
+      byte == BYTE_SPACE || byte == BYTE_TAB || byte == BYTE_NEWLINE || byte == BYTE_CR
+    end
+
+    # Position just past the ')' matching the '(' at pos, skipping strings; nil if unbalanced
+    def self.skip_parens(str, pos, len)
+      depth = 0
+      while pos < len
+        byte = str.getbyte(pos)
+        if byte == BYTE_DQUOTE || byte == BYTE_SQUOTE
+          pos += 1
+          while pos < len && str.getbyte(pos) != byte
+            pos += 1 if str.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < len
+            pos += 1
+          end
+          return nil if pos >= len
+        elsif byte == BYTE_LPAREN
+          depth += 1
+        elsif byte == BYTE_RPAREN
+          depth -= 1
+          return pos + 1 if depth.zero?
+        end
+        pos += 1
+      end
+      nil
+    end
+
+    def self.convert(value, from, to)
+      return value if from == to
+
+      a = UNITS[from]
+      b = UNITS[to]
+      return nil if a.nil? || b.nil? || a[0] != b[0]
+
+      value * a[1] / b[1]
+    end
+
+    def self.scalar?(sum)
+      sum.length == 1 && !sum[0].opaque
+    end
+
+    def self.number?(sum)
+      scalar?(sum) && sum[0].unit.empty?
+    end
+
+    def self.opaque(text)
+      [Term.new(true, 1.0, '', text)]
+    end
+
+    # acc += sign * rhs, merging numeric terms with the same unit
+    def self.add(acc, rhs, sign)
+      rhs.each do |t|
+        merged = false
+
+        unless t.opaque
+          acc.each do |existing|
+            next if existing.opaque
+
+            next unless existing.unit == t.unit
+
+            existing.value += sign * t.value
+            merged = true
+            break
+          end
+        end
+
+        next if merged
+        raise Unfoldable if acc.length >= MAX_TERMS
+
+        acc << Term.new(t.opaque, sign * t.value, t.unit, t.text)
+      end
+    end
+
+    # Drop zero numeric terms (100% - 0px => 100%), keeping one term if all are zero
+    def self.compact(sum)
+      kept = sum.reject { |t| !t.opaque && t.value == 0.0 }
+      if !kept.empty?
+        sum.replace(kept)
+      elsif sum.length > 1
+        sum.replace([sum[0]])
+      end
+      sum
+    end
+
+    # Format a non-negative magnitude with up to 5 decimals
+    def self.format_number(value)
+      raise Unfoldable if value.nan? || value.infinite?
+
+      str = format('%.5f', value)
+      if str.include?('.')
+        str = str[0, str.length - 1] while str.end_with?('0')
+        str = str[0, str.length - 1] if str.end_with?('.')
+      end
+      raise Unfoldable if str == '0' && value != 0.0
+
+      str
+    end
+
+    # Append "<magnitude><unit>" or "<coefficient> * <text>" for one term
+    def self.append_term(out, term, force_coefficient)
+      magnitude = term.value.abs
+
+      if term.opaque
+        out << format_number(magnitude) << ' * ' if magnitude != 1.0 || force_coefficient
+        out << term.text
+        return
+      end
+
+      # Zero is fine; it just has no distinguishable digits to lose
+      out << (magnitude == 0.0 ? '0' : format_number(magnitude)) << term.unit
+    end
+
+    # Serialize a sum without a calc() wrapper
+    def self.serialize_sum(sum, out)
+      sum.each_with_index do |term, i|
+        negative = term.value < 0.0
+        if i.zero?
+          out << '-' if negative
+          # "-var(--x)" would be an identifier, so spell out the coefficient
+          append_term(out, term, negative && term.opaque)
+        else
+          out << (negative ? ' - ' : ' + ')
+          append_term(out, term, false)
+        end
+      end
+      out
+    end
+
+    # Final text for a top-level math function. A single numeric term is emitted
+    # bare unless it is a unitless non-integer (integer-only properties like
+    # z-index accept calc(1.5) but reject 1.5) or negative (calc() clamps to the
+    # property's range, a bare -5px is invalid where negatives aren't allowed).
+    def self.finalize(sum, keep_wrapper_for_opaque, out)
+      compact(sum)
+      if scalar?(sum)
+        term = sum[0]
+        integral = term.value.finite? && term.value == term.value.floor
+        return serialize_sum(sum, out) if term.value >= 0.0 && (!term.unit.empty? || integral)
+      elsif sum.length == 1 && sum[0].value == 1.0 && !keep_wrapper_for_opaque
+        return out << sum[0].text
+      end
+
+      out << 'calc('
+      serialize_sum(sum, out)
+      out << ')'
+    end
+
+    # Recursive descent parser over a byte range of the value
+    class Parser
+      attr_reader :pos
+
+      def initialize(str, pos, len)
+        @str = str
+        @pos = pos
+        @len = len
+        @depth = 0
+      end
+
+      def skip_ws
+        @pos += 1 while @pos < @len && CalcFolder.whitespace?(@str.getbyte(@pos))
+      end
+
+      def parse_sum
+        out = parse_product
+
+        loop do
+          before_ws = @pos
+          skip_ws
+          byte = @pos + 1 < @len ? @str.getbyte(@pos) : nil
+          # + and - must be surrounded by whitespace
+          if @pos == before_ws || byte.nil? || (byte != BYTE_PLUS && byte != BYTE_HYPHEN) ||
+             !CalcFolder.whitespace?(@str.getbyte(@pos + 1))
+            @pos = before_ws
+            return out
+          end
+          sign = byte == BYTE_HYPHEN ? -1.0 : 1.0
+          @pos += 1
+
+          rhs = parse_product
+          CalcFolder.add(out, rhs, sign)
+        end
+      end
+
+      def parse_product
+        @depth += 1
+        raise Unfoldable if @depth > MAX_DEPTH
+
+        skip_ws
+        start = @pos
+        unfoldable = false
+        out = parse_value
+
+        loop do
+          before_ws = @pos
+          skip_ws
+          byte = @pos < @len ? @str.getbyte(@pos) : nil
+          if byte != BYTE_ASTERISK && byte != BYTE_SLASH
+            @pos = before_ws
+            break
+          end
+          @pos += 1
+
+          rhs = parse_value
+          next if unfoldable
+
+          if byte == BYTE_ASTERISK
+            if CalcFolder.number?(out)
+              k = out[0].value
+              out = rhs
+              out.each { |t| t.value *= k }
+            elsif CalcFolder.number?(rhs)
+              k = rhs[0].value
+              out.each { |t| t.value *= k }
+            else
+              unfoldable = true
+            end
+          elsif CalcFolder.number?(rhs) && rhs[0].value != 0.0
+            k = rhs[0].value
+            out.each { |t| t.value /= k }
+          else
+            unfoldable = true
+          end
+        end
+
+        # Keep products we can't compute as written
+        out = CalcFolder.opaque(@str.byteslice(start, @pos - start)) if unfoldable
+
+        @depth -= 1
+        out
+      end
+
+      def parse_value
+        skip_ws
+        raise Unfoldable if @pos >= @len
+
+        byte = @str.getbyte(@pos)
+
+        if byte == BYTE_LPAREN
+          @pos += 1
+          out = parse_sum
+          expect_close
+          return out
+        end
+
+        if digit?(byte) || byte == BYTE_DOT ||
+           ((byte == BYTE_PLUS || byte == BYTE_HYPHEN) && @pos + 1 < @len &&
+            (digit?(@str.getbyte(@pos + 1)) || @str.getbyte(@pos + 1) == BYTE_DOT))
+          return parse_number
+        end
+
+        raise Unfoldable unless CalcFolder.ident_start?(byte)
+
+        start = @pos
+        @pos += 1 while @pos < @len && CalcFolder.ident_char?(@str.getbyte(@pos))
+
+        if @pos < @len && @str.getbyte(@pos) == BYTE_LPAREN
+          name = @str.byteslice(start, @pos - start).downcase
+          if name == 'calc'
+            @pos += 1
+            out = parse_sum
+            expect_close
+            return out
+          end
+          if name == 'min' || name == 'max' || name == 'clamp'
+            @pos += 1
+            return parse_math_function(@str.byteslice(start, @pos - 1 - start), name)
+          end
+
+          # var(), env() and anything else we don't compute: keep verbatim
+          close = CalcFolder.skip_parens(@str, @pos, @len)
+          raise Unfoldable unless close
+
+          @pos = close
+        end
+
+        CalcFolder.opaque(@str.byteslice(start, @pos - start))
+      end
+
+      private
+
+      def digit?(byte)
+        byte >= 48 && byte <= 57
+      end
+
+      def expect_close
+        skip_ws
+        raise Unfoldable if @pos >= @len || @str.getbyte(@pos) != BYTE_RPAREN
+
+        @pos += 1
+      end
+
+      def parse_number
+        start = @pos
+        digits = 0
+        byte = @str.getbyte(@pos)
+        @pos += 1 if byte == BYTE_PLUS || byte == BYTE_HYPHEN
+        while @pos < @len && digit?(@str.getbyte(@pos))
+          @pos += 1
+          digits += 1
+        end
+        if @pos < @len && @str.getbyte(@pos) == BYTE_DOT
+          @pos += 1
+          while @pos < @len && digit?(@str.getbyte(@pos))
+            @pos += 1
+            digits += 1
+          end
+        end
+        raise Unfoldable if digits.zero?
+
+        # Exponent only if followed by a digit (so "1em" stays a unit)
+        if @pos < @len && (@str.getbyte(@pos) == 101 || @str.getbyte(@pos) == 69)
+          q = @pos + 1
+          q += 1 if q < @len && (@str.getbyte(q) == BYTE_PLUS || @str.getbyte(q) == BYTE_HYPHEN)
+          if q < @len && digit?(@str.getbyte(q))
+            @pos = q
+            @pos += 1 while @pos < @len && digit?(@str.getbyte(@pos))
+          end
+        end
+
+        raise Unfoldable if @pos - start >= 64
+
+        value = @str.byteslice(start, @pos - start).to_f
+
+        if @pos < @len && @str.getbyte(@pos) == BYTE_PERCENT
+          @pos += 1
+          return [Term.new(false, value, '%', nil)]
+        end
+
+        unit_start = @pos
+        while @pos < @len
+          byte = @str.getbyte(@pos)
+          break unless (byte >= 97 && byte <= 122) || (byte >= 65 && byte <= 90)
+
+          @pos += 1
+        end
+        raise Unfoldable if @pos - unit_start > UNIT_MAX
+
+        [Term.new(false, value, @str.byteslice(unit_start, @pos - unit_start).downcase, nil)]
+      end
+
+      # Parse comma-separated math function arguments up to and including ')'
+      def parse_args
+        args = []
+        loop do
+          raise Unfoldable if args.length >= MAX_ARGS
+
+          args << parse_sum
+          skip_ws
+          raise Unfoldable if @pos >= @len
+
+          byte = @str.getbyte(@pos)
+          @pos += 1
+          next if byte == BYTE_COMMA
+          return args if byte == BYTE_RPAREN
+
+          raise Unfoldable
+        end
+      end
+
+      # min()/max()/clamp(): fold to the winning argument when all are comparable,
+      # otherwise rebuild the function from the (folded) arguments as opaque text
+      def parse_math_function(name, lower_name)
+        args = parse_args
+        is_min = lower_name == 'min'
+        is_max = lower_name == 'max'
+        raise Unfoldable if !is_min && !is_max && args.length != 3
+
+        if comparable?(args)
+          unit = args[0][0].unit
+          if is_min || is_max
+            winner = 0
+            (1...args.length).each do |i|
+              candidate = canonical(args[i], unit)
+              best = canonical(args[winner], unit)
+              winner = i if is_min ? candidate < best : candidate > best
+            end
+          else
+            # clamp(MIN, VAL, MAX) = max(MIN, min(VAL, MAX))
+            inner = canonical(args[2], unit) < canonical(args[1], unit) ? 2 : 1
+            winner = canonical(args[inner], unit) > canonical(args[0], unit) ? inner : 0
+          end
+          return args[winner]
+        end
+
+        text = "#{name}("
+        args.each_with_index do |arg, i|
+          text << ', ' if i > 0
+          CalcFolder.compact(arg)
+          CalcFolder.serialize_sum(arg, text)
+        end
+        text << ')'
+        CalcFolder.opaque(text)
+      end
+
+      def comparable?(args)
+        args.all? do |arg|
+          CalcFolder.scalar?(arg) && !CalcFolder.convert(1.0, arg[0].unit, args[0][0].unit).nil?
+        end
+      end
+
+      def canonical(arg, unit)
+        CalcFolder.convert(arg[0].value, arg[0].unit, unit)
+      end
+    end
+  end
+end
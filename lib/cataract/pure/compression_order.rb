@@ -0,0 +1,219 @@
+# frozen_string_literal: true
+
+# Pure Ruby compression-friendly ordering - mirrors ext/cataract/compression_order.c
+# NO REGEXP ALLOWED - string manipulation only
+#
+# @api private
+# Sorts declarations by property family and clusters rules with identical
+# declarations, when doing so cannot change the cascade. See the C file for the
+# full rationale.
+
+module Cataract
+  module CompressionOrder
+    # Rules with their declarations in canonical order
+    #
+    # @param rules [Array<Rule, AtRule>] Rules in source order
+    # @param rule_ids [Array<Integer>, nil] Subset of rule indices to sort, or nil for all rules
+    # @return [Array<Rule, AtRule>] rules, or a copy with sorted rule copies swapped in
+    def self.sorted_rules(rules, rule_ids)
+      rule_ids ||= (0...rules.length)
+
+      # Canonical order: families in the order the sheet first uses them
+      ranks = {}
+      rule_ids.each do |i|
+        rule = rules[i]
+        next if rule.at_rule?
+
+        rule.declarations.each do |decl|
+          key = family_key(decl.property)
+          ranks[key] = ranks.size unless ranks.key?(key)
+        end
+      end
+
+      result = rules
+      rule_ids.each do |i|
+        rule = rules[i]
+        next if rule.at_rule?
+
+        sorted = sorted_declarations(rule.declarations, ranks)
+        next unless sorted
+
+        result = rules.dup if result.equal?(rules)
+        copy = rule.dup
+        copy.declarations = sorted
+        result[i] = copy
+      end
+      result
+    end
+
+    # Declarations in canonical order, or nil if they are already in it
+    def self.sorted_declarations(declarations, ranks)
+      return nil if declarations.length < 2
+
+      entries = []
+      sorted = true
+      declarations.each_with_index do |decl, index|
+        # "all" resets every property - its position matters to everything
+        return nil if decl.property == 'all'
+
+        entry = [ranks[family_key(decl.property)], index]
+        sorted = false if sorted && !entries.empty? && entries[-1][0] > entry[0]
+        entries << entry
+      end
+      return nil if sorted
+
+      entries.sort!.map { |_rank, index| declarations[index] }
+    end
+
+    # Hash key for a property's family
+    def self.family_key(property)
+      MediaConsolidation.fnv1a(MediaConsolidation.property_family(property), MediaConsolidation::FNV_OFFSET) >> 2
+    end
+
+    # Compute an emit order that clusters rules with identical declarations
+    #
+    # @param rules [Array<Rule, AtRule>] Rules, declarations already sorted
+    # @param rule_ids [Array<Integer>, nil] Rule indices in emit order, or nil for all rules
+    # @param selector_lists [Hash, nil] list_id => Array of rule ids
+    # @return [Array<Integer>, nil] Rule indices in emit order, or nil if nothing moved
+    def self.rule_order(rules, rule_ids, selector_lists)
+      rule_ids ||= (0...rules.length).to_a
+      return nil if rule_ids.length < 3
+
+      grouping_enabled = selector_lists && !selector_lists.empty?
+
+      # Units of rule_ids positions that move together: [start, length, run]
+      # where run numbers the run a unit belongs to, nil for a barrier
+      units = []
+      num_runs = 0
+      max_run = 0
+      run_len = 0
+      run_media = :none
+      pos = 0
+      while pos < rule_ids.length
+        rule = rules[rule_ids[pos]]
+        len = 1
+        movable = !rule.at_rule?
+
+        if movable
+          list_id = grouping_enabled ? rule.selector_list_id : nil
+          if list_id
+            while pos + len < rule_ids.length
+              following = rules[rule_ids[pos + len]]
+              break if following.at_rule? || following.selector_list_id != list_id ||
+                       following.media_query_id != rule.media_query_id
+
+              len += 1
+            end
+            members = selector_lists[list_id]
+            movable = false if members.nil? || members.length != len
+          end
+        end
+
+        if movable
+          if run_media == :none || run_media != rule.media_query_id
+            num_runs += 1
+            run_len = 0
+            run_media = rule.media_query_id
+          end
+          run_len += 1
+          max_run = run_len if run_len > max_run
+          units << [pos, len, num_runs - 1]
+        else
+          run_media = :none
+          units << [pos, len, nil]
+        end
+        pos += len
+      end
+
+      return nil if max_run < 3
+
+      order = []
+      moved = false
+      u = 0
+      while u < units.length
+        start, len, run = units[u]
+        unless run
+          order.concat(rule_ids[start, len])
+          u += 1
+          next
+        end
+
+        run_end = u
+        run_end += 1 while run_end < units.length && units[run_end][2] == run
+
+        cap = 1
+        cap <<= 1 while cap < run_end - u
+        tree = Array.new(2 * cap, 0)
+        segments = []
+        key_to_segment = {}
+
+        units[u...run_end].each do |unit_start, unit_len, _run|
+          key = cluster_key(rules[rule_ids[unit_start]]) >> 2
+          bits = 0
+          rule_ids[unit_start, unit_len].each { |i| bits |= MediaConsolidation.rule_bitset(rules[i]) }
+
+          seg = key_to_segment[key]
+          # Join the cluster only if no rule emitted after it can conflict
+          if seg && !range_intersects?(tree, cap, seg + 1, segments.length, bits)
+            moved = true if seg != segments.length - 1
+            segments[seg] << [unit_start, unit_len]
+          else
+            seg = segments.length
+            segments << [[unit_start, unit_len]]
+            key_to_segment[key] = seg
+          end
+          tree_add(tree, cap, seg, bits)
+        end
+
+        segments.each do |segment|
+          segment.each { |unit_start, unit_len| order.concat(rule_ids[unit_start, unit_len]) }
+        end
+        u = run_end
+      end
+
+      moved ? order : nil
+    end
+
+    # Cluster key: hash of the rule's declarations as printed
+    def self.cluster_key(rule)
+      h = MediaConsolidation::FNV_OFFSET
+      rule.declarations.each do |decl|
+        h = MediaConsolidation.fnv1a(decl.property, h)
+        h = MediaConsolidation.fnv1a(':', h)
+        h = MediaConsolidation.fnv1a(decl.value, h)
+        h = MediaConsolidation.fnv1a(decl.important ? "!\n" : "\n", h)
+      end
+      h
+    end
+
+    # Segment tree over segment positions: node i holds the union of its children
+    def self.tree_add(tree, cap, pos, bits)
+      pos += cap
+      while pos >= 1
+        tree[pos] |= bits
+        pos >>= 1
+      end
+    end
+
+    # Does any segment in [from, to) share a cascade key with bits?
+    def self.range_intersects?(tree, cap, from, to, bits)
+      from += cap
+      to += cap
+      while from < to
+        if from.odd?
+          return true unless (tree[from] & bits).zero?
+
+          from += 1
+        end
+        if to.odd?
+          to -= 1
+          return true unless (tree[to] & bits).zero?
+        end
+        from >>= 1
+        to >>= 1
+      end
+      false
+    end
+  end
+end
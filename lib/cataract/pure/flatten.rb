@@ -161,16 +161,20 @@ module Cataract
     #
     # @param stylesheet [Stylesheet] Stylesheet to merge
     # @param mutate [Boolean] If true, mutate the stylesheet; otherwise create new one
+    # @param selectors [String, Array<String>, Regexp, nil] Only flatten rules whose selector
+    #   matches (AtRules are dropped); nil flattens everything
     # @return [Stylesheet] Merged stylesheet
-    def self.flatten(stylesheet, mutate: false)
+    def self.flatten(stylesheet, mutate: false, selectors: nil)
+      selector_filter = build_selector_filter(selectors)
+
       # Separate AtRules (pass-through) from regular Rules (to merge)
       at_rules = []
       regular_rules = []
 
       stylesheet.rules.each do |rule|
         if rule.at_rule?
-          at_rules << rule
-        else
+          at_rules << rule unless selector_filter
+        elsif selector_filter.nil? || selector_matches_filter?(rule.selector, selector_filter)
           regular_rules << rule
         end
       end
@@ -304,6 +308,112 @@ module Cataract
       end
     end
 
+    # Normalize the selectors argument for selective flatten
+    #
+    # @param selectors [String, Array<String>, Regexp, nil]
+    # @return [Hash, Regexp, nil] Hash used as a set of selectors, a Regexp, or nil (no filter)
+    def self.build_selector_filter(selectors)
+      case selectors
+      when nil, Regexp
+        selectors
+      when String
+        { selectors => true }
+      when Array
+        filter = {}
+        selectors.each do |selector|
+          raise TypeError, "wrong argument type #{selector.class} (expected String)" unless selector.is_a?(String)
+
+          filter[selector] = true
+        end
+        filter
+      else
+        raise TypeError, "selectors must be a String, Array, or Regexp, got #{selectors.class}"
+      end
+    end
+
+    # @param selector [String] Rule selector
+    # @param filter [Hash, Regexp] Filter from build_selector_filter
+    # @return [Boolean] true if the selector passes the filter
+    def self.selector_matches_filter?(selector, filter)
+      filter.is_a?(Hash) ? filter.key?(selector) : filter.match?(selector)
+    end
+
+    # Remove declarations that can never win the cascade, without merging rules
+    #
+    # Groups rules by (selector, media_query_id) like flatten, then keeps only the
+    # winning declaration per property in each group: the last !important one if
+    # any, otherwise the last one. When the new winner or the one it replaces
+    # needs a fallback (see value_needs_fallback?) the replaced declarations
+    # stay. Rule count and order are preserved.
+    #
+    # @param stylesheet [Stylesheet] Stylesheet to compact (mutated)
+    # @return [Integer] Number of declarations removed
+    def self.eliminate_dead_declarations(stylesheet)
+      rules = stylesheet.instance_variable_get(:@rules)
+
+      # Pass 1: live Declaration objects per property, per group (winner last)
+      groups = {}
+      rule_winners = Array.new(rules.length)
+      rules.each_with_index do |rule, i|
+        next if rule.at_rule?
+        next if rule.declarations.empty?
+
+        winners = (groups[[rule.selector, rule.media_query_id]] ||= {})
+        rule_winners[i] = winners
+
+        rule.declarations.each do |decl|
+          live = winners[decl.property]
+          # Later declaration wins unless it would demote an !important one
+          if live.nil? || decl.important || !live.last.important
+            if live.nil? || (!value_needs_fallback?(decl.value) && !value_needs_fallback?(live.last.value))
+              live = winners[decl.property] = []
+            end
+            live << decl
+          end
+        end
+      end
+
+      # Pass 2: compact declarations in place, keeping only live ones
+      removed = 0
+      rules.each_with_index do |rule, i|
+        winners = rule_winners[i]
+        next unless winners
+
+        before = rule.declarations.length
+        rule.declarations.select! { |decl| winners[decl.property].any? { |live| live.equal?(decl) } }
+        removed += before - rule.declarations.length
+      end
+
+      removed
+    end
+
+    # True when a value may be rejected by some browsers, so a declaration of
+    # the same property next to it is still needed as the fallback: it holds a
+    # vendor-prefixed keyword ("-webkit-box") or a function ("linear-gradient(").
+    #
+    # @param value [String] Declaration value
+    # @return [Boolean]
+    def self.value_needs_fallback?(value)
+      len = value.bytesize
+      i = 0
+      while i < len
+        byte = value.getbyte(i)
+        return true if byte == BYTE_LPAREN
+
+        if byte == BYTE_HYPHEN && i + 1 < len && Cataract.letter?(value.getbyte(i + 1)) &&
+           (i == 0 || !Cataract.ident_char?(value.getbyte(i - 1)))
+          j = i + 1
+          j += 1 while j < len && Cataract.ident_char?(value.getbyte(j)) && value.getbyte(j) != BYTE_HYPHEN
+          return true if j < len && value.getbyte(j) == BYTE_HYPHEN
+
+          i = j
+          next
+        end
+        i += 1
+      end
+      false
+    end
+
     # Merge multiple rules with same selector
     #
     # @param selector [String] The selector
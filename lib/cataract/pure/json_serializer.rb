@@ -0,0 +1,206 @@
+# frozen_string_literal: true
+
+# Pure Ruby JSON export - mirrors ext/cataract/json_serializer.c
+# NO REGEXP ALLOWED - byte-by-byte escaping only
+#
+# @api private
+# Writes a stylesheet's parsed structure directly into a JSON string. Called by
+# Stylesheet#to_json; see the C file for the output shape.
+
+module Cataract
+  JSON_HEX_DIGITS = '0123456789abcdef'
+
+  # Short escapes for control bytes; all other bytes < 0x20 use \u00XX
+  JSON_SHORT_ESCAPES = {
+    8 => '\b',
+    9 => '\t',
+    10 => '\n',
+    12 => '\f',
+    13 => '\r'
+  }.freeze
+
+  # Serialize a stylesheet's parsed structure to a JSON string
+  #
+  # @param rules [Array<Rule, AtRule>] Rules
+  # @param charset [String, nil] @charset value
+  # @param media_queries [Array<MediaQuery>] MediaQuery objects
+  # @param media_query_lists [Hash] list_id => Array of MediaQuery ids
+  # @param selector_lists [Hash] list_id => Array of rule ids
+  # @param imports [Array<ImportStatement>] Import statements
+  # @param options [Hash, nil] :specificity => include each rule's specificity
+  # @return [String] UTF-8 JSON string
+  def self.stylesheet_to_json(rules, charset, media_queries, media_query_lists, selector_lists, imports, options = nil)
+    include_specificity = options ? options[:specificity] : false
+    buf = String.new(capacity: (rules.length * 192) + 128, encoding: Encoding::UTF_8)
+
+    buf << '{"charset":'
+    _json_value(buf, charset)
+
+    buf << ',"rules":['
+    rules.each_with_index do |rule, i|
+      buf << ',' if i > 0
+      _json_rule(buf, rule, include_specificity)
+    end
+
+    buf << '],"media_queries":['
+    (media_queries || []).each_with_index do |mq, i|
+      buf << ',' if i > 0
+      buf << '{"id":'
+      _json_value(buf, mq.id)
+      buf << ',"type":'
+      _json_value(buf, mq.type)
+      buf << ',"conditions":'
+      _json_value(buf, mq.conditions)
+      buf << '}'
+    end
+
+    buf << '],"media_query_lists":'
+    _json_id_lists(buf, media_query_lists)
+    buf << ',"selector_lists":'
+    _json_id_lists(buf, selector_lists)
+
+    buf << ',"imports":['
+    (imports || []).each_with_index do |import, i|
+      buf << ',' if i > 0
+      buf << '{"id":'
+      _json_value(buf, import.id)
+      buf << ',"url":'
+      _json_value(buf, import.url)
+      buf << ',"media":'
+      _json_value(buf, import.media)
+      buf << ',"media_query_id":'
+      _json_value(buf, import.media_query_id)
+      buf << ',"resolved":'
+      _json_value(buf, import.resolved ? true : false)
+      buf << '}'
+    end
+    buf << ']}'
+  end
+
+  # @api private
+  def self._json_rule(buf, rule, include_specificity)
+    buf << '{"id":'
+    _json_value(buf, rule.id)
+
+    if rule.at_rule?
+      buf << ',"type":"at_rule","selector":'
+      _json_value(buf, rule.selector)
+
+      # Content is either Declarations (@font-face) or Rules (@keyframes blocks)
+      buf << ',"content":['
+      (rule.content || []).each_with_index do |item, i|
+        buf << ',' if i > 0
+        if item.is_a?(Declaration)
+          _json_declaration(buf, item)
+        else
+          buf << '{"selector":'
+          _json_value(buf, item.selector)
+          buf << ',"declarations":'
+          _json_declarations(buf, item.declarations)
+          buf << '}'
+        end
+      end
+      buf << '],"media_query_id":'
+      _json_value(buf, rule.media_query_id)
+      buf << '}'
+      return
+    end
+
+    buf << ',"type":"rule","selector":'
+    _json_value(buf, rule.selector)
+    if include_specificity
+      buf << ',"specificity":'
+      _json_value(buf, rule.specificity)
+    end
+    buf << ',"declarations":'
+    _json_declarations(buf, rule.declarations)
+    buf << ',"parent_rule_id":'
+    _json_value(buf, rule.parent_rule_id)
+    buf << ',"nesting_style":'
+    _json_value(buf, rule.nesting_style)
+    buf << ',"selector_list_id":'
+    _json_value(buf, rule.selector_list_id)
+    buf << ',"media_query_id":'
+    _json_value(buf, rule.media_query_id)
+    buf << '}'
+  end
+
+  # @api private
+  def self._json_declarations(buf, declarations)
+    buf << '['
+    (declarations || []).each_with_index do |decl, i|
+      buf << ',' if i > 0
+      _json_declaration(buf, decl)
+    end
+    buf << ']'
+  end
+
+  # @api private
+  def self._json_declaration(buf, decl)
+    buf << '{"property":'
+    _json_value(buf, decl.property)
+    buf << ',"value":'
+    _json_value(buf, decl.value)
+    buf << ',"important":'
+    _json_value(buf, decl.important ? true : false)
+    buf << '}'
+  end
+
+  # @api private
+  # Hash of id => Array<Integer> (selector lists, media query lists)
+  def self._json_id_lists(buf, lists)
+    buf << '{'
+    first = true
+    (lists || {}).each do |key, ids|
+      buf << ',' unless first
+      first = false
+      # JSON object keys must be strings
+      _json_string(buf, key.to_s)
+      buf << ':['
+      ids.each_with_index do |id, i|
+        buf << ',' if i > 0
+        _json_value(buf, id)
+      end
+      buf << ']'
+    end
+    buf << '}'
+  end
+
+  # @api private
+  # String, Symbol, Integer, true/false or nil
+  def self._json_value(buf, val)
+    case val
+    when nil then buf << 'null'
+    when true then buf << 'true'
+    when false then buf << 'false'
+    when Integer then buf << val.to_s
+    else _json_string(buf, val.to_s)
+    end
+  end
+
+  # @api private
+  # Append a quoted, escaped JSON string. Copies clean runs with byteslice.
+  def self._json_string(buf, str)
+    buf << '"'
+    run_start = 0
+    len = str.bytesize
+    i = 0
+    while i < len
+      byte = str.getbyte(i)
+      if byte < 0x20 || byte == BYTE_DQUOTE || byte == BYTE_BACKSLASH
+        buf << str.byteslice(run_start, i - run_start) if i > run_start
+        if byte == BYTE_DQUOTE
+          buf << '\\"'
+        elsif byte == BYTE_BACKSLASH
+          buf << '\\\\'
+        else
+          buf << (JSON_SHORT_ESCAPES[byte] || "\\u00#{JSON_HEX_DIGITS[byte >> 4]}#{JSON_HEX_DIGITS[byte & 0xF]}")
+        end
+        run_start = i + 1
+      end
+      i += 1
+    end
+    buf << str.byteslice(run_start, len - run_start) if len > run_start
+    buf << '"'
+  end
+end
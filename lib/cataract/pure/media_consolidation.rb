@@ -0,0 +1,174 @@
+# frozen_string_literal: true
+
+# Pure Ruby media block consolidation - mirrors ext/cataract/media_consolidation.c
+# NO REGEXP ALLOWED - string manipulation only
+#
+# @api private
+# Computes an alternate emit order for serialization that moves media rules back
+# into the most recent block with an identical media query, when doing so cannot
+# change the cascade. See the C file for the full rationale.
+
+module Cataract
+  module MediaConsolidation
+    BITSET_BITS = 1024
+    MASK64 = 0xFFFFFFFFFFFFFFFF
+    FULL_BITSET = (1 << BITSET_BITS) - 1
+
+    FNV_OFFSET = 14_695_981_039_346_656_037
+    FNV_PRIME = 1_099_511_628_211
+    SPECIFICITY_MIX = 0x9E3779B97F4A7C15
+    IMPORTANT_MIX = 0xC2B2AE3D27D4EB4F
+
+    # First hyphen-separated segment => property family
+    # Families exist so that shorthand/longhand and logical/physical pairs collide.
+    FAMILY_ALIASES = {
+      # inset shorthand and physical offsets
+      'top' => 'inset', 'right' => 'inset', 'bottom' => 'inset', 'left' => 'inset',
+      # place-* shorthands cover align-* and justify-*
+      'align' => 'place', 'justify' => 'place',
+      # gap / grid-gap / row-gap / column-gap / columns
+      'row' => 'gap', 'column' => 'gap', 'columns' => 'gap', 'grid' => 'gap',
+      # Logical and physical sizing
+      'inline' => 'width', 'block' => 'width', 'height' => 'width', 'min' => 'width', 'max' => 'width',
+      # font shorthand resets line-height
+      'line' => 'font',
+      # white-space shorthand covers text-wrap-mode
+      'white' => 'text',
+      # word-wrap is a legacy alias of overflow-wrap
+      'word' => 'overflow',
+      # page-break-* is a legacy alias of break-*
+      'page' => 'break'
+    }.freeze
+
+    # Compute a consolidated emit order for rules
+    #
+    # @param rules [Array<Rule, AtRule>] Rules in source order
+    # @param rule_ids [Array<Integer>, nil] Subset of rule indices to order, or nil for all rules
+    # @param media_queries [Array<MediaQuery>] MediaQuery objects by id
+    # @param media_query_lists [Hash] list_id => Array of MediaQuery ids
+    # @param mq_id_to_list_id [Hash] Reverse map media_query_id => list_id
+    # @return [Array<Integer>, nil] Rule indices in emit order, or nil if nothing moved
+    def self.rule_order(rules, rule_ids, media_queries, media_query_lists, mq_id_to_list_id)
+      rule_ids ||= (0...rules.length).to_a
+      return nil if rule_ids.length < 2
+
+      segments = []       # Arrays of rule indices
+      segment_keys = []   # Parallel to segments: media key or nil
+      mq_id_to_key = {}
+      blocks = {}         # media key => [segment_index, after_bitset]
+      moved = false
+
+      rule_ids.each do |i|
+        rule = rules[i]
+        key = nil
+        bits = 0
+
+        unless rule.at_rule?
+          if rule.media_query_id
+            key = (mq_id_to_key[rule.media_query_id] ||= media_block_key(rule.media_query_id, mq_id_to_list_id, media_query_lists, media_queries))
+          end
+          bits = rule_bitset(rule)
+        end
+
+        last_segment = segments.length - 1
+        target_segment = nil
+        block = key ? blocks[key] : nil
+
+        # Move into the open block only if nothing after it can conflict
+        if block && (bits & block[1]).zero?
+          target_segment = block[0]
+        end
+
+        if target_segment
+          moved = true if target_segment != last_segment
+          segments[target_segment] << i
+        elsif key || last_segment < 0 || segment_keys[last_segment]
+          # Start a new segment (media rules always do, non-media after a media run)
+          target_segment = last_segment + 1
+          segments << [i]
+          segment_keys << key
+          # This becomes the open block for its media query
+          blocks[key] = [target_segment, 0] if key
+        else
+          # Extend trailing non-media segment
+          target_segment = last_segment
+          segments[last_segment] << i
+        end
+
+        # Everything positioned after this rule's segment now has it in between
+        blocks.each_value do |blk|
+          blk[1] |= bits if blk[0] < target_segment
+        end
+      end
+
+      return nil unless moved
+
+      segments.flatten
+    end
+
+    # @return [Integer] Bitset of cascade keys for a rule's declarations
+    def self.rule_bitset(rule)
+      return 0 if rule.declarations.empty?
+
+      spec = rule.specificity || Cataract.calculate_specificity(rule.selector)
+      bits = 0
+      rule.declarations.each do |decl|
+        # "all" resets every property - conflicts with everything
+        return FULL_BITSET if decl.property == 'all'
+
+        bits |= 1 << (cascade_key_hash(decl.property, spec, decl.important) % BITSET_BITS)
+      end
+      bits
+    end
+
+    # Hash a declaration's cascade key: (property family, specificity, important)
+    def self.cascade_key_hash(property, specificity, important)
+      h = fnv1a(property_family(property), FNV_OFFSET)
+      h ^= (specificity * SPECIFICITY_MIX) & MASK64
+      h ^= IMPORTANT_MIX if important
+      h
+    end
+
+    # @return [String] Property family a declaration cascades with
+    def self.property_family(property)
+      # Custom properties cascade independently by full name
+      return property if property.start_with?('--')
+
+      family = property
+      # Strip vendor prefix: -webkit-transition -> transition
+      if property.getbyte(0) == BYTE_HYPHEN
+        dash = property.index('-', 1)
+        family = property[(dash + 1)..] if dash
+      end
+
+      # First segment is the family: margin-top -> margin
+      dash = family.index('-')
+      family = family[0, dash] if dash
+      FAMILY_ALIASES.fetch(family, family)
+    end
+
+    # 64-bit FNV-1a over the bytes of str, continuing from h
+    def self.fnv1a(str, h)
+      str.each_byte do |byte|
+        h ^= byte
+        h = (h * FNV_PRIME) & MASK64
+      end
+      h
+    end
+
+    # Identity key for a rule's media query: full query text for every query in
+    # its comma-separated list (rules with equal keys print identical preludes)
+    def self.media_block_key(media_query_id, mq_id_to_list_id, media_query_lists, media_queries)
+      list_id = mq_id_to_list_id[media_query_id]
+      mq_ids = list_id ? media_query_lists[list_id] : [media_query_id]
+      key = +''
+      mq_ids.each do |mq_id|
+        mq = media_queries[mq_id]
+        next unless mq
+
+        key << mq.type.to_s << "\0" << (mq.conditions || '') << "\n"
+      end
+      key
+    end
+  end
+end
@@ -0,0 +1,65 @@
+# frozen_string_literal: true
+
+# Pure Ruby parse resource limits - mirrors ParseBudget in ext/cataract/css_parser.c
+#
+# @api private
+# Running totals for one parse call against the :limits parser option. One
+# budget is shared by the top-level Parser and every nested Parser it creates.
+# A limit of nil or 0 means unlimited.
+
+module Cataract
+  class ParseBudget
+    # Read the clock for the :timeout limit once per this many charges
+    CLOCK_INTERVAL = 256
+
+    # @param limits [Hash] :limits parser option
+    # @param input_bytes [Integer] Total size of the CSS being parsed
+    # @raise [LimitError] If input_bytes exceeds :max_bytes
+    def initialize(limits, input_bytes)
+      raise TypeError, "wrong argument type #{limits.class} (expected Hash)" unless limits.is_a?(Hash)
+
+      max_bytes = limits[:max_bytes] || 0
+      raise LimitError.new(limit: :max_bytes, max: max_bytes) if max_bytes > 0 && input_bytes > max_bytes
+
+      @max_rules = limits[:max_rules] || 0
+      @max_declarations = limits[:max_declarations] || 0
+      @max_selectors = limits[:max_selectors] || 0
+      @max_nested_rules = limits[:max_nested_rules] || 0
+      @timeout = (limits[:timeout] || 0).to_f
+      @deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + @timeout if @timeout > 0
+
+      @rules = 0
+      @declarations = 0
+      @nested_rules = 0
+      @charges = 0
+    end
+
+    # Count created rules / declarations; see charge_budget in the C parser
+    def charge(rules, declarations, nested_rules)
+      @rules += rules
+      @declarations += declarations
+      @nested_rules += nested_rules
+
+      raise LimitError.new(limit: :max_rules, max: @max_rules) if @max_rules > 0 && @rules > @max_rules
+      if @max_declarations > 0 && @declarations > @max_declarations
+        raise LimitError.new(limit: :max_declarations, max: @max_declarations)
+      end
+      if @max_nested_rules > 0 && @nested_rules > @max_nested_rules
+        raise LimitError.new(limit: :max_nested_rules, max: @max_nested_rules)
+      end
+      return unless @timeout > 0
+
+      @charges += 1
+      if @charges % CLOCK_INTERVAL == 0 && Process.clock_gettime(Process::CLOCK_MONOTONIC) > @deadline
+        raise LimitError.new(limit: :timeout, max: @timeout)
+      end
+    end
+
+    # Check a comma-separated selector list against :max_selectors
+    def check_selectors(selector_text)
+      return if @max_selectors <= 0
+
+      raise LimitError.new(limit: :max_selectors, max: @max_selectors) if selector_text.count(',') + 1 > @max_selectors
+    end
+  end
+end
@@ -118,6 +118,13 @@ module Cataract
         @_check_unclosed_blocks = false
       end
 
+      # Resource limits - one budget shared with nested parsers (see ParseBudget)
+      @_budget = @_parser_options[:_budget]
+      if @_budget.nil? && @_parser_options[:limits]
+        @_budget = ParseBudget.new(@_parser_options[:limits], @_len)
+        @_parser_options[:_budget] = @_budget
+      end
+
       # Private: Internal counters
       @_media_query_id_counter = 0   # Next MediaQuery ID (0-indexed)
       @_next_selector_list_id = 0    # Counter for selector list IDs
@@ -171,6 +178,7 @@ module Cataract
         if has_nested_selectors?(decl_start, decl_end)
           # NESTED PATH: Parse mixed declarations + nested rules
           # Split comma-separated selectors and parse each one
+          @_budget&.check_selectors(selector)
           selectors = selector.split(',')
 
           selectors.each do |individual_selector|
@@ -185,6 +193,7 @@ module Cataract
             next if individual_selector.empty?
 
             # Get rule ID for this selector
+            @_budget&.charge(1, 0, 0)
             current_rule_id = @_rule_id_counter
             @_rule_id_counter += 1
 
@@ -220,6 +229,7 @@ module Cataract
           declarations = parse_declarations
 
           # Split comma-separated selectors into individual rules
+          @_budget&.check_selectors(selector)
           selectors = selector.split(',')
 
           # Determine if we should track this as a selector list
@@ -242,6 +252,7 @@ module Cataract
 
             next if individual_selector.empty?
 
+            @_budget&.charge(1, declarations.size, 0)
             rule_id = @_rule_id_counter
 
             # Dup declarations for each rule in a selector list to avoid shared state
@@ -281,6 +292,7 @@ module Cataract
         _media_query_lists: @_media_query_lists,
         imports: @imports,
         charset: @charset,
+        last_rule_id: @_rule_id_counter,
         _has_nesting: @_has_nesting
       }
     end
@@ -659,6 +671,7 @@ module Cataract
                                   end
 
           # Create rule ID for this media rule
+          @_budget&.charge(1, 0, 1)
           media_rule_id = @_rule_id_counter
           @_rule_id_counter += 1
 
@@ -720,6 +733,7 @@ module Cataract
 
           # Extract nested selector and split on commas
           nested_selector_text = byteslice_encoded(nested_sel_start, nested_sel_end - nested_sel_start)
+          @_budget&.check_selectors(nested_selector_text)
           nested_selectors = nested_selector_text.split(',')
 
           nested_selectors.each do |seg|
@@ -730,6 +744,7 @@ module Cataract
             resolved_selector, nesting_style = resolve_nested_selector(parent_selector, seg)
 
             # Get rule ID
+            @_budget&.charge(1, 0, 1)
             rule_id = @_rule_id_counter
             @_rule_id_counter += 1
 
@@ -765,7 +780,10 @@ module Cataract
 
         # This is a declaration - parse it using shared helper
         decl, pos = parse_single_declaration(pos, end_pos, true)
-        declarations << decl if decl
+        next unless decl
+
+        @_budget&.charge(0, 1, 0)
+        declarations << decl
       end
 
       declarations
@@ -1272,6 +1290,7 @@ module Cataract
         @_pos += 1 if @_pos < @_len && @_css.getbyte(@_pos) == BYTE_RBRACE
 
         # Get rule ID and increment
+        @_budget&.charge(1, 0, 0)
         rule_id = @_rule_id_counter
         @_rule_id_counter += 1
 
@@ -1316,6 +1335,7 @@ module Cataract
         @_pos += 1 if @_pos < @_len && @_css.getbyte(@_pos) == BYTE_RBRACE
 
         # Get rule ID and increment
+        @_budget&.charge(1, content.size, 0)
         rule_id = @_rule_id_counter
         @_rule_id_counter += 1
 
@@ -1348,6 +1368,7 @@ module Cataract
 
       # Parse declarations
       declarations = parse_declarations
+      @_budget&.charge(1, declarations.size, 0)
 
       # Create Rule with declarations
       rule = Rule.new(
@@ -0,0 +1,349 @@
+# frozen_string_literal: true
+
+# Pure Ruby vendor prefix pruning - mirrors ext/cataract/prefix_pruner.c
+# NO REGEXP ALLOWED - byte-by-byte scanning only
+#
+# @api private
+# Applies the per-name actions compiled by PrefixTable: true keeps a prefixed
+# form, false removes it, a String is its standard form (rename, or remove
+# when the standard form is already there; for properties the cascade winner
+# of the two is kept under the standard name).
+
+module Cataract
+  module PrefixPruner
+    def self.prune(rules, properties, values, selectors, at_rules, prefixes)
+      tables = { properties: properties, values: values, selectors: selectors, at_rules: at_rules,
+                 prefixes: prefixes, rules: rules, existing: nil }
+      removed = []
+      rules.each_with_index do |rule, index|
+        if rule.is_a?(AtRule)
+          unless apply_selector(tables, rule, prune_at_rule_name(tables, rule.selector))
+            removed << index
+            next
+          end
+
+          content = rule.content
+          next unless content.is_a?(Array)
+
+          prune_declarations(tables, content)
+          content.each do |block|
+            prune_declarations(tables, block.declarations) if block.is_a?(Rule)
+          end
+        elsif rule.is_a?(Rule)
+          unless apply_selector(tables, rule, prune_selector(tables, rule.selector))
+            removed << index
+            next
+          end
+          prune_declarations(tables, rule.declarations)
+        end
+      end
+      removed
+    end
+
+    def self.alpha?(byte)
+      (byte >= BYTE_LOWER_A && byte <= BYTE_LOWER_Z) || (byte >= BYTE_UPPER_A && byte <= BYTE_UPPER_Z)
+    end
+
+    def self.ident_byte?(byte)
+      alpha?(byte) || (byte >= BYTE_DIGIT_0 && byte <= BYTE_DIGIT_9) || byte == BYTE_HYPHEN || byte == BYTE_UNDERSCORE
+    end
+
+    # Action for a prefixed name whose vendor prefix starts at byte `start`,
+    # trying shorter heads when `heads` is set (properties only).
+    #
+    # @return [Array(Object, Integer)] action and the length of the matched
+    #   table key (0 when the action came from the prefix fallback)
+    def self.lookup_action(table, prefixes, name, start, heads)
+      len = name.bytesize
+      prefix_end = nil
+      i = start + 1
+      while i < len
+        if name.getbyte(i) == BYTE_HYPHEN
+          prefix_end = i + 1
+          break
+        end
+        i += 1
+      end
+      return [true, 0] if prefix_end.nil? || prefix_end >= len
+
+      l = len
+      while l > prefix_end
+        action = table.fetch(name.byteslice(0, l), :undefined)
+        return [action, l] unless action == :undefined
+        break unless heads
+
+        l -= 1
+        l -= 1 while l > prefix_end && name.getbyte(l) != BYTE_HYPHEN
+      end
+      [prefixes.fetch(name.byteslice(start, prefix_end - start), true), 0]
+    end
+
+    # Standard form for a String action: the action plus the unmatched tail
+    def self.standard_name(action, name, matched)
+      return action if matched >= name.bytesize
+
+      action + name.byteslice(matched, name.bytesize - matched)
+    end
+
+    def self.url_at?(value, len, i)
+      return false unless i + 3 < len
+
+      b0 = value.getbyte(i)
+      b1 = value.getbyte(i + 1)
+      b2 = value.getbyte(i + 2)
+      (b0 == BYTE_LOWER_U || b0 == BYTE_UPPER_U) &&
+        (b1 == BYTE_LOWER_R || b1 == BYTE_UPPER_R) &&
+        (b2 == BYTE_LOWER_L || b2 == BYTE_UPPER_L) &&
+        value.getbyte(i + 3) == BYTE_LPAREN
+    end
+
+    # Index just past the quoted string starting at i
+    def self.skip_quoted(str, len, i)
+      quote = str.getbyte(i)
+      i += 1
+      while i < len && str.getbyte(i) != quote
+        i += str.getbyte(i) == BYTE_BACKSLASH && i + 1 < len ? 2 : 1
+      end
+      i < len ? i + 1 : len
+    end
+
+    # Worst action over the prefixed keywords of a value: false beats a
+    # String beats true. Strings and url() contents are skipped.
+    def self.value_action(tables, value)
+      return true unless value.is_a?(String)
+
+      len = value.bytesize
+      return true unless value.include?('-')
+
+      result = true
+      i = 0
+      while i < len
+        byte = value.getbyte(i)
+        if byte == BYTE_DQUOTE || byte == BYTE_SQUOTE
+          i = skip_quoted(value, len, i)
+        elsif url_at?(value, len, i) && (i == 0 || !ident_byte?(value.getbyte(i - 1)))
+          i += 4
+          while i < len && value.getbyte(i) != BYTE_RPAREN
+            byte = value.getbyte(i)
+            i = byte == BYTE_DQUOTE || byte == BYTE_SQUOTE ? skip_quoted(value, len, i) : i + 1
+          end
+        elsif byte == BYTE_HYPHEN && i + 1 < len && alpha?(value.getbyte(i + 1)) &&
+              (i == 0 || !ident_byte?(value.getbyte(i - 1)))
+          finish = i + 1
+          finish += 1 while finish < len && ident_byte?(value.getbyte(finish))
+
+          action, = lookup_action(tables[:values], tables[:prefixes], value.byteslice(i, finish - i), 0, false)
+          return false if action == false
+
+          result = action if action.is_a?(String)
+          i = finish
+        else
+          i += 1
+        end
+      end
+      result
+    end
+
+    def self.vendor_prefixed?(property)
+      property.is_a?(String) && property.bytesize > 2 &&
+        property.getbyte(0) == BYTE_HYPHEN && alpha?(property.getbyte(1))
+    end
+
+    # Standard name shared by declaration i and the prefixed forms renamed to
+    # it (a key of groups), or nil when the declaration is in no such group
+    def self.property_group(declarations, prop_actions, groups, i)
+      action = prop_actions[i]
+      return action if action.is_a?(String)
+      return nil unless action == true
+
+      decl = declarations[i]
+      return nil unless decl.is_a?(Declaration)
+
+      groups.key?(decl.property) ? decl.property : nil
+    end
+
+    # Prune one declarations Array in place; returns number of declarations changed
+    def self.prune_declarations(tables, declarations)
+      return 0 unless declarations.is_a?(Array) && !declarations.empty?
+
+      prop_actions = []
+      value_actions = []
+      any = false
+      declarations.each do |decl|
+        prop_action = true
+        val_action = true
+        if decl.is_a?(Declaration)
+          property = decl.property
+          if vendor_prefixed?(property)
+            action, matched = lookup_action(tables[:properties], tables[:prefixes], property, 0, true)
+            prop_action = action.is_a?(String) ? standard_name(action, property, matched) : action
+          end
+          val_action = value_action(tables, decl.value)
+        end
+        prop_actions << prop_action
+        value_actions << val_action
+        any = true if prop_action != true || val_action != true
+      end
+      return 0 unless any
+
+      n = declarations.size
+      removed = Array.new(n, false)
+      changed = 0
+
+      # Properties first: a renamed declaration can be the fallback for a value.
+      # A prefixed form that gets renamed and its standard form are one property,
+      # so only the cascade winner among them is kept (!important beats normal,
+      # then the later one wins): "transform: a; -webkit-transform: b" => "transform: b"
+      winners = {} # standard name => index of the winning declaration
+      prop_actions.each_with_index do |action, i|
+        if action == false
+          removed[i] = true
+        elsif action.is_a?(String)
+          winners[action] = nil
+        end
+      end
+      unless winners.empty?
+        n.times do |i|
+          key = property_group(declarations, prop_actions, winners, i)
+          next unless key
+
+          winner = winners[key]
+          winners[key] = i if winner.nil? || declarations[i].important || !declarations[winner].important
+        end
+        n.times do |i|
+          key = property_group(declarations, prop_actions, winners, i)
+          next unless key
+
+          if winners[key] != i
+            removed[i] = true
+          elsif prop_actions[i].is_a?(String)
+            declarations[i].property = key
+            changed += 1
+          end
+        end
+      end
+
+      value_actions.each_with_index do |action, i|
+        next if removed[i] || action == true
+
+        if action == false
+          removed[i] = true
+          next
+        end
+
+        property = declarations[i].property
+        n.times do |j|
+          next if j == i || removed[j] || value_actions[j] != true
+
+          other = declarations[j]
+          if other.is_a?(Declaration) && other.property == property
+            removed[i] = true
+            break
+          end
+        end
+      end
+
+      kept = 0
+      n.times do |i|
+        if removed[i]
+          changed += 1
+          next
+        end
+        declarations[kept] = declarations[i] if kept != i
+        kept += 1
+      end
+      declarations.pop(n - kept) if kept != n
+      changed
+    end
+
+    # Rewrite prefixed pseudo-classes/elements in a selector. Returns the
+    # selector (same object when unchanged), or false when the rule should go.
+    def self.prune_selector(tables, selector)
+      return selector unless selector.is_a?(String) && selector.include?(':')
+
+      len = selector.bytesize
+      result = nil
+      copied = 0
+      i = 0
+      while i < len
+        byte = selector.getbyte(i)
+        if byte == BYTE_BACKSLASH
+          i += 2
+        elsif byte == BYTE_DQUOTE || byte == BYTE_SQUOTE
+          i = skip_quoted(selector, len, i)
+        elsif byte == BYTE_LBRACKET
+          while i < len && selector.getbyte(i) != BYTE_RBRACKET
+            byte = selector.getbyte(i)
+            i = byte == BYTE_DQUOTE || byte == BYTE_SQUOTE ? skip_quoted(selector, len, i) : i + 1
+          end
+        elsif byte == BYTE_COLON
+          start = i + 1 < len && selector.getbyte(i + 1) == BYTE_COLON ? i + 2 : i + 1
+          if start + 1 < len && selector.getbyte(start) == BYTE_HYPHEN && alpha?(selector.getbyte(start + 1))
+            finish = start + 1
+            finish += 1 while finish < len && ident_byte?(selector.getbyte(finish))
+
+            name = selector.byteslice(i, finish - i)
+            action, matched = lookup_action(tables[:selectors], tables[:prefixes], name, start - i, false)
+            return false if action == false
+
+            if action.is_a?(String)
+              result ||= String.new(capacity: len)
+              result << selector.byteslice(copied, i - copied) << standard_name(action, name, matched)
+              copied = finish
+            end
+            i = finish
+          else
+            i = start
+          end
+        else
+          i += 1
+        end
+      end
+      return selector unless result
+
+      result << selector.byteslice(copied, len - copied)
+      result.force_encoding(selector.encoding)
+    end
+
+    # "@-webkit-keyframes spin" => "@keyframes spin", selector, or false
+    def self.prune_at_rule_name(tables, selector)
+      return selector unless selector.is_a?(String)
+
+      len = selector.bytesize
+      unless len >= 3 && selector.getbyte(0) == BYTE_AT && selector.getbyte(1) == BYTE_HYPHEN && alpha?(selector.getbyte(2))
+        return selector
+      end
+
+      finish = 2
+      finish += 1 while finish < len && ident_byte?(selector.getbyte(finish))
+
+      name = selector.byteslice(0, finish)
+      action, matched = lookup_action(tables[:at_rules], tables[:prefixes], name, 1, false)
+      return action == false ? false : selector unless action.is_a?(String)
+
+      (standard_name(action, name, matched) + selector.byteslice(finish, len - finish)).force_encoding(selector.encoding)
+    end
+
+    # Selectors already in the sheet, so a rename that would duplicate a
+    # standard rule removes the prefixed rule instead
+    def self.existing_selectors(tables)
+      tables[:existing] ||= tables[:rules].each_with_object({}) do |rule, existing|
+        existing[[rule.media_query_id, rule.selector]] = true if rule.is_a?(Rule) || rule.is_a?(AtRule)
+      end
+    end
+
+    # Apply a selector action; returns false when the rule should be removed
+    def self.apply_selector(tables, rule, pruned)
+      return false if pruned == false
+      return true if pruned.equal?(rule.selector)
+
+      existing = existing_selectors(tables)
+      key = [rule.media_query_id, pruned]
+      return false if existing[key]
+
+      existing[key] = true
+      rule.selector = pruned
+      true
+    end
+  end
+end
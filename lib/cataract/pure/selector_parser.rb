@@ -0,0 +1,678 @@
+# frozen_string_literal: true
+
+# Pure Ruby selector component parser - mirrors ext/cataract/selector_parser.c
+# NO REGEXP ALLOWED - byte-by-byte parsing only
+#
+# @api private
+# Splits a selector into compound selectors ([kind, name(, argument)] lists)
+# and combinator Symbols. Names are interned (frozen, deduplicated) Strings.
+# Selector tokens and class/id name minification read the same scan through
+# the byte offsets of each component.
+
+module Cataract
+  module SelectorParser
+    COMBINATORS = {
+      BYTE_GT => :child,
+      BYTE_PLUS => :next_sibling,
+      BYTE_TILDE => :subsequent_sibling,
+      BYTE_COMMA => :list
+    }.freeze
+
+    # Bytes that end a name
+    NAME_STOP = [
+      BYTE_SPACE, BYTE_TAB, BYTE_NEWLINE, BYTE_CR, 0x0c,
+      BYTE_HASH, BYTE_DOT, BYTE_LBRACKET, BYTE_RBRACKET, BYTE_COLON, BYTE_LPAREN, BYTE_RPAREN,
+      BYTE_GT, BYTE_PLUS, BYTE_TILDE, BYTE_COMMA, BYTE_ASTERISK, BYTE_AMPERSAND
+    ].freeze
+
+    # Bytes that end an attribute name (besides whitespace and "|=")
+    ATTRIBUTE_NAME_STOP = [BYTE_EQUALS, BYTE_TILDE, BYTE_CARET, BYTE_DOLLAR, BYTE_ASTERISK, BYTE_BANG].freeze
+
+    # Bytes that start a two-byte attribute match operator ("~=", "|=", ...)
+    MATCH_OPERATOR_BYTES = [BYTE_TILDE, BYTE_PIPE, BYTE_CARET, BYTE_DOLLAR, BYTE_ASTERISK].freeze
+
+    COMBINATOR_KINDS = %i[descendant child next_sibling subsequent_sibling list].freeze
+
+    LEGACY_PSEUDO_ELEMENTS = %w[before after first-line first-letter selection].freeze
+
+    # @param selector [String] A single (complex) selector
+    # @return [Array] Frozen components
+    def self.parse(selector)
+      raise TypeError, "wrong argument type #{selector.class} (expected String)" unless selector.is_a?(String)
+
+      components = []
+      compound = nil
+      scan(selector, 0, selector.bytesize) do |kind, _start, _finish, name_start, name_end, arg_start, arg_end|
+        if COMBINATOR_KINDS.include?(kind)
+          if compound
+            components << compound.freeze
+            compound = nil
+          end
+          components << kind
+          next
+        end
+
+        compound ||= []
+        argument = arg_start ? intern(selector, arg_start, arg_end) : nil
+        compound << simple(kind, intern(selector, name_start, name_end), argument)
+      end
+
+      components << compound.freeze if compound
+      components.freeze
+    end
+
+    # Report the simple selectors and combinators of selector bytes
+    # [pos, len) with their byte offsets (see scan_selector in
+    # selector_parser.c)
+    #
+    # @yieldparam kind [Symbol] Simple selector kind or combinator
+    # @yieldparam start [Integer] First byte ('.', '#', '[', ':' or the name)
+    # @yieldparam finish [Integer] One past the last byte
+    # @yieldparam name_start [Integer] Name as in parse's [kind, name]
+    # @yieldparam name_end [Integer]
+    # @yieldparam arg_start [Integer, nil] Argument, whitespace-trimmed; nil when there is none
+    # @yieldparam arg_end [Integer, nil]
+    def self.scan(selector, pos, len)
+      in_compound = false
+      pending_descendant = false
+
+      while pos < len
+        byte = selector.getbyte(pos)
+
+        if space?(byte)
+          if in_compound
+            in_compound = false
+            pending_descendant = true
+          end
+          pos += 1
+          next
+        end
+
+        combinator = COMBINATORS[byte]
+        if combinator
+          yield combinator, pos, pos + 1, pos, pos + 1, nil, nil
+          in_compound = false
+          pending_descendant = false
+          pos += 1
+          next
+        end
+
+        # Stray closers, parenthesized text and strings can't start a simple selector
+        if byte == BYTE_RPAREN || byte == BYTE_RBRACKET
+          pos += 1
+          next
+        end
+        if byte == BYTE_LPAREN
+          pos = scan_block(selector, pos + 1, len, BYTE_LPAREN, BYTE_RPAREN)
+          pos += 1 if pos < len
+          next
+        end
+        if byte == BYTE_DQUOTE || byte == BYTE_SQUOTE
+          pos += 1
+          while pos < len && selector.getbyte(pos) != byte
+            pos += selector.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < len ? 2 : 1
+          end
+          pos += 1 if pos < len
+          next
+        end
+
+        if pending_descendant
+          yield :descendant, pos, pos, pos, pos, nil, nil
+          pending_descendant = false
+        end
+        in_compound = true
+
+        start = pos
+        arg_start = arg_end = nil
+        case byte
+        when BYTE_HASH, BYTE_DOT
+          kind = byte == BYTE_HASH ? :id : :class
+          name_start = pos + 1
+          pos = name_end = scan_name(selector, name_start, len)
+        when BYTE_LBRACKET
+          kind, name_start, name_end, arg_start, arg_end, pos = scan_attribute(selector, pos + 1, len)
+        when BYTE_COLON
+          kind, name_start, name_end, arg_start, arg_end, pos = scan_pseudo(selector, pos + 1, len)
+        when BYTE_ASTERISK
+          kind = :universal
+          name_start = pos
+          pos += 1
+          # *|name and *|* - any namespace
+          if pos + 1 < len && selector.getbyte(pos) == BYTE_PIPE
+            any_element = selector.getbyte(pos + 1) == BYTE_ASTERISK
+            name_end = any_element ? pos + 2 : scan_name(selector, pos + 1, len)
+            if name_end > pos + 1
+              pos = name_end
+              kind = :type unless any_element
+            end
+          end
+          name_end = pos
+        when BYTE_AMPERSAND
+          kind = :nesting
+          name_start = pos
+          pos += 1
+          name_end = pos
+        else
+          kind = :type
+          name_start = pos
+          pos = scan_name(selector, pos, len)
+          # ns|* namespaced universal
+          if pos < len && selector.getbyte(pos) == BYTE_ASTERISK && selector.getbyte(pos - 1) == BYTE_PIPE
+            pos += 1
+            kind = :universal
+          end
+          name_end = pos
+        end
+        yield kind, start, pos, name_start, name_end, arg_start, arg_end
+      end
+    end
+
+    # Attribute selector; pos points past '['
+    #
+    # @return [Array] kind, name range, argument range (nil when there is no
+    #   argument) and the position after ']'
+    def self.scan_attribute(selector, pos, len)
+      close = scan_block(selector, pos, len, BYTE_LBRACKET, BYTE_RBRACKET)
+
+      pos += 1 while pos < close && space?(selector.getbyte(pos))
+      name_start = pos
+      while pos < close
+        byte = selector.getbyte(pos)
+        break if space?(byte) || ATTRIBUTE_NAME_STOP.include?(byte) ||
+                 (byte == BYTE_PIPE && pos + 1 < close && selector.getbyte(pos + 1) == BYTE_EQUALS)
+
+        pos += byte == BYTE_BACKSLASH && pos + 1 < close ? 2 : 1
+      end
+      name_end = pos
+
+      arg_end = close
+      arg_end -= 1 while arg_end > pos && space?(selector.getbyte(arg_end - 1))
+      pos += 1 while pos < arg_end && space?(selector.getbyte(pos))
+      arg_start = pos < arg_end ? pos : nil
+      arg_end = nil unless arg_start
+
+      [:attribute, name_start, name_end, arg_start, arg_end, close < len ? close + 1 : len]
+    end
+
+    # :name, ::name or :name(args); pos points past the first ':'
+    #
+    # @return [Array] kind, name range, argument range (nil when there is no
+    #   argument) and the position after the pseudo
+    def self.scan_pseudo(selector, pos, len)
+      element = false
+      if pos < len && selector.getbyte(pos) == BYTE_COLON
+        element = true
+        pos += 1
+      end
+
+      name_start = pos
+      pos = scan_name(selector, pos, len)
+      name_end = pos
+      element ||= LEGACY_PSEUDO_ELEMENTS.include?(selector.byteslice(name_start, name_end - name_start))
+
+      arg_start = arg_end = nil
+      if pos < len && selector.getbyte(pos) == BYTE_LPAREN
+        close = scan_block(selector, pos + 1, len, BYTE_LPAREN, BYTE_RPAREN)
+        arg_start = pos + 1
+        arg_end = close
+        arg_start += 1 while arg_start < arg_end && space?(selector.getbyte(arg_start))
+        arg_end -= 1 while arg_end > arg_start && space?(selector.getbyte(arg_end - 1))
+        pos = close < len ? close + 1 : len
+      end
+
+      [element ? :pseudo_element : :pseudo_class, name_start, name_end, arg_start, arg_end, pos]
+    end
+
+    # Scan a name; a backslash escapes the next byte
+    def self.scan_name(selector, pos, len)
+      while pos < len
+        byte = selector.getbyte(pos)
+        break if NAME_STOP.include?(byte)
+
+        pos += byte == BYTE_BACKSLASH && pos + 1 < len ? 2 : 1
+      end
+      pos
+    end
+
+    # Find the closer for an opener at pos - 1, skipping quoted strings and
+    # nested pairs. Returns len when unbalanced.
+    def self.scan_block(selector, pos, len, open, close)
+      depth = 1
+      while pos < len
+        byte = selector.getbyte(pos)
+        if byte == BYTE_BACKSLASH && pos + 1 < len
+          pos += 2
+          next
+        end
+        if byte == BYTE_DQUOTE || byte == BYTE_SQUOTE
+          pos += 1
+          while pos < len && selector.getbyte(pos) != byte
+            pos += selector.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < len ? 2 : 1
+          end
+          pos += 1 if pos < len
+          next
+        end
+        if byte == open
+          depth += 1
+        elsif byte == close
+          depth -= 1
+          return pos if depth == 0
+        end
+        pos += 1
+      end
+      len
+    end
+
+    # Class, id and type tokens per comma-separated branch (see
+    # selector_parser.c for the rules)
+    #
+    # @param selector [String] Selector
+    # @return [Array<Array<String>>]
+    def self.tokens(selector)
+      raise TypeError, "wrong argument type #{selector.class} (expected String)" unless selector.is_a?(String)
+
+      branch = []
+      branches = [branch]
+      scan(selector, 0, selector.bytesize) do |kind, start, _finish, name_start, name_end|
+        case kind
+        when :list
+          branch = []
+          branches << branch
+        when :class, :id
+          branch << token(selector, selector.getbyte(start), name_start, name_end, false) if name_end > name_start
+        when :type
+          # ns|type - only the type name counts
+          q = name_start
+          while q < name_end
+            b = selector.getbyte(q)
+            if b == BYTE_BACKSLASH && q + 1 < name_end
+              q += 1
+            elsif b == BYTE_PIPE
+              name_start = q + 1
+            end
+            q += 1
+          end
+          branch << token(selector, nil, name_start, name_end, true) if name_end > name_start
+        end
+      end
+
+      branches
+    end
+
+    # Token String: prefix byte (or nil) + name with escapes decoded
+    def self.token(selector, prefix, start, finish, downcase)
+      out = String.new(capacity: finish - start + 1, encoding: Encoding::BINARY)
+      out << prefix if prefix
+      pos = start
+      while pos < finish
+        byte = selector.getbyte(pos)
+        if byte == BYTE_BACKSLASH && pos + 1 < finish
+          pos += 1
+          byte = selector.getbyte(pos)
+        elsif downcase && byte >= 0x41 && byte <= 0x5a
+          byte += 0x20
+        end
+        out << byte
+        pos += 1
+      end
+      out.force_encoding(selector.encoding)
+    end
+
+    # Class and id names used by rule selectors (see selector_parser.c for
+    # how pseudo-class arguments and attribute selectors are handled)
+    #
+    # @return [Array(Hash{String => Integer}, Array<Array>, Array<String>)]
+    #   Occurrences per token, the attribute matches that can't be rewritten
+    #   and the decoded tokens written with hex escapes
+    def self.name_counts(rules)
+      scan = { counts: {}, patterns: [], fixed: [], mapping: nil }
+      rules.each do |rule|
+        visit_selector_names(scan, rule.selector) if rule.is_a?(Rule) && rule.selector.is_a?(String)
+      end
+      [scan[:counts], scan[:patterns], scan[:fixed]]
+    end
+
+    # Rename class and id names in rule selectors, in place
+    #
+    # @return [Integer] Number of selectors changed
+    def self.rename_names(rules, mapping)
+      scan = { counts: nil, patterns: nil, fixed: nil, mapping: mapping }
+      changed = 0
+      rules.each do |rule|
+        next unless rule.is_a?(Rule) && rule.selector.is_a?(String)
+
+        renamed = visit_selector_names(scan, rule.selector)
+        next unless renamed
+
+        rule.selector = renamed
+        changed += 1
+      end
+      changed
+    end
+
+    # Count or rename the names of one selector. Returns the rewritten
+    # selector in rename mode, nil when nothing changed.
+    def self.visit_selector_names(scan, selector)
+      len = selector.bytesize
+      scan[:selector] = selector
+      scan[:result] = nil
+      scan[:copied] = 0
+
+      visit_part_names(scan, 0, len)
+
+      result = scan[:result]
+      return nil unless result
+
+      result << selector.byteslice(scan[:copied], len - scan[:copied])
+      result.force_encoding(selector.encoding)
+    end
+
+    # Names in selector bytes [pos, len); pseudo arguments (:not(.a),
+    # :is(#b .c)) are selectors in the same text and are visited too
+    def self.visit_part_names(scan, pos, len)
+      selector = scan[:selector]
+      scan(selector, pos, len) do |kind, start, _finish, name_start, name_end, arg_start, arg_end|
+        case kind
+        when :class, :id
+          visit_name(scan, selector.getbyte(start), start, name_start, name_end) if name_end > name_start
+        when :attribute
+          visit_attribute(scan, name_start, name_end, arg_start, arg_end)
+        when :pseudo_class, :pseudo_element
+          visit_part_names(scan, arg_start, arg_end) if arg_start
+        end
+      end
+    end
+
+    # A .class or #id token at from; the name is [start, finish)
+    def self.visit_name(scan, prefix, from, start, finish)
+      selector = scan[:selector]
+      if hex_escape?(selector, start, finish)
+        scan[:fixed] << decode_escaped(selector, prefix, start, finish) unless scan[:mapping]
+        return
+      end
+
+      name = token(selector, prefix, start, finish, false)
+      mapping = scan[:mapping]
+      unless mapping
+        scan[:counts][name] = scan[:counts].fetch(name, 0) + 1
+        return
+      end
+
+      replacement = mapping[name]
+      splice(scan, from, finish, replacement) if replacement.is_a?(String)
+    end
+
+    # Names in an attribute selector: [class] and [id] only
+    def self.visit_attribute(scan, name_start, name_end, arg_start, arg_end)
+      selector = scan[:selector]
+      q = name_start
+      while q < name_end
+        byte = selector.getbyte(q)
+        if byte == BYTE_BACKSLASH && q + 1 < name_end
+          q += 1
+        elsif byte == BYTE_PIPE
+          name_start = q + 1 # ns|attr
+        end
+        q += 1
+      end
+
+      name = selector.byteslice(name_start, name_end - name_start)
+      if name.casecmp?('class')
+        prefix = BYTE_DOT
+      elsif name.casecmp?('id')
+        prefix = BYTE_HASH
+      else
+        return
+      end
+      return unless arg_start # [class] presence test
+
+      pos = arg_start
+      close = arg_end
+      byte = selector.getbyte(pos)
+      if byte == BYTE_EQUALS
+        pos += 1
+      elsif pos + 1 < close && selector.getbyte(pos + 1) == BYTE_EQUALS && MATCH_OPERATOR_BYTES.include?(byte)
+        pos += 2
+      else
+        return
+      end
+      operator = selector.byteslice(arg_start, pos - arg_start)
+
+      pos += 1 while pos < close && space?(selector.getbyte(pos))
+      value_from = pos
+      quote = pos < close ? selector.getbyte(pos) : nil
+      if quote == BYTE_DQUOTE || quote == BYTE_SQUOTE
+        pos += 1
+        value_start = pos
+        while pos < close && selector.getbyte(pos) != quote
+          pos += selector.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < close ? 2 : 1
+        end
+        value_end = pos
+        pos += 1 if pos < close
+      else
+        value_start = pos
+        while pos < close && !space?(selector.getbyte(pos))
+          pos += selector.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < close ? 2 : 1
+        end
+        value_end = pos
+      end
+      value_to = pos
+
+      pos += 1 while pos < close && space?(selector.getbyte(pos))
+      flag = pos < close ? selector.getbyte(pos) : nil
+      case_insensitive = flag == BYTE_LOWER_I || flag == BYTE_UPPER_I
+
+      escaped = hex_escape?(selector, value_start, value_end)
+      value = if escaped
+                decode_escaped(selector, nil, value_start, value_end)
+              else
+                token(selector, nil, value_start, value_end, false)
+              end
+      if case_insensitive || (operator != '=' && operator != '~=')
+        scan[:patterns] << [prefix == BYTE_DOT ? '.' : '#', operator, value, case_insensitive] unless scan[:mapping]
+        return
+      end
+      if escaped
+        fix_attribute_words(scan, prefix, value) unless scan[:mapping]
+        return
+      end
+
+      renamed = visit_attribute_words(scan, prefix, value)
+      splice(scan, value_from, value_to, quote_value(renamed)) if renamed
+    end
+
+    # Count or rename the whitespace-separated names of a decoded [class] or
+    # [id] value. Returns the renamed value, or nil when nothing changed.
+    def self.visit_attribute_words(scan, prefix, value)
+      len = value.bytesize
+      mapping = scan[:mapping]
+      renamed = nil
+      copied = 0
+      pos = 0
+
+      while pos < len
+        pos += 1 while pos < len && space?(value.getbyte(pos))
+        start = pos
+        pos += 1 while pos < len && !space?(value.getbyte(pos))
+        break if pos == start
+
+        name = (prefix == BYTE_DOT ? '.' : '#') + value.byteslice(start, pos - start)
+        unless mapping
+          scan[:counts][name] = scan[:counts].fetch(name, 0) + 1
+          next
+        end
+
+        replacement = mapping[name]
+        next unless replacement.is_a?(String)
+
+        renamed ||= String.new(capacity: len, encoding: value.encoding)
+        renamed << value.byteslice(copied, start - copied) << replacement.byteslice(1, replacement.bytesize - 1)
+        copied = pos
+      end
+
+      renamed << value.byteslice(copied, len - copied) if renamed
+      renamed
+    end
+
+    # Report the names of a [class] or [id] value written with hex escapes as fixed
+    def self.fix_attribute_words(scan, prefix, value)
+      len = value.bytesize
+      pos = 0
+      while pos < len
+        pos += 1 while pos < len && space?(value.getbyte(pos))
+        start = pos
+        pos += 1 while pos < len && !space?(value.getbyte(pos))
+        break if pos == start
+
+        scan[:fixed] << ((prefix == BYTE_DOT ? '.' : '#') + value.byteslice(start, pos - start))
+      end
+    end
+
+    # Double-quoted attribute value; kept names may need escaping
+    def self.quote_value(value)
+      out = String.new(capacity: value.bytesize + 2, encoding: Encoding::BINARY)
+      out << BYTE_DQUOTE
+      value.each_byte do |byte|
+        out << BYTE_BACKSLASH if byte == BYTE_DQUOTE || byte == BYTE_BACKSLASH
+        out << byte
+      end
+      out << BYTE_DQUOTE
+      out.force_encoding(value.encoding)
+    end
+
+    # Replace selector bytes [from, to) with text in the rewritten selector
+    def self.splice(scan, from, to, text)
+      selector = scan[:selector]
+      result = (scan[:result] ||= String.new(capacity: selector.bytesize, encoding: selector.encoding))
+      result << selector.byteslice(scan[:copied], from - scan[:copied]) << text
+      scan[:copied] = to
+    end
+
+    def self.hex_escape?(str, pos, finish)
+      while pos < finish
+        if str.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < finish
+          return true if hex_digit?(str.getbyte(pos + 1))
+
+          pos += 1
+        end
+        pos += 1
+      end
+      false
+    end
+
+    # UTF-8 token String: prefix byte (or nil) + name with hex and plain
+    # escapes decoded ("\61 b" => "ab")
+    def self.decode_escaped(selector, prefix, start, finish)
+      out = String.new(capacity: finish - start + 1, encoding: Encoding::BINARY)
+      out << prefix if prefix
+      pos = start
+      while pos < finish
+        byte = selector.getbyte(pos)
+        if byte == BYTE_BACKSLASH && pos + 1 < finish
+          pos += 1
+          byte = selector.getbyte(pos)
+          if hex_digit?(byte)
+            codepoint = 0
+            digits = 0
+            while digits < 6 && pos < finish && hex_digit?(selector.getbyte(pos))
+              codepoint = (codepoint * 16) + selector.byteslice(pos, 1).to_i(16)
+              pos += 1
+              digits += 1
+            end
+            pos += 1 if pos < finish && space?(selector.getbyte(pos))
+            codepoint = 0xfffd if codepoint == 0 || codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint <= 0xdfff)
+            out << [codepoint].pack('U').b
+            next
+          end
+        end
+        out << byte
+        pos += 1
+      end
+      out.force_encoding(Encoding::UTF_8)
+    end
+
+    def self.hex_digit?(byte)
+      (byte >= BYTE_DIGIT_0 && byte <= BYTE_DIGIT_9) ||
+        (byte >= BYTE_LOWER_A && byte <= BYTE_LOWER_F) || (byte >= BYTE_UPPER_A && byte <= BYTE_UPPER_F)
+    end
+
+    def self.simple(kind, name, argument = nil)
+      (argument.nil? ? [kind, name] : [kind, name, argument]).freeze
+    end
+
+    def self.intern(selector, start, finish)
+      -selector.byteslice(start, finish - start)
+    end
+
+    def self.space?(byte)
+      byte == BYTE_SPACE || byte == BYTE_TAB || byte == BYTE_NEWLINE || byte == BYTE_CR || byte == 0x0c
+    end
+  end
+
+  # Parse a selector into compound selectors and combinators
+  #
+  # @param selector [String] A single (complex) selector
+  # @return [Array] Frozen components
+  def self.parse_selector(selector)
+    SelectorParser.parse(selector)
+  end
+
+  # Class, id and type tokens of a selector, per comma-separated branch
+  #
+  # @param selector [String] Selector
+  # @return [Array<Array<String>>] e.g. [[".nav", "a"], ["#main"]]
+  def self.selector_tokens(selector)
+    SelectorParser.tokens(selector)
+  end
+
+  # Which pages can use each rule
+  #
+  # @api private
+  # @param rules [Array<Rule, AtRule>] Rules to test
+  # @param token_masks [Hash{String => Integer}] Token => bit mask of pages using it
+  # @param all_pages [Integer] Mask with a bit set for every page
+  # @return [Array<Integer, nil>] Mask of pages per rule (nil for at-rules)
+  def self._rule_page_masks(rules, token_masks, all_pages)
+    rules.map do |rule|
+      next nil unless rule.is_a?(Rule)
+
+      mask = 0
+      SelectorParser.tokens(rule.selector).each do |tokens|
+        branch_mask = all_pages
+        tokens.each do |token|
+          branch_mask &= token_masks.fetch(token, 0)
+          break if branch_mask == 0
+        end
+        mask |= branch_mask
+      end
+      mask
+    end
+  end
+
+  # Class and id names used by rule selectors
+  #
+  # @api private
+  # @param rules [Array<Rule, AtRule>] Rules to scan (at-rules are skipped)
+  # @return [Array(Hash{String => Integer}, Array<Array>, Array<String>)]
+  #   Occurrences per ".class" / "#id" token, in first-seen order, the [kind,
+  #   operator, value, case_insensitive] attribute matches that can't be
+  #   rewritten, and the decoded tokens written with hex escapes
+  def self._rule_name_counts(rules)
+    raise TypeError, "wrong argument type #{rules.class} (expected Array)" unless rules.is_a?(Array)
+
+    SelectorParser.name_counts(rules)
+  end
+
+  # Rename class and id names in rule selectors, in place
+  #
+  # @api private
+  # @param rules [Array<Rule, AtRule>] Rules to rewrite (at-rules are skipped)
+  # @param mapping [Hash{String => String}] ".class" / "#id" token => new token
+  # @return [Integer] Number of selectors changed
+  def self._rename_rule_names(rules, mapping)
+    raise TypeError, "wrong argument type #{rules.class} (expected Array)" unless rules.is_a?(Array)
+    raise TypeError, "wrong argument type #{mapping.class} (expected Hash)" unless mapping.is_a?(Hash)
+
+    SelectorParser.rename_names(rules, mapping)
+  end
+end
@@ -9,6 +9,19 @@
 # used directly. The public API is through the Stylesheet class.
 
 module Cataract
+  # Default chunk size for streaming output to a sink (e.g. Zlib::GzipWriter)
+  SERIALIZE_CHUNK_SIZE = 65_536
+
+  # @api private
+  # Hand the buffer to the sink once it is full, then reuse it for the next chunk.
+  # The sink must consume the string during #write (IO, GzipWriter and StringIO do).
+  def self._flush_to_sink(result, sink, chunk_size)
+    return if result.bytesize < chunk_size
+
+    sink.write(result)
+    result.clear
+  end
+
   # @api private
   # Helper: Build media query string from MediaQuery object or list
   # @param media_query [MediaQuery] The MediaQuery object
@@ -46,8 +59,9 @@ module Cataract
   # @param selector_lists [Hash] Selector list ID => array of rule IDs (for grouping)
   # @param media_queries [Array<MediaQuery>] Array of MediaQuery objects (optional, for proper serialization)
   # @param media_query_lists [Hash] List ID => array of MediaQuery IDs (optional, for comma-separated queries)
+  # @param options [Hash, nil] Serialization options (e.g. { consolidate_media: true })
   # @return [String] Compact CSS string
-  def self.stylesheet_to_s(rules, charset, has_nesting, selector_lists = {}, media_queries = [], media_query_lists = {})
+  def self.stylesheet_to_s(rules, charset, has_nesting, selector_lists = {}, media_queries = [], media_query_lists = {}, options = nil)
     result = +''
 
     # Add @charset if present
@@ -57,13 +71,13 @@ module Cataract
 
     # Fast path: no nesting - use simple algorithm
     unless has_nesting
-      return _stylesheet_to_s_without_nesting(rules, result, selector_lists, media_queries, media_query_lists)
+      return _stylesheet_to_s_without_nesting(rules, result, selector_lists, media_queries, media_query_lists, options)
     end
 
     # Build parent-child relationships
     rule_children = {}
     rules.each do |rule|
-      next unless rule.parent_rule_id
+      next unless rule.is_a?(Rule) && rule.parent_rule_id
 
       parent_id = rule.parent_rule_id.is_a?(Integer) ? rule.parent_rule_id : rule.parent_rule_id.to_i
       rule_children[parent_id] ||= []
@@ -83,7 +97,7 @@ module Cataract
 
     rules.each do |rule|
       # Skip rules that have a parent (they'll be serialized as nested)
-      next if rule.parent_rule_id
+      next if rule.is_a?(Rule) && rule.parent_rule_id
 
       rule_media_query_id = rule.is_a?(Rule) ? rule.media_query_id : nil
       rule_media_query = rule_media_query_id ? media_queries[rule_media_query_id] : nil
@@ -134,7 +148,7 @@ module Cataract
   end
 
   # Helper: serialize rules without nesting support (compact format)
-  def self._stylesheet_to_s_without_nesting(rules, result, selector_lists, media_queries = [], media_query_lists = {})
+  def self._stylesheet_to_s_without_nesting(rules, result, selector_lists, media_queries = [], media_query_lists = {}, options = nil)
     _serialize_stylesheet_with_grouping(
       rules: rules,
       result: result,
@@ -146,12 +160,22 @@ module Cataract
       media_indent: '',
       decl_indent_base: nil,
       decl_indent_media: nil,
-      add_blank_lines: false
+      add_blank_lines: false,
+      consolidate_media: options ? options[:consolidate_media] : false,
+      compression_order: options ? options[:compression_order] : false,
+      rule_ids: options ? options[:rule_ids] : nil,
+      sink: options ? options[:sink] : nil,
+      chunk_size: (options && options[:chunk_size]) || SERIALIZE_CHUNK_SIZE
     )
   end
 
   # Helper: serialize a rule with its nested children
   def self._serialize_rule_with_nesting(result, rule, rule_children, media_queries)
+    if rule.is_a?(AtRule)
+      _serialize_at_rule(result, rule)
+      return
+    end
+
     # Start selector
     result << "#{rule.selector} { "
 
@@ -261,7 +285,7 @@ module Cataract
 
   # Helper: find all selectors from same list with matching declarations
   # Returns array of selectors that can be grouped, marks rules as processed
-  def self._find_groupable_selectors(rule:, rules:, selector_lists:, processed_rule_ids:, current_media_query_id:)
+  def self._find_groupable_selectors(rule:, rules:, selector_lists:, processed_rule_ids:, current_media_query_id:, allowed_rule_ids: nil, rule_positions: nil)
     list_id = rule.selector_list_id
     rule_ids_in_list = selector_lists[list_id]
 
@@ -274,10 +298,12 @@ module Cataract
     # Find all rules in this list that have identical declarations AND same media context
     matching_selectors = []
     rule_ids_in_list.each do |rid|
-      # Direct array access (O(1)) - rules[i].id == i invariant is guaranteed by parser
-      other_rule = rules[rid]
-      next unless other_rule
+      pos = _rule_position(rules, rule_positions, rid)
+      next unless pos
+
+      other_rule = rules[pos]
       next if processed_rule_ids[rid]
+      next if allowed_rule_ids && !allowed_rule_ids[rid]
 
       # Check same media context (compare media_query_id directly)
       next if other_rule.media_query_id != current_media_query_id
@@ -292,6 +318,25 @@ module Cataract
     matching_selectors
   end
 
+  # Build rule id => position map for rules, or nil when every rule's id is its position.
+  # Ids and positions drift apart when @import statements take ids from the same
+  # counter (unresolved imports) or rules have been removed.
+  def self._rule_position_map(rules)
+    return nil if rules.each_with_index.all? { |rule, i| rule.id == i }
+
+    positions = {}
+    rules.each_with_index { |rule, i| positions[rule.id] = i }
+    positions
+  end
+
+  # Position of rule_id in rules (see _rule_position_map), or nil if absent
+  def self._rule_position(rules, positions, rule_id)
+    return positions[rule_id] if positions
+    return nil unless rule_id.is_a?(Integer) && rule_id >= 0 && rule_id < rules.length
+
+    rule_id
+  end
+
   # Private shared implementation for stylesheet serialization with optional selector list grouping
   # All formatting behavior controlled by kwargs to avoid mode flags and if/else branches
   def self._serialize_stylesheet_with_grouping(
@@ -305,7 +350,12 @@ module Cataract
     decl_indent_media:,  # nil (compact) vs '    ' (formatted media rules)
     add_blank_lines:,    # false (compact) vs true (formatted)
     media_queries: [],   # Array of MediaQuery objects
-    media_query_lists: {} # Hash: list_id => array of MediaQuery IDs
+    media_query_lists: {}, # Hash: list_id => array of MediaQuery IDs
+    consolidate_media: false, # Hoist media rules into earlier identical @media blocks when cascade-safe
+    compression_order: false, # Sort declarations and cluster similar rules when cascade-safe
+    rule_ids: nil,       # Subset of rule ids to serialize (ascending), or nil for all rules
+    sink: nil,           # Object responding to #write that receives output in chunks
+    chunk_size: SERIALIZE_CHUNK_SIZE # Flush to sink once result reaches this many bytes
   )
     grouping_enabled = selector_lists && !selector_lists.empty?
 
@@ -318,13 +368,50 @@ module Cataract
     # Track processed rules to avoid duplicates when grouping
     processed_rule_ids = {}
 
+    # Rule ids are not always positions in rules (see _rule_position_map)
+    rule_positions = _rule_position_map(rules)
+
+    # Optional subset of rules (e.g. from StylesheetScope). rules stays complete so
+    # selector list members can still be looked up; the ids become a rule_order of
+    # positions, and allowed_rule_ids stops selector list grouping from pulling in
+    # rules outside the subset.
+    rule_order = nil
+    allowed_rule_ids = nil
+    if rule_ids
+      rule_order = []
+      allowed_rule_ids = {}
+      rule_ids.each do |id|
+        pos = _rule_position(rules, rule_positions, id)
+        raise ArgumentError, "rule_ids contains invalid rule id: #{id.inspect}" unless pos
+
+        rule_order << pos
+        allowed_rule_ids[id] = true
+      end
+    end
+
+    # Optional emit order that moves media rules into earlier identical @media blocks
+    if consolidate_media
+      rule_order = MediaConsolidation.rule_order(rules, rule_order, media_queries, media_query_lists, mq_id_to_list_id) || rule_order
+    end
+
+    # Optional canonical declaration order and clustering of similar rules
+    # (see compression_order.rb). Sorted rules are copies; the stylesheet is untouched.
+    if compression_order
+      rules = CompressionOrder.sorted_rules(rules, rule_order)
+      rule_order = CompressionOrder.rule_order(rules, rule_order, grouping_enabled ? selector_lists : nil) || rule_order
+    end
+    ordered_rules = rule_order ? rule_order.map { |idx| rules[idx] } : rules
+
     # Iterate through rules in insertion order, grouping consecutive media queries
     current_media_query_list_id = nil
     current_media_query = nil
     in_media_block = false
     rule_index = 0
 
-    rules.each do |rule|
+    ordered_rules.each do |rule|
+      # Stream completed rules out before starting the next one
+      _flush_to_sink(result, sink, chunk_size) if sink
+
       # Skip if already processed (when grouped)
       next if processed_rule_ids[rule.id]
 
@@ -352,7 +439,9 @@ module Cataract
             rules: rules,
             selector_lists: selector_lists,
             processed_rule_ids: processed_rule_ids,
-            current_media_query_id: rule_media_query_id
+            current_media_query_id: rule_media_query_id,
+            allowed_rule_ids: allowed_rule_ids,
+            rule_positions: rule_positions
           )
 
           # Serialize with grouped selectors
@@ -410,7 +499,9 @@ module Cataract
             rules: rules,
             selector_lists: selector_lists,
             processed_rule_ids: processed_rule_ids,
-            current_media_query_id: rule_media_query_id
+            current_media_query_id: rule_media_query_id,
+            allowed_rule_ids: allowed_rule_ids,
+            rule_positions: rule_positions
           )
 
           # Serialize with grouped selectors (with media indent)
@@ -531,8 +622,9 @@ module Cataract
   # @param selector_lists [Hash] Selector list ID => array of rule IDs (for grouping)
   # @param media_queries [Array<MediaQuery>] Array of MediaQuery objects (optional, for proper serialization)
   # @param media_query_lists [Hash] List ID => array of MediaQuery IDs (optional, for comma-separated queries)
+  # @param options [Hash, nil] Serialization options (e.g. { consolidate_media: true })
   # @return [String] Formatted CSS string
-  def self.stylesheet_to_formatted_s(rules, charset, has_nesting, selector_lists = {}, media_queries = [], media_query_lists = {})
+  def self.stylesheet_to_formatted_s(rules, charset, has_nesting, selector_lists = {}, media_queries = [], media_query_lists = {}, options = nil)
     result = +''
 
     # Add @charset if present
@@ -542,13 +634,13 @@ module Cataract
 
     # Fast path: no nesting - use simple algorithm
     unless has_nesting
-      return _stylesheet_to_formatted_s_without_nesting(rules, result, selector_lists, media_queries, media_query_lists)
+      return _stylesheet_to_formatted_s_without_nesting(rules, result, selector_lists, media_queries, media_query_lists, options)
     end
 
     # Build parent-child relationships
     rule_children = {}
     rules.each do |rule|
-      next unless rule.parent_rule_id
+      next unless rule.is_a?(Rule) && rule.parent_rule_id
 
       parent_id = rule.parent_rule_id.is_a?(Integer) ? rule.parent_rule_id : rule.parent_rule_id.to_i
       rule_children[parent_id] ||= []
@@ -567,7 +659,7 @@ module Cataract
     in_media_block = false
 
     rules.each do |rule|
-      next if rule.parent_rule_id
+      next if rule.is_a?(Rule) && rule.parent_rule_id
 
       rule_media_query_id = rule.is_a?(Rule) ? rule.media_query_id : nil
       rule_media_query = rule_media_query_id ? media_queries[rule_media_query_id] : nil
@@ -622,7 +714,7 @@ module Cataract
   end
 
   # Helper: formatted serialization without nesting support
-  def self._stylesheet_to_formatted_s_without_nesting(rules, result, selector_lists, media_queries = [], media_query_lists = {})
+  def self._stylesheet_to_formatted_s_without_nesting(rules, result, selector_lists, media_queries = [], media_query_lists = {}, options = nil)
     _serialize_stylesheet_with_grouping(
       rules: rules,
       result: result,
@@ -634,12 +726,23 @@ module Cataract
       media_indent: '  ',
       decl_indent_base: '  ',
       decl_indent_media: '    ',
-      add_blank_lines: true
+      add_blank_lines: true,
+      consolidate_media: options ? options[:consolidate_media] : false,
+      compression_order: options ? options[:compression_order] : false,
+      rule_ids: options ? options[:rule_ids] : nil,
+      sink: options ? options[:sink] : nil,
+      chunk_size: (options && options[:chunk_size]) || SERIALIZE_CHUNK_SIZE
     )
   end
 
   # Helper: serialize a rule with nested children (formatted)
   def self._serialize_rule_with_nesting_formatted(result, rule, rule_children, indent, media_queries)
+    # AtRules are written compact here, same as the native nesting path
+    if rule.is_a?(AtRule)
+      _serialize_at_rule(result, rule)
+      return
+    end
+
     # Selector line with opening brace
     result << indent
     result << rule.selector
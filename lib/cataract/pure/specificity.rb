@@ -13,6 +13,8 @@ module Cataract
   # - Count IDs (#id) - each worth 100
   # - Count classes/attributes/pseudo-classes (.class, [attr], :pseudo) - each worth 10
   # - Count elements/pseudo-elements (div, ::before) - each worth 1
+  # - :is()/:not()/:has()/:matches() take their most specific argument
+  # - :where() and its arguments count nothing
   def self.calculate_specificity(selector)
     return 0 if selector.nil? || selector.empty?
 
@@ -23,6 +25,7 @@ module Cataract
     pseudo_class_count = 0
     pseudo_element_count = 0
     element_count = 0
+    argument_specificity = 0
 
     i = 0
     len = selector.length
@@ -103,69 +106,42 @@ module Cataract
           is_legacy_pseudo_element = pseudo_element_kwords.include?(pseudo_name)
         end
 
-        # Check for :not() - it doesn't count itself, but its content does
-        is_not = (pseudo_name == 'not')
+        # :is()/:not()/:has() take their most specific argument, :where() counts nothing
+        is_where = (pseudo_name == 'where')
+        takes_argument = SELECTOR_ARGUMENT_PSEUDOS.include?(pseudo_name)
 
         # Skip function arguments if present
         if i < len && selector.getbyte(i) == BYTE_LPAREN
           i += 1
           paren_depth = 1
-
-          # If it's :not(), calculate specificity of the content
-          if is_not
-            not_content_start = i
-
-            # Find closing paren
-            while i < len && paren_depth > 0
-              b = selector.getbyte(i)
-              if b == BYTE_LPAREN
-                paren_depth += 1
-              elsif b == BYTE_RPAREN
-                paren_depth -= 1
-              end
-              i += 1 if paren_depth > 0
-            end
-
-            not_content = selector[not_content_start...i]
-
-            # Recursively calculate specificity of :not() content
-            unless not_content.empty?
-              not_specificity = calculate_specificity(not_content)
-
-              # Add :not() content's specificity to our counts
-              additional_a = not_specificity / 100
-              additional_b = (not_specificity % 100) / 10
-              additional_c = not_specificity % 10
-
-              id_count += additional_a
-              class_count += additional_b
-              element_count += additional_c
+          args_start = i
+
+          # Find closing paren
+          while i < len && paren_depth > 0
+            b = selector.getbyte(i)
+            if b == BYTE_LPAREN
+              paren_depth += 1
+            elsif b == BYTE_RPAREN
+              paren_depth -= 1
             end
+            i += 1 if paren_depth > 0
+          end
 
-            i += 1 # Skip closing paren
+          if takes_argument
+            argument_specificity += max_argument_specificity(selector, args_start, i)
+          elsif is_where
+            # Zero specificity
+          elsif is_pseudo_element || is_legacy_pseudo_element
+            pseudo_element_count += 1
           else
-            # Skip other function arguments
-            while i < len && paren_depth > 0
-              b = selector.getbyte(i)
-              if b == BYTE_LPAREN
-                paren_depth += 1
-              elsif b == BYTE_RPAREN
-                paren_depth -= 1
-              end
-              i += 1
-            end
-
-            # Count the pseudo-class/element
-            if is_pseudo_element || is_legacy_pseudo_element
-              pseudo_element_count += 1
-            else
-              pseudo_class_count += 1
-            end
+            pseudo_class_count += 1
           end
+
+          i += 1 if i < len # Skip closing paren
         else
           # No function arguments - count the pseudo-class/element
-          if is_not
-            # :not without parens is invalid, but don't count it
+          if takes_argument || is_where
+            # :not/:is/:where without parens is invalid, but don't count it
           elsif is_pseudo_element || is_legacy_pseudo_element
             pseudo_element_count += 1
           else
@@ -199,8 +175,40 @@ module Cataract
     # Calculate specificity using W3C formula
     specificity = (id_count * 100) +
                   ((class_count + attr_count + pseudo_class_count) * 10) +
-                  ((element_count + pseudo_element_count) * 1)
+                  ((element_count + pseudo_element_count) * 1) +
+                  argument_specificity
 
     specificity
   end
+
+  # Pseudo-classes whose specificity is that of their most specific argument
+  SELECTOR_ARGUMENT_PSEUDOS = %w[is not has matches].freeze
+
+  # Specificity of the most specific selector in a comma-separated argument list
+  #
+  # @api private
+  def self.max_argument_specificity(selector, start, finish)
+    max = 0
+    depth = 0
+    arg_start = start
+    i = start
+
+    while i <= finish
+      b = i < finish ? selector.getbyte(i) : nil
+      if b == BYTE_LPAREN || b == BYTE_LBRACKET
+        depth += 1
+      elsif b == BYTE_RPAREN || b == BYTE_RBRACKET
+        depth -= 1
+      elsif b.nil? || (b == BYTE_COMMA && depth == 0)
+        if i > arg_start
+          spec = calculate_specificity(selector.byteslice(arg_start, i - arg_start))
+          max = spec if spec > max
+        end
+        arg_start = i + 1
+      end
+      i += 1
+    end
+
+    max
+  end
 end
@@ -0,0 +1,524 @@
+# frozen_string_literal: true
+
+# Pure Ruby CSS Syntax Level 3 tokenizer - mirrors ext/cataract/tokenizer.c
+# NO REGEXP ALLOWED - byte-by-byte parsing only
+#
+# Provides Cataract.each_token and Cataract::TokenStream when the C extension
+# isn't loaded. See the C file for the token model and spec deviations.
+
+module Cataract
+  # @api private
+  module Tokenizer
+    SINGLE_CHAR_TYPES = {
+      BYTE_LPAREN => :left_paren, BYTE_RPAREN => :right_paren,
+      BYTE_LBRACKET => :left_square, BYTE_RBRACKET => :right_square,
+      BYTE_LBRACE => :left_brace, BYTE_RBRACE => :right_brace,
+      BYTE_COMMA => :comma, BYTE_COLON => :colon, BYTE_SEMICOLON => :semicolon
+    }.freeze
+
+    BYTE_FF = 12       # '\f'
+    BYTE_LT = 60       # '<'
+    BYTE_LOWER_E = 101 # 'e'
+    BYTE_UPPER_E = 69  # 'E'
+    BYTE_LOWER_F = 102 # 'f'
+    BYTE_UPPER_F = 70  # 'F'
+
+    # A token: type, byte offset, byte length, number length (numeric only), integer flag
+    Token = Struct.new(:type, :offset, :length, :num_len, :integer)
+
+    module_function
+
+    def newline?(c)
+      c == BYTE_NEWLINE || c == BYTE_CR || c == BYTE_FF
+    end
+
+    def whitespace?(c)
+      c == BYTE_SPACE || c == BYTE_TAB || newline?(c)
+    end
+
+    def digit?(c)
+      !c.nil? && c >= BYTE_DIGIT_0 && c <= BYTE_DIGIT_9
+    end
+
+    def hex?(c)
+      digit?(c) || (!c.nil? && ((c >= BYTE_LOWER_A && c <= BYTE_LOWER_F) || (c >= BYTE_UPPER_A && c <= BYTE_UPPER_F)))
+    end
+
+    def ident_start?(c)
+      !c.nil? && ((c >= BYTE_LOWER_A && c <= BYTE_LOWER_Z) || (c >= BYTE_UPPER_A && c <= BYTE_UPPER_Z) ||
+                  c == BYTE_UNDERSCORE || c >= 0x80 || c == 0)
+    end
+
+    def ident?(c)
+      ident_start?(c) || digit?(c) || c == BYTE_HYPHEN
+    end
+
+    def non_printable?(c)
+      (c >= 0x01 && c <= 0x08) || c == 0x0B || (c >= 0x0E && c <= 0x1F) || c == 0x7F
+    end
+
+    def valid_escape?(c1, c2)
+      c1 == BYTE_BACKSLASH && !newline?(c2)
+    end
+
+    def starts_ident?(c1, c2, c3)
+      return ident_start?(c2) || c2 == BYTE_HYPHEN || valid_escape?(c2, c3) if c1 == BYTE_HYPHEN
+      return true if ident_start?(c1)
+
+      c1 == BYTE_BACKSLASH && valid_escape?(c1, c2)
+    end
+
+    def starts_number?(c1, c2, c3)
+      return digit?(c2) || (c2 == BYTE_DOT && digit?(c3)) if c1 == BYTE_PLUS || c1 == BYTE_HYPHEN
+      return digit?(c2) if c1 == BYTE_DOT
+
+      digit?(c1)
+    end
+
+    def utf8_len(c)
+      if c < 0x80 then 1
+      elsif c >= 0xF0 then 4
+      elsif c >= 0xE0 then 3
+      elsif c >= 0xC0 then 2
+      else 1
+      end
+    end
+
+    # Escape body: p points just past the backslash
+    def consume_escape(s, len, p)
+      return p if p >= len
+
+      if hex?(s.getbyte(p))
+        stop = p + 1
+        stop += 1 while stop < len && stop - p < 6 && hex?(s.getbyte(stop))
+        if stop < len && whitespace?(s.getbyte(stop))
+          stop += s.getbyte(stop) == BYTE_CR && stop + 1 < len && s.getbyte(stop + 1) == BYTE_NEWLINE ? 2 : 1
+        end
+        return stop
+      end
+
+      stop = p + utf8_len(s.getbyte(p))
+      stop > len ? len : stop
+    end
+
+    def consume_ident_sequence(s, len, p)
+      while p < len
+        c = s.getbyte(p)
+        if ident?(c)
+          p += 1
+        elsif valid_escape?(c, s.getbyte(p + 1))
+          p = consume_escape(s, len, p + 1)
+        else
+          break
+        end
+      end
+      p
+    end
+
+    # Returns [position after the number, integer?]
+    def consume_number(s, len, p)
+      integer = true
+      p += 1 if p < len && (s.getbyte(p) == BYTE_PLUS || s.getbyte(p) == BYTE_HYPHEN)
+      p += 1 while p < len && digit?(s.getbyte(p))
+
+      if p + 1 < len && s.getbyte(p) == BYTE_DOT && digit?(s.getbyte(p + 1))
+        p += 2
+        p += 1 while p < len && digit?(s.getbyte(p))
+        integer = false
+      end
+
+      if p + 1 < len && (s.getbyte(p) == BYTE_LOWER_E || s.getbyte(p) == BYTE_UPPER_E)
+        c2 = s.getbyte(p + 1)
+        if digit?(c2)
+          p += 2
+        elsif (c2 == BYTE_PLUS || c2 == BYTE_HYPHEN) && digit?(s.getbyte(p + 2))
+          p += 3
+        else
+          return [p, integer]
+        end
+        p += 1 while p < len && digit?(s.getbyte(p))
+        integer = false
+      end
+      [p, integer]
+    end
+
+    def consume_bad_url_remnants(s, len, p)
+      while p < len
+        c = s.getbyte(p)
+        return p + 1 if c == BYTE_RPAREN
+
+        if valid_escape?(c, s.getbyte(p + 1))
+          p = consume_escape(s, len, p + 1)
+        else
+          p += 1
+        end
+      end
+      p
+    end
+
+    # p points just past "url(" and any whitespace. Returns [type, position]
+    def consume_url(s, len, p)
+      while p < len
+        c = s.getbyte(p)
+        return [:url, p + 1] if c == BYTE_RPAREN
+
+        if whitespace?(c)
+          p += 1 while p < len && whitespace?(s.getbyte(p))
+          return [:url, p] if p >= len
+          return [:url, p + 1] if s.getbyte(p) == BYTE_RPAREN
+
+          return [:bad_url, consume_bad_url_remnants(s, len, p)]
+        end
+        if c == BYTE_DQUOTE || c == BYTE_SQUOTE || c == BYTE_LPAREN || non_printable?(c)
+          return [:bad_url, consume_bad_url_remnants(s, len, p + 1)]
+        end
+
+        if c == BYTE_BACKSLASH
+          if valid_escape?(c, s.getbyte(p + 1))
+            p = consume_escape(s, len, p + 1)
+            next
+          end
+          return [:bad_url, consume_bad_url_remnants(s, len, p + 1)]
+        end
+        p += 1
+      end
+      [:url, p]
+    end
+
+    # Returns [type, position]
+    def consume_ident_like(s, len, start)
+      p = consume_ident_sequence(s, len, start)
+
+      if p < len && s.getbyte(p) == BYTE_LPAREN
+        if p - start == 3 &&
+           (s.getbyte(start) | 0x20) == BYTE_LOWER_U &&
+           (s.getbyte(start + 1) | 0x20) == BYTE_LOWER_R &&
+           (s.getbyte(start + 2) | 0x20) == BYTE_LOWER_L
+          p += 1
+          p += 1 while p + 1 < len && whitespace?(s.getbyte(p)) && whitespace?(s.getbyte(p + 1))
+
+          c1 = s.getbyte(p)
+          c2 = s.getbyte(p + 1)
+          if c1 == BYTE_DQUOTE || c1 == BYTE_SQUOTE || (whitespace?(c1) && (c2 == BYTE_DQUOTE || c2 == BYTE_SQUOTE))
+            return [:function, p]
+          end
+
+          p += 1 while p < len && whitespace?(s.getbyte(p))
+          return consume_url(s, len, p)
+        end
+        return [:function, p + 1]
+      end
+
+      [:ident, p]
+    end
+
+    def consume_numeric(s, len, start, tok)
+      p, integer = consume_number(s, len, start)
+      tok.num_len = p - start
+      tok.integer = integer
+
+      if starts_ident?(s.getbyte(p), s.getbyte(p + 1), s.getbyte(p + 2))
+        tok.type = :dimension
+        return consume_ident_sequence(s, len, p)
+      end
+      if p < len && s.getbyte(p) == BYTE_PERCENT
+        tok.type = :percentage
+        return p + 1
+      end
+      tok.type = :number
+      p
+    end
+
+    # Returns [type, position]
+    def consume_string(s, len, p, quote)
+      while p < len
+        c = s.getbyte(p)
+        return [:string, p + 1] if c == quote
+        return [:bad_string, p] if newline?(c) # Newline is not part of the token
+
+        if c == BYTE_BACKSLASH
+          return [:string, p + 1] if p + 1 >= len
+
+          n = s.getbyte(p + 1)
+          p = if newline?(n)
+                p + (n == BYTE_CR && p + 2 < len && s.getbyte(p + 2) == BYTE_NEWLINE ? 3 : 2)
+              else
+                consume_escape(s, len, p + 1)
+              end
+          next
+        end
+        p += 1
+      end
+      [:string, p]
+    end
+
+    # Consume one token at pos, or nil at EOF
+    def next_token(s, len, pos)
+      return nil if pos >= len
+
+      p = pos
+      c = s.getbyte(p)
+      c1 = s.getbyte(p + 1)
+      c2 = s.getbyte(p + 2)
+      tok = Token.new(nil, pos, 0, 0, false)
+
+      if c == BYTE_SLASH && c1 == BYTE_STAR
+        p += 2
+        p += 1 while p + 1 < len && !(s.getbyte(p) == BYTE_STAR && s.getbyte(p + 1) == BYTE_SLASH)
+        p = p + 1 < len ? p + 2 : len
+        tok.type = :comment
+      elsif whitespace?(c)
+        p += 1 while p < len && whitespace?(s.getbyte(p))
+        tok.type = :whitespace
+      elsif c == BYTE_DQUOTE || c == BYTE_SQUOTE
+        tok.type, p = consume_string(s, len, p + 1, c)
+      elsif c == BYTE_HASH
+        if ident?(c1) || valid_escape?(c1, c2)
+          p = consume_ident_sequence(s, len, p + 1)
+          tok.type = :hash
+        else
+          p += 1
+          tok.type = :delim
+        end
+      elsif c == BYTE_PLUS || c == BYTE_DOT
+        if starts_number?(c, c1, c2)
+          p = consume_numeric(s, len, p, tok)
+        else
+          p += 1
+          tok.type = :delim
+        end
+      elsif c == BYTE_HYPHEN
+        if starts_number?(c, c1, c2)
+          p = consume_numeric(s, len, p, tok)
+        elsif c1 == BYTE_HYPHEN && c2 == BYTE_GT
+          p += 3
+          tok.type = :cdc
+        elsif starts_ident?(c, c1, c2)
+          tok.type, p = consume_ident_like(s, len, p)
+        else
+          p += 1
+          tok.type = :delim
+        end
+      elsif c == BYTE_LT
+        if c1 == BYTE_BANG && c2 == BYTE_HYPHEN && s.getbyte(p + 3) == BYTE_HYPHEN
+          p += 4
+          tok.type = :cdo
+        else
+          p += 1
+          tok.type = :delim
+        end
+      elsif c == BYTE_AT
+        if starts_ident?(c1, c2, s.getbyte(p + 3))
+          p = consume_ident_sequence(s, len, p + 1)
+          tok.type = :at_keyword
+        else
+          p += 1
+          tok.type = :delim
+        end
+      elsif c == BYTE_BACKSLASH
+        if valid_escape?(c, c1)
+          tok.type, p = consume_ident_like(s, len, p)
+        else
+          p += 1
+          tok.type = :delim
+        end
+      elsif digit?(c)
+        p = consume_numeric(s, len, p, tok)
+      elsif ident_start?(c)
+        tok.type, p = consume_ident_like(s, len, p)
+      else
+        p += 1
+        tok.type = SINGLE_CHAR_TYPES.fetch(c, :delim)
+      end
+
+      tok.length = p - pos
+      tok
+    end
+
+    # Tokenize source, yielding each Token (comments dropped unless requested)
+    def tokenize(source, comments)
+      len = source.bytesize
+      pos = 0
+      while (tok = next_token(source, len, pos))
+        pos = tok.offset + tok.length
+        next if tok.type == :comment && !comments
+
+        yield tok
+      end
+    end
+
+    def number(source, tok)
+      return nil if tok.num_len.zero?
+
+      text = source.byteslice(tok.offset, tok.num_len)
+      tok.integer ? Integer(text, 10) : Float(text)
+    end
+
+    def unit(source, tok)
+      case tok.type
+      when :percentage then -'%'
+      when :dimension then -source.byteslice(tok.offset + tok.num_len, tok.length - tok.num_len)
+      end
+    end
+
+    def record(source, tok)
+      [tok.type, tok.offset, tok.length, number(source, tok), unit(source, tok)]
+    end
+
+    def append_code_point(buf, cp)
+      cp = 0xFFFD if cp.zero? || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF
+      buf << [cp].pack('U').force_encoding(buf.encoding)
+    end
+
+    # Decode escapes from p up to stop; see decode_value in tokenizer.c
+    def decode_value(s, p, stop, mode, quote)
+      buf = String.new(encoding: s.encoding)
+      run = p
+
+      while p < stop
+        c = s.getbyte(p)
+
+        if c == BYTE_BACKSLASH
+          buf << s.byteslice(run, p - run)
+          n = s.getbyte(p + 1)
+          if p + 1 >= stop
+            # Escape at EOF: ident/url get U+FFFD, strings drop it
+            append_code_point(buf, 0xFFFD) unless mode == :string
+            p = stop
+          elsif newline?(n)
+            break unless mode == :string
+
+            p += n == BYTE_CR && p + 2 < stop && s.getbyte(p + 2) == BYTE_NEWLINE ? 3 : 2
+          elsif hex?(n)
+            cp = 0
+            q = p + 1
+            while q < stop && q - (p + 1) < 6 && hex?(s.getbyte(q))
+              h = s.getbyte(q)
+              cp = (cp * 16) + (digit?(h) ? h - BYTE_DIGIT_0 : (h | 0x20) - BYTE_LOWER_A + 10)
+              q += 1
+            end
+            if q < stop && whitespace?(s.getbyte(q))
+              q += s.getbyte(q) == BYTE_CR && q + 1 < stop && s.getbyte(q + 1) == BYTE_NEWLINE ? 2 : 1
+            end
+            append_code_point(buf, cp)
+            p = q
+          else
+            n_len = utf8_len(n)
+            n_len = stop - p - 1 if p + 1 + n_len > stop
+            buf << s.byteslice(p + 1, n_len)
+            p += 1 + n_len
+          end
+          run = p
+          next
+        end
+
+        break if mode == :ident && !ident?(c)
+        break if mode == :string && c == quote
+        break if mode == :url && (c == BYTE_RPAREN || whitespace?(c))
+
+        p += 1
+      end
+      buf << s.byteslice(run, p - run) if p > run
+      buf
+    end
+
+    def value(source, tok)
+      start = tok.offset
+      stop = tok.offset + tok.length
+
+      case tok.type
+      when :ident, :function
+        decode_value(source, start, stop, :ident, nil)
+      when :at_keyword, :hash
+        decode_value(source, start + 1, stop, :ident, nil)
+      when :string
+        decode_value(source, start + 1, stop, :string, source.getbyte(start))
+      when :url
+        p = start
+        p += 1 while p < stop && source.getbyte(p) != BYTE_LPAREN
+        p += 1
+        p += 1 while p < stop && whitespace?(source.getbyte(p))
+        decode_value(source, p, stop, :url, nil)
+      when :delim
+        source.byteslice(start, tok.length)
+      end
+    end
+  end
+
+  # Stream CSS Syntax Level 3 tokens (pure Ruby version)
+  #
+  # @param css [String] CSS source
+  # @param comments [Boolean] Emit :comment tokens
+  # @yield [type, offset, length, number, unit]
+  # @return [nil, Enumerator]
+  def self.each_token(css, comments: false)
+    return enum_for(:each_token, css, comments: comments) unless block_given?
+    raise TypeError, "wrong argument type #{css.class} (expected String)" unless css.is_a?(String)
+
+    source = css.frozen? ? css : css.dup.freeze
+    Tokenizer.tokenize(source, comments) do |tok|
+      yield(*Tokenizer.record(source, tok))
+    end
+    nil
+  end
+
+  # Pure Ruby TokenStream - see lib/cataract/token_stream.rb for the API
+  class TokenStream
+    attr_reader :source
+
+    def initialize(css, comments: false)
+      raise TypeError, "wrong argument type #{css.class} (expected String)" unless css.is_a?(String)
+
+      @source = css.frozen? ? css : css.dup.freeze
+      @tokens = []
+      Tokenizer.tokenize(@source, comments) { |tok| @tokens << tok }
+    end
+
+    def size
+      @tokens.size
+    end
+
+    def each
+      return enum_for(:each) { size } unless block_given?
+
+      @tokens.each { |tok| yield Tokenizer.record(@source, tok) }
+      self
+    end
+
+    def [](index)
+      Tokenizer.record(@source, token_at(index))
+    end
+
+    def type(index)
+      token_at(index).type
+    end
+
+    def number(index)
+      Tokenizer.number(@source, token_at(index))
+    end
+
+    def unit(index)
+      Tokenizer.unit(@source, token_at(index))
+    end
+
+    def text(index)
+      tok = token_at(index)
+      @source.byteslice(tok.offset, tok.length)
+    end
+
+    def value(index)
+      Tokenizer.value(@source, token_at(index))
+    end
+
+    private
+
+    def token_at(index)
+      i = index < 0 ? index + @tokens.size : index
+      if i < 0 || i >= @tokens.size
+        raise IndexError, "index #{index} outside of token stream (size #{@tokens.size})"
+      end
+
+      @tokens[i]
+    end
+  end
+end
@@ -0,0 +1,240 @@
+# frozen_string_literal: true
+
+# Pure Ruby url() extraction and mapping - mirrors ext/cataract/url_rewriter.c
+# NO REGEXP ALLOWED - byte-by-byte parsing only
+#
+# @api private
+# Finds url(...) tokens in declaration values with the same rules as the
+# parser's URL resolution, and rewrites them through a Hash lookup.
+
+module Cataract
+  module UrlRewriter
+    # Find the next url() token at or after pos.
+    #
+    # @return [Array(Integer, Integer, Integer, Integer), nil]
+    #   [url_start, url_end, quote byte (or nil), position after the token]
+    def self.next_url_token(value, len, pos)
+      while pos + 3 < len
+        byte = value.getbyte(pos)
+
+        # Skip "..." and '...' strings
+        if byte == BYTE_DQUOTE || byte == BYTE_SQUOTE
+          pos += 1
+          while pos < len && value.getbyte(pos) != byte
+            pos += value.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < len ? 2 : 1
+          end
+          pos += 1
+          next
+        end
+
+        break if (byte == BYTE_LOWER_U || byte == BYTE_UPPER_U) &&
+                 (value.getbyte(pos + 1) == BYTE_LOWER_R || value.getbyte(pos + 1) == BYTE_UPPER_R) &&
+                 (value.getbyte(pos + 2) == BYTE_LOWER_L || value.getbyte(pos + 2) == BYTE_UPPER_L) &&
+                 value.getbyte(pos + 3) == BYTE_LPAREN &&
+                 (pos == 0 || !name_byte?(value.getbyte(pos - 1)))
+
+        pos += 1
+      end
+      return nil if pos + 3 >= len
+
+      pos += 4
+      pos += 1 while pos < len && whitespace?(value.getbyte(pos))
+
+      quote = nil
+      if pos < len && (value.getbyte(pos) == BYTE_SQUOTE || value.getbyte(pos) == BYTE_DQUOTE)
+        quote = value.getbyte(pos)
+        pos += 1
+      end
+
+      url_start = pos
+      if quote
+        while pos < len && value.getbyte(pos) != quote
+          pos += value.getbyte(pos) == BYTE_BACKSLASH && pos + 1 < len ? 2 : 1
+        end
+      else
+        while pos < len
+          byte = value.getbyte(pos)
+          break if byte == BYTE_RPAREN || whitespace?(byte)
+
+          pos += 1
+        end
+      end
+      url_end = pos
+
+      pos += 1 if quote && pos < len && value.getbyte(pos) == quote
+      pos += 1 while pos < len && whitespace?(value.getbyte(pos))
+      pos += 1 if pos < len && value.getbyte(pos) == BYTE_RPAREN
+
+      [url_start, url_end, quote, pos]
+    end
+
+    def self.extract(rules, imports)
+      result = []
+
+      imports&.each do |import|
+        url = import.url
+        next unless url.is_a?(String) && !url.empty?
+
+        result << UrlReference.new(url, import.id, nil, nil, nil)
+      end
+
+      rules.each do |rule|
+        if rule.at_rule?
+          content = rule.content
+          next unless content.is_a?(Array)
+
+          extract_declarations(result, content, rule.id, nil)
+          content.each_with_index do |block, j|
+            extract_declarations(result, block.declarations, rule.id, j) if block.is_a?(Rule)
+          end
+        else
+          extract_declarations(result, rule.declarations, rule.id, nil)
+        end
+      end
+
+      result
+    end
+
+    def self.extract_declarations(result, declarations, rule_id, block_index)
+      return unless declarations.is_a?(Array)
+
+      declarations.each_with_index do |decl, i|
+        next unless decl.is_a?(Declaration)
+
+        value = decl.value
+        next unless value.is_a?(String)
+
+        len = value.bytesize
+        pos = 0
+        while (tok = next_url_token(value, len, pos))
+          url_start, url_end, _quote, pos = tok
+          next if url_end == url_start
+
+          url = value.byteslice(url_start, url_end - url_start)
+          result << UrlReference.new(url, rule_id, decl.property, i, block_index)
+        end
+      end
+    end
+
+    def self.map(rules, imports, mapping)
+      return 0 if mapping.empty?
+
+      replaced = 0
+
+      imports&.each do |import|
+        url = import.url
+        next unless url.is_a?(String)
+
+        replacement = lookup(mapping, url)
+        next unless replacement
+
+        import.url = replacement.dup
+        replaced += 1
+      end
+
+      rules.each do |rule|
+        if rule.at_rule?
+          content = rule.content
+          next unless content.is_a?(Array)
+
+          replaced += map_declarations(content, mapping)
+          content.each do |block|
+            replaced += map_declarations(block.declarations, mapping) if block.is_a?(Rule)
+          end
+        else
+          replaced += map_declarations(rule.declarations, mapping)
+        end
+      end
+
+      replaced
+    end
+
+    def self.map_declarations(declarations, mapping)
+      replaced = 0
+      return replaced unless declarations.is_a?(Array)
+
+      declarations.each do |decl|
+        next unless decl.is_a?(Declaration)
+
+        value = decl.value
+        next unless value.is_a?(String)
+
+        result = nil
+        copied = 0
+        len = value.bytesize
+        pos = 0
+        while (tok = next_url_token(value, len, pos))
+          url_start, url_end, quote, pos = tok
+          next if url_end == url_start
+
+          replacement = lookup(mapping, value.byteslice(url_start, url_end - url_start))
+          next unless replacement
+
+          result ||= String.new(capacity: len, encoding: value.encoding)
+          if quote
+            # Replace the quoted text including its quotes
+            result << value.byteslice(copied, url_start - 1 - copied)
+            append_quoted(result, replacement, quote)
+            copied = url_end
+            copied += 1 if copied < len && value.getbyte(copied) == quote
+          else
+            result << value.byteslice(copied, url_start - copied)
+            if needs_quotes?(replacement)
+              append_quoted(result, replacement, BYTE_DQUOTE)
+            else
+              result << replacement
+            end
+            copied = url_end
+          end
+          replaced += 1
+        end
+        next unless result
+
+        result << value.byteslice(copied, len - copied)
+        decl.value = result
+      end
+      replaced
+    end
+
+    # Replacement for url, or nil when unmapped (missing, nil, or unchanged)
+    def self.lookup(mapping, url)
+      return nil unless mapping.key?(url)
+
+      replacement = mapping[url]
+      return nil if replacement.nil?
+      raise TypeError, "wrong argument type #{replacement.class} (expected String)" unless replacement.is_a?(String)
+      return nil if replacement == url
+
+      replacement
+    end
+
+    # Bytes that continue an identifier, so "myurl(" is a function, not url(
+    def self.name_byte?(byte)
+      Cataract.ident_char?(byte) || byte >= 0x80 || byte == BYTE_BACKSLASH
+    end
+
+    # Unquoted url() can't hold whitespace, quotes, parens or backslashes
+    def self.needs_quotes?(url)
+      url.each_byte do |byte|
+        return true if whitespace?(byte) || byte == BYTE_DQUOTE || byte == BYTE_SQUOTE ||
+                       byte == BYTE_LPAREN || byte == BYTE_RPAREN || byte == BYTE_BACKSLASH
+      end
+      false
+    end
+
+    # Append url in the given quote style, escaping the quote character and backslashes
+    def self.append_quoted(result, url, quote)
+      quote_chr = quote.chr
+      result << quote_chr
+      url.each_char do |char|
+        result << '\\' if char == quote_chr || char == '\\'
+        result << char
+      end
+      result << quote_chr
+    end
+
+    def self.whitespace?(byte)
+      byte == BYTE_SPACE || byte == BYTE_TAB || byte == BYTE_NEWLINE || byte == BYTE_CR
+    end
+  end
+end
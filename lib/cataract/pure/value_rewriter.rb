@@ -0,0 +1,118 @@
+# frozen_string_literal: true
+
+# Pure Ruby bulk value rewriting - mirrors ext/cataract/value_rewriter.c
+# NO REGEXP ALLOWED - byte-by-byte matching only
+#
+# @api private
+# Replaces literal substrings in declaration values. At the leftmost position
+# where any pattern starts, the longest pattern starting there is replaced and
+# scanning resumes after it. In prefix mode only the start of a value is checked.
+
+module Cataract
+  module ValueRewriter
+    # Compile patterns into first byte => [[pattern, index], ...] (longest first)
+    def self.build_table(patterns)
+      # Duplicate patterns: the last one wins, like Hash#[]=
+      latest = {}
+      patterns.each_with_index { |pattern, i| latest[pattern.b] = i }
+
+      table = {}
+      latest.each do |pattern, i|
+        (table[pattern.getbyte(0)] ||= []) << [pattern, i]
+      end
+      table.each_value { |candidates| candidates.sort_by! { |pattern, _| -pattern.bytesize } }
+      table
+    end
+
+    def self.rewrite_rules(rules, patterns, replacements, prefix, properties)
+      table = build_table(patterns)
+      changed = 0
+      rules.each do |rule|
+        if rule.at_rule?
+          content = rule.content
+          next unless content.is_a?(Array)
+
+          changed += rewrite_declarations(content, table, patterns, replacements, prefix, properties)
+          content.each do |block|
+            changed += rewrite_declarations(block.declarations, table, patterns, replacements, prefix, properties) if block.is_a?(Rule)
+          end
+        else
+          changed += rewrite_declarations(rule.declarations, table, patterns, replacements, prefix, properties)
+        end
+      end
+      changed
+    end
+
+    def self.rewrite_declarations(declarations, table, patterns, replacements, prefix, properties)
+      changed = 0
+      return changed unless declarations.is_a?(Array)
+
+      declarations.each do |decl|
+        next unless decl.is_a?(Declaration)
+        next if properties && !properties.include?(decl.property)
+
+        value = decl.value
+        next unless value.is_a?(String)
+
+        rewritten = rewrite_value(value, table, patterns, replacements, prefix)
+        unless rewritten.equal?(value)
+          decl.value = rewritten
+          changed += 1
+        end
+      end
+      changed
+    end
+
+    # Rewrite one value. Returns the same object when nothing changes.
+    def self.rewrite_value(value, table, patterns, replacements, prefix)
+      len = value.bytesize
+
+      if prefix
+        m = longest_match_at(value, 0, len, table)
+        return value unless m
+
+        result = String.new(encoding: value.encoding)
+        result << replacements[m]
+        copied = patterns[m].bytesize
+      else
+        result = nil
+        copied = 0
+        pos = 0
+        while pos < len
+          m = longest_match_at(value, pos, len, table)
+          if m
+            result ||= String.new(capacity: len, encoding: value.encoding)
+            result << value.byteslice(copied, pos - copied) << replacements[m]
+            pos = copied = pos + patterns[m].bytesize
+          else
+            pos += 1
+          end
+        end
+        return value unless result
+      end
+
+      result << value.byteslice(copied, len - copied)
+
+      # Identity mappings (or replacements that cancel out) leave the value alone
+      return value if result == value
+
+      result
+    end
+
+    # Index of the longest pattern starting at pos, or nil
+    def self.longest_match_at(value, pos, len, table)
+      candidates = table[value.getbyte(pos)]
+      return nil unless candidates
+
+      candidates.each do |pattern, i|
+        plen = pattern.bytesize
+        next if pos + plen > len
+
+        j = 1
+        j += 1 while j < plen && value.getbyte(pos + j) == pattern.getbyte(j)
+        return i if j == plen
+      end
+      nil
+    end
+  end
+end
@@ -93,6 +93,27 @@ module Cataract
       calculated
     end
 
+    # Get the parsed components of this rule's selector.
+    #
+    # The selector is scanned once into compound selectors and combinators;
+    # the result is cached until the selector is replaced. See
+    # {Cataract.parse_selector} for the format.
+    #
+    # @return [Array] Frozen Array of compounds (Arrays of [kind, name] or
+    #   [kind, name, argument]) and combinator Symbols
+    #
+    # @example
+    #   rule = Cataract.parse_css("nav > a.active { color: red }").rules.first
+    #   rule.selector_components
+    #   #=> [[[:type, "nav"]], :child, [[:type, "a"], [:class, "active"]]]
+    def selector_components
+      current = selector
+      return @selector_components if @selector_components && @selector_components_source.equal?(current)
+
+      @selector_components_source = current
+      @selector_components = Cataract.parse_selector(current)
+    end
+
     # Check if this is a selector-based rule (vs an at-rule like @keyframes).
     #
     # @return [Boolean] Always returns true for Rule objects
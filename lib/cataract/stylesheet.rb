@@ -23,6 +23,9 @@ module Cataract
   class Stylesheet
     include Enumerable
 
+    # Keys accepted by the :limits option
+    LIMITS = %i[max_bytes max_rules max_declarations max_selectors max_nested_rules timeout].freeze
+
     # @return [Array<Rule>] Array of parsed CSS rules
     attr_reader :rules
 
@@ -87,6 +90,20 @@ module Cataract
     # @return [Array<ImportStatement>] Array of @import statements
     attr_reader :imports
 
+    # Imports resolved into this stylesheet, as importer URL => URLs it
+    # imports. The stylesheet's own CSS is keyed by its file:// URL when it
+    # came from {load_file}, otherwise by nil. See {ImportGraph} for tracking
+    # several entry stylesheets across rebuilds.
+    #
+    # @example
+    #   sheet = Cataract::Stylesheet.load_file('app.css', import: { allowed_schemes: ['file'] })
+    #   sheet.import_graph
+    #   # => { "file:///src/app.css" => ["file:///src/base.css"],
+    #   #      "file:///src/base.css" => ["file:///src/reset.css"] }
+    #
+    # @return [Hash{String, nil => Array<String>}]
+    attr_reader :import_graph
+
     # Create a new empty stylesheet.
     #
     # @param options [Hash] Configuration options
@@ -108,6 +125,17 @@ module Cataract
     #   Defaults to using Ruby's URI.parse(base).merge(relative).to_s
     # @option options [Hash] :parser ({}) Parser configuration options
     #   - :selector_lists [Boolean] (true) Track selector lists for W3C-compliant serialization
+    # @option options [Hash] :limits (nil) Resource budgets for untrusted CSS.
+    #   Each parse call (every add_block, and every imported file) is checked
+    #   on its own; exceeding a budget raises LimitError. Omitted keys are
+    #   unlimited.
+    #   - :max_bytes [Integer] CSS input size
+    #   - :max_rules [Integer] Rules created, after splitting selector lists
+    #     and expanding nesting
+    #   - :max_declarations [Integer] Declarations across those rules
+    #   - :max_selectors [Integer] Selectors in one comma-separated list
+    #   - :max_nested_rules [Integer] Rules created from CSS nesting
+    #   - :timeout [Numeric] Wall-clock seconds
     def initialize(options = {})
       # Type validation
       raise TypeError, "options must be a Hash, got #{options.class}" unless options.is_a?(Hash)
@@ -139,11 +167,19 @@ module Cataract
         raise TypeError, "uri_resolver must be a Proc or callable, got #{@options[:uri_resolver].class}"
       end
 
+      if @options[:limits]
+        raise TypeError, "limits must be a Hash, got #{@options[:limits].class}" unless @options[:limits].is_a?(Hash)
+
+        unknown = @options[:limits].keys - LIMITS
+        raise ArgumentError, "unknown limits: #{unknown.join(', ')}" unless unknown.empty?
+      end
+
       # Parser options with defaults (stored for passing to parser)
       @parser_options = {
         selector_lists: true,
         raise_parse_errors: @options[:raise_parse_errors]
       }.merge(@options[:parser] || {})
+      @parser_options[:limits] = @options[:limits] if @options[:limits]
 
       @rules = [] # Flat array of Rule structs
       @media_queries = [] # Array of MediaQuery objects
@@ -155,10 +191,12 @@ module Cataract
       @_next_media_query_list_id = 0 # Counter for media query list IDs
       @charset = nil
       @imports = [] # Array of ImportStatement objects
+      @import_graph = {} # Hash: importer URL => Array of imported URLs
       @_has_nesting = nil # Set by parser (nil or boolean)
       @_last_rule_id = nil # Tracks next rule ID for add_block
       @selectors = nil # Memoized cache of selectors
       @_custom_properties = nil # Memoized cache of custom properties
+      @_batch_removed = nil # Hash: rule ID => true for removals deferred by #batch
     end
 
     # Initialize copy for proper deep duplication.
@@ -174,11 +212,13 @@ module Cataract
       @_next_media_query_id = source.instance_variable_get(:@_next_media_query_id)
       @media_index = source.instance_variable_get(:@media_index).transform_values(&:dup)
       @imports = source.instance_variable_get(:@imports).dup
+      @import_graph = source.instance_variable_get(:@import_graph).transform_values(&:dup)
       @_selector_lists = source.instance_variable_get(:@_selector_lists).transform_values(&:dup)
       @_next_selector_list_id = source.instance_variable_get(:@_next_selector_list_id)
       @_media_query_lists = source.instance_variable_get(:@_media_query_lists).transform_values(&:dup)
       @_next_media_query_list_id = source.instance_variable_get(:@_next_media_query_list_id)
       @parser_options = source.instance_variable_get(:@parser_options).dup
+      @_batch_removed = nil
       clear_memoized_caches
       @_hash = nil # Clear cached hash
     end
@@ -194,6 +234,56 @@ module Cataract
       sheet
     end
 
+    # Parse several CSS sources into one Stylesheet with a single parser call.
+    #
+    # All sources share one parser context, so rule, selector list and media
+    # query IDs run on contiguously in source order with no remapping
+    # afterwards. The rules match parsing the first source and adding the rest
+    # with {#add_block}: @import is allowed at the top of each source and the
+    # first @charset wins.
+    #
+    # @param sources [Array<String, Pathname, IO>] CSS strings, file paths
+    #   (anything responding to #to_path, read as a file) or readable IO objects
+    # @param base_dirs [Array<String, nil>, nil] Directory for resolving each
+    #   source's relative @import paths. Defaults to the file's directory for
+    #   path sources and to the :base_dir option otherwise.
+    # @param options [Hash] Options passed to Stylesheet.new
+    # @return [Stylesheet] Parsed stylesheet
+    # @raise [TypeError] If a source is not a String, path or IO
+    # @raise [ArgumentError] If base_dirs and sources differ in size
+    #
+    # @example Bundle files
+    #   sheet = Cataract::Stylesheet.parse_many(%w[reset.css app.css].map { |f| Pathname(f) },
+    #                                           import: { allowed_schemes: ['file'] })
+    def self.parse_many(sources, base_dirs: nil, **options)
+      sources = Array(sources)
+      if base_dirs && base_dirs.size != sources.size
+        raise ArgumentError, "base_dirs has #{base_dirs.size} entries for #{sources.size} sources"
+      end
+
+      css_list = []
+      dirs = []
+      sources.each_with_index do |source, index|
+        dir = base_dirs && base_dirs[index]
+        if source.is_a?(String)
+          css_list << source
+        elsif source.respond_to?(:to_path)
+          path = source.to_path
+          css_list << File.read(path)
+          dir ||= File.dirname(File.expand_path(path))
+        elsif source.respond_to?(:read)
+          css_list << source.read
+        else
+          raise TypeError, "wrong argument type #{source.class} (expected String, Pathname or IO)"
+        end
+        dirs << dir
+      end
+
+      sheet = new(options)
+      sheet.send(:add_sources, css_list, dirs)
+      sheet
+    end
+
     # Load CSS from a file and return a new Stylesheet.
     #
     # @param filename [String] Path to the CSS file
@@ -451,6 +541,19 @@ module Cataract
     # Important: When filtering to specific media types, base rules (rules not
     # inside any @media block) are NOT included. Only rules explicitly inside
     # the requested @media queries are output. Use :all to include base rules.
+    #
+    # @param consolidate_media [Boolean] Merge rules from repeated identical
+    #   @media blocks into one block where the cascade permits (default: false).
+    #   A rule is only moved if no rule it would jump over sets a property from
+    #   the same family with the same specificity and importance. Ignored for
+    #   stylesheets with CSS nesting.
+    # @param compression_order [Boolean] Order output for smaller gzip/brotli
+    #   output (default: false). Declarations are sorted by property family in
+    #   the order the stylesheet first uses them, keeping the source order of
+    #   declarations that can override each other, and rules with identical
+    #   declarations within a media block are grouped together when the same
+    #   cascade check allows it. The stylesheet itself is not modified. Ignored
+    #   for stylesheets with CSS nesting.
     # @return [String] CSS string
     #
     # @example Get all CSS
@@ -463,14 +566,25 @@ module Cataract
     #
     # @example Filter to multiple media types
     #   sheet.to_s(media: [:screen, :print])  # => "@media screen { ... } @media print { ... }"
-    def to_s(media: :all)
+    #
+    # @example Consolidate interleaved media blocks
+    #   sheet = Cataract.parse_css('@media print { .a { color: black; } } .b { margin: 0; } @media print { .c { display: none; } }')
+    #   sheet.to_s(consolidate_media: true)
+    #   # => "@media print {\n.a { color: black; }\n.c { display: none; }\n}\n.b { margin: 0; }\n"
+    #
+    # @example Order for compression
+    #   sheet = Cataract.parse_css('.a { color: red; margin: 0; } .b { top: 0; } .c { margin: 0; color: red; }')
+    #   sheet.to_s(compression_order: true)
+    #   # => ".a { color: red; margin: 0; }\n.c { color: red; margin: 0; }\n.b { top: 0; }\n"
+    def to_s(media: :all, consolidate_media: false, compression_order: false)
+      serialize_options = output_options(consolidate_media: consolidate_media, compression_order: compression_order)
       which_media = media
       # Normalize to array for consistent filtering
       which_media_array = which_media.is_a?(Array) ? which_media : [which_media]
 
       # If :all is present, return everything (no filtering)
       if which_media_array.include?(:all)
-        Cataract.stylesheet_to_s(@rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists)
+        Cataract.stylesheet_to_s(@rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
       else
         # Collect all rule IDs that match the requested media types
         matching_rule_ids = []
@@ -486,7 +600,7 @@ module Cataract
         filtered_rules = matching_rule_ids.sort.map! { |rule_id| @rules[rule_id] }
 
         # Serialize with filtered data
-        Cataract.stylesheet_to_s(filtered_rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists)
+        Cataract.stylesheet_to_s(filtered_rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
       end
     end
     alias to_css to_s
@@ -502,6 +616,10 @@ module Cataract
     #   - :screen, :print, etc. - Output only rules from specified media query
     #   - [:screen, :print] - Output rules from multiple media queries
     #
+    # @param consolidate_media [Boolean] Merge rules from repeated identical
+    #   @media blocks where the cascade permits (see {#to_s})
+    # @param compression_order [Boolean] Sort declarations and group similar
+    #   rules where the cascade permits (see {#to_s})
     # @return [String] Formatted CSS string
     #
     # @example Get all CSS formatted
@@ -512,14 +630,15 @@ module Cataract
     #   sheet.to_formatted_s(:print)
     #
     # @see #to_s For compact single-line output
-    def to_formatted_s(media: :all)
+    def to_formatted_s(media: :all, consolidate_media: false, compression_order: false)
+      serialize_options = output_options(consolidate_media: consolidate_media, compression_order: compression_order)
       which_media = media
       # Normalize to array for consistent filtering
       which_media_array = which_media.is_a?(Array) ? which_media : [which_media]
 
       # If :all is present, return everything (no filtering)
       if which_media_array.include?(:all)
-        Cataract.stylesheet_to_formatted_s(@rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists)
+        Cataract.stylesheet_to_formatted_s(@rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
       else
         # Collect all rule IDs that match the requested media types
         matching_rule_ids = []
@@ -543,7 +662,86 @@ module Cataract
         filtered_rules = matching_rule_ids.sort.map! { |rule_id| @rules[rule_id] }
 
         # Serialize with filtered data
-        Cataract.stylesheet_to_formatted_s(filtered_rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists)
+        Cataract.stylesheet_to_formatted_s(filtered_rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
+      end
+    end
+
+    # Write gzip-compressed CSS to an IO.
+    #
+    # The serializer hands its output buffer to the gzip stream in chunks as it
+    # goes, so the full CSS string and its compressed copy are never held in
+    # memory together. Output decompresses to exactly {#to_s} (or
+    # {#to_formatted_s} with +formatted: true+), with the same
+    # +compression_order+. The IO is not closed, also when serialization
+    # raises (the gzip stream is finished with whatever was written).
+    #
+    # @param io [IO, StringIO] Destination for the gzip data
+    # @param level [Integer] Zlib compression level (default: Zlib::DEFAULT_COMPRESSION)
+    # @param formatted [Boolean] Compress formatted output (default: false)
+    # @param compression_order [Boolean] Sort declarations and group similar
+    #   rules where the cascade permits (see {#to_s})
+    # @return [IO] The io argument
+    #
+    # @example Precompress an asset
+    #   File.open('app.css.gz', 'wb') { |f| sheet.write_gzip(f, level: Zlib::BEST_COMPRESSION, compression_order: true) }
+    def write_gzip(io, level: nil, formatted: false, compression_order: false)
+      require 'zlib'
+
+      gz = Zlib::GzipWriter.new(io, level || Zlib::DEFAULT_COMPRESSION)
+      begin
+        serialize_options = { sink: gz, compression_order: compression_order }
+        # Whatever is left in the buffer after the last flush is returned
+        remainder = if formatted
+                      Cataract.stylesheet_to_formatted_s(@rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
+                    else
+                      Cataract.stylesheet_to_s(@rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
+                    end
+        gz.write(remainder)
+      ensure
+        # Finish even when serialization raises: an unfinished writer closes
+        # the caller's IO when it is garbage collected
+        gz.finish unless gz.closed?
+      end
+      io
+    end
+
+    # Serialize a subset of rules by ID.
+    #
+    # Used by {StylesheetScope#to_s}. The full rules array is handed to the
+    # serializer along with the IDs, so selector list grouping and @media
+    # wrappers work exactly as in {#to_s}, restricted to the given rules.
+    # IDs are not positions in the rules array (an unresolved @import takes an
+    # ID too); the serializer maps them. Nested rules are written inside their
+    # ancestors.
+    #
+    # @param rule_ids [Array<Integer>] Rule IDs to serialize, in ascending order
+    # @param formatted [Boolean] Use formatted output (see {#to_formatted_s})
+    # @return [String] CSS string
+    # @api private
+    def _serialize_rule_ids(rule_ids, formatted: false)
+      if @_has_nesting
+        # Nested serialization walks parent/child links itself; hand it the subset
+        # plus each selected rule's ancestors, so nested rules keep their parents
+        rules_by_id = @rules.to_h { |rule| [rule.id, rule] }
+        selected = {}
+        rule_ids.each do |rule_id|
+          rule = rules_by_id[rule_id]
+          while rule && !selected[rule.id]
+            selected[rule.id] = true
+            rule = rule.is_a?(Rule) && rule.parent_rule_id ? rules_by_id[rule.parent_rule_id] : nil
+          end
+        end
+        rules = @rules.select { |rule| selected[rule.id] }
+        serialize_options = nil
+      else
+        rules = @rules
+        serialize_options = { rule_ids: rule_ids }
+      end
+
+      if formatted
+        Cataract.stylesheet_to_formatted_s(rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
+      else
+        Cataract.stylesheet_to_s(rules, @charset, @_has_nesting || false, @_selector_lists, @media_queries, @_media_query_lists, serialize_options)
       end
     end
 
@@ -624,6 +822,10 @@ module Cataract
           file_dir = File.dirname(file_path)
           @options[:import] = @options[:import].merge(base_path: file_dir)
         end
+        # Key this file's own imports by its URL in import_graph
+        if @options[:import].is_a?(Hash) && !@options[:import].key?(:importer)
+          @options[:import] = @options[:import].merge(importer: "file://#{file_path}")
+        end
 
         css_content = File.read(file_path)
       else
@@ -685,6 +887,9 @@ module Cataract
       # Find rule IDs to remove
       rule_ids_to_remove = []
       @rules.each_with_index do |rule, rule_id|
+        # Already removed in the current batch
+        next if @_batch_removed&.key?(rule_id)
+
         # Check if this rule matches
         matches = if match_by_selector
                     # Match by selector for CSS string input
@@ -711,30 +916,15 @@ module Cataract
         rule_ids_to_remove << rule_id
       end
 
-      # Remove rules and update media_index (sort in reverse to maintain indices during deletion)
-      rule_ids_to_remove.sort.reverse_each do |rule_id|
-        @rules.delete_at(rule_id)
+      removed = rule_ids_to_remove.to_h { |rule_id| [rule_id, true] }
 
-        # Remove from media_index and update IDs for rules after this one
-        @media_index.each_value do |ids|
-          ids.delete(rule_id)
-          # Decrement IDs greater than removed ID
-          ids.map! { |id| id > rule_id ? id - 1 : id }
-        end
+      # Inside #batch: just mark them, compaction happens once at the end
+      if @_batch_removed
+        @_batch_removed.merge!(removed)
+        return self
       end
 
-      # Clean up empty media_index entries
-      @media_index.delete_if { |_media, ids| ids.empty? }
-
-      # Clean up unused MediaQuery objects (those not referenced by any rule)
-      used_mq_ids = @rules.filter_map { |r| r.media_query_id if r.is_a?(Rule) }.to_set
-      @media_queries.select! { |mq| used_mq_ids.include?(mq.id) }
-
-      # Update rule IDs in remaining rules
-      @rules.each_with_index { |rule, new_id| rule.id = new_id }
-
-      clear_memoized_caches
-
+      finish_mutations(removed)
       self
     end
 
@@ -761,111 +951,12 @@ module Cataract
       effective_base_dir = base_dir || @options[:base_dir]
       effective_absolute_paths = absolute_paths.nil? ? @options[:absolute_paths] : absolute_paths
 
-      # Get current rule ID offset
-      offset = @_last_rule_id || 0
-
-      # Build parser options with URL conversion settings
-      parse_options = @parser_options.dup
-      if effective_absolute_paths && effective_base_uri
-        parse_options[:base_uri] = effective_base_uri
-        parse_options[:absolute_paths] = true
-        parse_options[:uri_resolver] = @options[:uri_resolver] || Cataract::DEFAULT_URI_RESOLVER
-      end
-
       # Parse CSS first (this extracts @import statements into result[:imports])
-      result = Cataract._parse_css(css, parse_options)
-
-      # Merge selector_lists with offsetted IDs
-      list_id_offset = @_next_selector_list_id
-      if result[:_selector_lists] && !result[:_selector_lists].empty?
-        result[:_selector_lists].each do |list_id, rule_ids|
-          new_list_id = list_id + list_id_offset
-          offsetted_rule_ids = rule_ids.map { |id| id + offset }
-          @_selector_lists[new_list_id] = offsetted_rule_ids
-        end
-        @_next_selector_list_id = list_id_offset + result[:_selector_lists].size
-      end
-
-      # Merge media_query_lists with offsetted IDs
-      media_query_id_offset = @_next_media_query_id
-      mq_list_id_offset = @_next_media_query_list_id
-      if result[:_media_query_lists] && !result[:_media_query_lists].empty?
-        result[:_media_query_lists].each do |list_id, mq_ids|
-          new_list_id = list_id + mq_list_id_offset
-          offsetted_mq_ids = mq_ids.map { |id| id + media_query_id_offset }
-          @_media_query_lists[new_list_id] = offsetted_mq_ids
-        end
-        @_next_media_query_list_id = mq_list_id_offset + result[:_media_query_lists].size
-      end
-
-      # Merge rules with offsetted IDs
-      new_rules = result[:rules]
-      new_rules.each do |rule|
-        rule.id += offset
-        # Update selector_list_id to point to offsetted list (only for Rule, not AtRule)
-        if rule.is_a?(Rule) && rule.selector_list_id
-          rule.selector_list_id += list_id_offset
-        end
-        # Update media_query_id to point to offsetted MediaQuery
-        if rule.is_a?(Rule) && rule.media_query_id
-          rule.media_query_id += media_query_id_offset
-        end
-        @rules << rule
-      end
-
-      # Merge media_index with offsetted IDs
-      result[:_media_index].each do |media_sym, rule_ids|
-        offsetted_ids = rule_ids.map { |id| id + offset }
-        if @media_index[media_sym]
-          @media_index[media_sym].concat(offsetted_ids)
-        else
-          @media_index[media_sym] = offsetted_ids
-        end
-      end
-
-      # Merge media_queries with offsetted IDs
-      if result[:media_queries]
-        result[:media_queries].each do |mq|
-          mq.id += media_query_id_offset
-          @media_queries << mq
-        end
-        @_next_media_query_id += result[:media_queries].length
-      end
-
-      # Update last rule ID
-      @_last_rule_id = offset + new_rules.length
-
-      # Merge imports with offsetted IDs
-      if result[:imports]
-        new_imports = result[:imports]
-        new_imports.each do |import|
-          import.id += offset
-          # Update media_query_id to point to offsetted MediaQuery
-          if import.media_query_id
-            import.media_query_id += media_query_id_offset
-          end
-          @imports << import
-        end
-
-        # Resolve imports if configured
-        if @options[:import]
-          # Extract imported_urls and depth from options
-          if @options[:import].is_a?(Hash)
-            imported_urls = @options[:import][:imported_urls] || []
-            depth = @options[:import][:depth] || 0
-          else
-            imported_urls = []
-            depth = 0
-          end
+      result = Cataract._parse_css(css, url_parse_options(effective_base_uri, effective_absolute_paths))
+      new_imports = merge_parse_result(result)
 
-          # Build import options with base_uri/base_dir for URL resolution
-          import_opts = @options[:import].is_a?(Hash) ? @options[:import].dup : {}
-          import_opts[:base_uri] = effective_base_uri if effective_base_uri
-          import_opts[:base_path] = effective_base_dir if effective_base_dir
-
-          resolve_imports(new_imports, import_opts, imported_urls: imported_urls, depth: depth)
-        end
-      end
+      # Resolve imports if configured
+      resolve_new_imports(new_imports, effective_base_uri, effective_base_dir) if @options[:import]
 
       # Set charset if not already set
       @charset ||= result[:charset]
@@ -873,7 +964,7 @@ module Cataract
       # Track if we have any nesting (for serialization optimization)
       @_has_nesting = result[:_has_nesting]
 
-      clear_memoized_caches
+      clear_memoized_caches unless @_batch_removed
 
       self
     end
@@ -890,6 +981,47 @@ module Cataract
       add_block(css, media_types: media_types)
     end
 
+    # Group mutations and do the index bookkeeping once.
+    #
+    # Inside the block, {#add_block} and {#add_rule} append rules without
+    # merging media_index or clearing caches, and {#remove_rules!} only marks
+    # rules as removed. When the block returns (or raises), removed rules
+    # are compacted out with a single ID renumbering, the media index is
+    # rebuilt lazily, and memoized caches are cleared once.
+    #
+    # Until the batch ends, removed rules are still present in {#rules} and
+    # visible to queries and serialization, though a later
+    # {#remove_rules!} in the same batch skips them. Other mutating methods
+    # (e.g. {#flatten!}) should be called outside the block. Nested calls
+    # join the outer batch.
+    #
+    # @example Assemble a stylesheet from many snippets
+    #   sheet.batch do |s|
+    #     snippets.each { |css| s.add_block(css) }
+    #     s.remove_rules!('.debug { }')
+    #   end
+    #
+    # @yieldparam stylesheet [Stylesheet] self
+    # @return [self] Returns self for method chaining
+    def batch
+      raise ArgumentError, 'batch requires a block' unless block_given?
+
+      if @_batch_removed
+        yield self
+        return self
+      end
+
+      @_batch_removed = {}
+      begin
+        yield self
+      ensure
+        removed = @_batch_removed
+        @_batch_removed = nil
+        finish_mutations(removed)
+      end
+      self
+    end
+
     # Convert to hash
     #
     # @return [Hash] Hash representation
@@ -900,6 +1032,29 @@ module Cataract
       }
     end
 
+    # Serialize the parsed structure to a JSON string.
+    #
+    # Writes rules, declarations, media queries, selector lists and imports
+    # directly into the output buffer (no intermediate Hash), so it is much
+    # faster than +JSON.generate(sheet.to_h)+. Also called by JSON.generate
+    # when a stylesheet is nested inside another object; the generator state
+    # argument is ignored.
+    #
+    # @param specificity [Boolean] Include each rule's specificity (default: false)
+    # @return [String] UTF-8 JSON string
+    #
+    # @example
+    #   sheet = Cataract.parse_css('body { color: red; }')
+    #   sheet.to_json
+    #   # => '{"charset":null,"rules":[{"id":0,"type":"rule","selector":"body","declarations":[{"property":"color","value":"red","important":false}],"parent_rule_id":null,"nesting_style":null,"selector_list_id":null,"media_query_id":null}],"media_queries":[],"media_query_lists":{},"selector_lists":{},"imports":[]}'
+    #
+    # @example Include specificity
+    #   sheet.to_json(specificity: true)
+    def to_json(*_state, specificity: false)
+      json_options = specificity ? { specificity: true } : nil
+      Cataract.stylesheet_to_json(@rules, @charset, @media_queries, @_media_query_lists, @_selector_lists, @imports, json_options)
+    end
+
     def inspect
       total_rules = size
       if total_rules.zero?
@@ -945,9 +1100,26 @@ module Cataract
     # set of declarations. Also recreates shorthand properties from longhand
     # properties where possible.
     #
+    # Pass +selectors:+ to only group and cascade rules whose selector matches.
+    # The result then contains just the merged rules for those selectors (no
+    # AtRules), which is much cheaper than a full flatten when looking up a few
+    # selectors in a large stylesheet.
+    #
+    # @example Cascaded styles for a single component
+    #   sheet.flatten(selectors: ['.btn', '.btn:hover'])
+    #   sheet.flatten(selectors: /\A\.card/)
+    #
+    # Pass +fold_calc: true+ to also constant-fold calc()/min()/max()/clamp()
+    # in the flattened values (see {#fold_calc!}).
+    #
+    # @param selectors [String, Array<String>, Regexp, nil] Selectors to flatten
+    #   (exact match for strings, +match?+ for Regexp). nil flattens all rules.
+    # @param fold_calc [Boolean] Fold calc() expressions in the result (default: false)
     # @return [Stylesheet] New stylesheet with cascade applied
-    def flatten
-      Cataract.flatten(self)
+    def flatten(selectors: nil, fold_calc: false)
+      flattened = Cataract.flatten(self, selectors)
+      flattened.fold_calc! if fold_calc
+      flattened
     end
     alias cascade flatten
 
@@ -964,16 +1136,192 @@ module Cataract
     # itself is mutated (same object_id), but note that the C flatten function
     # still allocates new arrays internally.
     #
+    # @param fold_calc [Boolean] Fold calc() expressions in the result (default: false)
     # @return [self] Returns self for method chaining
-    def flatten!
+    def flatten!(fold_calc: false)
       flattened = Cataract.flatten(self)
       @rules = flattened.instance_variable_get(:@rules)
       @media_index = flattened.instance_variable_get(:@media_index)
       @_has_nesting = flattened.instance_variable_get(:@_has_nesting)
+      fold_calc! if fold_calc
       self
     end
     alias cascade! flatten!
 
+    # Constant-fold calc(), min(), max() and clamp() in declaration values.
+    #
+    # Values are rewritten in place, including declarations inside @keyframes
+    # and @font-face blocks. Only terms with the same unit are combined, so
+    # +calc(1in + 10mm)+, +calc(100% - 10px)+ and var() are kept. Negative
+    # results stay wrapped (+calc(-5px)+) so the browser still clamps them.
+    # A value is only replaced when the folded form is shorter.
+    #
+    # @example
+    #   sheet = Cataract.parse_css('.a { width: calc(8px * 2); margin: calc(100% - 2px - 2px) }')
+    #   sheet.fold_calc!
+    #   sheet.to_s # => ".a { width: 16px; margin: calc(100% - 4px); }\n"
+    #
+    # @return [self] Returns self for method chaining
+    def fold_calc!
+      folded = Cataract.fold_calc_values(@rules)
+      clear_memoized_caches if folded > 0
+      self
+    end
+
+    # Replace literal substrings in declaration values, in place.
+    #
+    # All mappings are applied in a single pass over every value, including
+    # declarations inside @keyframes and @font-face blocks. Where several
+    # patterns match, the one starting leftmost wins, then the longest;
+    # replaced text is not scanned again. Values without a match are left
+    # untouched (same String object).
+    #
+    # Note that +!important+ is not part of a value - it is stored on
+    # {Declaration#important}.
+    #
+    # @example Swap a CDN host
+    #   sheet.rewrite_values!({ 'http://old.cdn.example' => 'https://cdn.example' })
+    #
+    # @example Rename design tokens in colors only
+    #   sheet.rewrite_values!({ '--brand-blue' => '--primary' }, properties: %w[color background-color])
+    #
+    # @example Only rewrite values that start with a pattern
+    #   sheet.rewrite_values!({ 'Helvetica' => 'system-ui' }, prefix: true, properties: 'font-family')
+    #
+    # @param mappings [Hash{String => String}] Literal pattern => replacement
+    # @param prefix [Boolean] Only match patterns at the start of a value (default: false)
+    # @param properties [String, Array<String>, nil] Limit to these properties (nil = all)
+    # @return [self] Returns self for method chaining
+    # @raise [ArgumentError] If a pattern is empty
+    def rewrite_values!(mappings, prefix: false, properties: nil)
+      raise TypeError, "wrong argument type #{mappings.class} (expected Hash)" unless mappings.is_a?(Hash)
+      return self if mappings.empty?
+
+      patterns = mappings.keys.map(&:to_s)
+      replacements = mappings.values.map(&:to_s)
+      if properties
+        properties = Array(properties).map do |property|
+          property = property.to_s
+          property.start_with?('--') ? property : property.downcase
+        end
+      end
+
+      rewritten = Cataract.rewrite_values(@rules, patterns, replacements, prefix, properties)
+      clear_memoized_caches if rewritten > 0
+      self
+    end
+
+    # Get every url() reference in the stylesheet.
+    #
+    # Includes @import URLs (listed first), declaration values in rules, and
+    # @font-face / @keyframes content. URLs are returned as written, without
+    # quotes and without resolving them against a base URI.
+    #
+    # @example Collect assets to fingerprint
+    #   sheet.urls.map(&:url).uniq
+    #
+    # @example Find where an asset is used
+    #   sheet.urls.select { |ref| ref.url == 'logo.png' }.map(&:rule_id)
+    #
+    # @return [Array<UrlReference>] References in source order
+    def urls
+      Cataract.extract_urls(@rules, @imports)
+    end
+
+    # Replace URLs through a Hash lookup, in place.
+    #
+    # Each url() token in a declaration value, and each @import URL, is looked
+    # up by its text as written. Matches are replaced keeping the original
+    # quoting; URLs that aren't keys (or map to nil) are left untouched. The
+    # Hash's default value or default proc is not used.
+    #
+    # @example Rewrite to digested asset paths
+    #   digests = sheet.urls.map(&:url).uniq.to_h { |url| [url, fingerprint(url)] }
+    #   sheet.map_urls!(digests)
+    #
+    # @param mapping [Hash{String => String}] URL as written => replacement URL
+    # @return [self] Returns self for method chaining
+    def map_urls!(mapping)
+      replaced = Cataract.map_urls(@rules, @imports, mapping)
+      clear_memoized_caches if replaced > 0
+      self
+    end
+
+    # Remove vendor-prefixed forms the target browsers don't need, in place.
+    #
+    # Each -webkit-, -moz-, -ms- or -o- property, value keyword, pseudo
+    # selector and at-rule is looked up in a {PrefixTable}:
+    #
+    # - Needed by some target: kept.
+    # - No target parses the prefix: removed (rules with such a selector
+    #   are removed whole).
+    # - A target parses it but supports the standard form: a property and
+    #   its standard form in the same rule count as one, and the cascade
+    #   winner (!important first, then the later one) is kept under the
+    #   standard name. Selectors and at-rules are removed when the standard
+    #   form is already in the stylesheet, otherwise renamed to it. Prefixed
+    #   values are removed when the rule has an unprefixed declaration of
+    #   the same property, and kept otherwise.
+    #
+    # Prefixed names the table doesn't list are kept when a target parses
+    # their prefix. Declarations inside @keyframes and @font-face blocks are
+    # pruned too.
+    #
+    # @example
+    #   sheet = Cataract.parse_css('.a { -webkit-transition: x 1s; -moz-transition: x 1s; transition: x 1s; }')
+    #   sheet.prune_prefixes!(targets: { chrome: 120, firefox: 115, safari: 16 })
+    #   sheet.to_s # => ".a { transition: x 1s; }\n"
+    #
+    # @param targets [Hash{Symbol => Numeric, String}] Browser => oldest
+    #   version to support (:chrome, :edge, :firefox, :safari, :ios_saf,
+    #   :opera, :samsung, :android, :ie)
+    # @param table [PrefixTable, String, nil] Capability table or path to
+    #   one (default: {PrefixTable.default})
+    # @return [self] Returns self for method chaining
+    # @raise [ArgumentError] If targets is empty or names an unknown browser
+    def prune_prefixes!(targets:, table: nil)
+      table = PrefixTable.load(table) if table.is_a?(String)
+      table ||= PrefixTable.default
+      raise TypeError, "wrong argument type #{table.class} (expected Cataract::PrefixTable)" unless table.is_a?(PrefixTable)
+
+      removed = Cataract.prune_prefixes(@rules, *table.actions(targets)).to_h { |index| [index, true] }
+
+      # Inside #batch: renames are done, removal waits for the end of the batch
+      if @_batch_removed
+        @_batch_removed.merge!(removed)
+        clear_memoized_caches
+        return self
+      end
+
+      finish_mutations(removed)
+      self
+    end
+
+    # Remove declarations that are provably overridden, without merging rules.
+    #
+    # A cheaper, order-preserving alternative to {#flatten!}. Rules keep their
+    # position and selectors; only declarations that can never win the cascade
+    # are dropped. A declaration is dead when a rule with the same selector and
+    # media context (possibly the same rule) sets the same property later, or
+    # sets it with !important. Fallbacks are kept: when either value holds a
+    # vendor-prefixed keyword or a function, as in
+    # +display: -webkit-box; display: flex+, both declarations stay.
+    #
+    # Properties are matched by exact name - shorthands are not expanded, so
+    # +margin+ does not remove an earlier +margin-top+.
+    #
+    # @example
+    #   sheet = Cataract.parse_css('.a { color: red; margin: 0 } .b { color: red } .a { color: blue }')
+    #   sheet.eliminate_dead_declarations!
+    #   sheet.to_s # => ".a { margin: 0; }\n.b { color: red; }\n.a { color: blue; }\n"
+    #
+    # @return [self] Returns self for method chaining
+    def eliminate_dead_declarations!
+      removed = Cataract.eliminate_dead_declarations(self)
+      clear_memoized_caches if removed > 0
+      self
+    end
+
     # Deprecated: Use flatten! instead
     def merge!
       warn 'Stylesheet#merge! is deprecated, use #flatten! instead', uplevel: 1
@@ -1112,8 +1460,328 @@ module Cataract
       result
     end
 
+    # Compute the rule-level difference between two stylesheets.
+    #
+    # Unlike {#-}, this is two-sided and order-aware: rules are fingerprinted
+    # and the two rule sequences are aligned, producing :added, :removed and
+    # :modified operations (a rule whose selector and media context stayed
+    # the same but whose declarations changed). Near-linear for local edits
+    # to large stylesheets. See {StylesheetDiff} for details.
+    #
+    # @example Ship only the delta
+    #   diff = Cataract::Stylesheet.diff(deployed, updated)
+    #   diff.size #=> 3
+    #   deployed.apply_patch!(diff)
+    #
+    # @param old_sheet [Stylesheet] Stylesheet the patch applies to
+    # @param new_sheet [Stylesheet] Stylesheet the patch produces
+    # @return [StylesheetDiff]
+    def self.diff(old_sheet, new_sheet)
+      StylesheetDiff.compute(old_sheet, new_sheet)
+    end
+
+    # Apply a {StylesheetDiff} in place.
+    #
+    # The receiver must have the rules of the diff's old stylesheet. After
+    # the patch its rules are in the order of the new stylesheet: unchanged
+    # rules are kept (same objects), added and modified rules are copied from
+    # the diff. Media queries are matched by type and conditions and added
+    # when missing.
+    #
+    # @example
+    #   sheet.apply_patch!(Cataract::Stylesheet.diff(sheet, updated))
+    #   sheet.to_s == updated.to_s #=> true
+    #
+    # @param diff [StylesheetDiff] Diff from {Stylesheet.diff}
+    # @return [self] Returns self for method chaining
+    # @raise [ArgumentError] If the diff was not computed against these rules
+    def apply_patch!(diff)
+      raise TypeError, "wrong argument type #{diff.class} (expected Cataract::StylesheetDiff)" unless diff.is_a?(StylesheetDiff)
+      return self if diff.empty?
+
+      unless @rules.size == diff.old_size
+        raise ArgumentError, "patch expects #{diff.old_size} rules, stylesheet has #{@rules.size}"
+      end
+
+      replaced = {} # old index => new index (nil when removed)
+      inserted = {} # new index => operation
+      diff.each do |op|
+        if op.old_index
+          unless @rules[op.old_index].selector == op.rule.selector
+            raise ArgumentError, "patch does not apply: rule #{op.old_index} is not #{op.rule.selector.inspect}"
+          end
+
+          replaced[op.old_index] = op.new_index
+        end
+        inserted[op.new_index] = op if op.new_index
+      end
+
+      # Old index => new index for every surviving rule, for parent_rule_id
+      old_to_new = {}
+      kept = []
+      @rules.each_with_index do |rule, old_index|
+        if replaced.key?(old_index)
+          old_to_new[old_index] = replaced[old_index] if replaced[old_index]
+        else
+          kept << rule
+        end
+      end
+      unless kept.size + inserted.size == diff.new_size
+        raise ArgumentError, "patch does not apply: expected #{diff.new_size} rules"
+      end
+
+      media_lookup = patch_media_lookup
+      list_ids = {}
+      selector_list_ids = {}
+      new_rules = Array.new(diff.new_size)
+      kept_pos = 0
+      diff.new_size.times do |new_index|
+        op = inserted[new_index]
+        if op
+          rule = op.rule.dup
+          if rule.is_a?(Rule)
+            rule.declarations = rule.declarations.map(&:dup)
+          else
+            rule.content = rule.content.map(&:dup)
+          end
+          rule.media_query_id = patch_media_query_id(op.media_queries, media_lookup) if op.media_queries
+        else
+          rule = kept[kept_pos]
+          kept_pos += 1
+          old_to_new[rule.id] = new_index
+        end
+        # Selector lists follow the new stylesheet, for kept and inserted rules alike
+        if rule.is_a?(Rule)
+          new_list_id = diff.new_selector_list_ids[new_index]
+          rule.selector_list_id = new_list_id && (selector_list_ids[new_list_id] ||= selector_list_ids.size)
+          (list_ids[rule.selector_list_id] ||= []) << new_index if rule.selector_list_id
+        end
+        rule.id = new_index
+        new_rules[new_index] = rule
+      end
+
+      # Kept nested rules point at their parent's old position
+      kept.each do |rule|
+        rule.parent_rule_id = old_to_new[rule.parent_rule_id] if rule.is_a?(Rule) && rule.parent_rule_id
+      end
+
+      @rules = new_rules
+      @_selector_lists = list_ids
+      @_next_selector_list_id = list_ids.size
+      @_last_rule_id = @rules.length
+      @_has_nesting = @rules.any? { |rule| rule.is_a?(Rule) && rule.parent_rule_id }
+      @media_index = {}
+      clear_memoized_caches
+      @_hash = nil
+
+      self
+    end
+
+    # Split into a shared chunk and per-page chunks.
+    #
+    # Each page lists the element names, classes (".btn") and ids ("#main")
+    # its markup uses. Rules used by more than +shared_threshold+ of the
+    # pages go to the shared chunk, other rules to the chunks of the pages
+    # that use them, and unused rules are dropped. A page loads the shared
+    # chunk, then its own chunk. See {StylesheetSplit} for how cascade
+    # order is preserved.
+    #
+    # @example
+    #   split = sheet.split(pages: { home: %w[body nav .hero], blog: %w[body nav article] })
+    #   split.shared.to_s #=> "body { ... } nav { ... }"
+    #   split.pages[:home].to_s #=> ".hero { ... }"
+    #
+    # @param pages [Hash{Object => Enumerable<String>}] Page name => tokens it uses
+    # @param shared_threshold [Float] Fraction of pages (0..1) a rule must be
+    #   used by, exclusive, to be shared
+    # @return [StylesheetSplit]
+    # @raise [ArgumentError] If shared_threshold is outside 0..1
+    def split(pages:, shared_threshold: 0.5)
+      StylesheetSplit.compute(self, pages, shared_threshold)
+    end
+
+    # Rename class and id selectors to short names, in place.
+    #
+    # The most used names get the shortest replacements (see
+    # {NameMinifier}). Names inside pseudo-class arguments (:not(.a)) and
+    # exact [class~="a"] / [id="b"] matches are renamed too; names a prefix
+    # or substring attribute match could select ([class^="col-"]) are kept,
+    # and so are names spelled with hex escapes (.\31 0 is .10).
+    #
+    # Apply the returned mapping to templates and scripts. Names they use
+    # that no selector mentions belong in +keep+, so no short name
+    # collides with them.
+    #
+    # @example
+    #   sheet = Cataract.parse_css('.button { color: red; } #nav .button:hover { color: blue; }')
+    #   sheet.minify_names!(keep: %w[#nav]) #=> { ".button" => ".a" }
+    #   sheet.to_s #=> ".a { color: red; }\n#nav .a:hover { color: blue; }\n"
+    #
+    # @param keep [Enumerable<String>] Names to leave alone: ".class", "#id",
+    #   or a bare name for both
+    # @return [Hash{String => String}] Old ".class" / "#id" token => new token
+    # @raise [TypeError] If keep is not an Enumerable of Strings
+    def minify_names!(keep: [])
+      counts, patterns, fixed = Cataract._rule_name_counts(@rules)
+      mapping = NameMinifier.mapping(counts, patterns, keep, fixed)
+      return mapping if mapping.empty?
+
+      Cataract._rename_rule_names(@rules, mapping)
+      clear_memoized_caches
+      @_hash = nil
+      mapping
+    end
+
     private
 
+    # Parser options with URL conversion settings for one block
+    def url_parse_options(base_uri, absolute_paths)
+      parse_options = @parser_options.dup
+      if absolute_paths && base_uri
+        parse_options[:base_uri] = base_uri
+        parse_options[:absolute_paths] = true
+        parse_options[:uri_resolver] = @options[:uri_resolver] || Cataract::DEFAULT_URI_RESOLVER
+      end
+      parse_options
+    end
+
+    # Merge a parse result into this stylesheet, offsetting its rule,
+    # selector list and media query IDs past the existing ones.
+    #
+    # @param result [Hash] Result of Cataract._parse_css / _parse_css_many
+    # @return [Array<ImportStatement>] The newly added imports
+    def merge_parse_result(result)
+      # Get current rule ID offset
+      offset = @_last_rule_id || 0
+
+      # Merge selector_lists with offsetted IDs
+      list_id_offset = @_next_selector_list_id
+      if result[:_selector_lists] && !result[:_selector_lists].empty?
+        result[:_selector_lists].each do |list_id, rule_ids|
+          new_list_id = list_id + list_id_offset
+          offsetted_rule_ids = rule_ids.map { |id| id + offset }
+          @_selector_lists[new_list_id] = offsetted_rule_ids
+        end
+        @_next_selector_list_id = list_id_offset + result[:_selector_lists].size
+      end
+
+      # Merge media_query_lists with offsetted IDs
+      media_query_id_offset = @_next_media_query_id
+      mq_list_id_offset = @_next_media_query_list_id
+      if result[:_media_query_lists] && !result[:_media_query_lists].empty?
+        result[:_media_query_lists].each do |list_id, mq_ids|
+          new_list_id = list_id + mq_list_id_offset
+          offsetted_mq_ids = mq_ids.map { |id| id + media_query_id_offset }
+          @_media_query_lists[new_list_id] = offsetted_mq_ids
+        end
+        @_next_media_query_list_id = mq_list_id_offset + result[:_media_query_lists].size
+      end
+
+      # Merge rules with offsetted IDs
+      new_rules = result[:rules]
+      new_rules.each do |rule|
+        rule.id += offset
+        # Update selector_list_id to point to offsetted list (only for Rule, not AtRule)
+        if rule.is_a?(Rule) && rule.selector_list_id
+          rule.selector_list_id += list_id_offset
+        end
+        # Update media_query_id to point to offsetted MediaQuery
+        if rule.is_a?(Rule) && rule.media_query_id
+          rule.media_query_id += media_query_id_offset
+        end
+        @rules << rule
+      end
+
+      # Merge media_index with offsetted IDs. Inside #batch the index is
+      # dropped instead and rebuilt lazily on next access.
+      if @_batch_removed
+        @media_index = {} unless @media_index.empty?
+      else
+        result[:_media_index].each do |media_sym, rule_ids|
+          offsetted_ids = rule_ids.map { |id| id + offset }
+          if @media_index[media_sym]
+            @media_index[media_sym].concat(offsetted_ids)
+          else
+            @media_index[media_sym] = offsetted_ids
+          end
+        end
+      end
+
+      # Merge media_queries with offsetted IDs
+      if result[:media_queries]
+        result[:media_queries].each do |mq|
+          mq.id += media_query_id_offset
+          @media_queries << mq
+        end
+        @_next_media_query_id += result[:media_queries].length
+      end
+
+      # Update last rule ID
+      @_last_rule_id = offset + new_rules.length
+
+      # Merge imports with offsetted IDs
+      new_imports = result[:imports] || []
+      new_imports.each do |import|
+        import.id += offset
+        # Update media_query_id to point to offsetted MediaQuery
+        if import.media_query_id
+          import.media_query_id += media_query_id_offset
+        end
+        @imports << import
+      end
+      new_imports
+    end
+
+    # Parse and merge the sources of {Stylesheet.parse_many}
+    def add_sources(css_list, base_dirs)
+      result = Cataract._parse_css_many(css_list, url_parse_options(@options[:base_uri], @options[:absolute_paths]))
+      new_imports = merge_parse_result(result)
+
+      if @options[:import]
+        # Resolve each source's imports against its own directory. Later
+        # sources go first so their insertions don't shift earlier positions.
+        by_source = new_imports.each_with_index.group_by { |_import, index| result[:_import_sources][index] }
+        by_source.keys.reverse_each do |source_index|
+          entries = by_source[source_index]
+          # Import IDs also count the imports of earlier sources; drop those
+          # so they index rules the same way add_block's do
+          earlier = entries.first[1]
+          imports = entries.map do |import, _index|
+            import.id -= earlier
+            import
+          end
+          resolve_new_imports(imports, @options[:base_uri], base_dirs[source_index] || @options[:base_dir])
+        end
+      end
+
+      # First @charset wins
+      @charset ||= result[:charset]
+      @_has_nesting = result[:_has_nesting]
+
+      clear_memoized_caches unless @_batch_removed
+
+      self
+    end
+
+    # Resolve imports added by one block against its base URI / directory
+    def resolve_new_imports(new_imports, base_uri, base_dir)
+      # Extract imported_urls and depth from options
+      if @options[:import].is_a?(Hash)
+        imported_urls = @options[:import][:imported_urls] || []
+        depth = @options[:import][:depth] || 0
+      else
+        imported_urls = []
+        depth = 0
+      end
+
+      # Build import options with base_uri/base_dir for URL resolution
+      import_opts = @options[:import].is_a?(Hash) ? @options[:import].dup : {}
+      import_opts[:base_uri] = base_uri if base_uri
+      import_opts[:base_path] = base_dir if base_dir
+
+      resolve_imports(new_imports, import_opts, imported_urls: imported_urls, depth: depth)
+    end
+
     # @private
     # Internal index mapping media query symbols to rule IDs for efficient filtering.
     # This is an implementation detail and should not be relied upon by external code.
@@ -1138,12 +1806,14 @@ module Cataract
 
       # Get or create fetcher
       fetcher = opts[:fetcher] || ImportResolver::DefaultFetcher.new
+      graph = opts[:graph]
 
-      imports.each do |import|
+      # Check every import before fetching any of them
+      pending = []
+      imports.each_with_index do |import, index|
         next if import.resolved # Skip already resolved imports
 
         url = import.url
-        import_media_query_id = import.media_query_id
 
         # Validate URL
         ImportResolver.validate_url(url, opts)
@@ -1151,124 +1821,40 @@ module Cataract
         # Check for circular references
         raise ImportError, "Circular import detected: #{url}" if imported_urls.include?(url)
 
-        # Fetch imported CSS
-        imported_css = fetcher.call(url, opts)
-
-        # Parse imported CSS recursively
-        imported_urls_copy = imported_urls.dup
-        imported_urls_copy << url
-
-        # Determine the base URI for the imported file
-        # This becomes the new base for resolving relative URLs in the imported CSS
-        imported_base_uri = ImportResolver.normalize_url(url, base_path: opts[:base_path], base_uri: opts[:base_uri]).to_s
-
-        # Build parse options for imported CSS
-        parse_opts = {
-          import: opts.merge(imported_urls: imported_urls_copy, depth: depth + 1, base_uri: imported_base_uri),
-          parser: @parser_options.dup # Inherit parent's parser options (including selector_lists)
-        }
-
-        # If URL conversion is enabled (base_uri present), enable it for imported files too
-        if opts[:base_uri]
-          parse_opts[:absolute_paths] = true
-          parse_opts[:base_uri] = imported_base_uri
-          parse_opts[:uri_resolver] = opts[:uri_resolver]
-        end
-
-        # Pass parent import's media query context to parser so nested imports can combine
-        if import_media_query_id
-          parent_mq = @media_queries[import_media_query_id]
-          parse_opts[:parser][:parent_import_media_type] = parent_mq.type
-          parse_opts[:parser][:parent_import_media_conditions] = parent_mq.conditions
-        end
-
-        imported_sheet = Stylesheet.parse(imported_css, **parse_opts)
-
-        # Wrap rules in @media if import had media query
-        if import_media_query_id
-          # Get the import's MediaQuery object
-          import_mq = @media_queries[import_media_query_id]
-
-          imported_sheet.rules.each do |rule|
-            next unless rule.is_a?(Rule)
-
-            if rule.media_query_id
-              # Rule already has a media query - need to combine them
-              # Example: @import "mobile.css" screen; where mobile.css has @media (max-width: 768px)
-              # Result: screen and (max-width: 768px)
-              existing_mq = imported_sheet.media_queries[rule.media_query_id]
-
-              # Parse combined media query to extract type and conditions
-              # The type is always the import's type (leftmost)
-              combined_type = import_mq.type
-              combined_conditions = if import_mq.conditions && existing_mq.conditions
-                                      "#{import_mq.conditions} and #{existing_mq.conditions}"
-                                    elsif import_mq.conditions
-                                      "#{import_mq.conditions} and #{existing_mq.text}"
-                                    elsif existing_mq.conditions
-                                      existing_mq.conditions
-                                    else
-                                      existing_mq.text
-                                    end
-
-              # Create combined MediaQuery
-              combined_mq = MediaQuery.new(@_next_media_query_id, combined_type, combined_conditions)
-              @media_queries << combined_mq
-              rule.media_query_id = @_next_media_query_id
-              @_next_media_query_id += 1
-            else
-              # Rule has no media query - just assign the import's media query
-              rule.media_query_id = import_media_query_id
-            end
-          end
-        end
-
-        # Merge imported rules into this stylesheet
-        # Insert at current position (before any remaining local rules)
-        insert_position = import.id
-
-        # Insert rules without modifying IDs (will renumber everything after all imports resolved)
-        imported_sheet.rules.each_with_index do |rule, idx|
-          @rules.insert(insert_position + idx, rule)
-        end
-
-        # Merge media index
-        imported_sheet.instance_variable_get(:@media_index).each do |media_sym, rule_ids|
-          if @media_index[media_sym]
-            @media_index[media_sym].concat(rule_ids)
-          else
-            @media_index[media_sym] = rule_ids.dup
-          end
-        end
-
-        # Merge selector_lists with offsetted IDs
-        list_id_offset = @_next_selector_list_id
-        imported_selector_lists = imported_sheet.instance_variable_get(:@_selector_lists)
-        if imported_selector_lists && !imported_selector_lists.empty?
-          imported_selector_lists.each do |list_id, rule_ids|
-            new_list_id = list_id + list_id_offset
-            @_selector_lists[new_list_id] = rule_ids.dup
-          end
-          @_next_selector_list_id = list_id_offset + imported_selector_lists.size
-        end
+        key = ImportResolver.normalize_url(url, base_path: opts[:base_path], base_uri: opts[:base_uri]).to_s
+        pending << [import, index, key]
+      end
+      (@import_graph[opts[:importer]] ||= []).concat(pending.map(&:last)) unless pending.empty?
+
+      # Imports an ImportGraph still holds a parsed copy of skip the fetch
+      imported_sheets = {}
+      to_fetch = []
+      pending.each_with_index do |(_import, _index, key), n|
+        cached = graph&.cached_sheet(key)
+        cached ? imported_sheets[n] = cached : to_fetch << n
+      end
 
-        # Merge media_query_lists with offsetted IDs
-        mq_list_id_offset = @_next_media_query_list_id
-        imported_mq_lists = imported_sheet.instance_variable_get(:@_media_query_lists)
-        if imported_mq_lists && !imported_mq_lists.empty?
-          imported_mq_lists.each do |list_id, mq_ids|
-            new_list_id = list_id + mq_list_id_offset
-            @_media_query_lists[new_list_id] = mq_ids.dup
-          end
-          @_next_media_query_list_id = mq_list_id_offset + imported_mq_lists.size
+      # Fetch sibling imports together (concurrently when the fetcher supports
+      # it). Each one is parsed as it arrives and spliced in as soon as every
+      # import before it is in, so rules always land in document order.
+      inserted = 0
+      next_splice = 0
+      splice_ready = lambda do
+        while (imported_sheet = imported_sheets.delete(next_splice))
+          import, index = pending[next_splice]
+          splice_import(import, index, inserted, imported_sheet)
+          inserted += imported_sheet.rules.size
+          next_splice += 1
         end
-
-        # Merge charset (first one wins per CSS spec)
-        @charset ||= imported_sheet.instance_variable_get(:@charset)
-
-        # Mark as resolved
-        import.resolved = true
       end
+      ImportResolver.fetch_each(fetcher, to_fetch.map { |n| pending[n][0].url }, opts) do |i, imported_css|
+        n = to_fetch[i]
+        imported_sheet = parse_import(pending[n][0], imported_css, opts, imported_urls, depth)
+        graph&.store(pending[n][2], imported_css, imported_sheet)
+        imported_sheets[n] = imported_sheet
+        splice_ready.call
+      end
+      splice_ready.call
 
       # Renumber all rule IDs to be sequential in document order
       # This is O(n) and very fast (~1ms for 30k rules)
@@ -1298,6 +1884,253 @@ module Cataract
       @media_index = {}
     end
 
+    # Parse one fetched import as a stylesheet of its own, resolving its
+    # nested imports with the same options one level deeper
+    #
+    # @return [Stylesheet]
+    def parse_import(import, imported_css, opts, imported_urls, depth)
+      # URLs on the way down, for circular import detection
+      imported_urls_copy = imported_urls.dup
+      imported_urls_copy << import.url
+
+      # Determine the base URI for the imported file
+      # This becomes the new base for resolving relative URLs in the imported CSS
+      imported_base_uri = ImportResolver.normalize_url(import.url, base_path: opts[:base_path], base_uri: opts[:base_uri]).to_s
+
+      # Build parse options for imported CSS
+      parse_opts = {
+        import: opts.merge(imported_urls: imported_urls_copy, depth: depth + 1, base_uri: imported_base_uri,
+                           importer: imported_base_uri),
+        parser: @parser_options.dup # Inherit parent's parser options (including selector_lists)
+      }
+
+      # If URL conversion is enabled (base_uri present), enable it for imported files too
+      if opts[:base_uri]
+        parse_opts[:absolute_paths] = true
+        parse_opts[:base_uri] = imported_base_uri
+        parse_opts[:uri_resolver] = opts[:uri_resolver]
+      end
+
+      # Pass parent import's media query context to parser so nested imports can combine
+      if import.media_query_id
+        parent_mq = @media_queries[import.media_query_id]
+        parse_opts[:parser][:parent_import_media_type] = parent_mq.type
+        parse_opts[:parser][:parent_import_media_conditions] = parent_mq.conditions
+      end
+
+      Stylesheet.parse(imported_css, **parse_opts)
+    end
+
+    # Splice a parsed import into this stylesheet in place of its @import
+    #
+    # @param index [Integer] Position of the import among this block's imports
+    # @param inserted [Integer] Rules already inserted for earlier imports
+    def splice_import(import, index, inserted, imported_sheet)
+      import_media_query_id = import.media_query_id
+
+      # Wrap rules in @media if import had media query
+      if import_media_query_id
+        # Get the import's MediaQuery object
+        import_mq = @media_queries[import_media_query_id]
+
+        imported_sheet.rules.each do |rule|
+          next unless rule.is_a?(Rule)
+
+          if rule.media_query_id
+            # Rule already has a media query - need to combine them
+            # Example: @import "mobile.css" screen; where mobile.css has @media (max-width: 768px)
+            # Result: screen and (max-width: 768px)
+            existing_mq = imported_sheet.media_queries[rule.media_query_id]
+
+            # Parse combined media query to extract type and conditions
+            # The type is always the import's type (leftmost)
+            combined_type = import_mq.type
+            combined_conditions = if import_mq.conditions && existing_mq.conditions
+                                    "#{import_mq.conditions} and #{existing_mq.conditions}"
+                                  elsif import_mq.conditions
+                                    "#{import_mq.conditions} and #{existing_mq.text}"
+                                  elsif existing_mq.conditions
+                                    existing_mq.conditions
+                                  else
+                                    existing_mq.text
+                                  end
+
+            # Create combined MediaQuery
+            combined_mq = MediaQuery.new(@_next_media_query_id, combined_type, combined_conditions)
+            @media_queries << combined_mq
+            rule.media_query_id = @_next_media_query_id
+            @_next_media_query_id += 1
+          else
+            # Rule has no media query - just assign the import's media query
+            rule.media_query_id = import_media_query_id
+          end
+        end
+      end
+
+      # Merge imported rules into this stylesheet
+      # Insert at current position (before any remaining local rules).
+      # Each import takes an ID of its own, so the rule position is its ID
+      # less the imports before it, plus the rules inserted for those.
+      insert_position = import.id - index + inserted
+
+      # Insert rules without modifying IDs (will renumber everything after all imports resolved)
+      imported_sheet.rules.each_with_index do |rule, idx|
+        @rules.insert(insert_position + idx, rule)
+      end
+
+      # Merge media index
+      imported_sheet.instance_variable_get(:@media_index).each do |media_sym, rule_ids|
+        if @media_index[media_sym]
+          @media_index[media_sym].concat(rule_ids)
+        else
+          @media_index[media_sym] = rule_ids.dup
+        end
+      end
+
+      # Merge selector_lists with offsetted IDs
+      list_id_offset = @_next_selector_list_id
+      imported_selector_lists = imported_sheet.instance_variable_get(:@_selector_lists)
+      if imported_selector_lists && !imported_selector_lists.empty?
+        imported_selector_lists.each do |list_id, rule_ids|
+          new_list_id = list_id + list_id_offset
+          @_selector_lists[new_list_id] = rule_ids.dup
+        end
+        @_next_selector_list_id = list_id_offset + imported_selector_lists.size
+      end
+
+      # Merge media_query_lists with offsetted IDs
+      mq_list_id_offset = @_next_media_query_list_id
+      imported_mq_lists = imported_sheet.instance_variable_get(:@_media_query_lists)
+      if imported_mq_lists && !imported_mq_lists.empty?
+        imported_mq_lists.each do |list_id, mq_ids|
+          new_list_id = list_id + mq_list_id_offset
+          @_media_query_lists[new_list_id] = mq_ids.dup
+        end
+        @_next_media_query_list_id = mq_list_id_offset + imported_mq_lists.size
+      end
+
+      # Merge charset (first one wins per CSS spec)
+      @charset ||= imported_sheet.instance_variable_get(:@charset)
+
+      # Merge the imported sheet's own import edges
+      imported_sheet.import_graph.each do |importer, urls|
+        @import_graph[importer] = (@import_graph[importer] || []) | urls
+      end
+
+      # Mark as resolved
+      import.resolved = true
+    end
+
+    # Compact out removed rules in one pass and redo the bookkeeping once:
+    # renumber rule IDs, remap parent and selector list IDs, drop unused
+    # media queries, reset the media index (rebuilt lazily) and clear caches.
+    #
+    # @param removed [Hash{Integer => true}] Removed rule IDs
+    def finish_mutations(removed)
+      unless removed.empty?
+        old_to_new = {}
+        kept = []
+        @rules.each_with_index do |rule, old_id|
+          next if removed.key?(old_id)
+
+          old_to_new[old_id] = kept.size
+          kept << rule
+        end
+
+        kept.each_with_index do |rule, new_id|
+          rule.id = new_id
+          rule.parent_rule_id = old_to_new[rule.parent_rule_id] if rule.is_a?(Rule) && rule.parent_rule_id
+        end
+        @rules = kept
+
+        @_selector_lists.each_value do |rule_ids|
+          rule_ids.map! { |old_id| old_to_new[old_id] }.compact!
+        end
+        @_selector_lists.delete_if { |_list_id, rule_ids| rule_ids.empty? }
+
+        compact_media_queries
+        @_last_rule_id = @rules.length
+      end
+
+      @media_index = {}
+      clear_memoized_caches
+      @_hash = nil
+    end
+
+    # Drop MediaQuery objects no rule or import refers to, renumbering the
+    # rest so that IDs stay equal to their index in @media_queries. A rule
+    # only refers to the first query of a list (@media screen, print), so
+    # the other members of a referenced list are kept too.
+    def compact_media_queries
+      used_mq_ids = {}
+      @rules.each { |r| used_mq_ids[r.media_query_id] = true if r.media_query_id }
+      @imports.each { |i| used_mq_ids[i.media_query_id] = true if i.media_query_id }
+      @_media_query_lists.each_value do |mq_ids|
+        mq_ids.each { |mq_id| used_mq_ids[mq_id] = true } if mq_ids.any? { |mq_id| used_mq_ids.key?(mq_id) }
+      end
+      return if @media_queries.all? { |mq| used_mq_ids.key?(mq.id) }
+
+      old_to_new_mq_id = {}
+      kept = @media_queries.select { |mq| used_mq_ids.key?(mq.id) }
+      @media_queries = kept.each_with_index.map do |mq, new_id|
+        old_to_new_mq_id[mq.id] = new_id
+        MediaQuery.new(new_id, mq.type, mq.conditions)
+      end
+      @_next_media_query_id = @media_queries.size
+
+      @rules.each { |r| r.media_query_id = old_to_new_mq_id[r.media_query_id] if r.media_query_id }
+      @imports.each { |i| i.media_query_id = old_to_new_mq_id[i.media_query_id] if i.media_query_id }
+      @_media_query_lists.each_value { |mq_ids| mq_ids.map! { |mq_id| old_to_new_mq_id[mq_id] }.compact! }
+      @_media_query_lists.delete_if { |_list_id, mq_ids| mq_ids.empty? }
+    end
+
+    # Existing media queries for apply_patch!, keyed by the sorted texts of a
+    # media query list (one text for a query outside any list)
+    #
+    # @return [Hash{Array<String> => Hash{MediaQuery => Integer}}]
+    def patch_media_lookup
+      by_id = {}
+      @media_queries.each { |mq| by_id[mq.id] = mq }
+
+      lookup = {}
+      listed = {}
+      @_media_query_lists.each_value do |mq_ids|
+        members = mq_ids.filter_map { |mq_id| by_id[mq_id] }
+        members.each { |mq| listed[mq.id] = true }
+        lookup[members.map(&:text).sort] ||= members.to_h { |mq| [mq, mq.id] }
+      end
+      @media_queries.each do |mq|
+        lookup[[mq.text]] ||= { mq => mq.id } unless listed[mq.id]
+      end
+      lookup
+    end
+
+    # Find or add the media query (and media query list) for a patched rule
+    #
+    # @param media_queries [Array<MediaQuery>] Rule's media query, then the
+    #   other members of its list
+    # @param lookup [Hash] From {#patch_media_lookup}, updated with additions
+    # @return [Integer] media_query_id in this stylesheet
+    def patch_media_query_id(media_queries, lookup)
+      key = media_queries.map(&:text).sort
+      existing = lookup[key]
+      return existing[media_queries.first] if existing
+
+      ids = media_queries.map do |mq|
+        id = @_next_media_query_id
+        @media_queries << MediaQuery.new(id, mq.type, mq.conditions)
+        @_next_media_query_id += 1
+        id
+      end
+      if ids.size > 1
+        @_media_query_lists[@_next_media_query_list_id] = ids
+        @_next_media_query_list_id += 1
+      end
+
+      lookup[key] = media_queries.zip(ids).to_h
+      ids.first
+    end
+
     # Check if a rule matches any of the requested media queries
     #
     # @param rule_id [Integer] Rule ID to check
@@ -1340,6 +2173,13 @@ module Cataract
       @_custom_properties = nil
     end
 
+    # Serializer options hash for #to_s / #to_formatted_s (nil when all off)
+    def output_options(consolidate_media:, compression_order:)
+      return nil unless consolidate_media || compression_order
+
+      { consolidate_media: consolidate_media, compression_order: compression_order }
+    end
+
     # Build custom properties hash organized by media context
     #
     # @return [Hash{Symbol => Hash{String => String}}] Media contexts mapped to custom properties
@@ -0,0 +1,341 @@
+# frozen_string_literal: true
+
+module Cataract
+  # A single change in a {StylesheetDiff}.
+  #
+  # @attr [Symbol] type :added, :removed or :modified
+  # @attr [Integer, nil] old_index Position of the rule in the old stylesheet (nil for :added)
+  # @attr [Integer, nil] new_index Position of the rule in the new stylesheet (nil for :removed)
+  # @attr [Rule, AtRule] rule The new rule (:added, :modified) or the old rule (:removed)
+  # @attr [Array<MediaQuery>, nil] media_queries Media query of an added/modified rule,
+  #   followed by the other members of its media query list ("screen, print")
+  DiffOperation = Struct.new(:type, :old_index, :new_index, :rule, :media_queries) unless const_defined?(:DiffOperation)
+
+  # Rule-level difference between two stylesheets.
+  #
+  # Created by {Stylesheet.diff} and applied with {Stylesheet#apply_patch!}.
+  # Each rule gets a fingerprint of its media context, selector (and parent
+  # selector for nested rules) and declarations. The two fingerprint
+  # sequences are aligned patience-diff style: common prefix and suffix are
+  # trimmed, then rules whose fingerprint is unique on both sides anchor the
+  # alignment (longest increasing subsequence) and the gaps between anchors
+  # are aligned recursively. Only small anchorless gaps fall back to an LCS
+  # table, so large stylesheets with local edits diff in near-linear time.
+  #
+  # Within each gap, a removed and an added rule with the same media context
+  # and selector are reported as one :modified operation.
+  #
+  # Only rules are compared; @import statements and @charset are not.
+  #
+  # @example
+  #   diff = Cataract::Stylesheet.diff(old_sheet, new_sheet)
+  #   diff.modified.map { |op| op.rule.selector } #=> [".btn"]
+  #   old_sheet.apply_patch!(diff)
+  #   old_sheet.to_s == new_sheet.to_s #=> true
+  class StylesheetDiff
+    include Enumerable
+
+    # Largest anchorless gap (old rules * new rules) aligned with an LCS
+    # table; bigger gaps are reported as removed + added.
+    LCS_LIMIT = 250_000
+
+    # @return [Array<DiffOperation>] Operations in document order
+    attr_reader :operations
+
+    # @return [Integer] Number of rules in the old stylesheet
+    attr_reader :old_size
+
+    # @return [Integer] Number of rules in the new stylesheet
+    attr_reader :new_size
+
+    # @return [Array<Integer, nil>] selector_list_id of each rule in the new
+    #   stylesheet, by position, so a patch also regroups unchanged rules
+    attr_reader :new_selector_list_ids
+
+    # Compute the difference between two stylesheets.
+    #
+    # @param old_sheet [Stylesheet] Stylesheet the patch applies to
+    # @param new_sheet [Stylesheet] Stylesheet the patch produces
+    # @return [StylesheetDiff]
+    def self.compute(old_sheet, new_sheet)
+      raise TypeError, "wrong argument type #{old_sheet.class} (expected Stylesheet)" unless old_sheet.is_a?(Stylesheet)
+      raise TypeError, "wrong argument type #{new_sheet.class} (expected Stylesheet)" unless new_sheet.is_a?(Stylesheet)
+
+      old_keys, old_prints = fingerprints(old_sheet)
+      new_keys, new_prints = fingerprints(new_sheet)
+      matches = []
+      align(old_prints, 0, old_prints.size, new_prints, 0, new_prints.size, matches)
+
+      new_media = media_query_lists(new_sheet)
+      operations = []
+      old_pos = 0
+      new_pos = 0
+      (matches << [old_prints.size, new_prints.size]).each do |old_match, new_match|
+        if old_pos < old_match || new_pos < new_match
+          gap_operations(operations, old_sheet.rules, old_keys, old_pos...old_match,
+                         new_sheet.rules, new_keys, new_pos...new_match, new_media)
+        end
+        old_pos = old_match + 1
+        new_pos = new_match + 1
+      end
+
+      new_selector_list_ids = new_sheet.rules.map { |rule| rule.selector_list_id if rule.is_a?(Rule) }
+      new(operations, old_prints.size, new_prints.size, new_selector_list_ids)
+    end
+
+    # Media query of each media_query_id, followed by the other members of
+    # its media query list ("screen, print").
+    #
+    # @api private
+    # @param sheet [Stylesheet]
+    # @return [Hash{Integer => Array<MediaQuery>}]
+    def self.media_query_lists(sheet)
+      by_id = {}
+      sheet.media_queries.each { |mq| by_id[mq.id] = [mq] }
+      sheet.instance_variable_get(:@_media_query_lists).each_value do |mq_ids|
+        members = mq_ids.filter_map { |mq_id| by_id[mq_id]&.first }
+        mq_ids.each do |mq_id|
+          next unless by_id[mq_id]
+
+          by_id[mq_id] = [by_id[mq_id].first] + members.reject { |mq| mq.id == mq_id }
+        end
+      end
+      by_id
+    end
+
+    # @param operations [Array<DiffOperation>]
+    # @param old_size [Integer]
+    # @param new_size [Integer]
+    # @param new_selector_list_ids [Array<Integer, nil>]
+    def initialize(operations, old_size, new_size, new_selector_list_ids)
+      @operations = operations
+      @old_size = old_size
+      @new_size = new_size
+      @new_selector_list_ids = new_selector_list_ids
+    end
+
+    # Iterate over operations.
+    #
+    # @yieldparam operation [DiffOperation]
+    # @return [self, Enumerator]
+    def each(&)
+      return enum_for(:each) { @operations.size } unless block_given?
+
+      @operations.each(&)
+      self
+    end
+
+    # @return [Array<DiffOperation>] :added operations
+    def added
+      @operations.select { |op| op.type == :added }
+    end
+
+    # @return [Array<DiffOperation>] :removed operations
+    def removed
+      @operations.select { |op| op.type == :removed }
+    end
+
+    # @return [Array<DiffOperation>] :modified operations
+    def modified
+      @operations.select { |op| op.type == :modified }
+    end
+
+    # @return [Integer] Number of operations
+    def size
+      @operations.size
+    end
+    alias length size
+
+    # @return [Boolean] true if the stylesheets have the same rules
+    def empty?
+      @operations.empty?
+    end
+
+    def inspect
+      "#<Cataract::StylesheetDiff +#{added.size} -#{removed.size} ~#{modified.size}>"
+    end
+
+    class << self
+      private
+
+      # Identity key (media context + selector) and full fingerprint per rule
+      def fingerprints(sheet)
+        rules = sheet.rules
+        media_texts = {}
+        media_query_lists(sheet).each do |mq_id, mqs|
+          media_texts[mq_id] = mqs.map(&:text).join(', ')
+        end
+
+        keys = Array.new(rules.size)
+        prints = Array.new(rules.size)
+        rules.each_with_index do |rule, index|
+          key = +"#{media_texts[rule.media_query_id]}\x00#{rule.selector}"
+          if rule.is_a?(Rule)
+            parent = rules[rule.parent_rule_id] if rule.parent_rule_id
+            key << "\x00" << parent.selector if parent
+            body = declarations_fingerprint(rule.declarations)
+            body << "\x00" << rule.nesting_style.to_s
+          else
+            body = +''
+            rule.content.each do |item|
+              if item.is_a?(Declaration)
+                append_declaration(body, item)
+              else
+                body << item.selector << "{" << declarations_fingerprint(item.declarations) << "}"
+              end
+            end
+          end
+          keys[index] = key
+          prints[index] = "#{key}\x01#{body}"
+        end
+        [keys, prints]
+      end
+
+      def declarations_fingerprint(declarations)
+        body = +''
+        declarations.each { |decl| append_declaration(body, decl) }
+        body
+      end
+
+      def append_declaration(body, decl)
+        body << decl.property << "\x00" << decl.value << (decl.important ? "\x00!\x00" : "\x00\x00")
+      end
+
+      # Append matched [old_index, new_index] pairs for a[a_lo...a_hi] and
+      # b[b_lo...b_hi] to matches, in increasing order
+      def align(a, a_lo, a_hi, b, b_lo, b_hi, matches)
+        while a_lo < a_hi && b_lo < b_hi && a[a_lo] == b[b_lo]
+          matches << [a_lo, b_lo]
+          a_lo += 1
+          b_lo += 1
+        end
+
+        suffix = []
+        while a_lo < a_hi && b_lo < b_hi && a[a_hi - 1] == b[b_hi - 1]
+          a_hi -= 1
+          b_hi -= 1
+          suffix << [a_hi, b_hi]
+        end
+
+        if a_lo < a_hi && b_lo < b_hi
+          anchors = unique_anchors(a, a_lo, a_hi, b, b_lo, b_hi)
+          if anchors.empty?
+            lcs(a, a_lo, a_hi, b, b_lo, b_hi, matches) if (a_hi - a_lo) * (b_hi - b_lo) <= LCS_LIMIT
+          else
+            prev_a = a_lo
+            prev_b = b_lo
+            anchors.each do |i, j|
+              align(a, prev_a, i, b, prev_b, j, matches)
+              matches << [i, j]
+              prev_a = i + 1
+              prev_b = j + 1
+            end
+            align(a, prev_a, a_hi, b, prev_b, b_hi, matches)
+          end
+        end
+
+        matches.concat(suffix.reverse!) unless suffix.empty?
+      end
+
+      # Fingerprints that occur exactly once in both ranges, reduced to the
+      # longest run that is increasing on both sides (patience sorting)
+      def unique_anchors(a, a_lo, a_hi, b, b_lo, b_hi)
+        counts = {}
+        (a_lo...a_hi).each do |i|
+          entry = counts[a[i]]
+          if entry
+            entry[0] += 1
+          else
+            counts[a[i]] = [1, i, 0, nil]
+          end
+        end
+        (b_lo...b_hi).each do |j|
+          entry = counts[b[j]]
+          next unless entry
+
+          entry[2] += 1
+          entry[3] = j
+        end
+
+        candidates = []
+        (a_lo...a_hi).each do |i|
+          entry = counts[a[i]]
+          candidates << [i, entry[3]] if entry[0] == 1 && entry[2] == 1
+        end
+        return candidates if candidates.size <= 1
+
+        # Longest increasing subsequence of new indices
+        tails = []
+        previous = Array.new(candidates.size)
+        candidates.each_with_index do |(_, j), index|
+          pos = tails.bsearch_index { |tail| candidates[tail][1] >= j } || tails.size
+          previous[index] = tails[pos - 1] if pos > 0
+          tails[pos] = index
+        end
+
+        result = []
+        index = tails.last
+        while index
+          result << candidates[index]
+          index = previous[index]
+        end
+        result.reverse!
+      end
+
+      # Classic LCS table for small anchorless gaps
+      def lcs(a, a_lo, a_hi, b, b_lo, b_hi, matches)
+        rows = a_hi - a_lo
+        cols = b_hi - b_lo
+        table = Array.new(rows + 1) { Array.new(cols + 1, 0) }
+        (rows - 1).downto(0) do |i|
+          row = table[i]
+          below = table[i + 1]
+          (cols - 1).downto(0) do |j|
+            row[j] = if a[a_lo + i] == b[b_lo + j]
+                       below[j + 1] + 1
+                     else
+                       [below[j], row[j + 1]].max
+                     end
+          end
+        end
+
+        i = 0
+        j = 0
+        while i < rows && j < cols
+          if a[a_lo + i] == b[b_lo + j]
+            matches << [a_lo + i, b_lo + j]
+            i += 1
+            j += 1
+          elsif table[i + 1][j] >= table[i][j + 1]
+            i += 1
+          else
+            j += 1
+          end
+        end
+      end
+
+      # Turn one unmatched gap into removed / modified / added operations
+      def gap_operations(operations, old_rules, old_keys, old_range, new_rules, new_keys, new_range, new_media)
+        pending = {}
+        old_range.each { |i| (pending[old_keys[i]] ||= []) << i }
+
+        changes = []
+        paired = {}
+        new_range.each do |j|
+          i = pending[new_keys[j]]&.shift
+          if i
+            paired[i] = true
+            changes << DiffOperation.new(:modified, i, j, new_rules[j], new_media[new_rules[j].media_query_id])
+          else
+            changes << DiffOperation.new(:added, nil, j, new_rules[j], new_media[new_rules[j].media_query_id])
+          end
+        end
+
+        old_range.each do |i|
+          operations << DiffOperation.new(:removed, i, nil, old_rules[i], nil) unless paired[i]
+        end
+        operations.concat(changes)
+      end
+    end
+  end
+end
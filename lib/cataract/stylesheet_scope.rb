@@ -248,6 +248,41 @@ module Cataract
       to_a
     end
 
+    # Serialize the matching rules to a CSS string.
+    #
+    # Forces evaluation of the scope. Rule IDs are passed straight to the
+    # serializer, so rules keep their @media wrappers and rules from the same
+    # selector list are grouped back together (only those in the scope).
+    #
+    # @return [String] CSS string
+    #
+    # @example
+    #   sheet.with_media(:print).to_s  # => "@media print {\n.footer { color: red; }\n}\n"
+    def to_s
+      @stylesheet._serialize_rule_ids(map(&:id))
+    end
+    alias to_css to_s
+
+    # Serialize the matching rules to a formatted CSS string.
+    #
+    # @return [String] Formatted CSS string
+    # @see #to_s
+    def to_formatted_s
+      @stylesheet._serialize_rule_ids(map(&:id), formatted: true)
+    end
+
+    # Write the matching rules as CSS to an IO.
+    #
+    # @param io [IO, StringIO] Any object responding to #write
+    # @param formatted [Boolean] Use formatted output (default: false)
+    # @return [Integer] Result of io.write
+    #
+    # @example
+    #   File.open('print.css', 'w') { |f| sheet.with_media(:print).write_to(f) }
+    def write_to(io, formatted: false)
+      io.write(@stylesheet._serialize_rule_ids(map(&:id), formatted: formatted))
+    end
+
     # Human-readable representation showing filtered results.
     #
     # Forces evaluation of the scope and displays results.
@@ -0,0 +1,210 @@
+# frozen_string_literal: true
+
+module Cataract
+  # Per-page bundles of a stylesheet with a shared common chunk.
+  #
+  # Created by {Stylesheet#split}. Each page is described by the set of
+  # tokens its markup uses: element names ("nav"), classes (".btn") and
+  # ids ("#main"), as returned by {Cataract.selector_tokens} for a selector.
+  # A rule is used by a page when every token of at least one of its
+  # selectors is in the page's set; selectors without tokens (":root", "*")
+  # are used by every page. Token extraction and page matching run in the
+  # native extension.
+  #
+  # Rules used by more than +shared_threshold+ of the pages go to {#shared},
+  # the rest to the {#pages} that use them, and rules no page uses are
+  # dropped. Nested rules travel with their top-level rule, and at-rules
+  # (@font-face, @keyframes, ...) always go to the shared chunk.
+  #
+  # Pages load the shared chunk first, so a rule may only move there if no
+  # earlier page-only rule could be overridden by it. A candidate that sets
+  # a property family ("margin" for margin-top, "width" for inline-size, as
+  # in media consolidation) already set by an earlier page-only rule on one
+  # of its pages stays in the page chunks instead. This is conservative: it
+  # does not compare selectors or specificity.
+  #
+  # @example
+  #   split = sheet.split(pages: {
+  #     home: Set['body', 'nav', '.hero'],
+  #     blog: Set['body', 'nav', 'article', '.post']
+  #   })
+  #   File.write('common.css', split.shared.to_s)
+  #   split.pages.each { |name, chunk| File.write("#{name}.css", chunk.to_s) }
+  class StylesheetSplit
+    # @return [Stylesheet] Rules used by most pages, plus at-rules and @imports
+    attr_reader :shared
+
+    # @return [Hash{Object => Stylesheet}] Page-only rules per page, in the
+    #   order the pages were given
+    attr_reader :pages
+
+    # @return [Array<Rule>] Rules no page uses (from the source stylesheet)
+    attr_reader :unused
+
+    # @param shared [Stylesheet]
+    # @param pages [Hash{Object => Stylesheet}]
+    # @param unused [Array<Rule>]
+    def initialize(shared, pages, unused)
+      @shared = shared
+      @pages = pages
+      @unused = unused
+    end
+
+    # Split a stylesheet. See {Stylesheet#split}.
+    #
+    # @param sheet [Stylesheet] Stylesheet to split (not modified)
+    # @param pages [Hash{Object => Enumerable<String>}] Page name => tokens used
+    # @param shared_threshold [Float] Fraction of pages above which a rule is shared
+    # @return [StylesheetSplit]
+    def self.compute(sheet, pages, shared_threshold)
+      raise TypeError, "pages must be a Hash, got #{pages.class}" unless pages.is_a?(Hash)
+      unless shared_threshold.is_a?(Numeric) && shared_threshold >= 0 && shared_threshold <= 1
+        raise ArgumentError, "shared_threshold must be between 0 and 1, got #{shared_threshold.inspect}"
+      end
+
+      names = pages.keys
+      token_masks = Hash.new(0)
+      names.each_with_index do |name, page|
+        pages[name].each { |token| token_masks[token.to_s] |= 1 << page }
+      end
+      all_pages = (1 << names.size) - 1
+
+      rules = sheet.rules
+      masks = Cataract._rule_page_masks(rules, token_masks, all_pages)
+      shared_minimum = shared_threshold * names.size
+
+      shared_rules = []
+      page_rules = Array.new(names.size) { [] }
+      unused = []
+      blocked = {} # property family => pages with an earlier page-only rule setting it
+      units(rules, masks).each do |indexes, mask, families|
+        if mask.nil?
+          shared_rules.concat(indexes)
+        elsif mask == 0
+          indexes.each { |index| unused << rules[index] }
+        elsif mask.to_s(2).count('1') > shared_minimum && !overrides_page_rules?(families, mask, blocked)
+          shared_rules.concat(indexes)
+        else
+          each_page(mask) { |page| page_rules[page].concat(indexes) }
+          families.each { |family| blocked[family] = blocked.fetch(family, 0) | mask }
+        end
+      end
+
+      media_lists = StylesheetDiff.media_query_lists(sheet)
+      shared = build_chunk(sheet, shared_rules, media_lists, imports: true)
+      chunks = {}
+      names.each_with_index { |name, page| chunks[name] = build_chunk(sheet, page_rules[page], media_lists) }
+      new(shared, chunks, unused)
+    end
+
+    # @return [Integer] Number of page chunks
+    def size
+      @pages.size
+    end
+
+    def inspect
+      "#<Cataract::StylesheetSplit shared=#{@shared.size} pages=#{@pages.size} unused=#{@unused.size}>"
+    end
+
+    class << self
+      private
+
+      # Top-level rules with their nested rules, in source order:
+      # [rule indexes, page mask (nil for at-rules), property families]
+      def units(rules, masks)
+        # Rule ids can run ahead of positions (@import consumes ids)
+        positions = {}
+        rules.each_with_index { |rule, index| positions[rule.id] = index }
+
+        by_root = {}
+        rules.each_with_index do |rule, index|
+          root = index
+          while rules[root].is_a?(Rule) && (parent = positions[rules[root].parent_rule_id])
+            root = parent
+          end
+
+          unit = (by_root[root] ||= [[], 0, {}])
+          unit[0] << index
+          if masks[index].nil?
+            unit[1] = nil
+            next
+          end
+
+          unit[1] |= masks[index] if unit[1]
+          rule.declarations.each { |decl| unit[2][Cataract._property_family(decl.property)] = true }
+        end
+        by_root.each_value.map { |indexes, mask, families| [indexes, mask, families.keys] }
+      end
+
+      # Would a shared rule setting these families override an earlier
+      # page-only rule on one of its pages? "all" resets every family.
+      def overrides_page_rules?(families, mask, blocked)
+        return blocked.each_value.any? { |pages| pages & mask != 0 } if families.include?('all')
+
+        blocked.fetch('all', 0) & mask != 0 || families.any? { |family| blocked.fetch(family, 0) & mask != 0 }
+      end
+
+      def each_page(mask)
+        while mask != 0
+          low = mask & -mask
+          yield low.bit_length - 1
+          mask ^= low
+        end
+      end
+
+      # New stylesheet with copies of the given rules, renumbered in order
+      def build_chunk(sheet, indexes, media_lists, imports: false)
+        chunk = Stylesheet.new
+        chunk.instance_variable_set(:@parser_options, sheet.instance_variable_get(:@parser_options).dup)
+        lookup = chunk.send(:patch_media_lookup)
+        media_ids = {}
+        remap_media = lambda do |media_query_id|
+          media_ids[media_query_id] ||= chunk.send(:patch_media_query_id, media_lists[media_query_id], lookup)
+        end
+
+        new_ids = {}
+        selector_lists = {}
+        rules = indexes.each_with_index.map do |index, new_id|
+          source = sheet.rules[index]
+          new_ids[source.id] = new_id
+          rule = source.dup
+          rule.id = new_id
+          if rule.is_a?(Rule)
+            rule.declarations = source.declarations.map(&:dup)
+            rule.parent_rule_id = new_ids[source.parent_rule_id] if source.parent_rule_id
+            (selector_lists[source.selector_list_id] ||= []) << rule if source.selector_list_id
+          else
+            rule.content = source.content.dup
+          end
+          rule.media_query_id = remap_media.call(source.media_query_id) if source.media_query_id
+          rule
+        end
+
+        lists = {}
+        selector_lists.each_value do |members|
+          if members.size > 1
+            members.each { |rule| rule.selector_list_id = lists.size }
+            lists[lists.size] = members.map(&:id)
+          else
+            members.first.selector_list_id = nil
+          end
+        end
+
+        if imports
+          chunk.instance_variable_set(:@imports, sheet.imports.map do |import|
+            copy = import.dup
+            copy.media_query_id = remap_media.call(import.media_query_id) if import.media_query_id
+            copy
+          end)
+        end
+        chunk.instance_variable_set(:@charset, sheet.charset)
+        chunk.instance_variable_set(:@rules, rules)
+        chunk.instance_variable_set(:@_last_rule_id, rules.size)
+        chunk.instance_variable_set(:@_selector_lists, lists)
+        chunk.instance_variable_set(:@_next_selector_list_id, lists.size)
+        chunk.instance_variable_set(:@_has_nesting, rules.any? { |rule| rule.is_a?(Rule) && rule.parent_rule_id })
+        chunk
+      end
+    end
+  end
+end
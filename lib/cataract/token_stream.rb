@@ -0,0 +1,82 @@
+# frozen_string_literal: true
+
+module Cataract
+  # CSS Syntax Level 3 tokens for a CSS string.
+  #
+  # The string is tokenized once into compact records (type, byte offset, byte
+  # length). Nothing is sliced out of the source until asked for: {#text} and
+  # {#value} build Strings on demand, numbers are parsed when read, and units
+  # are interned frozen Strings.
+  #
+  # Token types: :ident, :function, :at_keyword, :hash, :string, :bad_string,
+  # :url, :bad_url, :delim, :number, :percentage, :dimension, :whitespace,
+  # :cdo, :cdc, :colon, :semicolon, :comma, :left_square, :right_square,
+  # :left_paren, :right_paren, :left_brace, :right_brace, and :comment (only
+  # with +comments: true+).
+  #
+  # The class and its accessors are implemented natively (see
+  # ext/cataract/tokenizer.c) or by lib/cataract/pure/tokenizer.rb.
+  #
+  # @example Find every hex color
+  #   tokens = Cataract::TokenStream.new(css)
+  #   tokens.each_with_index.select { |(type, *), _| type == :hash }.map { |_, i| tokens.text(i) }
+  #
+  # @example Read a dimension
+  #   tokens = Cataract::TokenStream.new('1.5em')
+  #   tokens[0] #=> [:dimension, 0, 5, 1.5, "em"]
+  #
+  # @see Cataract.each_token Streaming variant that doesn't keep the records
+  class TokenStream
+    include Enumerable
+
+    # @!method initialize(css, comments: false)
+    #   @param css [String] CSS source (a frozen copy is kept)
+    #   @param comments [Boolean] Emit :comment tokens (default: false)
+
+    # @!method size
+    #   @return [Integer] Number of tokens
+
+    # @!method each
+    #   Yields each token record as [type, offset, length, number, unit]:
+    #   the type Symbol, byte offset into {#source}, byte length, the value
+    #   of number/percentage/dimension tokens (Integer or Float, else nil) and
+    #   the dimension unit as written ("%" for percentages, else nil).
+    #   @yieldparam record [Array] Token record
+    #   @return [self, Enumerator]
+
+    # @!method [](index)
+    #   @return [Array] Token record [type, offset, length, number, unit]
+    #   @raise [IndexError] If index is out of range
+
+    # @!method type(index)
+    #   @return [Symbol] Token type
+
+    # @!method number(index)
+    #   @return [Integer, Float, nil] Numeric value (integers stay Integers)
+
+    # @!method unit(index)
+    #   @return [String, nil] Unit of a dimension ("%" for percentages)
+
+    # @!method text(index)
+    #   @return [String] Source text of the token
+
+    # @!method value(index)
+    #   Token value with escapes decoded: the name of an ident, function,
+    #   at-keyword or hash (without '@' / '#' / '('), the contents of a string
+    #   or url, or the delim character. nil for other tokens.
+    #   @return [String, nil]
+
+    # @!method source
+    #   @return [String] The frozen source string
+
+    # @return [Integer] Number of tokens
+    def length
+      size
+    end
+
+    # @return [String] Inspection string
+    def inspect
+      "#<Cataract::TokenStream (#{size} tokens)>"
+    end
+  end
+end
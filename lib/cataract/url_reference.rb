@@ -0,0 +1,35 @@
+# frozen_string_literal: true
+
+module Cataract
+  # A url() reference found in a stylesheet, as returned by {Stylesheet#urls}.
+  #
+  # UrlReference is a Struct with fields: (url, rule_id, property, declaration_index, block_index)
+  #
+  # For declaration values, +rule_id+ is the id of the Rule or AtRule and
+  # +declaration_index+ the position of the declaration within it. Inside
+  # @keyframes, +block_index+ is the index of the keyframe block (from, 50%,
+  # to, ...) in the AtRule's content. For @import statements, +rule_id+ is the
+  # ImportStatement id and +property+ / +declaration_index+ are nil.
+  #
+  # @example
+  #   sheet = Cataract.parse_css('.logo { background: url(logo.png) }')
+  #   ref = sheet.urls.first
+  #   ref.url #=> "logo.png"
+  #   ref.property #=> "background"
+  #
+  # @attr [String] url URL text as written (without quotes)
+  # @attr [Integer] rule_id Rule, AtRule or ImportStatement id
+  # @attr [String, nil] property Declaration property, or nil for @import
+  # @attr [Integer, nil] declaration_index Index into the rule's declarations, or nil for @import
+  # @attr [Integer, nil] block_index Keyframe block index inside @keyframes, otherwise nil
+  UrlReference = Struct.new(:url, :rule_id, :property, :declaration_index, :block_index) unless const_defined?(:UrlReference)
+
+  class UrlReference
+    # Check if this reference comes from an @import statement.
+    #
+    # @return [Boolean] true for @import URLs
+    def import?
+      property.nil?
+    end
+  end
+end
@@ -0,0 +1,323 @@
+#!/usr/bin/env ruby
+# frozen_string_literal: true
+
+# Algorithmic-complexity fuzzer - looks for inputs that are slow, not crashing
+#
+# Generates CSS from a shape (rule count, selector list width, nesting depth,
+# near-duplicate @media blocks, ...) and grows one dimension at a time while
+# measuring time and object allocations per input byte for parse, flatten,
+# to_s and the scopes. A series whose cost grows faster than its input
+# (log-log slope above the threshold) is flagged, the other dimensions are
+# shrunk while it stays flagged, and the result is written as a regression
+# fixture for benchmarks/benchmark_complexity.rb.
+#
+# Usage: ruby scripts/fuzzer/complexity.rb [iterations] [rng_seed]
+#   iterations: random shapes to try after the built-in dimensions (default: 20)
+#   rng_seed:   random number generator seed for reproducibility (default: random)
+#
+# Environment:
+#   CATARACT_PURE=1          Measure the pure Ruby implementation
+#   COMPLEXITY_EXPONENT      Slope that counts as superlinear (default: 1.3)
+#   COMPLEXITY_MAX_BYTES     Largest input in a series (default: 256KB)
+#   COMPLEXITY_FIXTURES      Fixture directory (default: benchmarks/fixtures/complexity)
+
+require 'digest'
+require 'fileutils'
+
+PURE_RUBY = ENV['CATARACT_PURE'] == '1'
+if PURE_RUBY
+  require_relative '../../lib/cataract/pure'
+else
+  require_relative '../../lib/cataract'
+end
+
+ITERATIONS = (ARGV[0] || 20).to_i
+RNG_SEED = (ARGV[1] || Random.new_seed).to_i
+srand(RNG_SEED)
+
+EXPONENT_THRESHOLD = (ENV['COMPLEXITY_EXPONENT'] || 1.3).to_f
+MAX_BYTES = (ENV['COMPLEXITY_MAX_BYTES'] || 256 * 1024).to_i
+FIXTURES_DIR = ENV['COMPLEXITY_FIXTURES'] || File.expand_path('../../benchmarks/fixtures/complexity', __dir__)
+
+# Stop growing a series once one measurement takes this long
+TIME_CAP = 0.5
+# Stop growing before the input expands to more rules than this (nesting and
+# selector lists multiply, so a single step can otherwise take minutes)
+MAX_EXPANDED_RULES = 200_000
+# Timings below this are too noisy to fit
+MIN_FIT_TIME = 0.002
+# Fit only points within this factor of the largest input
+FIT_RANGE = 16
+# Extra slope a timing fit needs before it counts as superlinear
+TIME_MARGIN = 0.3
+# Fixtures are cut at the largest size that still runs this fast
+FIXTURE_TIME = 0.05
+# Minimization re-runs whole series; bound the attempts per finding
+MAX_MINIMIZE_STEPS = 40
+
+# Structural dimensions of a generated stylesheet
+#   min/base: smallest and starting value
+#   max:      largest value a series grows to
+#   grow:     :double or :step (+1); nil for dimensions that are only varied
+#             between shapes, never grown
+DIMENSIONS = {
+  rules: { min: 1, base: 20, max: 1_000_000, grow: :double },
+  selectors: { min: 1, base: 2, max: 100_000, grow: :double },
+  declarations: { min: 1, base: 3, max: 100_000, grow: :double },
+  value_length: { min: 1, base: 8, max: 1_000_000, grow: :double },
+  nest_depth: { min: 0, base: 1, max: 8, grow: :step },
+  nest_selectors: { min: 1, base: 2, max: 100_000, grow: :double },
+  media: { min: 0, base: 4, max: 1_000_000, grow: :double },
+  distinct: { min: 0, base: 0, max: 0, grow: nil } # Selector pool size (0 = every selector unique)
+}.freeze
+
+PROPERTIES = %w[color margin padding border font background top left display width].freeze
+
+# Operations measured on each input; everything but parse runs on a sheet
+# parsed outside the timing
+OPERATIONS = {
+  'parse' => ->(css, _sheet) { Cataract.parse_css(css) },
+  'flatten' => ->(_css, sheet) { sheet.flatten },
+  'to_s' => ->(_css, sheet) { sheet.to_s },
+  'to_formatted_s' => ->(_css, sheet) { sheet.to_formatted_s },
+  'scopes' => lambda { |_css, sheet|
+    sheet.with_media(:screen).to_a
+    sheet.with_selector('.s0-0').to_a
+    sheet.with_property('color').base_only.to_a
+  }
+}.freeze
+
+def selector_name(shape, rule, index)
+  pool = shape[:distinct]
+  pool.positive? ? ".s#{((rule * shape[:selectors]) + index) % pool}-0" : ".s#{rule}-#{index}"
+end
+
+def declarations(shape)
+  value = 'v' * shape[:value_length]
+  Array.new(shape[:declarations]) do |i|
+    property = i < PROPERTIES.size ? PROPERTIES[i] : "--p#{i}"
+    "#{property}: #{value};"
+  end.join(' ')
+end
+
+def nested_block(shape, level, decls)
+  return '' if level > shape[:nest_depth]
+
+  selectors = Array.new(shape[:nest_selectors]) { |i| "& .n#{level}-#{i}" }.join(', ')
+  " #{selectors} { #{decls}#{nested_block(shape, level + 1, decls)} }"
+end
+
+def build_css(shape)
+  decls = declarations(shape)
+  nested = nested_block(shape, 1, decls)
+  css = +''
+  shape[:rules].times do |rule|
+    selectors = Array.new(shape[:selectors]) { |i| selector_name(shape, rule, i) }.join(', ')
+    css << "#{selectors} { #{decls}#{nested} }\n"
+  end
+  # Near-duplicate media queries: same feature, a different breakpoint each
+  shape[:media].times do |i|
+    css << "@media screen and (min-width: #{i}px) { #{selector_name(shape, i, 0)} { #{decls} } }\n"
+  end
+  css
+end
+
+# Rules the parser creates from shape, after selector lists and nesting expand
+def expanded_rules(shape)
+  nested = (1..shape[:nest_depth]).sum { |depth| shape[:nest_selectors]**depth }
+  (shape[:rules] * shape[:selectors] * (1 + nested)) + shape[:media]
+end
+
+def grow(shape, dimension)
+  value = shape[dimension]
+  value = DIMENSIONS[dimension][:grow] == :step ? value + 1 : [value * 2, 1].max
+  shape.merge(dimension => value)
+end
+
+# Fastest of a few runs; allocations from the first (they do not vary)
+def measure(operation, css, sheet)
+  GC.start
+  allocated = GC.stat(:total_allocated_objects)
+  best = nil
+  3.times do |run|
+    started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    OPERATIONS[operation].call(css, sheet)
+    elapsed = Process.clock_gettime(Process::CLOCK_MONOTONIC) - started
+    allocated = GC.stat(:total_allocated_objects) - allocated if run.zero?
+    best = elapsed if best.nil? || elapsed < best
+    break if elapsed > TIME_CAP / 4
+  end
+  [best, allocated]
+end
+
+# Grow dimension from shape until the input, the expansion or the time gets
+# too large
+#
+# @return [Array<Hash>] Points with :shape, :bytes, :time, :allocations
+def series(shape, dimension, operation)
+  points = []
+  loop do
+    break if shape[dimension] > DIMENSIONS[dimension][:max]
+    break if expanded_rules(shape) > MAX_EXPANDED_RULES
+
+    css = build_css(shape)
+    break if css.bytesize > MAX_BYTES
+
+    begin
+      sheet = operation == 'parse' ? nil : Cataract.parse_css(css)
+      time, allocations = measure(operation, css, sheet)
+    rescue Cataract::Error
+      break # Hit a hard limit (e.g. MAX_MEDIA_QUERIES) - nothing to measure beyond it
+    end
+    points << { shape: shape, bytes: css.bytesize, time: time, allocations: allocations }
+    break if time > TIME_CAP
+
+    shape = grow(shape, dimension)
+  end
+  points
+end
+
+# Least-squares slope of log(cost) against log(bytes), over the largest
+# sizes only so fixed per-call costs do not bend the fit
+def slope(points, key, minimum)
+  largest = points.last ? points.last[:bytes] : 0
+  points = points.select { |point| point[key] >= minimum && point[:bytes] * FIT_RANGE >= largest }
+  return nil if points.size < 3 || points.last[:bytes] < points.first[:bytes] * 2
+
+  xs = points.map { |point| Math.log(point[:bytes]) }
+  ys = points.map { |point| Math.log(point[key]) }
+  x_mean = xs.sum / xs.size
+  y_mean = ys.sum / ys.size
+  numerator = xs.zip(ys).sum { |x, y| (x - x_mean) * (y - y_mean) }
+  denominator = xs.sum { |x| (x - x_mean)**2 }
+  denominator.zero? ? nil : numerator / denominator
+end
+
+def analyze(points)
+  {
+    time: slope(points, :time, MIN_FIT_TIME),
+    allocations: slope(points, :allocations, 1000)
+  }
+end
+
+# Allocation counts are exact, so their slope is held to the threshold; GC
+# pauses make timings noisy, so the time slope gets TIME_MARGIN on top
+def superlinear?(exponents)
+  time = exponents[:time]
+  allocations = exponents[:allocations]
+  (allocations && allocations > EXPONENT_THRESHOLD) || (time && time > EXPONENT_THRESHOLD + TIME_MARGIN)
+end
+
+def format_exponent(value)
+  value ? format('x^%.2f', value) : '  -   '
+end
+
+def format_bytes(bytes)
+  bytes >= 1024 ? "#{(bytes / 1024.0).round(1)}KB" : "#{bytes}B"
+end
+
+def report(label, points, exponents, flagged)
+  range = points.empty? ? 'no points' : "#{format_bytes(points.first[:bytes])}..#{format_bytes(points.last[:bytes])}"
+  marker = flagged ? '  !! SUPERLINEAR' : ''
+  puts "#{label.ljust(40)} time #{format_exponent(exponents[:time])}  " \
+       "allocs #{format_exponent(exponents[:allocations])}  (#{points.size} points, #{range})#{marker}"
+end
+
+def shrink(shape, dimension)
+  value = shape[dimension]
+  value = DIMENSIONS[dimension][:grow] == :step ? value - 1 : value / 2
+  shape.merge(dimension => [value, DIMENSIONS[dimension][:min]].max)
+end
+
+# Shrink every other dimension while the series stays superlinear
+def minimize(shape, dimension, operation)
+  steps = 0
+  DIMENSIONS.each_key do |other|
+    next if other == dimension
+
+    while shape[other] > DIMENSIONS[other][:min] && steps < MAX_MINIMIZE_STEPS
+      steps += 1
+      smaller = shrink(shape, other)
+      break unless superlinear?(analyze(series(smaller, dimension, operation)))
+
+      shape = smaller
+    end
+  end
+  shape
+end
+
+def write_fixture(shape, dimension, operation, exponents)
+  points = series(shape, dimension, operation)
+  point = points.reverse.find { |p| p[:time] <= FIXTURE_TIME } || points.first
+  return nil unless point
+
+  fixture_shape = point[:shape]
+  name = "#{operation}-#{dimension}-#{Digest::SHA256.hexdigest(fixture_shape.inspect)[0, 8]}.css"
+  path = File.join(FIXTURES_DIR, name)
+  return nil if File.exist?(path)
+
+  FileUtils.mkdir_p(FIXTURES_DIR)
+  header = "/* complexity fixture: operation=#{operation} dimension=#{dimension} " \
+           "time=#{format_exponent(exponents[:time])} allocations=#{format_exponent(exponents[:allocations])}\n" \
+           "   shape=#{fixture_shape.inspect} seed=#{RNG_SEED} */\n"
+  File.write(path, header + build_css(fixture_shape))
+  path
+end
+
+def random_shape
+  DIMENSIONS.to_h do |name, dimension|
+    value = case name
+            when :distinct then [0, 0, 1, 10].sample
+            when :nest_depth then rand(0..3)
+            else rand(dimension[:min]..[dimension[:base] * 2, dimension[:min] + 1].max)
+            end
+    [name, value]
+  end
+end
+
+base_shape = DIMENSIONS.transform_values { |dimension| dimension[:base] }
+growable = DIMENSIONS.select { |_name, dimension| dimension[:grow] }.keys
+
+# Built-in sweep: each dimension from the base shape, then random shapes
+cases = growable.map { |dimension| [base_shape, dimension] }
+ITERATIONS.times { cases << [random_shape, growable.sample] }
+
+puts "Complexity fuzzer (#{PURE_RUBY ? 'pure Ruby' : 'C extension'}): #{cases.size} shapes x #{OPERATIONS.size} operations"
+puts "RNG seed: #{RNG_SEED} (use this to reproduce)"
+puts "Superlinear above x^#{EXPONENT_THRESHOLD}, inputs up to #{format_bytes(MAX_BYTES)}"
+puts ''
+
+findings = []
+seen = {}
+cases.each_with_index do |(shape, dimension), index|
+  OPERATIONS.each_key do |operation|
+    points = series(shape, dimension, operation)
+    exponents = analyze(points)
+    flagged = superlinear?(exponents)
+    label = index < growable.size ? "#{operation} / #{dimension}" : "#{operation} / #{dimension} (random #{index})"
+    report(label, points, exponents, flagged)
+    next unless flagged
+
+    minimized = minimize(shape, dimension, operation)
+    key = [operation, dimension, minimized]
+    next if seen[key]
+
+    seen[key] = true
+    path = write_fixture(minimized, dimension, operation, exponents)
+    findings << [operation, dimension, minimized, path]
+  end
+end
+
+puts "\n#{'=' * 60}"
+if findings.empty?
+  puts 'No superlinear scaling found'
+else
+  puts "Superlinear cases: #{findings.size}"
+  findings.each do |operation, dimension, shape, path|
+    puts "  #{operation} / #{dimension}: #{shape.inspect}"
+    puts "    fixture: #{path || '(already present)'}"
+  end
+end
+puts '=' * 60
+
+exit(findings.empty? ? 0 : 1)
@@ -529,4 +529,14 @@ class TestParserMediaTypes < Minitest::Test
     assert_empty @sheet.with_media(:screen).with_selector('.header')
     assert_empty @sheet.with_media(:print).with_selector('.header')
   end
+
+  def test_media_query_symbols_are_collectable
+    # Media queries from user CSS must not become immortal Symbols
+    prefix = "soak-#{Process.pid}"
+    parse = ->(i) { Cataract.parse_css("@media #{prefix}-#{i} and (min-width: #{i}px) { .a { top: 0; } }").to_s }
+    1000.times { |i| parse.call(i) }
+    GC.start
+
+    assert_operator Symbol.all_symbols.count { |sym| sym.start_with?(prefix) }, :<, 100
+  end
 end
@@ -0,0 +1,164 @@
+# frozen_string_literal: true
+
+require 'stringio'
+require 'zlib'
+
+# Tests for to_s(compression_order: true) - canonical declaration order and
+# clustering of identical rules when reordering cannot change the cascade
+class TestCompressionOrder < Minitest::Test
+  def test_disabled_by_default
+    sheet = Cataract.parse_css('.a { color: red; margin: 0; } .b { margin: 4px; color: blue; }')
+
+    assert_equal ".a { color: red; margin: 0; }\n.b { margin: 4px; color: blue; }\n", sheet.to_s
+  end
+
+  # ============================================================================
+  # Declarations
+  # ============================================================================
+
+  def test_declarations_follow_first_use_order
+    sheet = Cataract.parse_css('.a { color: red; margin: 0; } .b { margin: 4px; display: block; color: blue; }')
+
+    assert_equal ".a { color: red; margin: 0; }\n.b { color: blue; margin: 4px; display: block; }\n",
+                 sheet.to_s(compression_order: true)
+  end
+
+  def test_same_family_keeps_source_order
+    css = '.a { color: red; margin: 0; } ' \
+          '.b { margin-top: 4px; transition: none; margin: 0; -webkit-transition: x 1s; color: blue; margin-top: 2px; }'
+    sheet = Cataract.parse_css(css)
+
+    assert_equal '.b { color: blue; margin-top: 4px; margin: 0; margin-top: 2px; transition: none; -webkit-transition: x 1s; }',
+                 sheet.to_s(compression_order: true).lines[1].chomp
+  end
+
+  def test_logical_and_physical_properties_keep_source_order
+    sheet = Cataract.parse_css('.a { color: red; inline-size: 10px; } .b { width: 20px; color: blue; inline-size: 5px; }')
+
+    assert_equal '.b { color: blue; width: 20px; inline-size: 5px; }', sheet.to_s(compression_order: true).lines[1].chomp
+  end
+
+  def test_rules_with_all_are_not_sorted
+    sheet = Cataract.parse_css('.a { color: red; margin: 0; } .b { margin: 0; all: unset; color: blue; }')
+
+    assert_equal '.b { margin: 0; all: unset; color: blue; }', sheet.to_s(compression_order: true).lines[1].chomp
+  end
+
+  def test_stylesheet_is_not_modified
+    sheet = Cataract.parse_css('.a { color: red; margin: 0; } .b { margin: 4px; color: blue; }')
+    before = sheet.to_s
+
+    sheet.to_s(compression_order: true)
+
+    assert_equal before, sheet.to_s
+    assert_equal %w[margin color], sheet.rules[1].declarations.map(&:property)
+  end
+
+  # ============================================================================
+  # Rules
+  # ============================================================================
+
+  def test_identical_rules_are_clustered
+    sheet = Cataract.parse_css('.a { color: red; } .b { margin: 0; } .c { color: red; } .d { top: 0; }')
+
+    assert_equal ".a { color: red; }\n.c { color: red; }\n.b { margin: 0; }\n.d { top: 0; }\n",
+                 sheet.to_s(compression_order: true)
+  end
+
+  def test_rule_does_not_jump_over_same_property
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; } .c { color: red; }')
+
+    assert_equal sheet.to_s, sheet.to_s(compression_order: true)
+  end
+
+  def test_rule_does_not_jump_over_shorthand
+    sheet = Cataract.parse_css('.a { margin-top: 0; } .b { margin: 4px; } .c { margin-top: 0; }')
+
+    assert_equal sheet.to_s, sheet.to_s(compression_order: true)
+  end
+
+  def test_rule_jumps_over_different_specificity
+    sheet = Cataract.parse_css('.a { color: red; } div { color: blue; } .c { color: red; }')
+
+    assert_equal ".a { color: red; }\n.c { color: red; }\ndiv { color: blue; }\n", sheet.to_s(compression_order: true)
+  end
+
+  def test_rule_does_not_jump_over_zero_specificity_where
+    # .h:where(.q) has the specificity of .h alone, so .i must stay after it
+    sheet = Cataract.parse_css('.g { width: 1px; } .h:where(.q) { width: 2px; } .i { width: 1px; }')
+
+    assert_equal ".g { width: 1px; }\n.h:where(.q) { width: 2px; }\n.i { width: 1px; }\n",
+                 sheet.to_s(compression_order: true)
+  end
+
+  def test_rule_does_not_jump_over_is_with_id
+    sheet = Cataract.parse_css('#g { width: 1px; } :is(#h, .k) { width: 2px; } #i { width: 1px; }')
+
+    assert_equal sheet.to_s, sheet.to_s(compression_order: true)
+  end
+
+  def test_conflict_starts_a_new_cluster
+    sheet = Cataract.parse_css('.a { top: 0; } .b { top: 1px; } .c { top: 0; } .d { margin: 0; } .e { top: 0; }')
+
+    assert_equal %w[.a .b .c .e .d], sheet.to_s(compression_order: true).lines.map { |line| line.split.first }
+  end
+
+  def test_media_blocks_and_at_rules_are_barriers
+    css = '.a { color: red; } .b { margin: 0; } @media print { .c { color: red; } } ' \
+          '.d { color: red; } @font-face { font-family: X; } .e { margin: 0; } .f { color: red; }'
+    sheet = Cataract.parse_css(css)
+
+    assert_equal sheet.to_s, sheet.to_s(compression_order: true)
+  end
+
+  def test_rules_inside_media_block
+    sheet = Cataract.parse_css('@media print { .a { color: red; } .b { margin: 0; } .c { color: red; } }')
+
+    assert_equal "@media print {\n.a { color: red; }\n.c { color: red; }\n.b { margin: 0; }\n}\n",
+                 sheet.to_s(compression_order: true)
+  end
+
+  def test_selector_lists_move_together
+    sheet = Cataract.parse_css('.a { color: red; } .b { margin: 0; } .c, .d { color: red; }')
+
+    assert_equal ".a { color: red; }\n.c, .d { color: red; }\n.b { margin: 0; }\n", sheet.to_s(compression_order: true)
+  end
+
+  # ============================================================================
+  # Options
+  # ============================================================================
+
+  def test_with_consolidate_media
+    css = '.a { color: red; } @media print { .p { top: 0; } } .b { margin: 0; } ' \
+          '@media print { .q { left: 0; } } .c { color: red; }'
+    sheet = Cataract.parse_css(css)
+
+    expected = ".a { color: red; }\n@media print {\n.p { top: 0; }\n.q { left: 0; }\n}\n" \
+               ".b { margin: 0; }\n.c { color: red; }\n"
+
+    assert_equal expected, sheet.to_s(compression_order: true, consolidate_media: true)
+  end
+
+  def test_formatted_output
+    sheet = Cataract.parse_css('.a { color: red; } .b { margin: 0; top: 0; } .c { color: red; }')
+
+    expected = ".a {\n  color: red;\n}\n\n.c {\n  color: red;\n}\n\n.b {\n  margin: 0;\n  top: 0;\n}\n"
+
+    assert_equal expected, sheet.to_formatted_s(compression_order: true)
+  end
+
+  def test_write_gzip
+    sheet = Cataract.parse_css('.a { color: red; } .b { margin: 0; top: 0; } .c { color: red; }')
+    io = StringIO.new
+
+    sheet.write_gzip(io, compression_order: true)
+
+    assert_equal sheet.to_s(compression_order: true), Zlib.gunzip(io.string)
+  end
+
+  def test_ignored_with_nesting
+    sheet = Cataract.parse_css('.a { color: red; } .b { margin: 0; &:hover { color: blue; } } .c { color: red; }')
+
+    assert_equal sheet.to_s, sheet.to_s(compression_order: true)
+  end
+end
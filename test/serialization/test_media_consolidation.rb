@@ -0,0 +1,135 @@
+# frozen_string_literal: true
+
+# Tests for to_s(consolidate_media: true) - merging repeated identical @media
+# blocks when moving rules cannot change the cascade
+class TestMediaConsolidation < Minitest::Test
+  def test_disabled_by_default
+    sheet = Cataract.parse_css('@media print { .a { color: black; } } .b { margin: 0; } @media print { .c { display: none; } }')
+
+    expected = "@media print {\n.a { color: black; }\n}\n.b { margin: 0; }\n@media print {\n.c { display: none; }\n}\n"
+
+    assert_equal expected, sheet.to_s
+  end
+
+  def test_merges_non_conflicting_blocks
+    sheet = Cataract.parse_css('@media print { .a { color: black; } } .b { margin: 0; } @media print { .c { display: none; } }')
+
+    expected = "@media print {\n.a { color: black; }\n.c { display: none; }\n}\n.b { margin: 0; }\n"
+
+    assert_equal expected, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_keeps_block_when_intervening_rule_sets_same_property
+    css = '@media print { .a { color: black; } } .b { color: red; } @media print { .c { color: blue; } }'
+    sheet = Cataract.parse_css(css)
+
+    assert_equal sheet.to_s, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_shorthand_and_longhand_conflict
+    css = '@media print { .a { color: black; } } .b { margin: 0; } @media print { .c { margin-top: 4px; } }'
+    sheet = Cataract.parse_css(css)
+
+    assert_equal sheet.to_s, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_different_specificity_does_not_conflict
+    css = '@media print { .a { color: black; } } div { color: red; } @media print { .c { color: blue; } }'
+    sheet = Cataract.parse_css(css)
+
+    expected = "@media print {\n.a { color: black; }\n.c { color: blue; }\n}\ndiv { color: red; }\n"
+
+    assert_equal expected, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_different_importance_does_not_conflict
+    css = '@media print { .a { color: black; } } .b { color: red !important; } @media print { .c { color: blue; } }'
+    sheet = Cataract.parse_css(css)
+
+    expected = "@media print {\n.a { color: black; }\n.c { color: blue; }\n}\n.b { color: red !important; }\n"
+
+    assert_equal expected, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_zero_specificity_where_conflicts_by_specificity
+    # .h:where(.q) is (0,1,0), the same as .j - moving .j above it would change which width wins
+    css = '@media print { .i { width: 1px; } } .h:where(.q) { width: 2px; } @media print { .j { width: 1px; } }'
+    sheet = Cataract.parse_css(css)
+
+    assert_equal sheet.to_s, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_is_takes_most_specific_argument
+    css = '@media print { .a { width: 1px; } } :is(#x, .y) { width: 2px; } @media print { #z { width: 1px; } }'
+    sheet = Cataract.parse_css(css)
+
+    assert_equal sheet.to_s, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_does_not_merge_different_media_queries
+    css = '@media print { .a { color: black; } } .b { margin: 0; } @media screen { .c { display: none; } }'
+    sheet = Cataract.parse_css(css)
+
+    assert_equal sheet.to_s, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_merges_into_most_recent_block_after_conflict
+    css = <<~CSS
+      @media print { .a { color: black; } }
+      .b { color: red; }
+      @media print { .c { color: blue; } }
+      .d { margin: 0; }
+      @media print { .e { display: none; } }
+    CSS
+    sheet = Cataract.parse_css(css)
+
+    expected = "@media print {\n.a { color: black; }\n}\n.b { color: red; }\n" \
+               "@media print {\n.c { color: blue; }\n.e { display: none; }\n}\n.d { margin: 0; }\n"
+
+    assert_equal expected, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_media_with_conditions
+    css = <<~CSS
+      .a { color: red; }
+      @media (min-width: 768px) { .a { color: blue; } }
+      .b { padding: 0; }
+      @media (min-width: 768px) { .c { float: left; } }
+    CSS
+    sheet = Cataract.parse_css(css)
+
+    expected = ".a { color: red; }\n@media (min-width: 768px) {\n.a { color: blue; }\n.c { float: left; }\n}\n" \
+               ".b { padding: 0; }\n"
+
+    assert_equal expected, sheet.to_s(consolidate_media: true)
+  end
+
+  def test_formatted_output
+    sheet = Cataract.parse_css('@media print { .a { color: black; } } .b { margin: 0; } @media print { .c { display: none; } }')
+
+    result = sheet.to_formatted_s(consolidate_media: true)
+
+    expected = "@media print {\n  .a {\n    color: black;\n  }\n  .c {\n    display: none;\n  }\n}\n\n" \
+               ".b {\n  margin: 0;\n}\n"
+
+    assert_equal expected, result
+  end
+
+  def test_preserves_cascade
+    sheet = Cataract.parse_css(File.read('test/fixtures/bootstrap.css'))
+
+    consolidated = Cataract.parse_css(sheet.to_s(consolidate_media: true))
+
+    assert_equal sheet.rules.size, consolidated.rules.size
+    assert_equal flattened_rules(sheet), flattened_rules(consolidated)
+  end
+
+  # Flattened (media, selector, declarations) triples - equal when the cascade is unchanged
+  def flattened_rules(sheet)
+    flat = sheet.flatten
+    flat.rules.select(&:selector?).map do |rule|
+      media = rule.media_query_id ? flat.media_queries[rule.media_query_id].to_s : ''
+      [media, rule.selector, rule.declarations.map(&:to_s).sort]
+    end.sort
+  end
+end
@@ -0,0 +1,97 @@
+# frozen_string_literal: true
+
+require 'stringio'
+
+# Tests for StylesheetScope#to_s / #to_formatted_s / #write_to - serializing
+# only the rules matched by a scope
+class TestStylesheetScopeSerialization < Minitest::Test
+  CSS = <<~CSS
+    h1, h2, h3 { color: red; }
+    .x { margin: 0; }
+    @media print { .a, .b { color: black; } .c { display: none; } }
+  CSS
+
+  def setup
+    @sheet = Cataract.parse_css(CSS)
+  end
+
+  def test_keeps_media_wrapper
+    assert_equal "@media print {\n.a, .b { color: black; }\n.c { display: none; }\n}\n", @sheet.with_media(:print).to_s
+  end
+
+  def test_base_only
+    assert_equal "h1, h2, h3 { color: red; }\n.x { margin: 0; }\n", @sheet.base_only.to_s
+  end
+
+  def test_groups_only_rules_in_scope
+    assert_equal "h1, h2 { color: red; }\n", @sheet.with_selector(/h[12]/).to_s
+  end
+
+  def test_single_rule_from_selector_list_in_media
+    assert_equal "@media print {\n.a { color: black; }\n}\n", @sheet.with_media(:print).with_selector('.a').to_s
+  end
+
+  def test_empty_scope
+    assert_equal '', @sheet.with_selector('.missing').to_s
+  end
+
+  def test_to_css_alias
+    scope = @sheet.with_selector('.x')
+
+    assert_equal scope.to_s, scope.to_css
+  end
+
+  def test_to_formatted_s
+    assert_equal ".x {\n  margin: 0;\n}\n", @sheet.with_selector('.x').to_formatted_s
+  end
+
+  def test_write_to
+    io = StringIO.new
+    scope = @sheet.with_media(:print)
+    scope.write_to(io)
+
+    assert_equal scope.to_s, io.string
+  end
+
+  def test_write_to_formatted
+    io = StringIO.new
+    scope = @sheet.with_selector('.x')
+    scope.write_to(io, formatted: true)
+
+    assert_equal scope.to_formatted_s, io.string
+  end
+
+  def test_does_not_modify_stylesheet
+    before = @sheet.to_s
+    @sheet.with_selector('h1').to_s
+
+    assert_equal before, @sheet.to_s
+  end
+
+  def test_nested_stylesheet
+    sheet = Cataract.parse_css('.parent { color: red; & .child { color: blue; } } .other { margin: 0; }')
+
+    assert_equal ".other { margin: 0; }\n", sheet.with_selector('.other').to_s
+  end
+
+  def test_nested_rule_keeps_its_parent
+    sheet = Cataract.parse_css('.a { color: red; & .b { color: blue; } } .c { margin: 0; }')
+
+    assert_equal ".a { color: red; & .b { color: blue; } }\n", sheet.with_selector('.a .b').to_s
+  end
+
+  # An unresolved @import takes a rule id, so ids are offset from positions
+  def test_rule_ids_after_unresolved_import
+    sheet = Cataract.parse_css('@import "x.css"; .a { c: d } .b { e: f }')
+
+    assert_equal ".a { c: d; }\n", sheet.with_selector('.a').to_s
+    assert_equal ".b { e: f; }\n", sheet.with_selector('.b').to_s
+  end
+
+  def test_selector_list_after_unresolved_import
+    sheet = Cataract.parse_css('@import "x.css"; .a, .b { c: d } .e { f: g }')
+
+    assert_equal ".a, .b { c: d; }\n.e { f: g; }\n", sheet.to_s
+    assert_equal ".b { c: d; }\n", sheet.with_selector('.b').to_s
+  end
+end
@@ -760,4 +760,10 @@ class TestStylesheetSerialization < Minitest::Test
 
     assert_equal expected, output
   end
+
+  def test_to_s_at_rule_alongside_nested_rules
+    sheet = Cataract.parse_css('@keyframes k { from { top: 0; } } .a { top: 0; & .b { top: 1px; } }')
+
+    assert_equal "@keyframes k {\n  from { top: 0; }\n}\n.a { top: 0; & .b { top: 1px; } }\n", sheet.to_s
+  end
 end
@@ -0,0 +1,138 @@
+# frozen_string_literal: true
+
+require 'json'
+
+# Tests for Stylesheet#to_json - direct JSON export of the parsed structure
+class TestStylesheetToJson < Minitest::Test
+  def test_simple_rule
+    sheet = Cataract.parse_css('body { color: red; }')
+    expected = '{"charset":null,"rules":[{"id":0,"type":"rule","selector":"body","declarations":' \
+               '[{"property":"color","value":"red","important":false}],"parent_rule_id":null,' \
+               '"nesting_style":null,"selector_list_id":null,"media_query_id":null}],' \
+               '"media_queries":[],"media_query_lists":{},"selector_lists":{},"imports":[]}'
+
+    assert_equal expected, sheet.to_json
+  end
+
+  def test_empty_stylesheet
+    data = JSON.parse(Cataract::Stylesheet.new.to_json)
+
+    assert_empty data['rules']
+    assert_nil data['charset']
+  end
+
+  def test_returns_utf8
+    assert_equal Encoding::UTF_8, Cataract.parse_css('a { color: red; }').to_json.encoding
+  end
+
+  def test_important_flag
+    data = JSON.parse(Cataract.parse_css('.a { margin: 0 !important; }').to_json)
+
+    assert data['rules'][0]['declarations'][0]['important']
+  end
+
+  def test_specificity_excluded_by_default
+    data = JSON.parse(Cataract.parse_css('#a .b { color: red; }').to_json)
+
+    refute data['rules'][0].key?('specificity')
+  end
+
+  def test_specificity_option
+    data = JSON.parse(Cataract.parse_css('#a .b { color: red; }').to_json(specificity: true))
+
+    assert_equal 110, data['rules'][0]['specificity']
+  end
+
+  def test_escapes_quotes_and_backslashes
+    sheet = Cataract.parse_css('.a { content: "x\\"y\\\\z"; }')
+    value = sheet.rules[0].declarations[0].value
+
+    assert_equal value, JSON.parse(sheet.to_json)['rules'][0]['declarations'][0]['value']
+  end
+
+  def test_escapes_control_characters
+    sheet = Cataract.parse_css('.a { color: red; }')
+    value = "#{'a' * 20}\t\n\u0001#{'b' * 20}"
+    sheet.rules[0].declarations[0].value = value
+    json = sheet.to_json
+    expected = '{"charset":null,"rules":[{"id":0,"type":"rule","selector":".a","declarations":' \
+               '[{"property":"color","value":"aaaaaaaaaaaaaaaaaaaa\\t\\n\\u0001bbbbbbbbbbbbbbbbbbbb",' \
+               '"important":false}],"parent_rule_id":null,"nesting_style":null,"selector_list_id":null,' \
+               '"media_query_id":null}],"media_queries":[],"media_query_lists":{},"selector_lists":{},"imports":[]}'
+
+    assert_equal expected, json
+    assert_equal value, JSON.parse(json)['rules'][0]['declarations'][0]['value']
+  end
+
+  def test_non_ascii_passes_through
+    sheet = Cataract.parse_css('.a { content: "→ é"; }')
+    expected = '{"charset":null,"rules":[{"id":0,"type":"rule","selector":".a","declarations":' \
+               '[{"property":"content","value":"\\"→ é\\"","important":false}],"parent_rule_id":null,' \
+               '"nesting_style":null,"selector_list_id":null,"media_query_id":null}],' \
+               '"media_queries":[],"media_query_lists":{},"selector_lists":{},"imports":[]}'
+
+    assert_equal expected, sheet.to_json
+  end
+
+  def test_media_queries_and_lists
+    data = JSON.parse(Cataract.parse_css('@media screen, print { .a { color: blue; } }').to_json)
+    rule = data['rules'][0]
+
+    assert_equal(%w[screen print], data['media_queries'].map { |mq| mq['type'] })
+    assert_equal({ '0' => [0, 1] }, data['media_query_lists'])
+    assert_equal 0, rule['media_query_id']
+  end
+
+  def test_media_query_conditions
+    data = JSON.parse(Cataract.parse_css('@media screen and (min-width: 768px) { .a { color: blue; } }').to_json)
+
+    assert_equal '(min-width: 768px)', data['media_queries'][0]['conditions']
+  end
+
+  def test_selector_lists
+    data = JSON.parse(Cataract.parse_css('h1, h2 { color: red; }').to_json)
+
+    assert_equal({ '0' => [0, 1] }, data['selector_lists'])
+    assert_equal [0, 0], data['rules'].map { |r| r['selector_list_id'] }
+  end
+
+  def test_at_rule_with_declarations
+    data = JSON.parse(Cataract.parse_css('@font-face { font-family: X; }').to_json)
+    rule = data['rules'][0]
+
+    assert_equal 'at_rule', rule['type']
+    assert_equal '@font-face', rule['selector']
+    assert_equal [{ 'property' => 'font-family', 'value' => 'X', 'important' => false }], rule['content']
+  end
+
+  def test_at_rule_with_nested_blocks
+    data = JSON.parse(Cataract.parse_css('@keyframes f { 0% { opacity: 0; } 100% { opacity: 1; } }').to_json)
+    content = data['rules'][0]['content']
+
+    assert_equal %w[0% 100%], content.map { |block| block['selector'] }
+    assert_equal 'opacity', content[0]['declarations'][0]['property']
+  end
+
+  def test_nested_rules
+    data = JSON.parse(Cataract.parse_css('.parent { color: red; & .child { color: blue; } }').to_json)
+    child = data['rules'].find { |r| r['selector'] == '.parent .child' }
+
+    assert_equal 0, child['parent_rule_id']
+    assert_equal 1, child['nesting_style']
+  end
+
+  def test_charset_and_imports
+    data = JSON.parse(Cataract.parse_css('@charset "UTF-8"; @import url("a.css") print; .a { color: red; }').to_json)
+
+    assert_equal 'UTF-8', data['charset']
+    assert_equal 'a.css', data['imports'][0]['url']
+    assert_equal 'print', data['imports'][0]['media']
+    refute data['imports'][0]['resolved']
+  end
+
+  def test_json_generate_uses_to_json
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_equal "[#{sheet.to_json}]", JSON.generate([sheet])
+  end
+end
@@ -0,0 +1,103 @@
+# frozen_string_literal: true
+
+require 'zlib'
+require 'stringio'
+
+# Tests for Stylesheet#write_gzip - streaming serializer output into a gzip stream
+class TestStylesheetWriteGzip < Minitest::Test
+  # Sink that records each chunk the serializer hands over
+  class ChunkRecorder
+    attr_reader :chunks
+
+    def initialize
+      @chunks = []
+    end
+
+    def write(str)
+      @chunks << str.dup
+      str.bytesize
+    end
+  end
+
+  def gunzip(data)
+    Zlib::GzipReader.new(StringIO.new(data)).read.force_encoding(Encoding::UTF_8)
+  end
+
+  def test_round_trips_to_s
+    sheet = Cataract.parse_css('.a { color: red; } @media print { .b { color: black; } } h1, h2 { margin: 0; }')
+    io = StringIO.new(''.b)
+    sheet.write_gzip(io)
+
+    assert_equal sheet.to_s, gunzip(io.string)
+  end
+
+  def test_returns_io_and_leaves_it_open
+    io = StringIO.new(''.b)
+    result = Cataract.parse_css('.a { color: red; }').write_gzip(io)
+
+    assert_same io, result
+    refute_predicate io, :closed?
+  end
+
+  def test_error_finishes_stream_and_leaves_io_open
+    sheet = Cataract.parse_css('.a { color: red; }')
+    sheet.instance_variable_set(:@_selector_lists, 5)
+    io = StringIO.new(''.b)
+
+    assert_raises(StandardError) { sheet.write_gzip(io) }
+    refute_predicate io, :closed?
+    assert_equal '', gunzip(io.string)
+  end
+
+  def test_formatted
+    sheet = Cataract.parse_css('.a { color: red; } @media print { .b { color: black; } }')
+    io = StringIO.new(''.b)
+    sheet.write_gzip(io, formatted: true)
+
+    assert_equal sheet.to_formatted_s, gunzip(io.string)
+  end
+
+  def test_compression_level
+    sheet = Cataract.parse_css(File.read(File.expand_path('../fixtures/bootstrap.css', __dir__)))
+    fast = StringIO.new(''.b)
+    best = StringIO.new(''.b)
+    sheet.write_gzip(fast, level: Zlib::BEST_SPEED)
+    sheet.write_gzip(best, level: Zlib::BEST_COMPRESSION)
+
+    assert_operator best.string.bytesize, :<, fast.string.bytesize
+    assert_equal sheet.to_s, gunzip(best.string)
+  end
+
+  def test_large_stylesheet_matches_to_s
+    sheet = Cataract.parse_css(File.read(File.expand_path('../fixtures/bootstrap.css', __dir__)))
+    io = StringIO.new(''.b)
+    sheet.write_gzip(io)
+
+    assert_equal sheet.to_s, gunzip(io.string)
+  end
+
+  def test_charset_included
+    sheet = Cataract.parse_css('@charset "UTF-8"; .a { color: red; }')
+    io = StringIO.new(''.b)
+    sheet.write_gzip(io)
+
+    assert_equal sheet.to_s, gunzip(io.string)
+  end
+
+  def test_nested_stylesheet
+    sheet = Cataract.parse_css('.parent { color: red; & .child { color: blue; } }')
+    io = StringIO.new(''.b)
+    sheet.write_gzip(io)
+
+    assert_equal sheet.to_s, gunzip(io.string)
+  end
+
+  def test_serializer_flushes_chunks_to_sink
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; } @media print { .c { color: black; } } .d { margin: 0; }')
+    sink = ChunkRecorder.new
+    remainder = Cataract.stylesheet_to_s(sheet.rules, nil, false, {}, sheet.media_queries, {}, { sink: sink, chunk_size: 1 })
+
+    assert_equal [".a { color: red; }\n", ".b { color: blue; }\n", "@media print {\n.c { color: black; }\n"], sink.chunks
+    assert_equal "}\n.d { margin: 0; }\n", remainder
+  end
+end
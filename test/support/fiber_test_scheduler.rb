@@ -0,0 +1,121 @@
+# frozen_string_literal: true
+
+# Minimal Fiber::Scheduler for tests, modeled on the one in Ruby's own test
+# suite: a select() loop over fibers waiting on IO, sleeping, or blocked on a
+# Mutex/Queue. Enough to run Net::HTTP requests from non-blocking fibers
+# without pulling in the async gem.
+#
+# @example
+#   Thread.new do
+#     Fiber.set_scheduler(FiberTestScheduler.new)
+#     Fiber.schedule { ... }
+#   end.join # The scheduler runs until every fiber is done
+class FiberTestScheduler
+  def initialize
+    @readable = {}  # IO => Fiber
+    @writable = {}  # IO => Fiber
+    @waiting = {}   # Fiber => wake-up time
+    @blocking = {}  # Fiber => true, blocked until #unblock
+    @ready = []     # Fibers unblocked (possibly from other threads)
+    @lock = Thread::Mutex.new
+    @urgent = IO.pipe
+    @closed = false
+  end
+
+  def run
+    while @readable.any? || @writable.any? || @waiting.any? || @blocking.any?
+      readable, writable = IO.select([*@readable.keys, @urgent.first], @writable.keys, [], next_timeout)
+
+      selected = {}
+      readable&.each do |io|
+        if io == @urgent.first
+          io.read_nonblock(1024, exception: false)
+        elsif (fiber = @readable.delete(io))
+          selected[fiber] = IO::READABLE
+        end
+      end
+      writable&.each do |io|
+        fiber = @writable.delete(io)
+        selected[fiber] = selected.fetch(fiber, 0) | IO::WRITABLE if fiber
+      end
+      selected.each { |fiber, events| fiber.resume(events) if fiber.alive? }
+
+      now = current_time
+      @waiting.select { |_fiber, time| time <= now }.each_key do |fiber|
+        @waiting.delete(fiber)
+        fiber.resume if fiber.alive?
+      end
+
+      ready = @lock.synchronize { @ready.slice!(0, @ready.size) }
+      ready.each { |fiber| fiber.resume if fiber.alive? }
+    end
+  end
+
+  def close
+    return if @closed
+
+    run
+    @urgent.each(&:close)
+    @closed = true
+  end
+
+  def fiber(&block)
+    fiber = Fiber.new(blocking: false, &block)
+    fiber.resume
+    fiber
+  end
+
+  # @return [Integer, nil] Ready events, nil on timeout
+  def io_wait(io, events, timeout)
+    fiber = Fiber.current
+    @readable[io] = fiber unless (events & IO::READABLE).zero?
+    @writable[io] = fiber unless (events & IO::WRITABLE).zero?
+    @waiting[fiber] = current_time + timeout if timeout
+    Fiber.yield
+  ensure
+    @readable.delete(io) if @readable[io] == fiber
+    @writable.delete(io) if @writable[io] == fiber
+    @waiting.delete(fiber)
+  end
+
+  def kernel_sleep(duration = nil)
+    if duration
+      @waiting[Fiber.current] = current_time + duration
+      Fiber.yield
+    else
+      block(:sleep)
+    end
+    true
+  end
+
+  # @return [Boolean] false on timeout
+  def block(_blocker, timeout = nil)
+    fiber = Fiber.current
+    @blocking[fiber] = true
+    @waiting[fiber] = current_time + timeout if timeout
+    Fiber.yield
+    timeout.nil? || @waiting.key?(fiber)
+  ensure
+    @blocking.delete(fiber)
+    @waiting.delete(fiber)
+  end
+
+  # May be called from another thread
+  def unblock(_blocker, fiber)
+    @lock.synchronize { @ready << fiber }
+    @urgent.last.write_nonblock('.', exception: false)
+  end
+
+  private
+
+  def current_time
+    Process.clock_gettime(Process::CLOCK_MONOTONIC)
+  end
+
+  def next_timeout
+    return 0 if @lock.synchronize { @ready.any? }
+    return nil if @waiting.empty?
+
+    [@waiting.values.min - current_time, 0].max
+  end
+end
@@ -0,0 +1,92 @@
+# frozen_string_literal: true
+
+require 'socket'
+
+# Local HTTP server standing in for a CDN in import tests. Serves fixed
+# bodies, each after an optional delay and with optional extra headers, and
+# records how many requests were in flight at once. A request whose
+# If-None-Match or If-Modified-Since matches the route's ETag or
+# Last-Modified header gets a 304.
+#
+# @example
+#   server = ImportTestServer.new('/a.css' => ['.a { color: red; }', 0.2])
+#   server.url('/a.css') # => "http://127.0.0.1:54321/a.css"
+#   server.close
+class ImportTestServer
+  attr_reader :routes, :max_in_flight, :requests, :statuses
+
+  # @param routes [Hash{String => Array}] path => [body, delay, headers];
+  #   change it to serve new content
+  def initialize(routes)
+    @routes = routes
+    @server = TCPServer.new('127.0.0.1', 0)
+    @mutex = Thread::Mutex.new
+    @in_flight = 0
+    @max_in_flight = 0
+    @requests = []
+    @statuses = []
+    @thread = Thread.new { accept_loop }
+  end
+
+  def url(path)
+    "http://127.0.0.1:#{@server.addr[1]}#{path}"
+  end
+
+  def close
+    @server.close
+    @thread.join
+  end
+
+  private
+
+  def accept_loop
+    loop do
+      client = @server.accept
+      Thread.new(client) { |socket| handle(socket) }
+    end
+  rescue IOError, Errno::EBADF
+    # Server closed
+  end
+
+  def handle(socket)
+    path = socket.gets.to_s.split[1]
+    request_headers = {}
+    while (line = socket.gets) && line != "\r\n"
+      name, value = line.chomp.split(': ', 2)
+      request_headers[name.downcase] = value
+    end
+
+    track(path) do
+      body, delay, headers = @routes[path]
+      headers ||= {}
+      sleep delay if delay
+      status = if body.nil? then '404 Not Found'
+               elsif not_modified?(request_headers, headers) then '304 Not Modified'
+               else '200 OK'
+               end
+      @mutex.synchronize { @statuses << status.to_i }
+      body = '' unless status == '200 OK'
+
+      head = headers.merge('Content-Type' => 'text/css', 'Content-Length' => body.bytesize, 'Connection' => 'close')
+      socket.write("HTTP/1.1 #{status}\r\n#{head.map { |name, value| "#{name}: #{value}\r\n" }.join}\r\n#{body}")
+    end
+  ensure
+    socket.close
+  end
+
+  def not_modified?(request_headers, headers)
+    (headers['ETag'] && request_headers['if-none-match'] == headers['ETag']) ||
+      (headers['Last-Modified'] && request_headers['if-modified-since'] == headers['Last-Modified'])
+  end
+
+  def track(path)
+    @mutex.synchronize do
+      @requests << path
+      @in_flight += 1
+      @max_in_flight = @in_flight if @in_flight > @max_in_flight
+    end
+    yield
+  ensure
+    @mutex.synchronize { @in_flight -= 1 }
+  end
+end
@@ -0,0 +1,151 @@
+require_relative 'test_helper'
+
+class TestCascade < Minitest::Test
+  def values(declarations)
+    declarations.to_h { |decl| [decl.property, decl.important ? "#{decl.value} !important" : decl.value] }
+  end
+
+  # ============================================================================
+  # Origins and importance
+  # ============================================================================
+
+  def test_author_beats_user_beats_user_agent
+    cascade = Cataract::Cascade.new
+    cascade.add(Cataract.parse_css('.a { color: black; margin: 0; padding: 0; }'), origin: :user_agent)
+    cascade.add(Cataract.parse_css('.a { color: blue; margin: 1px; }'), origin: :user)
+    cascade.add(Cataract.parse_css('.a { color: red; }'), origin: :author)
+
+    assert_equal({ 'color' => 'red', 'margin' => '1px', 'padding' => '0' }, values(cascade.declarations('.a')))
+  end
+
+  def test_important_reverses_origin_order
+    cascade = Cataract::Cascade.new
+    cascade.add(Cataract.parse_css('.a { color: black !important; }'), origin: :user_agent)
+    cascade.add(Cataract.parse_css('.a { color: blue !important; margin: 1px !important; }'), origin: :user)
+    cascade.add(Cataract.parse_css('.a { color: red !important; margin: 2px !important; top: 0; }'))
+
+    assert_equal({ 'color' => 'black !important', 'margin' => '1px !important', 'top' => '0' },
+                 values(cascade.declarations('.a')))
+  end
+
+  def test_later_member_wins_ties
+    cascade = Cataract::Cascade.new([Cataract.parse_css('.a { color: red; }'), Cataract.parse_css('.a { color: blue; }')])
+
+    assert_equal({ 'color' => 'blue' }, values(cascade.declarations('.a')))
+  end
+
+  # ============================================================================
+  # Layers
+  # ============================================================================
+
+  def test_layers_order_by_first_appearance_and_unlayered_wins
+    cascade = Cataract::Cascade.new
+    cascade.add(Cataract.parse_css('.a { color: red; margin: 0; padding: 0; }'), layer: 'framework')
+    cascade.add(Cataract.parse_css('.a { color: blue; margin: 1px; }'), layer: 'theme')
+    cascade.add(Cataract.parse_css('.a { color: green; }'))
+    cascade.add(Cataract.parse_css('.a { padding: 9px; }'), layer: 'framework')
+
+    assert_equal({ 'color' => 'green', 'margin' => '1px', 'padding' => '9px' }, values(cascade.declarations('.a')))
+  end
+
+  def test_important_in_earlier_layer_wins
+    cascade = Cataract::Cascade.new
+    cascade.add(Cataract.parse_css('.a { color: red !important; }'), layer: 'framework')
+    cascade.add(Cataract.parse_css('.a { color: blue !important; }'), layer: 'theme')
+    cascade.add(Cataract.parse_css('.a { color: green !important; }'))
+
+    assert_equal({ 'color' => 'red !important' }, values(cascade.declarations('.a')))
+  end
+
+  # ============================================================================
+  # Groups
+  # ============================================================================
+
+  def test_shorthands_cascade_as_longhands
+    cascade = Cataract::Cascade.new
+    cascade.add(Cataract.parse_css('.a { margin: 0; }'), origin: :user_agent)
+    cascade.add(Cataract.parse_css('.a { margin-top: 5px; }'))
+
+    assert_equal({ 'margin' => '5px 0 0' }, values(cascade.declarations('.a')))
+  end
+
+  def test_media_contexts_are_separate_groups
+    cascade = Cataract::Cascade.new
+    cascade.add(Cataract.parse_css('.a { color: red; } @media screen, print { .a { color: gray; } }'))
+    cascade.add(Cataract.parse_css('@media print, screen { .a { color: black; } }'))
+
+    assert_equal({ 'color' => 'red' }, values(cascade.declarations('.a')))
+    assert_equal({ 'color' => 'black' }, values(cascade.declarations('.a', media: 'screen, print')))
+    assert_nil cascade.declarations('.a', media: :print)
+    assert_equal 2, cascade.size
+  end
+
+  def test_unknown_selector_returns_nil
+    cascade = Cataract::Cascade.new([Cataract.parse_css('.a { color: red; }')])
+
+    assert_nil cascade.declarations('.b')
+  end
+
+  def test_returned_declarations_are_copies
+    cascade = Cataract::Cascade.new([Cataract.parse_css('.a { color: red; }')])
+    cascade.declarations('.a').first.value = 'blue'
+
+    assert_equal 'red', cascade.declarations('.a').first.value
+  end
+
+  # ============================================================================
+  # to_stylesheet
+  # ============================================================================
+
+  def test_to_stylesheet
+    base = Cataract.parse_css('@charset "utf-8"; .a { color: red; } @media print { .a { color: black; } }')
+    theme = Cataract.parse_css('.b { margin: 0; } .a { color: blue; } @font-face { font-family: X; }')
+    cascade = Cataract::Cascade.new([base, theme])
+
+    sheet = cascade.to_stylesheet
+
+    assert_equal %w[.a .a .b @font-face], sheet.rules.map(&:selector)
+    assert_equal [0, 1, 2, 3], sheet.rules.map(&:id)
+    assert_equal 'utf-8', sheet.charset
+    assert_equal [1], sheet.media_index[:print]
+    assert_equal ".a { color: blue; }\n@media print {\n.a { color: black; }\n}\n", sheet.to_s.lines[1..4].join
+  end
+
+  def test_members_are_not_modified
+    css = '.a { margin: 0; color: red; }'
+    member = Cataract.parse_css(css)
+    cascade = Cataract::Cascade.new([member, Cataract.parse_css('.a { margin-top: 1px; }')])
+
+    cascade.to_stylesheet
+
+    assert_equal Cataract.parse_css(css).to_s, member.to_s
+  end
+
+  # ============================================================================
+  # refresh
+  # ============================================================================
+
+  def test_refresh_resolves_only_changed_groups
+    theme = Cataract.parse_css('.a { color: blue; } .b { color: blue; } .c { color: blue; }')
+    cascade = Cataract::Cascade.new([Cataract.parse_css('.a { color: red; } .b { margin: 0; }'), theme])
+    cascade.to_stylesheet
+
+    theme.rules[1].declarations[0].value = 'green'
+    theme.add_block('.d { color: blue; }')
+
+    assert_equal 2, cascade.refresh(theme)
+    assert_equal({ 'color' => 'green', 'margin' => '0' }, values(cascade.declarations('.b')))
+    assert_equal %w[.a .b .c .d], cascade.to_stylesheet.rules.map(&:selector)
+  end
+
+  def test_refresh_non_member_raises
+    cascade = Cataract::Cascade.new([Cataract.parse_css('.a { color: red; }')])
+
+    assert_raises(ArgumentError) { cascade.refresh(Cataract.parse_css('.a { color: red; }')) }
+  end
+
+  def test_invalid_arguments
+    assert_raises(ArgumentError) { Cataract::Cascade.new.add(Cataract.parse_css('.a {}'), origin: :browser) }
+    assert_raises(TypeError) { Cataract::Cascade.new.add('.a {}') }
+  end
+end
@@ -0,0 +1,170 @@
+# frozen_string_literal: true
+
+require_relative 'test_helper'
+require 'tmpdir'
+
+# Tests for Stylesheet#import_graph and Cataract::ImportGraph
+class TestImportGraph < Minitest::Test
+  # Records every URL it fetches
+  class RecordingFetcher < Cataract::ImportResolver::DefaultFetcher
+    attr_reader :urls
+
+    def initialize
+      super
+      @urls = []
+    end
+
+    def call(url, options)
+      @urls << File.basename(url)
+      super
+    end
+  end
+
+  def setup
+    @dir = Dir.mktmpdir
+    write('app.css', "@import \"base.css\";\n.app { top: 0; }")
+    write('admin.css', "@import \"base.css\";\n@import \"extra.css\";\n.admin { top: 0; }")
+    write('base.css', "@import \"reset.css\";\n.base { color: red; }")
+    write('reset.css', '.reset { margin: 0; }')
+    write('extra.css', '.extra { left: 0; }')
+    @fetcher = RecordingFetcher.new
+    @graph = Cataract::ImportGraph.new
+  end
+
+  def teardown
+    FileUtils.rm_rf(@dir)
+  end
+
+  def write(name, css)
+    File.write(path(name), css)
+  end
+
+  def path(name)
+    File.join(@dir, name)
+  end
+
+  def url(name)
+    "file://#{path(name)}"
+  end
+
+  def load(name)
+    @graph.load_file(path(name), import: { allowed_schemes: ['file'], fetcher: @fetcher })
+  end
+
+  # ============================================================================
+  # Stylesheet#import_graph
+  # ============================================================================
+
+  def test_stylesheet_import_graph
+    sheet = Cataract::Stylesheet.load_file(path('admin.css'), import: { allowed_schemes: ['file'] })
+
+    assert_equal({ url('admin.css') => [url('base.css'), url('extra.css')],
+                   url('base.css') => [url('reset.css')] }, sheet.import_graph)
+  end
+
+  def test_stylesheet_import_graph_without_file
+    sheet = Cataract.parse_css('@import "reset.css"; .a { top: 0; }',
+                               import: { allowed_schemes: ['file'], base_path: @dir })
+
+    assert_equal({ nil => [url('reset.css')] }, sheet.import_graph)
+  end
+
+  def test_stylesheet_import_graph_is_empty_without_imports
+    assert_empty Cataract.parse_css('.a { top: 0; }').import_graph
+  end
+
+  # ============================================================================
+  # Queries
+  # ============================================================================
+
+  def test_edges
+    load('app.css')
+    load('admin.css')
+
+    assert_equal [url('app.css'), url('admin.css')], @graph.entries
+    assert_equal [url('base.css'), url('extra.css')], @graph.imports(path('admin.css'))
+    assert_equal [url('app.css'), url('admin.css')], @graph.importers(path('base.css'))
+    assert_equal Digest::SHA256.hexdigest('.reset { margin: 0; }'), @graph.digest(url('reset.css'))
+  end
+
+  def test_affected_entries
+    load('app.css')
+    load('admin.css')
+
+    assert_equal [url('app.css'), url('admin.css')], @graph.affected_entries(path('reset.css'))
+    assert_equal [url('admin.css')], @graph.affected_entries(path('extra.css'))
+    assert_equal [url('app.css')], @graph.affected_entries(path('app.css'))
+    assert_empty @graph.affected_entries(path('unrelated.css'))
+  end
+
+  # ============================================================================
+  # Rebuilds
+  # ============================================================================
+
+  def test_unchanged_rebuild_fetches_nothing
+    first = load('admin.css').to_s
+    @fetcher.urls.clear
+
+    assert_equal first, load('admin.css').to_s
+    assert_empty @fetcher.urls
+  end
+
+  def test_invalidate_re_resolves_only_affected_subtree
+    load('app.css')
+    load('admin.css')
+    @fetcher.urls.clear
+    write('reset.css', '.reset { margin: 1px; }')
+
+    affected = @graph.invalidate(path('reset.css'))
+    sheet = load('admin.css')
+
+    assert_equal [url('app.css'), url('admin.css')], affected
+    assert_equal %w[base.css reset.css], @fetcher.urls
+    assert_equal ".reset { margin: 1px; }\n.base { color: red; }\n.extra { left: 0; }\n.admin { top: 0; }\n",
+                 sheet.to_s
+  end
+
+  def test_cached_imports_are_copies
+    first = load('admin.css')
+    first.rules[0].declarations[0].value = '9px'
+
+    assert_equal '0', load('admin.css').rules[0].declarations[0].value
+  end
+
+  def test_cached_imports_with_media
+    write('print.css', "@import \"base.css\" print;\n.p { top: 0; }")
+    expected = "@media print {\n.reset { margin: 0; }\n.base { color: red; }\n}\n.p { top: 0; }\n"
+
+    assert_equal expected, load('print.css').to_s
+    assert_equal expected, load('print.css').to_s
+  end
+
+  def test_removed_import_is_pruned
+    load('admin.css')
+    write('admin.css', "@import \"base.css\";\n.admin { top: 0; }")
+
+    @graph.invalidate(path('admin.css'))
+    load('admin.css')
+
+    assert_equal [url('base.css')], @graph.imports(path('admin.css'))
+    assert_nil @graph.digest(url('extra.css'))
+  end
+
+  # ============================================================================
+  # Persistence
+  # ============================================================================
+
+  def test_save_and_load
+    load('app.css')
+    load('admin.css')
+    @graph.save(path('graph.json'))
+    write('extra.css', '.extra { left: 1px; }')
+    File.delete(path('reset.css'))
+
+    graph = Cataract::ImportGraph.load(path('graph.json'))
+
+    assert_equal [url('app.css'), url('admin.css')], graph.entries
+    assert_equal [url('extra.css'), url('reset.css')], graph.changed.sort
+    assert_equal [url('admin.css')], graph.affected_entries(url('extra.css'))
+  end
+end
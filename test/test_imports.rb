@@ -172,6 +172,19 @@ body { color: red; }"
     end
   end
 
+  def test_multiple_imports_keep_document_order
+    Dir.mktmpdir do |dir|
+      File.write(File.join(dir, 'a.css'), '.a1 { color: red; } .a2 { color: red; }')
+      File.write(File.join(dir, 'b.css'), '.b1 { color: blue; } .b2 { color: blue; }')
+
+      sheet = Cataract.parse_css('@import "a.css"; @import "b.css"; .local { color: green; }',
+                                 import: { allowed_schemes: ['file'] }, base_dir: dir)
+
+      assert_equal %w[.a1 .a2 .b1 .b2 .local], sheet.rules.map(&:selector)
+      assert_equal [0, 1, 2, 3, 4], sheet.rules.map(&:id)
+    end
+  end
+
   def test_import_with_custom_max_depth
     Dir.mktmpdir do |dir|
       # Create nested import: level1.css -> level2.css -> level3.css
@@ -0,0 +1,191 @@
+# frozen_string_literal: true
+
+require_relative 'test_helper'
+require_relative 'support/import_test_server'
+require 'tmpdir'
+
+# Tests for ImportResolver::CachingFetcher - disk cache with conditional revalidation
+class TestImportsCachingFetcher < Minitest::Test
+  def setup
+    # Other import tests stub HTTP; these talk to a real local server
+    WebMock.disable_net_connect!(allow_localhost: true) if defined?(WebMock)
+    @cache_dir = Dir.mktmpdir
+    @server = nil
+  end
+
+  def teardown
+    @server&.close
+    FileUtils.rm_rf(@cache_dir)
+    WebMock.disable_net_connect! if defined?(WebMock)
+  end
+
+  def serve(body, headers = {})
+    @server = ImportTestServer.new('/a.css' => [body, 0, headers])
+  end
+
+  # Parse with a fresh fetcher each time, as a new process would
+  def parse(**fetcher_options)
+    fetcher = Cataract::ImportResolver::CachingFetcher.new(@cache_dir, **fetcher_options)
+    Cataract.parse_css("@import url(\"#{@server.url('/a.css')}\"); .b { top: 0; }",
+                       import: { allowed_schemes: ['http'], fetcher: fetcher }).to_s
+  end
+
+  def fetch_options
+    Cataract::ImportResolver.normalize_options(allowed_schemes: ['http'])
+  end
+
+  def cache_files
+    Dir.children(@cache_dir)
+  end
+
+  # ============================================================================
+  # Freshness
+  # ============================================================================
+
+  def test_fresh_entry_skips_network
+    serve('.a { color: red; }', 'Cache-Control' => 'public, max-age=3600')
+
+    assert_equal ".a { color: red; }\n.b { top: 0; }\n", parse
+    assert_equal ".a { color: red; }\n.b { top: 0; }\n", parse
+    assert_equal [200], @server.statuses
+    assert_equal 1, cache_files.size
+  end
+
+  def test_age_header_shortens_lifetime
+    serve('.a { color: red; }', 'Cache-Control' => 'max-age=60', 'Age' => '60')
+
+    parse
+    parse
+
+    assert_equal [200, 200], @server.statuses
+  end
+
+  def test_default_max_age
+    serve('.a { color: red; }')
+
+    parse(default_max_age: 3600)
+    parse(default_max_age: 3600)
+
+    assert_equal [200], @server.statuses
+  end
+
+  # ============================================================================
+  # Revalidation
+  # ============================================================================
+
+  def test_stale_entry_revalidates_with_etag
+    serve('.a { color: red; }', 'ETag' => '"v1"', 'Cache-Control' => 'max-age=0')
+
+    parse
+
+    assert_equal ".a { color: red; }\n.b { top: 0; }\n", parse
+    assert_equal [200, 304], @server.statuses
+  end
+
+  def test_stale_entry_revalidates_with_last_modified
+    serve('.a { color: red; }', 'Last-Modified' => 'Wed, 21 Oct 2015 07:28:00 GMT')
+
+    parse
+
+    assert_equal ".a { color: red; }\n.b { top: 0; }\n", parse
+    assert_equal [200, 304], @server.statuses
+  end
+
+  def test_changed_resource_replaces_entry
+    serve('.a { color: red; }', 'ETag' => '"v1"')
+    parse
+
+    @server.routes['/a.css'] = ['.a { color: blue; }', 0, { 'ETag' => '"v2"' }]
+
+    assert_equal ".a { color: blue; }\n.b { top: 0; }\n", parse
+    assert_equal ".a { color: blue; }\n.b { top: 0; }\n", parse
+    assert_equal [200, 200, 304], @server.statuses
+  end
+
+  def test_not_modified_refreshes_lifetime
+    serve('.a { color: red; }', 'ETag' => '"v1"', 'Cache-Control' => 'max-age=0')
+    parse
+
+    @server.routes['/a.css'][2] = { 'ETag' => '"v1"', 'Cache-Control' => 'max-age=3600' }
+    parse
+    parse
+
+    assert_equal [200, 304], @server.statuses
+  end
+
+  def test_no_cache_always_revalidates
+    serve('.a { color: red; }', 'ETag' => '"v1"', 'Cache-Control' => 'no-cache, max-age=3600')
+
+    3.times { parse }
+
+    assert_equal [200, 304, 304], @server.statuses
+  end
+
+  # ============================================================================
+  # Storage
+  # ============================================================================
+
+  def test_no_store_is_not_written
+    serve('.a { color: red; }', 'ETag' => '"v1"', 'Cache-Control' => 'no-store')
+
+    parse
+    parse
+
+    assert_equal [200, 200], @server.statuses
+    assert_empty cache_files
+  end
+
+  def test_unreadable_entry_is_refetched
+    serve('.a { color: red; }', 'Cache-Control' => 'max-age=3600')
+    parse
+    File.write(File.join(@cache_dir, cache_files.first), '{"url":')
+
+    assert_equal ".a { color: red; }\n.b { top: 0; }\n", parse
+    assert_equal [200, 200], @server.statuses
+  end
+
+  def test_non_utf8_body_is_cached
+    serve("/* caf\xE9 */ .a { color: red; }".b, 'Cache-Control' => 'max-age=3600')
+    fetcher = Cataract::ImportResolver::CachingFetcher.new(@cache_dir)
+    url = @server.url('/a.css')
+
+    first = fetcher.call(url, fetch_options)
+    second = Cataract::ImportResolver::CachingFetcher.new(@cache_dir).call(url, fetch_options)
+
+    assert_equal "/* caf\xE9 */ .a { color: red; }".b, first.b
+    assert_equal first.b, second.b
+    assert_equal first.encoding, second.encoding
+    assert_equal [200], @server.statuses
+  end
+
+  def test_failed_cache_write_does_not_fail_fetch
+    serve('.a { color: red; }', 'Cache-Control' => 'max-age=3600')
+    fetcher = Cataract::ImportResolver::CachingFetcher.new(@cache_dir)
+    FileUtils.rm_rf(@cache_dir)
+
+    assert_equal '.a { color: red; }', fetcher.call(@server.url('/a.css'), fetch_options)
+  end
+
+  def test_clear
+    serve('.a { color: red; }', 'Cache-Control' => 'max-age=3600')
+    parse
+
+    Cataract::ImportResolver::CachingFetcher.new(@cache_dir).clear
+    parse
+
+    assert_equal [200, 200], @server.statuses
+  end
+
+  def test_file_imports_are_not_cached
+    Dir.mktmpdir do |dir|
+      File.write(File.join(dir, 'a.css'), '.a { color: red; }')
+      fetcher = Cataract::ImportResolver::CachingFetcher.new(@cache_dir)
+
+      sheet = Cataract.parse_css('@import "a.css";', import: { allowed_schemes: ['file'], base_path: dir,
+                                                                 fetcher: fetcher })
+
+      assert_equal ".a { color: red; }\n", sheet.to_s
+      assert_empty cache_files
+    end
+  end
+end
@@ -0,0 +1,130 @@
+# frozen_string_literal: true
+
+require_relative 'test_helper'
+require_relative 'support/fiber_test_scheduler'
+require_relative 'support/import_test_server'
+
+# Tests for fetching sibling @imports together under a Fiber scheduler
+class TestImportsFiberScheduler < Minitest::Test
+  IMPORT_OPTIONS = { allowed_schemes: ['http'] }.freeze
+
+  def setup
+    # Other import tests stub HTTP; these talk to a real local server
+    WebMock.disable_net_connect!(allow_localhost: true) if defined?(WebMock)
+    @server = nil
+  end
+
+  def teardown
+    @server&.close
+    WebMock.disable_net_connect! if defined?(WebMock)
+  end
+
+  def serve(routes)
+    @server = ImportTestServer.new(routes)
+  end
+
+  def import_css(*paths)
+    paths.map { |path| "@import url(\"#{@server.url(path)}\");" }.join("\n")
+  end
+
+  # Run the block in a non-blocking fiber on a fresh scheduler thread
+  def with_scheduler
+    result = nil
+    Thread.new do
+      Fiber.set_scheduler(FiberTestScheduler.new)
+      Fiber.schedule { result = yield }
+    end.join
+    result
+  end
+
+  def test_sibling_imports_are_fetched_together
+    serve('/a.css' => ['.a { color: red; }', 0.3],
+          '/b.css' => ['.b { color: blue; }', 0.3],
+          '/c.css' => ['.c { color: green; }', 0.3])
+    css = import_css('/a.css', '/b.css', '/c.css')
+
+    started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    sheet = with_scheduler { Cataract.parse_css(css, import: IMPORT_OPTIONS) }
+    elapsed = Process.clock_gettime(Process::CLOCK_MONOTONIC) - started
+
+    assert_equal 3, @server.max_in_flight
+    assert_operator elapsed, :<, 0.8
+    assert_equal %w[.a .b .c], sheet.rules.map(&:selector)
+  end
+
+  def test_reactor_keeps_running_while_imports_load
+    serve('/a.css' => ['.a { color: red; }', 0.3], '/b.css' => ['.b { color: blue; }', 0.3])
+    css = import_css('/a.css', '/b.css')
+    ticks = 0
+
+    sheet = with_scheduler do
+      ticker = Fiber.schedule do
+        loop do
+          sleep 0.02
+          ticks += 1
+        end
+      end
+      parsed = Cataract.parse_css(css, import: IMPORT_OPTIONS)
+      ticker.kill
+      parsed
+    end
+
+    assert_operator ticks, :>=, 5
+    assert_equal %w[.a .b], sheet.rules.map(&:selector)
+  end
+
+  def test_document_order_is_kept_when_later_imports_arrive_first
+    serve('/slow.css' => ["@import url(\"nested.css\");\n.slow { color: red; }", 0.3],
+          '/nested.css' => ['.nested { margin: 0; }', 0.1],
+          '/fast.css' => ['.fast { color: blue; }', 0])
+    css = "#{import_css('/slow.css', '/fast.css')}\n.local { top: 0; }"
+
+    sheet = with_scheduler { Cataract.parse_css(css, import: IMPORT_OPTIONS) }
+
+    assert_equal %w[.nested .slow .fast .local], sheet.rules.map(&:selector)
+    assert_equal (0..3).to_a, sheet.rules.map(&:id)
+    assert_equal ['/fast.css', '/nested.css', '/slow.css'], @server.requests.sort
+    # nested.css is only discovered once slow.css has arrived
+    assert_operator @server.requests.index('/nested.css'), :>, @server.requests.index('/slow.css')
+  end
+
+  def test_failed_import_raises_after_siblings_finish
+    serve('/a.css' => ['.a { color: red; }', 0.2])
+    css = import_css('/a.css', '/missing.css')
+
+    error = with_scheduler do
+      Cataract.parse_css(css, import: IMPORT_OPTIONS)
+      nil
+    rescue Cataract::ImportError => e
+      e
+    end
+
+    assert_kind_of Cataract::ImportError, error
+    assert_equal ['/a.css', '/missing.css'], @server.requests.sort
+  end
+
+  def test_without_scheduler_imports_are_fetched_one_at_a_time
+    serve('/a.css' => ['.a { color: red; }', 0.1], '/b.css' => ['.b { color: blue; }', 0.1])
+
+    sheet = Cataract.parse_css(import_css('/a.css', '/b.css'), import: IMPORT_OPTIONS)
+
+    assert_equal 1, @server.max_in_flight
+    assert_equal %w[.a .b], sheet.rules.map(&:selector)
+  end
+
+  # Fetchers implementing fetch_each may yield in any order
+  class ReversedFetcher
+    def fetch_each(urls, _options)
+      urls.each_with_index.reverse_each { |url, index| yield index, ".#{File.basename(url, '.css')} { top: 0; }" }
+    end
+  end
+
+  def test_custom_fetch_each
+    css = '@import "https://example.com/one.css"; @import "https://example.com/two.css"; ' \
+          '@import "https://example.com/three.css"; .four { top: 0; }'
+
+    sheet = Cataract.parse_css(css, import: { fetcher: ReversedFetcher.new })
+
+    assert_equal %w[.one .two .three .four], sheet.rules.map(&:selector)
+  end
+end
@@ -0,0 +1,134 @@
+# frozen_string_literal: true
+
+require_relative 'test_helper'
+require 'tmpdir'
+
+# Tests for the :limits option - resource budgets for untrusted CSS
+class TestParseLimits < Minitest::Test
+  def parse(css, **limits)
+    Cataract::Stylesheet.new(limits: limits).add_block(css)
+  end
+
+  def assert_limit(limit, max, &block)
+    error = assert_raises(Cataract::LimitError, &block)
+
+    assert_equal limit, error.limit
+    assert_equal max, error.max
+    error
+  end
+
+  # ============================================================================
+  # Individual limits
+  # ============================================================================
+
+  def test_max_bytes
+    error = assert_limit(:max_bytes, 10) { parse('.a { color: red; }', max_bytes: 10) }
+
+    assert_equal 'CSS exceeds max_bytes limit of 10', error.message
+    assert_equal 1, parse('.a { color: red; }', max_bytes: 18).rules.size
+  end
+
+  def test_max_rules_counts_selector_list_members
+    assert_limit(:max_rules, 2) { parse('.a, .b, .c { color: red; }', max_rules: 2) }
+    assert_equal 3, parse('.a, .b, .c { color: red; }', max_rules: 3).rules.size
+  end
+
+  def test_max_rules_counts_at_rules_and_keyframe_blocks
+    css = '@keyframes k { from { top: 0; } to { top: 1px; } } @font-face { font-family: A; }'
+
+    assert_limit(:max_rules, 3) { parse(css, max_rules: 3) }
+    assert_equal 2, parse(css, max_rules: 4).rules.size
+  end
+
+  def test_max_rules_inside_media
+    assert_limit(:max_rules, 1) { parse('@media print { .a { top: 0; } .b { top: 0; } }', max_rules: 1) }
+  end
+
+  def test_max_declarations_counts_copies_per_selector
+    assert_limit(:max_declarations, 5) { parse('.a, .b, .c { top: 0; left: 0; }', max_declarations: 5) }
+    assert_equal 3, parse('.a, .b, .c { top: 0; left: 0; }', max_declarations: 6).rules.size
+  end
+
+  def test_max_declarations_in_nested_blocks
+    css = '.a { top: 0; & .b { left: 0; } & .c { right: 0; } }'
+
+    assert_limit(:max_declarations, 2) { parse(css, max_declarations: 2) }
+    assert_equal 3, parse(css, max_declarations: 3).rules.size
+  end
+
+  def test_max_selectors
+    assert_limit(:max_selectors, 2) { parse('.a, .b, .c { top: 0; }', max_selectors: 2) }
+    assert_limit(:max_selectors, 2) { parse('.a { & .b, & .c, & .d { top: 0; } }', max_selectors: 2) }
+    assert_equal 2, parse('.a, .b { top: 0; }', max_selectors: 2).rules.size
+  end
+
+  def test_max_nested_rules
+    css = '.a { top: 0; & .b { left: 0; } @media print { right: 0; } }'
+
+    assert_limit(:max_nested_rules, 1) { parse(css, max_nested_rules: 1) }
+    assert_equal 3, parse(css, max_nested_rules: 2).rules.size
+  end
+
+  def test_max_nested_rules_bounds_selector_list_expansion
+    # Every parent selector re-expands every nested selector list
+    css = '.a, .b, .c, .d { & .e, & .f, & .g, & .h { & .i, & .j, & .k, & .l { top: 0; } } }'
+
+    assert_limit(:max_nested_rules, 50) { parse(css, max_nested_rules: 50) }
+  end
+
+  def test_timeout
+    error = assert_limit(:timeout, 0.000001) { parse('.a { top: 0; }' * 5000, timeout: 0.000001) }
+
+    assert_equal 'CSS parse exceeded timeout of 1.0e-06s', error.message
+    assert_equal 5000, parse('.a { top: 0; }' * 5000, timeout: 60).rules.size
+  end
+
+  # ============================================================================
+  # Scope
+  # ============================================================================
+
+  def test_no_limits_by_default
+    assert_equal 2000, Cataract.parse_css('.a, .b { top: 0; }' * 1000).rules.size
+  end
+
+  def test_limits_apply_per_add_block
+    sheet = parse('.a { top: 0; }', max_rules: 1)
+    sheet.add_block('.b { top: 0; }')
+
+    assert_equal 2, sheet.rules.size
+    assert_limit(:max_rules, 1) { sheet.add_block('.c { top: 0; } .d { top: 0; }') }
+  end
+
+  def test_limits_apply_to_parse_many_sources_together
+    sources = ['.a { top: 0; }', '.b { top: 0; }']
+
+    assert_limit(:max_rules, 1) { Cataract::Stylesheet.parse_many(sources, limits: { max_rules: 1 }) }
+    assert_limit(:max_bytes, 20) { Cataract::Stylesheet.parse_many(sources, limits: { max_bytes: 20 }) }
+    assert_equal 2, Cataract::Stylesheet.parse_many(sources, limits: { max_rules: 2 }).rules.size
+  end
+
+  def test_imported_files_have_their_own_budget
+    Dir.mktmpdir do |dir|
+      File.write(File.join(dir, 'small.css'), '.a { top: 0; }')
+      File.write(File.join(dir, 'big.css'), '.a { top: 0; } .b { top: 0; }')
+      import = { allowed_schemes: ['file'], base_path: dir }
+
+      sheet = Cataract.parse_css('@import "small.css"; .c { top: 0; }', import: import, limits: { max_rules: 1 })
+
+      assert_equal %w[.a .c], sheet.rules.map(&:selector)
+      assert_limit(:max_rules, 1) do
+        Cataract.parse_css('@import "big.css";', import: import, limits: { max_rules: 1 })
+      end
+    end
+  end
+
+  def test_unknown_limit
+    error = assert_raises(ArgumentError) { Cataract::Stylesheet.new(limits: { max_rule: 1 }) }
+
+    assert_equal 'unknown limits: max_rule', error.message
+  end
+
+  def test_limits_must_be_a_hash
+    assert_raises(TypeError) { Cataract::Stylesheet.new(limits: 10) }
+  end
+end
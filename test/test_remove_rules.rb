@@ -187,6 +187,14 @@ class TestRemoveRules < Minitest::Test
     assert_empty @sheet.media_queries
   end
 
+  def test_remove_rules_keeps_whole_media_query_list
+    @sheet.add_block('.x { a: b; } @media screen, print { .a { color: red; } }')
+
+    @sheet.remove_rules!('.x { }')
+
+    assert_equal "@media screen, print {\n.a { color: red; }\n}\n", @sheet.to_s
+  end
+
   def test_remove_rules_with_at_rules
     @sheet.add_block(<<~CSS)
       body { color: black; }
@@ -0,0 +1,118 @@
+require_relative 'test_helper'
+
+class TestSelectorComponents < Minitest::Test
+  # ============================================================================
+  # Cataract.parse_selector - simple selectors
+  # ============================================================================
+
+  def test_compound_selector
+    assert_equal [[[:type, 'a'], [:id, 'main'], [:class, 'nav'], [:class, 'active']]],
+                 Cataract.parse_selector('a#main.nav.active')
+  end
+
+  def test_universal_and_nesting
+    assert_equal [[[:universal, '*'], [:class, 'a']]], Cataract.parse_selector('*.a')
+    assert_equal [[[:nesting, '&'], [:pseudo_class, 'hover']]], Cataract.parse_selector('&:hover')
+    assert_equal [[[:universal, 'svg|*']]], Cataract.parse_selector('svg|*')
+  end
+
+  def test_namespaced_type_selectors
+    assert_equal [[[:type, '*|a'], [:class, 'x']]], Cataract.parse_selector('*|a.x')
+    assert_equal [[[:type, '|c']], :child, [[:type, 'svg|rect']]], Cataract.parse_selector('|c > svg|rect')
+    assert_equal [[[:universal, '*|*']], :descendant, [[:universal, '|*']]], Cataract.parse_selector('*|* |*')
+  end
+
+  def test_attribute_selectors
+    assert_equal [[[:attribute, 'disabled']]], Cataract.parse_selector('[disabled]')
+    assert_equal [[[:type, 'a'], [:attribute, 'href', '^="http"']]], Cataract.parse_selector('a[href^="http"]')
+    assert_equal [[[:attribute, 'lang', '|= en']]], Cataract.parse_selector('[ lang |= en ]')
+    assert_equal [[[:attribute, 'title', '="a]b" i']]], Cataract.parse_selector('[title="a]b" i]')
+  end
+
+  def test_pseudo_classes_and_elements
+    assert_equal [[[:type, 'p'], [:pseudo_class, 'first-child'], [:pseudo_element, 'before']]],
+                 Cataract.parse_selector('p:first-child::before')
+    assert_equal [[[:pseudo_element, 'after']]], Cataract.parse_selector(':after')
+  end
+
+  def test_functional_pseudo_keeps_argument
+    assert_equal [[[:type, 'li'], [:pseudo_class, 'nth-child', '2n + 1']]],
+                 Cataract.parse_selector('li:nth-child( 2n + 1 )')
+    assert_equal [[[:pseudo_class, 'not', '.a:is(.b, .c)']]], Cataract.parse_selector(':not(.a:is(.b, .c))')
+  end
+
+  def test_escapes_are_kept_as_written
+    assert_equal [[[:class, 'sm\\:flex']]], Cataract.parse_selector('.sm\\:flex')
+  end
+
+  # ============================================================================
+  # Cataract.parse_selector - combinators
+  # ============================================================================
+
+  def test_combinators
+    assert_equal [[[:type, 'a']], :descendant, [[:type, 'b']], :child, [[:type, 'c']],
+                  :next_sibling, [[:type, 'd']], :subsequent_sibling, [[:type, 'e']]],
+                 Cataract.parse_selector('a b>c + d ~ e')
+  end
+
+  def test_whitespace_around_combinators_is_not_descendant
+    assert_equal [[[:type, 'a']], :child, [[:type, 'b']]], Cataract.parse_selector("  a \n >\tb  ")
+  end
+
+  def test_relative_selector_and_list
+    assert_equal [:child, [[:class, 'a']]], Cataract.parse_selector('> .a')
+    assert_equal [[[:type, 'h1']], :list, [[:type, 'h2']]], Cataract.parse_selector('h1, h2')
+  end
+
+  def test_empty_selector
+    assert_empty Cataract.parse_selector('')
+  end
+
+  # ============================================================================
+  # Result objects
+  # ============================================================================
+
+  def test_result_is_deeply_frozen
+    components = Cataract.parse_selector('a.b')
+
+    assert_predicate components, :frozen?
+    assert_predicate components[0], :frozen?
+    assert_predicate components[0][0], :frozen?
+    assert_predicate components[0][1][1], :frozen?
+  end
+
+  def test_names_are_interned
+    first = Cataract.parse_selector('.card .title')
+    second = Cataract.parse_selector('div.card')
+
+    assert_same first[0][0][1], second[0][1][1]
+  end
+
+  def test_non_string_raises
+    assert_raises(TypeError) { Cataract.parse_selector(nil) }
+  end
+
+  # ============================================================================
+  # Rule#selector_components
+  # ============================================================================
+
+  def test_rule_selector_components
+    rule = Cataract.parse_css('nav > a.active { color: red }').rules.first
+
+    assert_equal [[[:type, 'nav']], :child, [[:type, 'a'], [:class, 'active']]], rule.selector_components
+  end
+
+  def test_rule_selector_components_cached
+    rule = Cataract.parse_css('.a .b { color: red }').rules.first
+
+    assert_same rule.selector_components, rule.selector_components
+  end
+
+  def test_rule_selector_components_follow_selector_changes
+    rule = Cataract.parse_css('.a { color: red }').rules.first
+    rule.selector_components
+    rule.selector = '#b'
+
+    assert_equal [[[:id, 'b']]], rule.selector_components
+  end
+end
@@ -82,4 +82,15 @@ class TestSpecificity < Minitest::Test
     assert_equal 103, Cataract.calculate_specificity('#sidebar ul li a') # #sidebar(100) + ul(1) + li(1) + a(1) = 103
     assert_equal 121, Cataract.calculate_specificity('#nav .menu-item:hover a') # #nav(100) + .menu-item(10) + :hover(10) + a(1) = 121
   end
+
+  def test_specificity_with_selector_argument_pseudo_classes
+    # :is()/:not()/:has() count their most specific argument, :where() counts nothing
+    assert_equal 10, Cataract.calculate_specificity('.h:where(.q)')
+    assert_equal 0, Cataract.calculate_specificity(':where(#x, .y)')
+    assert_equal 100, Cataract.calculate_specificity(':is(#x)')
+    assert_equal 100, Cataract.calculate_specificity(':is(.a, #b)')
+    assert_equal 110, Cataract.calculate_specificity('.a:not(#b)')
+    assert_equal 20, Cataract.calculate_specificity(':has(.a .b)')
+    assert_equal 101, Cataract.calculate_specificity(':not(:is(#a, .b)) p')
+  end
 end
@@ -0,0 +1,138 @@
+require_relative 'test_helper'
+
+class TestStylesheetBatch < Minitest::Test
+  SNIPPETS = [
+    '.a { color: red; }',
+    '@media print { .b { margin: 0; } }',
+    'h1, h2, h3 { font-weight: bold; }',
+    '@media screen { .c { padding: 1px; } }',
+    '.d { color: blue; }'
+  ].freeze
+
+  def build(batched)
+    sheet = Cataract::Stylesheet.new
+    work = lambda do |s|
+      SNIPPETS.each { |css| s.add_block(css) }
+      s.remove_rules!('.a { }')
+      s.add_rule(selector: '.e', declarations: 'color: green', media_types: :print)
+      s.remove_rules!('.d { }')
+    end
+    batched ? sheet.batch(&work) : work.call(sheet)
+    sheet
+  end
+
+  # ============================================================================
+  # Equivalence with unbatched mutations
+  # ============================================================================
+
+  def test_batch_matches_sequential_mutations
+    batched = build(true)
+    sequential = build(false)
+
+    assert_equal sequential.to_s, batched.to_s
+    assert_equal sequential.rules.map(&:selector), batched.rules.map(&:selector)
+    assert_equal (0...batched.size).to_a, batched.rules.map(&:id)
+  end
+
+  def test_batch_media_index_is_rebuilt
+    sheet = build(true)
+
+    assert_equal sheet.rules.select { |r| %w[.b .e].include?(r.selector) }.map(&:id).sort,
+                 sheet.media_index[:print].sort
+    assert_equal %w[.b .e], sheet.with_media(:print).map(&:selector)
+  end
+
+  def test_batch_remaps_selector_lists
+    sheet = build(true)
+    sheet.batch { |s| s.remove_rules!('h2 { }') }
+    lists = sheet.instance_variable_get(:@_selector_lists)
+
+    assert_equal [%w[h1 h3]], lists.values.map { |ids| ids.map { |id| sheet.rules[id].selector } }
+    assert_equal "@media print {\n.b { margin: 0; }\n}\nh1, h3 { font-weight: bold; }\n" \
+                 "@media screen {\n.c { padding: 1px; }\n}\n@media print {\n.e { color: green; }\n}\n", sheet.to_s
+  end
+
+  def test_batch_clears_memoized_caches
+    sheet = Cataract.parse_css('.a { color: red; }')
+    sheet.selectors
+
+    sheet.batch { |s| s.add_block('.b { color: blue; }') }
+
+    assert_equal %w[.a .b], sheet.selectors
+  end
+
+  # ============================================================================
+  # Batch semantics
+  # ============================================================================
+
+  def test_batch_returns_self
+    sheet = Cataract::Stylesheet.new
+
+    assert_same sheet, sheet.batch { |s| s.add_block('.a { color: red; }') }
+  end
+
+  def test_removals_are_deferred_until_batch_ends
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; }')
+
+    sheet.batch do |s|
+      s.remove_rules!('.a { }')
+
+      assert_equal 2, s.size
+    end
+
+    assert_equal %w[.b], sheet.rules.map(&:selector)
+  end
+
+  def test_removed_rules_are_not_matched_twice
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; } .c { color: green; }')
+    removed = sheet.rules[0]
+
+    sheet.batch do |s|
+      s.remove_rules!('.a { }')
+      s.remove_rules!([removed, s.rules[2]])
+    end
+
+    assert_equal %w[.b], sheet.rules.map(&:selector)
+  end
+
+  def test_nested_rules_keep_parents
+    sheet = Cataract.parse_css('.x { color: red; } .p { color: red; &:hover { color: blue; } }')
+
+    sheet.batch { |s| s.remove_rules!('.x { }') }
+
+    hover = sheet.rules.find { |r| r.selector == '.p:hover' }
+
+    assert_equal 0, hover.parent_rule_id
+    assert_equal '.p { color: red; &:hover { color: blue; } }', sheet.to_s.strip
+  end
+
+  def test_nested_batch_joins_outer_batch
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; }')
+
+    sheet.batch do |outer|
+      outer.batch { |inner| inner.remove_rules!('.a { }') }
+
+      assert_equal 2, outer.size
+    end
+
+    assert_equal 1, sheet.size
+  end
+
+  def test_batch_commits_when_block_raises
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; }')
+
+    assert_raises(RuntimeError) do
+      sheet.batch do |s|
+        s.remove_rules!('.a { }')
+        raise 'boom'
+      end
+    end
+
+    assert_equal %w[.b], sheet.rules.map(&:selector)
+    assert_equal [0], sheet.rules.map(&:id)
+  end
+
+  def test_batch_without_block_raises
+    assert_raises(ArgumentError) { Cataract::Stylesheet.new.batch }
+  end
+end
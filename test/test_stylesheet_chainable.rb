@@ -455,4 +455,16 @@ class TestStylesheetChainable < Minitest::Test
     assert_equal 1, color_rules.size
     assert_equal '.color', color_rules.first.selector
   end
+
+  def test_with_property_skips_at_rules
+    css = <<~CSS
+      @keyframes fade { from { opacity: 0; } to { opacity: 1; } }
+      @font-face { font-family: A; }
+      .color { color: red; }
+    CSS
+    sheet = Cataract::Stylesheet.parse(css)
+
+    assert_equal ['.color'], sheet.with_property('color').map(&:selector)
+    assert_equal ['.color'], sheet.with_property('col', prefix_match: true).map(&:selector)
+  end
 end
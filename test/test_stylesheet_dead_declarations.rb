@@ -0,0 +1,132 @@
+require_relative 'test_helper'
+
+class TestStylesheetDeadDeclarations < Minitest::Test
+  # ============================================================================
+  # Dead declaration elimination (order-preserving, no rule merging)
+  # ============================================================================
+
+  def test_returns_self
+    sheet = Cataract.parse_css('.box { color: red; }')
+
+    assert_same sheet, sheet.eliminate_dead_declarations!
+  end
+
+  def test_removes_duplicate_property_within_rule
+    sheet = Cataract.parse_css('.box { color: red; margin: 0; color: blue; }')
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal '.box { margin: 0; color: blue; }', sheet.to_s.strip
+  end
+
+  def test_important_survives_later_normal_declaration
+    sheet = Cataract.parse_css('.box { color: red !important; color: blue; }')
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal '.box { color: red !important; }', sheet.to_s.strip
+  end
+
+  def test_later_important_wins_over_earlier_important
+    sheet = Cataract.parse_css('.box { color: red !important; color: blue !important; }')
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal '.box { color: blue !important; }', sheet.to_s.strip
+  end
+
+  def test_keeps_fallback_for_vendor_prefixed_value
+    sheet = Cataract.parse_css('.box { display: -webkit-box; display: flex; display: -webkit-flex; }')
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal '.box { display: -webkit-box; display: flex; display: -webkit-flex; }', sheet.to_s.strip
+  end
+
+  def test_keeps_fallback_for_function_value
+    css = '.a { background: red; background: linear-gradient(red, blue); } ' \
+          '.a { color: red; color: blue; width: 10px; width: 9px; width: calc(100% - 1px); }'
+    sheet = Cataract.parse_css(css)
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal ".a { background: red; background: linear-gradient(red, blue); }\n" \
+                 ".a { color: blue; width: 9px; width: calc(100% - 1px); }\n", sheet.to_s
+  end
+
+  def test_plain_value_ends_fallback_chain
+    sheet = Cataract.parse_css('.box { display: -webkit-box; display: block; display: flex; }')
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal '.box { display: flex; }', sheet.to_s.strip
+  end
+
+  def test_removes_across_rules_with_same_selector_preserving_order
+    css = '.a { color: red; margin: 0; } .b { color: green; } .a { color: blue; }'
+    sheet = Cataract.parse_css(css)
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal 3, sheet.rules.size
+    assert_equal %w[.a .b .a], sheet.rules.map(&:selector)
+    assert_equal ".a { margin: 0; }\n.b { color: green; }\n.a { color: blue; }\n", sheet.to_s
+  end
+
+  def test_keeps_declarations_in_different_media
+    css = '.a { color: red; } @media print { .a { color: blue; } }'
+    sheet = Cataract.parse_css(css)
+
+    sheet.eliminate_dead_declarations!
+
+    assert_has_property({ color: 'red' }, sheet.rules[0])
+    assert_has_property({ color: 'blue' }, sheet.rules[1])
+  end
+
+  def test_removes_across_rules_in_same_media
+    css = '@media print { .a { color: red; } .b { color: red; } .a { color: blue; } }'
+    sheet = Cataract.parse_css(css)
+
+    sheet.eliminate_dead_declarations!
+
+    assert_empty sheet.rules[0].declarations
+    assert_has_property({ color: 'red' }, sheet.rules[1])
+    assert_has_property({ color: 'blue' }, sheet.rules[2])
+  end
+
+  def test_keeps_declarations_for_different_selectors
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; }')
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal ".a { color: red; }\n.b { color: blue; }\n", sheet.to_s
+  end
+
+  def test_does_not_treat_shorthand_as_overriding_longhand
+    sheet = Cataract.parse_css('.a { margin-top: 5px; margin: 0; }')
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal '.a { margin-top: 5px; margin: 0; }', sheet.to_s.strip
+  end
+
+  def test_at_rules_are_untouched
+    css = '@font-face { font-family: X; src: url(x.woff); } .a { color: red; color: blue; }'
+    sheet = Cataract.parse_css(css)
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal 2, sheet.rules.size
+    assert_equal "@font-face {\n  font-family: X; src: url(x.woff);\n}\n.a { color: blue; }\n", sheet.to_s
+  end
+
+  def test_clears_memoized_custom_properties
+    sheet = Cataract.parse_css(':root { --x: 1px; --x: 2px; }')
+    sheet.custom_properties
+
+    sheet.eliminate_dead_declarations!
+
+    assert_equal '2px', sheet.custom_properties[:root]['--x']
+    assert_equal 1, sheet.rules.first.declarations.size
+  end
+end
@@ -0,0 +1,164 @@
+require_relative 'test_helper'
+
+class TestStylesheetDiff < Minitest::Test
+  def assert_patch_round_trips(old_css, new_css)
+    old_sheet = Cataract.parse_css(old_css)
+    new_sheet = Cataract.parse_css(new_css)
+
+    diff = Cataract::Stylesheet.diff(old_sheet, new_sheet)
+    old_sheet.apply_patch!(diff)
+
+    assert_equal new_sheet.to_s, old_sheet.to_s
+    assert_equal (0...old_sheet.rules.size).to_a, old_sheet.rules.map(&:id)
+    diff
+  end
+
+  # ============================================================================
+  # Stylesheet.diff
+  # ============================================================================
+
+  def test_identical_stylesheets_have_empty_diff
+    css = '.a { color: red; } @media print { .b { margin: 0; } }'
+
+    diff = Cataract::Stylesheet.diff(Cataract.parse_css(css), Cataract.parse_css(css))
+
+    assert_empty diff
+    assert_equal 0, diff.size
+  end
+
+  def test_added_removed_and_modified
+    old_sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; } .c { color: green; }')
+    new_sheet = Cataract.parse_css('.a { color: red; } .c { color: lime; } .d { color: black; }')
+
+    diff = Cataract::Stylesheet.diff(old_sheet, new_sheet)
+
+    assert_equal [['.b', 1]], diff.removed.map { |op| [op.rule.selector, op.old_index] }
+    assert_equal [['.c', 2, 1]], diff.modified.map { |op| [op.rule.selector, op.old_index, op.new_index] }
+    assert_equal [['.d', 2]], diff.added.map { |op| [op.rule.selector, op.new_index] }
+    assert_equal 'lime', diff.modified.first.rule.declarations.first.value
+  end
+
+  def test_same_selector_in_other_media_is_not_modified
+    old_sheet = Cataract.parse_css('.a { color: red; }')
+    new_sheet = Cataract.parse_css('@media print { .a { color: blue; } }')
+
+    diff = Cataract::Stylesheet.diff(old_sheet, new_sheet)
+
+    assert_equal %i[removed added], diff.map(&:type)
+    assert_equal [Cataract::MediaQuery.new(nil, :print, nil)], diff.added.first.media_queries
+  end
+
+  def test_important_flag_is_a_modification
+    diff = Cataract::Stylesheet.diff(Cataract.parse_css('.a { color: red; }'),
+                                     Cataract.parse_css('.a { color: red !important; }'))
+
+    assert_equal %i[modified], diff.map(&:type)
+  end
+
+  def test_moved_rule_is_removed_and_added
+    diff = Cataract::Stylesheet.diff(Cataract.parse_css('.a { color: red; } .b { color: blue; } .c { color: green; }'),
+                                     Cataract.parse_css('.b { color: blue; } .c { color: green; } .a { color: red; }'))
+
+    assert_equal 2, diff.size
+    assert_equal [0], diff.removed.map(&:old_index)
+    assert_equal [2], diff.added.map(&:new_index)
+  end
+
+  def test_inspect
+    diff = Cataract::Stylesheet.diff(Cataract.parse_css('.a { color: red; } .b { color: red; }'),
+                                     Cataract.parse_css('.a { color: blue; } .c { color: red; }'))
+
+    assert_equal '#<Cataract::StylesheetDiff +1 -1 ~1>', diff.inspect
+  end
+
+  def test_non_stylesheet_raises
+    assert_raises(TypeError) { Cataract::Stylesheet.diff('.a {}', Cataract.parse_css('.a {}')) }
+  end
+
+  # ============================================================================
+  # Stylesheet#apply_patch!
+  # ============================================================================
+
+  def test_apply_patch_returns_self
+    sheet = Cataract.parse_css('.a { color: red; }')
+    diff = Cataract::Stylesheet.diff(sheet, Cataract.parse_css('.a { color: blue; }'))
+
+    assert_same sheet, sheet.apply_patch!(diff)
+  end
+
+  def test_apply_patch_keeps_unchanged_rule_objects
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: blue; }')
+    unchanged = sheet.rules[1]
+
+    sheet.apply_patch!(Cataract::Stylesheet.diff(sheet, Cataract.parse_css('.a { color: green; } .b { color: blue; }')))
+
+    assert_same unchanged, sheet.rules[1]
+  end
+
+  def test_apply_patch_round_trips
+    assert_patch_round_trips('.a { color: red; } .b { color: blue; } .c { color: green; }',
+                             '.x { top: 0; } .a { color: red; } .c { color: lime; } .d { color: black; }')
+  end
+
+  def test_apply_patch_with_media_queries
+    assert_patch_round_trips('.a { color: red; } @media screen { .b { color: blue; } }',
+                             '@media print { .p { color: black; } } .a { color: red; } @media screen { .b { color: navy; } }')
+  end
+
+  def test_apply_patch_with_at_rules
+    assert_patch_round_trips('@keyframes k { from { opacity: 0; } } @font-face { font-family: A; src: url(a.woff); }',
+                             '@keyframes k { from { opacity: 1; } } @font-face { font-family: A; src: url(a2.woff); }')
+  end
+
+  def test_apply_patch_with_nesting
+    assert_patch_round_trips('.a { color: red; } .p { color: red; &:hover { color: blue; } }',
+                             '.p { color: red; &:hover { color: navy; } } .q { margin: 0; }')
+  end
+
+  def test_apply_patch_regroups_kept_and_added_rules
+    diff = assert_patch_round_trips('.x1, .c7 { margin: 2px; }', '.x1, .c1 { margin: 2px; }')
+
+    assert_equal 2, diff.size
+  end
+
+  def test_apply_patch_ungroups_kept_rules
+    assert_patch_round_trips('.a, .b { margin: 2px; } .c { top: 0; }', '.a { margin: 2px; } .b { margin: 2px; }')
+  end
+
+  def test_apply_patch_adds_missing_media_query
+    sheet = Cataract.parse_css('.a { color: red; }')
+    sheet.apply_patch!(Cataract::Stylesheet.diff(sheet, Cataract.parse_css('@media (min-width: 10px) { .a { color: red; } }')))
+
+    assert_equal 1, sheet.media_queries.size
+    assert_equal [0], sheet.media_index[:all]
+  end
+
+  def test_apply_patch_to_wrong_stylesheet_raises
+    diff = Cataract::Stylesheet.diff(Cataract.parse_css('.a { color: red; }'), Cataract.parse_css('.b { color: red; }'))
+
+    assert_raises(ArgumentError) { Cataract.parse_css('.x { color: red; } .y { color: red; }').apply_patch!(diff) }
+    assert_raises(ArgumentError) { Cataract.parse_css('.x { color: red; }').apply_patch!(diff) }
+  end
+
+  def test_apply_patch_can_be_applied_to_several_copies
+    old_css = '.a { color: red; }'
+    diff = Cataract::Stylesheet.diff(Cataract.parse_css(old_css), Cataract.parse_css('.a { color: blue; }'))
+    first = Cataract.parse_css(old_css).apply_patch!(diff)
+    first.rules[0].declarations[0].value = 'green'
+
+    second = Cataract.parse_css(old_css).apply_patch!(diff)
+
+    assert_equal 'blue', second.rules[0].declarations[0].value
+  end
+
+  def test_large_stylesheet_with_local_edits
+    old_css = Array.new(5000) { |i| ".r#{i} { width: #{i}px; }" }.join("\n")
+    new_css = old_css.sub('.r10 { width: 10px; }', '.r10 { width: 11px; }')
+                     .sub('.r2500 { width: 2500px; }', '')
+                     .sub('.r4000 { width: 4000px; }', ".r4000 { width: 4000px; }\n.new { color: red; }")
+
+    diff = assert_patch_round_trips(old_css, new_css)
+
+    assert_equal 3, diff.size
+  end
+end
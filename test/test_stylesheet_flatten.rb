@@ -178,4 +178,74 @@ class TestStylesheetFlatten < Minitest::Test
     refute_equal important_bg_rule.id, regular_bg_rule.id,
                  'Print and base body rules should not be merged'
   end
+
+  # ============================================================================
+  # Selective flatten (flatten(selectors: ...))
+  # ============================================================================
+
+  def test_flatten_with_selector_array_only_returns_matching_rules
+    sheet = Cataract.parse_css(<<~CSS)
+      .btn { color: red; padding: 0; }
+      .card { color: green; }
+      .btn { color: blue; }
+      @font-face { font-family: X; src: url(x.woff); }
+    CSS
+
+    result = sheet.flatten(selectors: ['.btn'])
+
+    assert_equal 1, result.rules.size
+    assert_equal '.btn', result.rules.first.selector
+    assert_has_property({ color: 'blue' }, result.rules.first)
+    assert_has_property({ padding: '0' }, result.rules.first)
+    assert_equal 4, sheet.rules.size, 'source stylesheet should be untouched'
+  end
+
+  def test_flatten_with_selector_string
+    sheet = Cataract.parse_css('.a { color: red; } .b { color: green; } .a { margin: 0; }')
+
+    result = sheet.flatten(selectors: '.a')
+
+    assert_equal ['.a'], result.rules.map(&:selector)
+    assert_has_property({ color: 'red' }, result.rules.first)
+    assert_has_property({ margin: '0' }, result.rules.first)
+  end
+
+  def test_flatten_with_selector_regexp
+    sheet = Cataract.parse_css('.card { color: red; } .card-title { color: green; } .nav { color: blue; }')
+
+    result = sheet.flatten(selectors: /\A\.card/)
+
+    assert_equal ['.card', '.card-title'], result.rules.map(&:selector).sort
+  end
+
+  def test_flatten_with_selectors_keeps_media_separation
+    sheet = Cataract.parse_css(<<~CSS)
+      .btn { color: red; }
+      @media print { .btn { color: black; } }
+      .other { color: blue; }
+    CSS
+
+    result = sheet.flatten(selectors: ['.btn'])
+
+    assert_equal 2, result.rules.size
+    print_ids = result.media_index[:print]
+
+    assert_equal 1, print_ids.size
+    assert_has_property({ color: 'black' }, result.rules[print_ids.first])
+    assert_equal "@media print {\n.btn { color: black; }\n}\n", result.to_s(media: :print)
+  end
+
+  def test_flatten_with_no_matching_selectors_returns_empty_stylesheet
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    result = sheet.flatten(selectors: ['.missing'])
+
+    assert_empty result.rules
+  end
+
+  def test_flatten_with_invalid_selectors_type_raises
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_raises(TypeError) { sheet.flatten(selectors: 42) }
+  end
 end
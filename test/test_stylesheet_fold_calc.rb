@@ -0,0 +1,152 @@
+require_relative 'test_helper'
+
+class TestStylesheetFoldCalc < Minitest::Test
+  # ============================================================================
+  # Cataract.fold_calc - single value folding
+  # ============================================================================
+
+  def test_folds_same_unit_arithmetic
+    assert_equal '16px', Cataract.fold_calc('calc(8px * 2)')
+    assert_equal '6px', Cataract.fold_calc('calc(10px - 4px)')
+    assert_equal '2.5em', Cataract.fold_calc('calc(5em / 2)')
+  end
+
+  def test_keeps_mixed_absolute_units
+    # Converting would round to px (calc(1in + 10mm) = 133.79528px)
+    assert_equal 'calc(1in + 10mm)', Cataract.fold_calc('calc(1in + 10mm)')
+    assert_equal 'calc(1s + 500ms)', Cataract.fold_calc('calc(1s + 500ms)')
+    assert_equal 'calc(1in + 4px)', Cataract.fold_calc('calc(1in + 2px + 2px)')
+  end
+
+  def test_compares_convertible_units_in_min_max
+    assert_equal '10px', Cataract.fold_calc('min(10px, 1in)')
+    assert_equal '1in', Cataract.fold_calc('max(10px, 1in)')
+  end
+
+  def test_keeps_calc_around_negative_results
+    # A bare -5px is invalid for padding; calc(-5px) is clamped to 0
+    assert_equal 'calc(-5px)', Cataract.fold_calc('calc(5px - 10px)')
+    assert_equal 'calc(-2)', Cataract.fold_calc('calc(1 - 3)')
+    assert_equal 'calc(-5px)', Cataract.fold_calc('min(-5px, 0px)')
+  end
+
+  def test_keeps_mixed_relative_units
+    assert_equal 'calc(100% - 10px)', Cataract.fold_calc('calc(100% - 10px)')
+    assert_equal 'min(10px, 2em)', Cataract.fold_calc('min(10px, 2em)')
+  end
+
+  def test_combines_terms_around_unknown_parts
+    assert_equal 'calc(100% - 4px)', Cataract.fold_calc('calc(100% - 2px - 2px)')
+    assert_equal 'calc(var(--gap) + 4px)', Cataract.fold_calc('calc(var(--gap) + 2px + 2px)')
+  end
+
+  def test_drops_zero_terms
+    assert_equal '100%', Cataract.fold_calc('calc(100% - 0px)')
+  end
+
+  def test_folds_min_max_clamp
+    assert_equal '10px', Cataract.fold_calc('min(10px, 20px)')
+    assert_equal '20px', Cataract.fold_calc('max(10px, calc(10px * 2))')
+    assert_equal '15px', Cataract.fold_calc('clamp(10px, 15px, 20px)')
+  end
+
+  def test_folds_nested_calc_inside_other_values
+    assert_equal '0 4px', Cataract.fold_calc('0 calc(2px * 2)')
+  end
+
+  def test_leaves_invalid_expressions_untouched
+    assert_equal 'calc(1px -2px)', Cataract.fold_calc('calc(1px -2px)')
+    assert_equal 'calc(10px + 2s)', Cataract.fold_calc('calc(10px + 2s)')
+  end
+
+  def test_keeps_inexact_unitless_division
+    assert_equal 'calc(10 / 3)', Cataract.fold_calc('calc(10 / 3)')
+  end
+
+  def test_returns_same_object_when_unchanged
+    value = 'red'
+
+    assert_same value, Cataract.fold_calc(value)
+  end
+
+  def test_skips_urls_and_strings
+    value = 'url("calc(1px + 1px).png")'
+
+    assert_equal value, Cataract.fold_calc(value)
+  end
+
+  def test_raises_type_error_for_non_string
+    assert_raises(TypeError) { Cataract.fold_calc(42) }
+  end
+
+  # ============================================================================
+  # Stylesheet#fold_calc!
+  # ============================================================================
+
+  def test_returns_self
+    sheet = Cataract.parse_css('.box { width: calc(1px + 1px); }')
+
+    assert_same sheet, sheet.fold_calc!
+  end
+
+  def test_rewrites_declaration_values
+    sheet = Cataract.parse_css('.box { width: calc(8px * 2); margin: calc(100% - 2px - 2px) !important; }')
+
+    sheet.fold_calc!
+
+    assert_equal '.box { width: 16px; margin: calc(100% - 4px) !important; }', sheet.to_s.strip
+  end
+
+  def test_rewrites_rules_inside_media
+    sheet = Cataract.parse_css('@media screen { .box { height: calc(2 * 3rem); } }')
+
+    sheet.fold_calc!
+
+    assert_equal "@media screen {\n.box { height: 6rem; }\n}\n", sheet.to_s
+  end
+
+  def test_rewrites_keyframes_content
+    sheet = Cataract.parse_css('@keyframes slide { from { left: calc(5px + 5px); } to { left: calc(50px * 2); } }')
+
+    sheet.fold_calc!
+
+    assert_equal "@keyframes slide {\n  from { left: 10px; }\n  to { left: 100px; }\n}\n", sheet.to_s
+  end
+
+  def test_leaves_unfoldable_stylesheet_unchanged
+    css = '.box { width: calc(100% - 10px); color: red; }'
+    sheet = Cataract.parse_css(css)
+    before = sheet.to_s
+
+    sheet.fold_calc!
+
+    assert_equal before, sheet.to_s
+  end
+
+  # ============================================================================
+  # flatten(fold_calc:)
+  # ============================================================================
+
+  def test_flatten_folds_when_requested
+    sheet = Cataract.parse_css('.box { width: calc(10px + 10px); } .box { height: calc(3px * 3); }')
+
+    flattened = sheet.flatten(fold_calc: true)
+
+    assert_equal '20px', flattened.rules.first.declarations.find { |d| d.property == 'width' }.value
+    assert_equal '9px', flattened.rules.first.declarations.find { |d| d.property == 'height' }.value
+  end
+
+  def test_flatten_does_not_fold_by_default
+    sheet = Cataract.parse_css('.box { width: calc(10px + 10px); }')
+
+    assert_equal ".box { width: calc(10px + 10px); }\n", sheet.flatten.to_s
+  end
+
+  def test_flatten_bang_folds_when_requested
+    sheet = Cataract.parse_css('.box { width: calc(10px + 10px); }')
+
+    sheet.flatten!(fold_calc: true)
+
+    assert_equal ".box { width: 20px; }\n", sheet.to_s
+  end
+end
@@ -0,0 +1,166 @@
+require_relative 'test_helper'
+
+class TestStylesheetMinifyNames < Minitest::Test
+  # ============================================================================
+  # Mapping
+  # ============================================================================
+
+  def test_most_used_names_get_shortest_names
+    sheet = Cataract.parse_css('.rare { color: red; } .common .common { color: blue; } .common:hover { color: green; }')
+
+    mapping = sheet.minify_names!
+
+    assert_equal({ '.common' => '.a', '.rare' => '.b' }, mapping)
+    assert_equal ['.b', '.a .a', '.a:hover'], sheet.rules.map(&:selector)
+  end
+
+  def test_classes_and_ids_are_separate_namespaces
+    sheet = Cataract.parse_css('#main .content { margin: 0; }')
+
+    assert_equal({ '#main' => '#a', '.content' => '.a' }, sheet.minify_names!)
+    assert_equal '#a .a', sheet.rules[0].selector
+  end
+
+  def test_short_names_grow_past_one_character
+    indexes = [0, 25, 26, 27, 26 + (26 * 36) - 1, 26 + (26 * 36)]
+
+    assert_equal %w[a z aa ba z9 aaa], indexes.map { |i| Cataract::NameMinifier.short_name(i) }
+  end
+
+  def test_keep
+    sheet = Cataract.parse_css('.js-toggle { color: red; } .nav { color: blue; } #app .nav { top: 0; } .app { left: 0; }')
+
+    mapping = sheet.minify_names!(keep: %w[.js-toggle app])
+
+    assert_equal({ '.nav' => '.a' }, mapping)
+    assert_equal ['.js-toggle', '.a', '#app .a', '.app'], sheet.rules.map(&:selector)
+  end
+
+  def test_keep_reserves_short_names
+    sheet = Cataract.parse_css('.header { color: red; }')
+
+    assert_equal({ '.header' => '.c' }, sheet.minify_names!(keep: %w[.a .b]))
+  end
+
+  # ============================================================================
+  # Selector syntax
+  # ============================================================================
+
+  def test_pseudo_class_arguments_are_renamed
+    sheet = Cataract.parse_css('.item:not(.active) { color: red; } .list:has(> .item) { color: blue; } ' \
+                               '.nav:is(.open, .pinned) { top: 0; }')
+
+    mapping = sheet.minify_names!
+
+    assert_equal %w[.item .active .list .nav .open .pinned].sort, mapping.keys.sort
+    assert_equal "#{mapping['.item']}:not(#{mapping['.active']}) { color: red; }\n" \
+                 "#{mapping['.list']}:has(> #{mapping['.item']}) { color: blue; }\n" \
+                 "#{mapping['.nav']}:is(#{mapping['.open']}, #{mapping['.pinned']}) { top: 0; }\n",
+                 sheet.to_s
+  end
+
+  def test_names_in_nested_pseudo_arguments_and_attributes
+    sheet = Cataract.parse_css('svg|a:not(:is(.x [class~="y"])) a\.b { color: red; }')
+
+    assert_equal({ '.x' => '.a', '.y' => '.b' }, sheet.minify_names!)
+    assert_equal 'svg|a:not(:is(.a [class~="b"])) a\.b', sheet.rules[0].selector
+  end
+
+  def test_exact_class_and_id_attributes_are_renamed
+    sheet = Cataract.parse_css('.btn { color: red; } [class~=btn] { top: 0; } [id="main"] { margin: 0; } ' \
+                               '#main { padding: 0; } [class="btn wide"] { left: 0; }')
+
+    mapping = sheet.minify_names!
+
+    assert_equal '.a', mapping['.btn']
+    assert_equal ['.a', '[class~="a"]', '[id="a"]', '#a', "[class=\"a #{mapping['.wide'][1..]}\"]"],
+                 sheet.rules.map(&:selector)
+  end
+
+  def test_other_attributes_and_strings_are_untouched
+    sheet = Cataract.parse_css('a[href=".btn"] .btn { color: red; } [data-id="#main"] #main { top: 0; } ' \
+                               '[class] .x { left: 0; }')
+
+    sheet.minify_names!
+
+    assert_equal ['a[href=".btn"] .a', '[data-id="#main"] #a', '[class] .b'], sheet.rules.map(&:selector)
+  end
+
+  def test_substring_attribute_matches_keep_names
+    sheet = Cataract.parse_css('[class^="col-"] { float: left; } .col-6 { width: 50%; } .row { margin: 0; } ' \
+                               '[class*="c"] { top: 0; } [ID="Main" i] { left: 0; } #main { right: 0; }')
+
+    mapping = sheet.minify_names!
+
+    assert_equal({ '.row' => '.a' }, mapping)
+    assert_equal '.col-6', sheet.rules[1].selector
+    assert_equal '#main', sheet.rules[5].selector
+  end
+
+  def test_short_names_avoid_substring_attribute_matches
+    sheet = Cataract.parse_css('[class*="a"] { top: 0; } .list { color: red; }')
+
+    assert_equal({ '.list' => '.b' }, sheet.minify_names!)
+  end
+
+  def test_escaped_names
+    sheet = Cataract.parse_css('.sm\:flex { display: flex; } .\31 0 { top: 0; }')
+
+    mapping = sheet.minify_names!
+
+    assert_equal({ '.sm:flex' => '.a' }, mapping)
+    assert_equal ['.a', '.\31 0'], sheet.rules.map(&:selector)
+  end
+
+  def test_hex_escaped_names_are_not_reused
+    sheet = Cataract.parse_css('.\\61 { color: red; } .btn { color: blue; } .a { top: 0; } ' \
+                               '[class="\\62 "] { left: 0; } [class^="\\63 "] { right: 0; } .cell { margin: 0; }')
+
+    mapping = sheet.minify_names!
+
+    assert_equal({ '.btn' => '.d' }, mapping)
+    assert_equal ".\\61 { color: red; }\n.d { color: blue; }\n.a { top: 0; }\n[class=\"\\62 \"] { left: 0; }\n" \
+                 "[class^=\"\\63 \"] { right: 0; }\n.cell { margin: 0; }\n", sheet.to_s
+  end
+
+  def test_non_ascii_names
+    sheet = Cataract.parse_css(".café { color: red; } .café:hover { color: blue; }")
+
+    assert_equal({ '.café' => '.a' }, sheet.minify_names!)
+    assert_equal %w[.a .a:hover], sheet.rules.map(&:selector)
+  end
+
+  # ============================================================================
+  # Stylesheet state
+  # ============================================================================
+
+  def test_media_rules_and_selector_lists
+    sheet = Cataract.parse_css('.card, .panel { color: red; } @media print { .card { color: black; } }')
+
+    sheet.minify_names!
+
+    assert_equal ".a, .b { color: red; }\n@media print {\n.a { color: black; }\n}\n", sheet.to_s
+    assert_equal [2], sheet.media_index[:print]
+  end
+
+  def test_nested_rules
+    sheet = Cataract.parse_css('.card { margin: 0; &:hover { color: blue; } .title { color: red; } }')
+
+    assert_equal({ '.card' => '.a', '.title' => '.b' }, sheet.minify_names!)
+    assert_equal ".a { margin: 0; &:hover { color: blue; } .b { color: red; } }\n", sheet.to_s
+  end
+
+  def test_no_names
+    sheet = Cataract.parse_css('body { margin: 0; } @font-face { font-family: X; }')
+
+    assert_empty sheet.minify_names!
+    assert_equal Cataract.parse_css('body { margin: 0; } @font-face { font-family: X; }').to_s, sheet.to_s
+  end
+
+  def test_invalid_keep
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_raises(TypeError) { sheet.minify_names!(keep: '.a') }
+    assert_raises(TypeError) { sheet.minify_names!(keep: [:a]) }
+  end
+end
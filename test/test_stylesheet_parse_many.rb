@@ -0,0 +1,136 @@
+require_relative 'test_helper'
+require 'pathname'
+require 'stringio'
+require 'tmpdir'
+
+class TestStylesheetParseMany < Minitest::Test
+  SOURCES = [
+    '.a, .b { color: red; } @media screen, print { .c { margin: 0; } }',
+    '.p { color: red; } @media (min-width: 10px) { .d { top: 0; } }',
+    '@font-face { font-family: A; } h1, h2 { font-weight: bold; } @media print { .e { color: black; } }'
+  ].freeze
+
+  # ============================================================================
+  # Stylesheet.parse_many - equivalence with parse + add_block
+  # ============================================================================
+
+  def test_matches_sequential_add_block
+    sequential = Cataract::Stylesheet.parse(SOURCES[0])
+    SOURCES.drop(1).each { |css| sequential.add_block(css) }
+
+    sheet = Cataract::Stylesheet.parse_many(SOURCES)
+
+    assert_equal sequential.to_s, sheet.to_s
+    assert_equal sequential.rules.map(&:id), sheet.rules.map(&:id)
+    assert_equal sequential.rules.map(&:selector), sheet.rules.map(&:selector)
+    assert_equal sequential.media_queries, sheet.media_queries
+    assert_equal sequential.media_index, sheet.media_index
+    assert_equal sequential.instance_variable_get(:@_selector_lists), sheet.instance_variable_get(:@_selector_lists)
+    assert_equal sequential.instance_variable_get(:@_media_query_lists),
+                 sheet.instance_variable_get(:@_media_query_lists)
+  end
+
+  def test_ids_are_contiguous_across_sources
+    sheet = Cataract::Stylesheet.parse_many(SOURCES)
+
+    assert_equal (0...sheet.rules.size).to_a, sheet.rules.map(&:id)
+    assert_equal (0...sheet.media_queries.size).to_a, sheet.media_queries.map(&:id)
+    assert_equal [[0, 1], [6, 7]], sheet.instance_variable_get(:@_selector_lists).values
+  end
+
+  def test_nested_rule_parent_ids_point_into_the_sheet
+    sheet = Cataract::Stylesheet.parse_many(['.a { color: red; }', '.p { color: red; &:hover { color: blue; } }'])
+    hover = sheet.rules.find { |rule| rule.selector == '.p:hover' }
+
+    assert_equal '.p', sheet.rules[hover.parent_rule_id].selector
+  end
+
+  def test_later_additions_continue_numbering
+    sheet = Cataract::Stylesheet.parse_many(['.a { color: red; }', '.b { color: red; }'])
+    sheet.add_block('.c, .d { color: blue; }')
+
+    assert_equal [0, 1, 2, 3], sheet.rules.map(&:id)
+    assert_equal [[2, 3]], sheet.instance_variable_get(:@_selector_lists).values
+  end
+
+  def test_empty_sources
+    sheet = Cataract::Stylesheet.parse_many([])
+
+    assert_empty sheet
+  end
+
+  # ============================================================================
+  # @charset and @import
+  # ============================================================================
+
+  def test_first_charset_wins
+    sheet = Cataract::Stylesheet.parse_many(['.a { color: red; }', '@charset "utf-8"; .b { color: red; }',
+                                             '@charset "latin1"; .c { color: red; }'])
+
+    assert_equal 'utf-8', sheet.charset
+    assert_equal %w[.a .b .c], sheet.rules.map(&:selector)
+  end
+
+  def test_import_at_top_of_later_source_is_kept
+    sheet = Cataract::Stylesheet.parse_many(['.a { color: red; }', '@import "b.css" print; .b { color: red; }'])
+
+    assert_equal ['b.css'], sheet.imports.map(&:url)
+    assert_equal :print, sheet.media_queries[sheet.imports.first.media_query_id].type
+  end
+
+  def test_imports_resolve_against_each_base_dir
+    Dir.mktmpdir do |dir|
+      %w[one two].each do |name|
+        Dir.mkdir(File.join(dir, name))
+        File.write(File.join(dir, name, 'part.css'), ".from-#{name} { color: red; }")
+      end
+
+      sheet = Cataract::Stylesheet.parse_many(
+        ['@import "part.css"; .first { color: red; }', '@import "part.css"; .second { color: red; }'],
+        base_dirs: [File.join(dir, 'one'), File.join(dir, 'two')],
+        import: { allowed_schemes: ['file'] }
+      )
+
+      assert_equal %w[.from-one .first .from-two .second], sheet.rules.map(&:selector)
+      assert_equal [0, 1, 2, 3], sheet.rules.map(&:id)
+    end
+  end
+
+  # ============================================================================
+  # Source types
+  # ============================================================================
+
+  def test_path_and_io_sources
+    Dir.mktmpdir do |dir|
+      File.write(File.join(dir, 'a.css'), '.a { color: red; }')
+      File.write(File.join(dir, 'b.css'), '.b { color: blue; }')
+
+      sheet = File.open(File.join(dir, 'b.css')) do |file|
+        Cataract::Stylesheet.parse_many([Pathname(File.join(dir, 'a.css')), file,
+                                         StringIO.new('.c { color: green; }'), '.d { color: black; }'])
+      end
+
+      assert_equal %w[.a .b .c .d], sheet.rules.map(&:selector)
+    end
+  end
+
+  def test_path_source_resolves_imports_from_its_directory
+    Dir.mktmpdir do |dir|
+      File.write(File.join(dir, 'base.css'), '.base { color: red; }')
+      File.write(File.join(dir, 'main.css'), '@import "base.css"; .main { color: blue; }')
+
+      sheet = Cataract::Stylesheet.parse_many([Pathname(File.join(dir, 'main.css'))],
+                                              import: { allowed_schemes: ['file'] })
+
+      assert_equal %w[.base .main], sheet.rules.map(&:selector)
+    end
+  end
+
+  def test_invalid_source_raises
+    assert_raises(TypeError) { Cataract::Stylesheet.parse_many(['.a { color: red; }', 42]) }
+  end
+
+  def test_base_dirs_size_mismatch_raises
+    assert_raises(ArgumentError) { Cataract::Stylesheet.parse_many(['.a {}', '.b {}'], base_dirs: ['.']) }
+  end
+end
@@ -0,0 +1,217 @@
+require_relative 'test_helper'
+require 'tmpdir'
+
+class TestStylesheetPrunePrefixes < Minitest::Test
+  MODERN = { chrome: 120, firefox: 115, safari: 16 }.freeze
+
+  def prune(css, targets = MODERN, **options)
+    Cataract.parse_css(css).prune_prefixes!(targets: targets, **options)
+  end
+
+  # ============================================================================
+  # Properties
+  # ============================================================================
+
+  def test_prefixed_property_removed_when_standard_present
+    sheet = prune('.a { -webkit-transition: x 1s; -moz-transition: x 1s; -o-transition: x 1s; transition: x 1s; }')
+
+    assert_equal ".a { transition: x 1s; }\n", sheet.to_s
+  end
+
+  def test_prefixed_property_renamed_when_standard_missing
+    sheet = prune('.a { -webkit-appearance: none; }')
+
+    assert_equal ".a { appearance: none; }\n", sheet.to_s
+  end
+
+  def test_later_prefixed_property_wins_over_standard
+    sheet = prune('.a { transform: rotate(2deg); -webkit-transform: rotate(1deg); }', { chrome: 120, firefox: 120, safari: 17 })
+
+    assert_equal ".a { transform: rotate(1deg); }\n", sheet.to_s
+  end
+
+  def test_important_prefixed_property_wins_over_standard
+    sheet = prune('.a { -webkit-transform: rotate(1deg) !important; transform: rotate(2deg); }', { chrome: 120, firefox: 120, safari: 17 })
+
+    assert_equal ".a { transform: rotate(1deg) !important; }\n", sheet.to_s
+  end
+
+  def test_prefix_no_target_parses_is_removed
+    sheet = prune('.a { -ms-overflow-style: none; -o-tab-size: 4; color: red; }')
+
+    assert_equal ".a { color: red; }\n", sheet.to_s
+  end
+
+  def test_needed_prefix_is_kept
+    sheet = prune('.a { -webkit-backdrop-filter: blur(2px); backdrop-filter: blur(2px); }')
+
+    assert_equal ".a { -webkit-backdrop-filter: blur(2px); backdrop-filter: blur(2px); }\n", sheet.to_s
+    refute_includes prune(sheet.to_s, { chrome: 120, safari: 18 }).to_s, '-webkit-'
+  end
+
+  def test_old_targets_keep_everything
+    css = '.a { -webkit-transition: x 1s; -moz-transition: x 1s; transition: x 1s; }'
+
+    assert_equal Cataract.parse_css(css).to_s, prune(css, { chrome: 20, firefox: 10 }).to_s
+  end
+
+  def test_property_entry_covers_longer_names
+    sheet = prune('.a { -webkit-animation-name: spin; -webkit-animation-duration: 1s; animation-duration: 1s; }')
+
+    assert_equal ".a { animation-name: spin; animation-duration: 1s; }\n", sheet.to_s
+  end
+
+  def test_longhands_with_their_own_standard_are_not_renamed
+    css = '.a { -webkit-mask-box-image: url(m.svg) 30 fill; -webkit-mask-image: url(m.svg); }'
+
+    assert_equal ".a { -webkit-mask-box-image: url(m.svg) 30 fill; mask-image: url(m.svg); }\n",
+                 prune(css, { chrome: 120, firefox: 120, safari: 17 }).to_s
+  end
+
+  def test_longhands_with_different_values_are_not_renamed
+    css = '.a { -webkit-mask-composite: source-over; -webkit-mask-repeat: no-repeat; }'
+
+    assert_equal ".a { -webkit-mask-composite: source-over; mask-repeat: no-repeat; }\n",
+                 prune(css, { chrome: 120, firefox: 120, safari: 17 }).to_s
+  end
+
+  def test_names_without_standard_form_are_kept
+    css = '.a { display: -webkit-box; -webkit-line-clamp: 3; -webkit-box-orient: vertical; ' \
+          '-webkit-font-smoothing: antialiased; -moz-osx-font-smoothing: grayscale; }'
+
+    assert_equal Cataract.parse_css(css).to_s, prune(css).to_s
+    assert_equal ".a { display: -webkit-box; -webkit-line-clamp: 3; -webkit-box-orient: vertical; " \
+                 "-webkit-font-smoothing: antialiased; }\n", prune(css, { chrome: 120 }).to_s
+  end
+
+  def test_unknown_names_follow_their_prefix
+    sheet = prune('.a { -webkit-made-up: 1; -moz-made-up: 1; -khtml-made-up: 1; }', { chrome: 120 })
+
+    assert_equal ".a { -webkit-made-up: 1; -khtml-made-up: 1; }\n", sheet.to_s
+  end
+
+  # ============================================================================
+  # Values
+  # ============================================================================
+
+  def test_prefixed_value_removed_when_fallback_exists
+    sheet = prune('.a { position: -webkit-sticky; position: sticky; }')
+
+    assert_equal ".a { position: sticky; }\n", sheet.to_s
+  end
+
+  def test_prefixed_value_without_fallback_is_kept
+    sheet = prune('.a { position: -webkit-sticky; }')
+
+    assert_equal ".a { position: -webkit-sticky; }\n", sheet.to_s
+  end
+
+  def test_value_with_prefix_no_target_parses_is_removed
+    sheet = prune('.a { background: -moz-linear-gradient(red, blue); color: red; }', { chrome: 120 })
+
+    assert_equal ".a { color: red; }\n", sheet.to_s
+  end
+
+  def test_strings_urls_and_system_fonts_are_not_values
+    css = '.a { font-family: -apple-system, "-moz-x"; background: url(-webkit-sprite.png); content: "-moz-y"; }'
+
+    assert_equal Cataract.parse_css(css).to_s, prune(css, { chrome: 120 }).to_s
+  end
+
+  # ============================================================================
+  # Selectors and at-rules
+  # ============================================================================
+
+  def test_prefixed_selector_rule_removed_when_standard_rule_exists
+    sheet = prune('::-moz-selection { color: red; } ::selection { color: red; } ' \
+                  'input::-ms-input-placeholder { color: gray; }')
+
+    assert_equal ['::selection'], sheet.rules.map(&:selector)
+  end
+
+  def test_prefixed_selector_renamed_when_standard_rule_missing
+    sheet = prune('input::-webkit-input-placeholder { color: gray; }')
+
+    assert_equal ['input::placeholder'], sheet.rules.map(&:selector)
+  end
+
+  def test_selector_entries_match_whole_names
+    sheet = prune('.a:not(:-moz-placeholder-shown) { color: red; } [data-x=":-moz-selection"] { color: red; }')
+
+    assert_equal [".a:not(:-moz-placeholder-shown)", '[data-x=":-moz-selection"]'], sheet.rules.map(&:selector)
+  end
+
+  def test_prefixed_keyframes
+    sheet = prune('@-webkit-keyframes spin { to { -webkit-transform: rotate(1turn); } } ' \
+                  '@keyframes spin { to { transform: rotate(1turn); } } ' \
+                  '@-moz-keyframes fade { to { opacity: 0; } }')
+
+    assert_equal ['@keyframes spin', '@keyframes fade'], sheet.rules.map(&:selector)
+    assert_equal "@keyframes spin {\n  to { transform: rotate(1turn); }\n}\n@keyframes fade {\n  to { opacity: 0; }\n}\n",
+                 sheet.to_s
+  end
+
+  def test_keyframe_blocks_are_pruned
+    sheet = prune('@keyframes spin { from { -webkit-transform: none; transform: none; } }')
+
+    assert_equal "@keyframes spin {\n  from { transform: none; }\n}\n", sheet.to_s
+  end
+
+  def test_media_index_is_rebuilt
+    sheet = prune('@media print { .a { color: red; } ::-moz-selection { color: red; } } .b { color: blue; }',
+                  { chrome: 120 })
+
+    assert_equal %w[.a .b], sheet.rules.map(&:selector)
+    assert_equal [0], sheet.media_index[:print]
+  end
+
+  # ============================================================================
+  # Tables and arguments
+  # ============================================================================
+
+  def test_custom_table
+    data = { 'engines' => { '-webkit-' => %w[chrome] },
+             'properties' => { '-webkit-box-shadow' => { 'chrome' => 9 } } }
+    css = '.a { -webkit-box-shadow: none; -webkit-transition: x 1s; }'
+    table = Cataract::PrefixTable.new(data)
+
+    assert_equal ".a { box-shadow: none; -webkit-transition: x 1s; }\n",
+                 prune(css, { chrome: 100 }, table: table).to_s
+
+    Dir.mktmpdir do |dir|
+      path = File.join(dir, 'prefixes.json')
+      File.write(path, JSON.generate(data))
+
+      assert_equal ".a { -webkit-box-shadow: none; -webkit-transition: x 1s; }\n",
+                   prune(css, { chrome: 8 }, table: path).to_s
+    end
+  end
+
+  def test_version_strings
+    css = '.a { -webkit-backdrop-filter: blur(2px); }'
+
+    assert_equal ".a { -webkit-backdrop-filter: blur(2px); }\n", prune(css, { safari: '17.6' }).to_s
+    assert_equal ".a { backdrop-filter: blur(2px); }\n", prune(css, { safari: '18.0' }).to_s
+  end
+
+  def test_invalid_arguments
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_raises(TypeError) { sheet.prune_prefixes!(targets: [:chrome]) }
+    assert_raises(TypeError) { sheet.prune_prefixes!(targets: MODERN, table: 1) }
+    assert_raises(ArgumentError) { sheet.prune_prefixes!(targets: {}) }
+    assert_raises(ArgumentError) { sheet.prune_prefixes!(targets: { netscape: 4 }) }
+    assert_raises(ArgumentError) { sheet.prune_prefixes!(targets: { chrome: 'latest' }) }
+  end
+
+  def test_returns_self_and_works_in_batch
+    sheet = Cataract.parse_css('::-moz-selection { color: red; } .a { -moz-user-select: none; }')
+
+    result = sheet.batch { |s| s.prune_prefixes!(targets: { chrome: 120 }) }
+
+    assert_same sheet, result
+    assert_equal %w[.a], sheet.rules.map(&:selector)
+    assert_equal [0], sheet.rules.map(&:id)
+    assert_empty sheet.rules[0].declarations
+  end
+end
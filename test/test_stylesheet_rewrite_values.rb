@@ -0,0 +1,187 @@
+require_relative 'test_helper'
+
+class TestStylesheetRewriteValues < Minitest::Test
+  # ============================================================================
+  # Stylesheet#rewrite_values! - bulk literal substring replacement
+  # ============================================================================
+
+  def test_returns_self
+    sheet = Cataract.parse_css('.box { color: red; }')
+
+    assert_same sheet, sheet.rewrite_values!({ 'red' => 'blue' })
+  end
+
+  def test_replaces_substring_in_values
+    sheet = Cataract.parse_css('.hero { background: url(http://old.cdn/a.png) no-repeat; }')
+
+    sheet.rewrite_values!({ 'http://old.cdn' => 'https://cdn.example' })
+
+    assert_equal '.hero { background: url(https://cdn.example/a.png) no-repeat; }', sheet.to_s.strip
+  end
+
+  def test_replaces_every_occurrence
+    sheet = Cataract.parse_css('.a { font-family: Arial, Arial Black, sans-serif; }')
+
+    sheet.rewrite_values!({ 'Arial' => 'Inter' })
+
+    assert_equal 'Inter, Inter Black, sans-serif', sheet.rules.first.declarations.first.value
+  end
+
+  def test_applies_multiple_mappings_in_one_pass
+    sheet = Cataract.parse_css('.a { color: var(--old-fg); background: var(--old-bg); }')
+
+    sheet.rewrite_values!({ '--old-fg' => '--fg', '--old-bg' => '--bg' })
+
+    assert_equal '.a { color: var(--fg); background: var(--bg); }', sheet.to_s.strip
+  end
+
+  def test_longest_pattern_wins_at_same_position
+    sheet = Cataract.parse_css('.a { color: var(--brand-dark); }')
+
+    sheet.rewrite_values!({ '--brand' => '--x', '--brand-dark' => '--y' })
+
+    assert_equal 'var(--y)', sheet.rules.first.declarations.first.value
+  end
+
+  def test_match_found_after_partial_longer_pattern
+    sheet = Cataract.parse_css('.a { content: abcx abce; }')
+
+    sheet.rewrite_values!({ 'abcd' => '1', 'bcx' => '2', 'ce' => '3', 'bc' => '4' })
+
+    assert_equal '.a { content: a2 a4e; }', sheet.to_s.strip
+  end
+
+  def test_many_long_patterns
+    mappings = Array.new(5000) { |i| ["pattern-#{i.to_s.rjust(16, '0')}", "p#{i}"] }.to_h
+    sheet = Cataract.parse_css('.a { content: xpattern-0000000000004999 pattern-0000000000000007y; }')
+
+    sheet.rewrite_values!(mappings)
+
+    assert_equal '.a { content: xp4999 p7y; }', sheet.to_s.strip
+  end
+
+  def test_replacement_text_is_not_rescanned
+    sheet = Cataract.parse_css('.a { content: "ab"; }')
+
+    sheet.rewrite_values!({ 'a' => 'b', 'b' => 'a' })
+
+    assert_equal '"ba"', sheet.rules.first.declarations.first.value
+  end
+
+  def test_prefix_only_matches_start_of_value
+    sheet = Cataract.parse_css('.a { font-family: Helvetica, Arial; } .b { font-family: Arial, Helvetica; }')
+
+    sheet.rewrite_values!({ 'Helvetica' => 'system-ui' }, prefix: true)
+
+    assert_equal 'system-ui, Arial', sheet.rules[0].declarations.first.value
+    assert_equal 'Arial, Helvetica', sheet.rules[1].declarations.first.value
+  end
+
+  def test_limits_to_properties
+    sheet = Cataract.parse_css('.a { color: red; border-color: red; background: red; }')
+
+    sheet.rewrite_values!({ 'red' => 'blue' }, properties: %w[color Border-Color])
+
+    assert_equal '.a { color: blue; border-color: blue; background: red; }', sheet.to_s.strip
+  end
+
+  def test_single_property_string
+    sheet = Cataract.parse_css('.a { color: red; background: red; }')
+
+    sheet.rewrite_values!({ 'red' => 'blue' }, properties: 'background')
+
+    assert_equal '.a { color: red; background: blue; }', sheet.to_s.strip
+  end
+
+  def test_keeps_important_flag
+    sheet = Cataract.parse_css('.a { color: red !important; }')
+
+    sheet.rewrite_values!({ 'red' => 'blue' })
+
+    assert_equal '.a { color: blue !important; }', sheet.to_s.strip
+  end
+
+  def test_rewrites_inside_media_and_at_rules
+    css = <<~CSS
+      @media print { .a { color: red; } }
+      @font-face { font-family: X; src: url(http://old.cdn/x.woff2); }
+      @keyframes fade { from { color: red; } to { color: white; } }
+    CSS
+    sheet = Cataract.parse_css(css)
+
+    sheet.rewrite_values!({ 'red' => 'blue', 'http://old.cdn' => '//cdn' })
+
+    expected = "@media print {\n.a { color: blue; }\n}\n" \
+               "@font-face {\n  font-family: X; src: url(//cdn/x.woff2);\n}\n" \
+               "@keyframes fade {\n  from { color: blue; }\n  to { color: white; }\n}\n"
+
+    assert_equal expected, sheet.to_s
+  end
+
+  def test_unchanged_values_keep_same_object
+    sheet = Cataract.parse_css('.a { color: green; margin: 0; }')
+    before = sheet.rules.first.declarations.map(&:value)
+
+    sheet.rewrite_values!({ 'red' => 'blue' })
+
+    sheet.rules.first.declarations.map(&:value).zip(before).each do |after, original|
+      assert_same original, after
+    end
+  end
+
+  def test_identity_mapping_keeps_same_object
+    sheet = Cataract.parse_css('.a { color: red; }')
+    before = sheet.rules.first.declarations.first.value
+
+    sheet.rewrite_values!({ 'red' => 'red' })
+
+    assert_same before, sheet.rules.first.declarations.first.value
+  end
+
+  def test_replacement_can_be_empty
+    sheet = Cataract.parse_css('.a { width: 10px; }')
+
+    sheet.rewrite_values!({ 'px' => '' })
+
+    assert_equal '10', sheet.rules.first.declarations.first.value
+  end
+
+  def test_preserves_utf8
+    sheet = Cataract.parse_css('.a { content: "café ☕"; }')
+
+    sheet.rewrite_values!({ 'café' => 'thé' })
+
+    value = sheet.rules.first.declarations.first.value
+
+    assert_equal '"thé ☕"', value
+    assert_equal Encoding::UTF_8, value.encoding
+  end
+
+  def test_empty_mappings_is_noop
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_same sheet, sheet.rewrite_values!({})
+    assert_equal '.a { color: red; }', sheet.to_s.strip
+  end
+
+  def test_empty_pattern_raises
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_raises(ArgumentError) { sheet.rewrite_values!({ '' => 'x' }) }
+  end
+
+  def test_non_hash_raises
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_raises(TypeError) { sheet.rewrite_values!([%w[red blue]]) }
+  end
+
+  def test_clears_memoized_caches
+    sheet = Cataract.parse_css('.a { color: red; }')
+    sheet.to_s
+
+    sheet.rewrite_values!({ 'red' => 'blue' })
+
+    assert_equal '.a { color: blue; }', sheet.to_s.strip
+  end
+end
@@ -0,0 +1,156 @@
+require_relative 'test_helper'
+
+class TestStylesheetSplit < Minitest::Test
+  # ============================================================================
+  # Cataract.selector_tokens
+  # ============================================================================
+
+  def test_selector_tokens
+    assert_equal [['nav', 'a', '.Active']], Cataract.selector_tokens('nav > a.Active:hover')
+    assert_equal [['#main', 'p'], ['.x']], Cataract.selector_tokens('#main p, .x')
+    assert_equal [['div']], Cataract.selector_tokens('DIV[data-x="a.b"]::before')
+  end
+
+  def test_selector_tokens_skip_pseudo_arguments
+    assert_equal [['.b']], Cataract.selector_tokens(':not(.a) .b')
+    assert_equal [['li']], Cataract.selector_tokens('li:nth-child(2n + 1)')
+    assert_equal [[]], Cataract.selector_tokens('*')
+  end
+
+  def test_selector_tokens_decode_escapes
+    assert_equal [['.sm:flex']], Cataract.selector_tokens('.sm\:flex')
+    assert_equal [['.café']], Cataract.selector_tokens('.café')
+  end
+
+  # ============================================================================
+  # Placement
+  # ============================================================================
+
+  def test_rules_used_by_most_pages_are_shared
+    sheet = Cataract.parse_css('body { margin: 0; } .hero { color: red; } article { color: black; }')
+
+    split = sheet.split(pages: { home: %w[body .hero], blog: %w[body article], about: %w[body] })
+
+    assert_equal %w[body], split.shared.rules.map(&:selector)
+    assert_equal %w[.hero], split.pages[:home].rules.map(&:selector)
+    assert_equal %w[article], split.pages[:blog].rules.map(&:selector)
+    assert_empty split.pages[:about]
+  end
+
+  def test_selector_without_tokens_is_used_by_every_page
+    sheet = Cataract.parse_css(':root { --x: 1; } * { box-sizing: border-box; }')
+
+    split = sheet.split(pages: { a: [], b: [] })
+
+    assert_equal [':root', '*'], split.shared.rules.map(&:selector)
+  end
+
+  def test_unused_rules_are_dropped
+    sheet = Cataract.parse_css('.a { color: red; } .b .c { color: blue; } nav a, footer a { color: green; }')
+
+    split = sheet.split(pages: { one: %w[.a .b nav a], two: %w[.c] })
+
+    assert_equal ['.b .c', 'footer a'], split.unused.map(&:selector)
+    assert_equal ['.a', 'nav a'], split.pages[:one].rules.map(&:selector)
+  end
+
+  def test_threshold
+    sheet = Cataract.parse_css('.a { color: red; }')
+    pages = { one: %w[.a], two: %w[.a], three: [] }
+
+    assert_equal 1, sheet.split(pages: pages).shared.size
+    assert_equal 0, sheet.split(pages: pages, shared_threshold: 0.7).shared.size
+    assert_equal 1, sheet.split(pages: pages, shared_threshold: 0.7).pages[:two].size
+  end
+
+  def test_at_rules_and_imports_go_to_shared_chunk
+    sheet = Cataract.parse_css('@charset "utf-8"; @import "base.css" print; ' \
+                               '@font-face { font-family: X; } .a { color: red; }')
+
+    split = sheet.split(pages: { one: %w[.a], two: [] })
+
+    assert_equal %w[@font-face], split.shared.rules.map(&:selector)
+    assert_equal ['base.css'], split.shared.imports.map(&:url)
+    assert_equal :print, split.shared.media_queries[split.shared.imports.first.media_query_id].type
+    assert_equal 'utf-8', split.pages[:one].charset
+  end
+
+  # ============================================================================
+  # Cascade order
+  # ============================================================================
+
+  def test_shared_candidate_after_conflicting_page_rule_stays_in_pages
+    sheet = Cataract.parse_css('.hero { margin-top: 5px; } body { margin: 0; color: black; }')
+
+    split = sheet.split(pages: { home: %w[body .hero], blog: %w[body], about: %w[body] })
+
+    assert_empty split.shared
+    assert_equal %w[.hero body], split.pages[:home].rules.map(&:selector)
+    assert_equal %w[body], split.pages[:blog].rules.map(&:selector)
+  end
+
+  def test_conflicts_follow_shorthand_families
+    sheet = Cataract.parse_css('article { line-height: 2; } p { font: 12px serif; } .x { top: 0; } div { inset: 0; }')
+
+    split = sheet.split(pages: { a: %w[p article .x div], b: %w[p div], c: %w[p div] })
+
+    assert_empty split.shared
+  end
+
+  def test_conflicts_follow_logical_property_families
+    sheet = Cataract.parse_css('.p { width: 100px; } .s { inline-size: 50px; }')
+
+    split = sheet.split(pages: { a: %w[.p .s], b: %w[.s], c: %w[.s] })
+
+    assert_empty split.shared
+    assert_equal %w[.p .s], split.pages[:a].rules.map(&:selector)
+  end
+
+  def test_conflict_only_on_other_pages_still_shares
+    sheet = Cataract.parse_css('.hero { margin: 5px; } body { margin: 0; }')
+
+    split = sheet.split(pages: { home: %w[.hero], blog: %w[body], about: %w[body] })
+
+    assert_equal %w[body], split.shared.rules.map(&:selector)
+  end
+
+  # ============================================================================
+  # Chunks
+  # ============================================================================
+
+  def test_chunks_are_renumbered_copies
+    sheet = Cataract.parse_css('.a, .b { color: red; } .c { margin: 0; } @media print, screen { .a { color: black; } }')
+
+    split = sheet.split(pages: { one: %w[.a .b .c], two: %w[.a .b] })
+    shared = split.shared
+
+    assert_equal [0, 1, 2], shared.rules.map(&:id)
+    assert_equal [[0, 1]], shared.instance_variable_get(:@_selector_lists).values
+    assert_equal ".a, .b { color: red; }\n@media print, screen {\n.a { color: black; }\n}\n", shared.to_s
+    assert_equal [2], shared.media_index[:print]
+    assert_equal [0], split.pages[:one].rules.map(&:id)
+
+    shared.rules[0].declarations[0].value = 'green'
+
+    assert_equal 'red', sheet.rules[0].declarations[0].value
+  end
+
+  def test_nested_rules_travel_with_parent
+    sheet = Cataract.parse_css('@import "x.css"; .p { color: red; &:hover { color: blue; } } .q { margin: 0; }')
+
+    split = sheet.split(pages: { one: %w[.p .q], two: %w[.q], three: %w[.q] })
+    chunk = split.pages[:one]
+
+    assert_equal %w[.p .p:hover], chunk.rules.map(&:selector)
+    assert_equal 0, chunk.rules[1].parent_rule_id
+    assert_equal Cataract.parse_css('.p { color: red; &:hover { color: blue; } }').to_s, chunk.to_s
+    assert_equal %w[.q], split.shared.rules.map(&:selector)
+  end
+
+  def test_invalid_arguments
+    sheet = Cataract.parse_css('.a { color: red; }')
+
+    assert_raises(TypeError) { sheet.split(pages: [%w[.a]]) }
+    assert_raises(ArgumentError) { sheet.split(pages: { a: %w[.a] }, shared_threshold: 2) }
+  end
+end
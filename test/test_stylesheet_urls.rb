@@ -0,0 +1,192 @@
+require_relative 'test_helper'
+
+class TestStylesheetUrls < Minitest::Test
+  # ============================================================================
+  # Stylesheet#urls - url() extraction
+  # ============================================================================
+
+  def test_urls_in_declarations
+    sheet = Cataract.parse_css('.a { color: red; background: url(logo.png) no-repeat; }')
+
+    refs = sheet.urls
+
+    assert_equal 1, refs.length
+    assert_equal 'logo.png', refs[0].url
+    assert_equal sheet.rules[0].id, refs[0].rule_id
+    assert_equal 'background', refs[0].property
+    assert_equal 1, refs[0].declaration_index
+    assert_nil refs[0].block_index
+    refute_predicate refs[0], :import?
+  end
+
+  def test_quoted_and_uppercase_urls
+    sheet = Cataract.parse_css(%(.a { background: url("a.png"), URL( 'b.png' ); }))
+
+    assert_equal %w[a.png b.png], sheet.urls.map(&:url)
+  end
+
+  def test_urls_inside_strings_are_skipped
+    sheet = Cataract.parse_css(%(.a { content: "see url(x.css)"; quotes: 'url(y.css)' "\\" url(z.css)"; background: url(a.png); }))
+
+    assert_equal %w[a.png], sheet.urls.map(&:url)
+  end
+
+  def test_url_must_start_an_identifier
+    sheet = Cataract.parse_css('.a { background: myurl(z.png), -x-url(y.png), url(a.png); }')
+
+    assert_equal %w[a.png], sheet.urls.map(&:url)
+  end
+
+  def test_multiple_urls_in_font_face_src
+    sheet = Cataract.parse_css('@font-face { font-family: X; src: url(x.woff2) format("woff2"), url(x.woff); }')
+
+    refs = sheet.urls
+
+    assert_equal %w[x.woff2 x.woff], refs.map(&:url)
+    assert(refs.all? { |ref| ref.property == 'src' && ref.declaration_index == 1 })
+  end
+
+  def test_urls_in_keyframes_report_block_index
+    sheet = Cataract.parse_css('@keyframes k { from { color: red; } to { background: url(end.png); } }')
+
+    ref = sheet.urls.first
+
+    assert_equal 'end.png', ref.url
+    assert_equal sheet.rules[0].id, ref.rule_id
+    assert_equal 1, ref.block_index
+    assert_equal 0, ref.declaration_index
+  end
+
+  def test_import_urls_listed_first
+    sheet = Cataract.parse_css(%(@import url("base.css") print;\n.a { background: url(a.png); }))
+
+    refs = sheet.urls
+
+    assert_equal %w[base.css a.png], refs.map(&:url)
+    assert_predicate refs[0], :import?
+    assert_equal sheet.imports[0].id, refs[0].rule_id
+    assert_nil refs[0].declaration_index
+  end
+
+  def test_empty_url_is_skipped
+    sheet = Cataract.parse_css('.a { background: url(); }')
+
+    assert_empty sheet.urls
+  end
+
+  def test_no_urls
+    assert_empty Cataract.parse_css('.a { color: red; }').urls
+  end
+
+  # ============================================================================
+  # Stylesheet#map_urls! - Hash-based URL replacement
+  # ============================================================================
+
+  def test_map_urls_returns_self
+    sheet = Cataract.parse_css('.a { background: url(a.png); }')
+
+    assert_same sheet, sheet.map_urls!({ 'a.png' => 'a-1.png' })
+  end
+
+  def test_map_urls_keeps_quoting
+    sheet = Cataract.parse_css(%(.a { background: url(a.png), url('b.png'), url("c.png"); }))
+
+    sheet.map_urls!({ 'a.png' => 'a-1.png', 'b.png' => 'b-1.png', 'c.png' => 'c-1.png' })
+
+    assert_equal %(url(a-1.png), url('b-1.png'), url("c-1.png")), sheet.rules[0].declarations[0].value
+  end
+
+  def test_map_urls_quotes_unquoted_replacement_when_needed
+    sheet = Cataract.parse_css('.a { background: url(a.png); }')
+
+    sheet.map_urls!({ 'a.png' => 'my image.png' })
+
+    assert_equal 'url("my image.png")', sheet.rules[0].declarations[0].value
+  end
+
+  def test_map_urls_escapes_quote_character
+    sheet = Cataract.parse_css(%(.a { background: url('a.png'); }))
+
+    sheet.map_urls!({ 'a.png' => "it's.png" })
+
+    assert_equal %(url('it\\'s.png')), sheet.rules[0].declarations[0].value
+  end
+
+  def test_map_urls_escapes_backslash
+    sheet = Cataract.parse_css(%(.a { background: url(a.png), url('b.png'); }))
+
+    sheet.map_urls!({ 'a.png' => 'back\\slash.png', 'b.png' => 'back\\slash.png' })
+
+    assert_equal %(url("back\\\\slash.png"), url('back\\\\slash.png')), sheet.rules[0].declarations[0].value
+  end
+
+  def test_map_urls_skips_other_functions
+    sheet = Cataract.parse_css('.a { background: myurl(z.png); }')
+
+    sheet.map_urls!({ 'z.png' => 'q.png' })
+
+    assert_equal 'myurl(z.png)', sheet.rules[0].declarations[0].value
+  end
+
+  def test_map_urls_rewrites_font_face_keyframes_and_imports
+    css = <<~CSS
+      @import "base.css";
+      @font-face { font-family: X; src: url(x.woff2) format("woff2"), url(x.woff); }
+      @keyframes k { to { background: url(a.png); } }
+    CSS
+    sheet = Cataract.parse_css(css)
+
+    sheet.map_urls!({ 'base.css' => 'base-1.css', 'x.woff' => 'x-1.woff', 'a.png' => 'a-1.png' })
+
+    assert_equal 'base-1.css', sheet.imports[0].url
+    assert_equal %w[base-1.css x.woff2 x-1.woff a-1.png], sheet.urls.map(&:url)
+  end
+
+  def test_map_urls_leaves_strings_untouched
+    sheet = Cataract.parse_css('.a { content: "see url(x.css)" url(x.css); }')
+
+    sheet.map_urls!({ 'x.css' => 'y.css' })
+
+    assert_equal ".a { content: \"see url(x.css)\" url(y.css); }\n", sheet.to_s
+  end
+
+  def test_map_urls_leaves_unmapped_values_untouched
+    sheet = Cataract.parse_css('.a { background: url(a.png); color: red; }')
+    before = sheet.rules[0].declarations.map(&:value)
+
+    sheet.map_urls!({ 'other.png' => 'x.png', 'a.png' => nil })
+
+    sheet.rules[0].declarations.map(&:value).zip(before).each do |after, original|
+      assert_same original, after
+    end
+  end
+
+  def test_map_urls_ignores_hash_default
+    sheet = Cataract.parse_css('.a { background: url(a.png); }')
+
+    sheet.map_urls!(Hash.new { |_, url| "cdn/#{url}" })
+
+    assert_equal 'url(a.png)', sheet.rules[0].declarations[0].value
+  end
+
+  def test_map_urls_clears_memoized_caches
+    sheet = Cataract.parse_css('.a { background: url(a.png); }')
+    sheet.to_s
+
+    sheet.map_urls!({ 'a.png' => 'a-1.png' })
+
+    assert_equal '.a { background: url(a-1.png); }', sheet.to_s.strip
+  end
+
+  def test_map_urls_non_string_replacement_raises
+    sheet = Cataract.parse_css('.a { background: url(a.png); }')
+
+    assert_raises(TypeError) { sheet.map_urls!({ 'a.png' => 42 }) }
+  end
+
+  def test_map_urls_non_hash_raises
+    sheet = Cataract.parse_css('.a { background: url(a.png); }')
+
+    assert_raises(TypeError) { sheet.map_urls!([%w[a.png b.png]]) }
+  end
+end
@@ -0,0 +1,175 @@
+require_relative 'test_helper'
+
+class TestTokenStream < Minitest::Test
+  def types(css, **options)
+    Cataract::TokenStream.new(css, **options).map(&:first)
+  end
+
+  # ============================================================================
+  # Token types
+  # ============================================================================
+
+  def test_rule_tokens
+    assert_equal %i[hash whitespace left_brace whitespace ident colon whitespace ident semicolon whitespace right_brace],
+                 types('#a { color: red; }')
+  end
+
+  def test_at_keyword_and_function
+    assert_equal %i[at_keyword whitespace left_paren ident colon whitespace dimension right_paren],
+                 types('@media (min-width: 10em)')
+    assert_equal %i[function percentage whitespace delim whitespace dimension right_paren],
+                 types('calc(100% - 2px)')
+  end
+
+  def test_punctuation
+    assert_equal %i[left_square right_square left_paren right_paren left_brace right_brace comma colon semicolon],
+                 types('[](){},:;')
+  end
+
+  def test_cdo_and_cdc
+    assert_equal %i[cdo whitespace cdc], types('<!-- -->')
+  end
+
+  def test_delims
+    assert_equal %i[delim whitespace delim whitespace delim], types('> + ~')
+  end
+
+  def test_unquoted_url_is_single_token
+    assert_equal %i[url], types('url( a.png )')
+  end
+
+  def test_quoted_url_is_function
+    assert_equal %i[function string right_paren], types('url("a.png")')
+  end
+
+  def test_bad_url_and_bad_string
+    assert_equal %i[bad_url], types('url(a b)')
+    assert_equal %i[bad_string whitespace ident], types(%("abc\ndef))
+  end
+
+  def test_custom_property_is_ident
+    assert_equal %i[ident colon whitespace number], types('--gap: 4')
+  end
+
+  def test_comments_skipped_by_default
+    assert_equal %i[ident whitespace whitespace ident], types('a /* note */ b')
+    assert_equal %i[ident whitespace comment whitespace ident], types('a /* note */ b', comments: true)
+  end
+
+  # ============================================================================
+  # Records
+  # ============================================================================
+
+  def test_numeric_records
+    tokens = Cataract::TokenStream.new('1.5em 50% -3 +.5 1e3')
+
+    assert_equal [:dimension, 0, 5, 1.5, 'em'], tokens[0]
+    assert_equal [:percentage, 6, 3, 50, '%'], tokens[2]
+    assert_equal [:number, 10, 2, -3, nil], tokens[4]
+    assert_equal 0.5, tokens.number(6)
+    assert_equal 1000.0, tokens.number(8)
+  end
+
+  def test_integers_stay_integers
+    assert_kind_of Integer, Cataract::TokenStream.new('10px').number(0)
+    assert_kind_of Float, Cataract::TokenStream.new('10.0px').number(0)
+  end
+
+  def test_units_are_frozen_and_shared
+    tokens = Cataract::TokenStream.new('1px 2px')
+
+    assert_predicate tokens.unit(0), :frozen?
+    assert_same tokens.unit(0), tokens.unit(2)
+  end
+
+  def test_offsets_are_byte_offsets
+    css = '.café { color: red }'
+    tokens = Cataract::TokenStream.new(css)
+    _, offset, length = tokens[1]
+
+    assert_equal 'café', css.byteslice(offset, length).force_encoding('UTF-8')
+    assert_equal 'café', tokens.text(1)
+  end
+
+  def test_tokens_cover_source
+    css = "a{b:url(x.png) 'q' /* c */ #f00 1.5E+2px}\r\n"
+    tokens = Cataract::TokenStream.new(css, comments: true)
+
+    assert_equal css.bytesize, tokens.sum { |_, _, length| length }
+    assert_equal css, tokens.size.times.map { |i| tokens.text(i) }.join
+  end
+
+  def test_negative_index_and_out_of_range
+    tokens = Cataract::TokenStream.new('a b')
+
+    assert_equal :ident, tokens.type(-1)
+    assert_raises(IndexError) { tokens[3] }
+  end
+
+  # ============================================================================
+  # Values
+  # ============================================================================
+
+  def test_values_decode_escapes
+    tokens = Cataract::TokenStream.new('@media #f\\30 o "s\\41 t" url(x\\29 y) f\\6fo( -')
+
+    assert_equal 'media', tokens.value(0)
+    assert_equal 'f0o', tokens.value(2)
+    assert_equal 'sAt', tokens.value(4)
+    assert_equal 'x)y', tokens.value(6)
+    assert_equal 'foo', tokens.value(8)
+    assert_equal '-', tokens.value(10)
+  end
+
+  def test_value_nil_for_other_tokens
+    tokens = Cataract::TokenStream.new('1px ;')
+
+    assert_nil tokens.value(0)
+    assert_nil tokens.value(2)
+  end
+
+  def test_string_line_continuation
+    assert_equal 'ab', Cataract::TokenStream.new(%("a\\\nb")).value(0)
+  end
+
+  # ============================================================================
+  # Stream API
+  # ============================================================================
+
+  def test_source_is_frozen_copy
+    css = +'a b'
+    tokens = Cataract::TokenStream.new(css)
+    css << ' c'
+
+    assert_predicate tokens.source, :frozen?
+    assert_equal 'a b', tokens.source
+    assert_equal 3, tokens.size
+  end
+
+  def test_enumerable
+    tokens = Cataract::TokenStream.new('a b')
+
+    assert_equal 3, tokens.length
+    assert_equal 3, tokens.each.size
+    assert_equal %i[ident whitespace ident], tokens.map(&:first)
+    assert_equal '#<Cataract::TokenStream (3 tokens)>', tokens.inspect
+  end
+
+  def test_each_token_matches_stream
+    css = '.a { margin: 0 auto; background: url(a.png) } /* x */'
+    yielded = []
+    result = Cataract.each_token(css, comments: true) { |*token| yielded << token }
+
+    assert_nil result
+    assert_equal Cataract::TokenStream.new(css, comments: true).to_a, yielded
+  end
+
+  def test_each_token_without_block_returns_enumerator
+    assert_equal %i[ident whitespace ident], Cataract.each_token('a b').map { |type, *| type }
+  end
+
+  def test_non_string_raises
+    assert_raises(TypeError) { Cataract::TokenStream.new(nil) }
+    assert_raises(TypeError) { Cataract.each_token(42) { nil } }
+  end
+end